@@ -1,15 +1,106 @@
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
 
 #include "backend.h"
 #include "backend_common.h"
 #include "backend_dump.h"
 
 #include "instruction_encoding.h"
+#include "tree_optimizer.h"
+#include "stack_slots.h"
 #include "elf_ctor.h"
+#include "incremental.h"
+#include "profile.h"
+#include "../debug/time_passes.h"
 
 
 static const char *id_table_file_name = "id_table.txt";
 
+struct RuntimeFunc
+{
+    size_t      operation_code;
+
+    const char *func_name;
+};
+
+static const RuntimeFunc kDoubleRuntimeFuncs[] =
+{
+    {kPrintPos, "пишу_твоей_матери_f64"},
+    {kScanPos,  "скажи_мне_f64"},
+    {kSqrtPos,  "трент_ультует_f64"},
+    {kSinPos,   "углы_вымеряет_f64"},
+    {kCosPos,   "это_все_преломления_f64"},
+};
+
+static const size_t kDoubleRuntimeFuncsCount = sizeof(kDoubleRuntimeFuncs) / sizeof(RuntimeFunc);
+
+static const RuntimeFunc kFastTrigRuntimeFuncs[] =
+{
+    {kSinPos,   "углы_вымеряет_fast"},
+    {kCosPos,   "это_все_преломления_fast"},
+};
+
+static const size_t kFastTrigRuntimeFuncsCount = sizeof(kFastTrigRuntimeFuncs) / sizeof(RuntimeFunc);
+
+// Part of a worker's output that belongs to one function. Addresses, list
+// positions and label identifiers are the worker's own, the merge rebases them.
+struct CompiledFunction
+{
+    TreeNode       *func_node;
+
+    BackendContext *worker_context;
+
+    BackendErrs_t   error;
+
+    int             prev_tail;
+    size_t          instruction_count;
+
+    size_t          begin_address;
+
+    size_t          first_request;
+    size_t          end_request;
+
+    size_t          first_relocation;
+    size_t          end_relocation;
+
+    size_t          first_label;
+    size_t          end_label;
+
+    uint32_t        first_identifier;
+    uint32_t        end_identifier;
+
+    size_t          first_line_row;
+    size_t          end_line_row;
+};
+
+struct CodegenWorker
+{
+    BackendContext   context;
+
+    ParallelCodegen *codegen;
+
+    pthread_t        thread;
+};
+
+struct ParallelCodegen
+{
+    LanguageContext  *language_context;
+
+    CompiledFunction *functions;
+
+    size_t            function_count;
+
+    size_t            next_function;
+
+    size_t            merged_count;
+
+    CodegenWorker    *workers;
+
+    size_t            worker_count;
+};
+
 static BackendErrs_t GetVariablePos(TableOfNames *table,
                                     size_t        var_id_pos,
                                     size_t       *ret_id_pos);
@@ -28,6 +119,32 @@ static BackendErrs_t AsmExternalDeclarations(BackendContext  *backend_context,
                                              LanguageContext *language_context,
                                              TreeNode        *cur_node);
 
+static BackendErrs_t AsmIncrementalFuncDeclaration(BackendContext  *backend_context,
+                                                   LanguageContext *language_context,
+                                                   TreeNode        *cur_node);
+
+static BackendErrs_t AsmCachedFunction(BackendContext       *backend_context,
+                                       LanguageContext      *language_context,
+                                       TreeNode             *cur_node,
+                                       const CachedFunction *cached_function);
+
+static BackendErrs_t CompileFunctionsInParallel(BackendContext  *backend_context,
+                                                LanguageContext *language_context,
+                                                TreeNode        *cur_node,
+                                                ParallelCodegen *codegen);
+
+static void *CodegenWorkerRoutine(void *worker_arg);
+
+static BackendErrs_t DestroyParallelCodegen(ParallelCodegen *codegen);
+
+static BackendErrs_t AsmFunction(BackendContext  *backend_context,
+                                 LanguageContext *language_context,
+                                 TreeNode        *cur_node);
+
+static BackendErrs_t MergeCompiledFunction(BackendContext   *backend_context,
+                                           LanguageContext  *language_context,
+                                           CompiledFunction *function);
+
 static BackendErrs_t AsmFuncDeclaration     (BackendContext  *backend_context,
                                              LanguageContext *language_context,
                                              TreeNode        *cur_node);
@@ -37,6 +154,59 @@ static BackendErrs_t AsmFuncEntry(BackendContext  *backend_context,
                                   TreeNode        *cur_node,
                                   TableOfNames    *cur_table);
 
+static BackendErrs_t AddProfileSymbols(BackendContext  *backend_context,
+                                       LanguageContext *language_context,
+                                       TreeNode        *cur_node);
+
+static BackendErrs_t AsmProfileEntry(BackendContext  *backend_context,
+                                     LanguageContext *language_context,
+                                     int32_t          func_pos);
+
+static BackendErrs_t AsmProfileExit(BackendContext  *backend_context,
+                                    LanguageContext *language_context,
+                                    int32_t          func_pos);
+
+static BackendErrs_t AsmProfileCounterAccess(BackendContext  *backend_context,
+                                             LanguageContext *language_context,
+                                             int32_t          func_pos,
+                                             const char      *symbol_suffix,
+                                             LogicalOpcode_t  logical_opcode,
+                                             Opcode_t         op_code,
+                                             RegisterCode_t   reg,
+                                             size_t           field_offset);
+
+static const BranchSite *GetNextBranchSite(BackendContext *backend_context,
+                                           size_t         *site_pos);
+
+static bool IsColdBranch(const BackendContext *backend_context,
+                         const BranchSite     *site);
+
+static BackendErrs_t AsmBranchCounter(BackendContext  *backend_context,
+                                      LanguageContext *language_context,
+                                      int32_t          func_pos,
+                                      size_t           site_pos,
+                                      size_t           field_offset);
+
+static BackendErrs_t AddColdBlock(BackendContext  *backend_context,
+                                  const ColdBlock *cold_block);
+
+static BackendErrs_t AsmColdBlocks(BackendContext  *backend_context,
+                                   LanguageContext *language_context,
+                                   TableOfNames    *cur_table);
+
+static BackendErrs_t AsmSavePromotedRegisters   (BackendContext *backend_context);
+static BackendErrs_t AsmRestorePromotedRegisters(BackendContext *backend_context);
+
+static RegisterCode_t GetSlotRegister(BackendContext *backend_context,
+                                      size_t          slot);
+
+static BackendErrs_t AsmReadTimestamp(BackendContext *backend_context);
+
+static BackendErrs_t AsmAlignHotCode(BackendContext *backend_context,
+                                     size_t          base_address);
+
+static DisplacementType_t GetProfileSlotDisplacement(BackendContext *backend_context);
+
 static BackendErrs_t AsmLanguageInstructions(BackendContext  *backend_context,
                                              LanguageContext *language_context,
                                              TreeNode        *cur_node,
@@ -57,6 +227,75 @@ static BackendErrs_t AsmFunctionCall        (BackendContext  *backend_context,
                                              TreeNode        *cur_node,
                                              TableOfNames    *cur_table);
 
+static BackendErrs_t AsmTailCall            (BackendContext  *backend_context,
+                                             LanguageContext *language_context,
+                                             TreeNode        *cur_node,
+                                             TableOfNames    *cur_table);
+
+static bool IsTailCall(const TreeNode *return_value);
+
+static bool IsLeafFunction(const TreeNode *cur_node,
+                           size_t          func_pos);
+
+static BackendErrs_t AsmLoadVariable (BackendContext *backend_context,
+                                      size_t          variable_pos);
+
+static BackendErrs_t AsmStoreVariable(BackendContext *backend_context,
+                                      size_t          variable_pos);
+
+static BackendErrs_t AsmLoadDoubleVariable(BackendContext    *backend_context,
+                                           size_t             variable_pos,
+                                           XmmRegisterCode_t  xmm_reg);
+
+static BackendErrs_t AsmLoadDoubleConstant(BackendContext    *backend_context,
+                                           NumType_t          value,
+                                           XmmRegisterCode_t  xmm_reg,
+                                           RegisterCode_t     scratch_reg);
+
+static BackendErrs_t AsmDoubleOperands(BackendContext  *backend_context,
+                                       LanguageContext *language_context,
+                                       TreeNode        *cur_node,
+                                       TableOfNames    *cur_table);
+
+static BackendErrs_t AsmDoubleArithmetic(BackendContext  *backend_context,
+                                         LanguageContext *language_context,
+                                         TreeNode        *cur_node,
+                                         TableOfNames    *cur_table);
+
+static BackendErrs_t AsmDoubleComparison(BackendContext  *backend_context,
+                                         LanguageContext *language_context,
+                                         TreeNode        *cur_node,
+                                         TableOfNames    *cur_table);
+
+static BackendErrs_t AsmResultToRax(BackendContext *backend_context);
+
+static bool IsLogicalOperator(KeyCode_t key_word_code);
+
+static BackendErrs_t AsmRuntimeCall(BackendContext *backend_context,
+                                    size_t          operation_code);
+
+static size_t AsmAlignStackForCall(BackendContext *backend_context);
+
+static BackendErrs_t AsmRestoreStackAfterCall(BackendContext *backend_context,
+                                              size_t          padding);
+
+static const char *GetRuntimeFuncName(BackendContext *backend_context,
+                                      size_t          operation_code);
+
+static BackendErrs_t AsmMulByConstant(BackendContext  *backend_context,
+                                      LanguageContext *language_context,
+                                      int64_t          multiplier);
+
+static BackendErrs_t AsmDivByConstant(BackendContext  *backend_context,
+                                      LanguageContext *language_context,
+                                      int64_t          divisor);
+
+static bool GetSignedDivisionMagic(int64_t  divisor,
+                                   int64_t *magic,
+                                   uint8_t *shift);
+
+static uint8_t GetPowerOfTwo(uint64_t value);
+
 static BackendErrs_t AsmOperator            (BackendContext  *backend_context,
                                              LanguageContext *language_context,
                                              TreeNode        *cur_node,
@@ -104,6 +343,13 @@ static BackendErrs_t AddAddressRequest(AddressRequests *address_requests,
 static BackendErrs_t ReallocAddressRequests(AddressRequests *address_requests,
                                             size_t           new_size);
 
+static BackendErrs_t InitLineTable   (LineTable *line_table);
+static BackendErrs_t DestroyLineTable(LineTable *line_table);
+
+static BackendErrs_t AddLineRow(BackendContext *backend_context,
+                                size_t          address,
+                                size_t          line_number);
+
 static BackendErrs_t SetCallRelativeAddress(Instruction *call_instruction,
                                             uint32_t     address);
 
@@ -115,9 +361,23 @@ static size_t AddString(StringTable *strings,
 static BackendErrs_t ReallocStringTable(StringTable *strings,
                                         size_t       new_size);
 
+static BackendErrs_t ReallocStringIndex(StringTable *strings,
+                                        size_t       new_size);
+
+static size_t *FindStringSlot(StringTable *strings,
+                              const char  *str);
+
+static uint64_t HashString(const char *str);
+
 static BackendErrs_t ReallocSymbolTable(SymbolTable *sym_table,
                                         size_t       new_size);
 
+static BackendErrs_t ReallocSymbolIndex(SymbolTable *sym_table,
+                                        size_t       new_size);
+
+static size_t *FindSymbolSlot(SymbolTable *sym_table,
+                              size_t       string_index);
+
 static BackendErrs_t InitRelocationTable   (RelocationTable *relocation_table);
 static BackendErrs_t DestroyRelocationTable(RelocationTable *relocation_table);
 static BackendErrs_t ReallocRelocationTable(RelocationTable *relocation_table,
@@ -128,11 +388,8 @@ static BackendErrs_t AddRelocation(RelocationTable *relocation_table,
                                    Elf64_Xword      info,
                                    Elf64_Sxword     addend);
 
-static size_t GetStringsCurPos(BackendContext *backend_context);
-
-
-static BackendErrs_t AddLabelString(BackendContext *backend_context,
-                                    int32_t         identification_number);
+static size_t AddLabelString(BackendContext *backend_context,
+                             int32_t         identification_number);
 
 static int32_t FindString(BackendContext *backend_context,
                           const char     *str);
@@ -149,21 +406,39 @@ static int32_t FindSymbol(BackendContext *backend_context,
                           size_t          string_index);
 
 static BackendErrs_t AddFuncCallRelocation(BackendContext *backend_context,
-                                           size_t          operation_code);
+                                           const char     *func_name);
+
+static BackendErrs_t AddSymbolRelocation(BackendContext *backend_context,
+                                         const char     *func_name,
+                                         size_t          offset,
+                                         int64_t         addend);
 
 //==============================================================================
 
 static BackendErrs_t AddFuncCallRelocation(BackendContext *backend_context,
-                                           size_t          operation_code)
+                                           const char     *func_name)
+{
+    return AddSymbolRelocation(backend_context,
+                               func_name,
+                               backend_context->cur_address - sizeof(RelativeAddrType_t),
+                               -0x4);
+}
+
+//==============================================================================
+
+static BackendErrs_t AddSymbolRelocation(BackendContext *backend_context,
+                                         const char     *func_name,
+                                         size_t          offset,
+                                         int64_t         addend)
 {
-    int32_t string_index = FindString(backend_context, NameTable[operation_code].key_word);
+    int32_t string_index = FindString(backend_context, func_name);
 
 
     int32_t symbol_index = 0;
 
     if (string_index < 0)
     {
-        string_index = AddString(backend_context->strings, NameTable[operation_code].key_word);
+        string_index = AddString(backend_context->strings, func_name);
 
         symbol_index = AddSymbol(backend_context->symbol_table,
                                  string_index,
@@ -177,7 +452,7 @@ static BackendErrs_t AddFuncCallRelocation(BackendContext *backend_context,
 
         if (symbol_index < 0)
         {
-            ColorPrintf(kRed, "%s() failed to find symbol index\n");
+            ColorPrintf(kRed, "%s() failed to find symbol index\n", __func__);
 
             return kFailedToFindSymbolIndex;
         }
@@ -185,9 +460,9 @@ static BackendErrs_t AddFuncCallRelocation(BackendContext *backend_context,
 
 
     AddRelocation(backend_context->relocation_table,
-                  backend_context->cur_address - sizeof(RelativeAddrType_t),
+                  offset,
                   ELF64_R_INFO(symbol_index, STT_FUNC),
-                  -0x4);
+                  addend);
 
     return kBackendSuccess;
 }
@@ -197,19 +472,14 @@ static BackendErrs_t AddFuncCallRelocation(BackendContext *backend_context,
 static int32_t FindString(BackendContext *backend_context,
                           const char     *str)
 {
-    int32_t index = 0;
+    size_t *slot = FindStringSlot(backend_context->strings, str);
 
-    for (size_t i = 0; i < backend_context->strings->string_count; i++)
+    if (*slot == kStringIndexEmptySlot)
     {
-        if (strcmp(str, backend_context->strings->string_array[i]) == 0)
-        {
-            return index;
-        }
-
-        index += strlen(backend_context->strings->string_array[i]) + 1;
+        return -1;
     }
 
-    return -1;
+    return (int32_t) *slot;
 }
 
 //==============================================================================
@@ -217,19 +487,38 @@ static int32_t FindString(BackendContext *backend_context,
 static int32_t FindSymbol(BackendContext *backend_context,
                           size_t          string_index)
 {
-    int32_t index = 0;
+    size_t *slot = FindSymbolSlot(backend_context->symbol_table, string_index);
 
-    for (; index < backend_context->symbol_table->sym_count;)
+    if (*slot == kSymbolIndexEmptySlot)
     {
-        if (backend_context->symbol_table->sym_array[index].st_name == string_index)
-        {
-            return index;
-        }
+        return -1;
+    }
+
+    return (int32_t) *slot;
+}
+
+//==============================================================================
+
+// Open addressing over the symbol name offsets. Names are unique in the
+// string table, so the offset identifies the name.
+static size_t *FindSymbolSlot(SymbolTable *sym_table,
+                              size_t       string_index)
+{
+    static const uint64_t kFibonacciMultiplier = 0x9e3779b97f4a7c15;
 
-        index++;
+    size_t mask = sym_table->name_index_capacity - 1;
+
+    uint64_t hash = string_index * kFibonacciMultiplier;
+
+    size_t pos = (hash ^ (hash >> 32)) & mask;
+
+    while (sym_table->name_index[pos] != kSymbolIndexEmptySlot &&
+           sym_table->sym_array[sym_table->name_index[pos]].st_name != string_index)
+    {
+        pos = (pos + 1) & mask;
     }
 
-    return -1;
+    return &sym_table->name_index[pos];
 }
 
 //==============================================================================
@@ -313,6 +602,14 @@ static BackendErrs_t InitSymbolTable(SymbolTable *sym_table)
 
     sym_table->sym_count = 0;
 
+    sym_table->name_index          = nullptr;
+    sym_table->name_index_capacity = 0;
+
+    if (ReallocSymbolIndex(sym_table, kBaseSymbolIndexCapacity) != kBackendSuccess)
+    {
+        return kBackendFailedAllocation;
+    }
+
     AddSymbol(sym_table, 0, 0, 0, 0, 0, 0);
 
     return kBackendSuccess;
@@ -323,8 +620,12 @@ static BackendErrs_t InitSymbolTable(SymbolTable *sym_table)
 static BackendErrs_t DestroySymbolTable(SymbolTable *sym_table)
 {
     free(sym_table->sym_array);
+    free(sym_table->name_index);
 
-    sym_table->sym_array = nullptr;
+    sym_table->sym_array  = nullptr;
+    sym_table->name_index = nullptr;
+
+    sym_table->name_index_capacity = 0;
 
     sym_table->capacity = 0;
 
@@ -357,6 +658,19 @@ static size_t AddSymbol(SymbolTable  *sym_table,
 
     sym_table->sym_count += 1;
 
+    if (sym_table->sym_count * 2 > sym_table->name_index_capacity)
+    {
+        ReallocSymbolIndex(sym_table, sym_table->name_index_capacity * 2);
+    }
+
+    // several symbols may share a name, lookups find the first one
+    size_t *slot = FindSymbolSlot(sym_table, string_table_name);
+
+    if (*slot == kSymbolIndexEmptySlot)
+    {
+        *slot = sym_table->sym_count - 1;
+    }
+
     return sym_table->sym_count - 1;
 }
 
@@ -380,6 +694,43 @@ static BackendErrs_t ReallocSymbolTable(SymbolTable *sym_table,
 
 //==============================================================================
 
+static BackendErrs_t ReallocSymbolIndex(SymbolTable *sym_table,
+                                        size_t       new_size)
+{
+    size_t *new_index = (size_t *) calloc(new_size, sizeof(size_t));
+
+    if (new_index == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kBackendFailedAllocation;
+    }
+
+    free(sym_table->name_index);
+
+    sym_table->name_index          = new_index;
+    sym_table->name_index_capacity = new_size;
+
+    for (size_t i = 0; i < new_size; i++)
+    {
+        sym_table->name_index[i] = kSymbolIndexEmptySlot;
+    }
+
+    for (size_t i = 0; i < sym_table->sym_count; i++)
+    {
+        size_t *slot = FindSymbolSlot(sym_table, sym_table->sym_array[i].st_name);
+
+        if (*slot == kSymbolIndexEmptySlot)
+        {
+            *slot = i;
+        }
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
 static BackendErrs_t InitAddressRequests(AddressRequests *address_requests)
 {
     address_requests->capacity = kBaseCallRequestArraySize;
@@ -433,6 +784,74 @@ BackendErrs_t AddCommonLabelRequest(BackendContext *backend_context,
 
 //==============================================================================
 
+static BackendErrs_t InitLineTable(LineTable *line_table)
+{
+    line_table->capacity  = kBaseLineTableCapacity;
+    line_table->row_count = 0;
+
+    line_table->rows = (LineRow *) calloc(line_table->capacity, sizeof(LineRow));
+
+    if (line_table->rows == nullptr)
+    {
+        return kBackendFailedAllocation;
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t DestroyLineTable(LineTable *line_table)
+{
+    free(line_table->rows);
+
+    line_table->rows      = nullptr;
+    line_table->capacity  = 0;
+    line_table->row_count = 0;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// Rows are kept as they come, the line program drops the redundant ones
+// when it is written, so a function's rows can be moved around as is.
+static BackendErrs_t AddLineRow(BackendContext *backend_context,
+                                size_t          address,
+                                size_t          line_number)
+{
+    if (!backend_context->is_debug_info || line_number == 0)
+    {
+        return kBackendSuccess;
+    }
+
+    LineTable *line_table = backend_context->line_table;
+
+    if (line_table->row_count >= line_table->capacity)
+    {
+        LineRow *new_rows = (LineRow *) realloc(line_table->rows, 2 * line_table->capacity * sizeof(LineRow));
+
+        if (new_rows == nullptr)
+        {
+            ColorPrintf(kRed, "%s() failed reallocation\n", __func__);
+
+            return kBackendFailedAllocation;
+        }
+
+        line_table->rows      = new_rows;
+        line_table->capacity *= 2;
+    }
+
+    line_table->rows[line_table->row_count].address     = (uint32_t) address;
+    line_table->rows[line_table->row_count].line_number = (uint32_t) line_number;
+
+    line_table->row_count++;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
 static BackendErrs_t AddAddressRequest(AddressRequests *address_requests,
                                        size_t           jmp_instruction_list_pos,
                                        int32_t          func_pos,
@@ -559,16 +978,23 @@ static size_t AddLabel(BackendContext  *backend_context,
 
     backend_context->label_table->label_count++;
 
-    size_t label_string_pos = GetStringsCurPos(backend_context);
+    size_t label_string_pos = 0;
 
     size_t label_bind = STB_LOCAL;
 
     if (identification_number != kCommonLabelIdentifierPoison)
     {
-        AddLabelString(backend_context,
-                       identification_number);
-
         DumpPrintCommonLabel(identification_number);
+
+        // jumps to internal labels are resolved by the backend itself,
+        // the symbols are only there for disassemblers and debuggers
+        if (!backend_context->is_keeping_labels)
+        {
+            return backend_context->label_table->label_count - 1;
+        }
+
+        label_string_pos = AddLabelString(backend_context,
+                                          identification_number);
     }
     else if (func_pos != kFuncLabelPosPoison)
     {
@@ -576,13 +1002,13 @@ static size_t AddLabel(BackendContext  *backend_context,
 
         if (func_pos == language_context->tables.main_id_pos)
         {
-            AddString(backend_context->strings, (char *) kAsmMainName);
+            label_string_pos = AddString(backend_context->strings, (char *) kAsmMainName);
 
         }
         else
         {
-            AddString(backend_context->strings,
-                      language_context->identifiers.identifier_array[func_pos].id);
+            label_string_pos = AddString(backend_context->strings,
+                                         language_context->identifiers.identifier_array[func_pos].id);
         }
 
         BackendDumpPrintFuncLabel(language_context, func_pos);
@@ -592,7 +1018,7 @@ static size_t AddLabel(BackendContext  *backend_context,
                                              ELF64_ST_INFO(label_bind, STT_NOTYPE),
                                              STV_DEFAULT,
                                              kSectionTextIndex,
-                                             backend_context->cur_address, 0);
+                                             address, 0);
 
     return backend_context->label_table->label_count - 1;
 }
@@ -603,16 +1029,14 @@ static const size_t kMaxLabelName = 128;
 
 //==============================================================================
 
-static BackendErrs_t AddLabelString(BackendContext *backend_context,
-                                    int32_t         identification_number)
+static size_t AddLabelString(BackendContext *backend_context,
+                             int32_t         identification_number)
 {
-    static char label_string[kMaxLabelName] = {0};
+    char label_string[kMaxLabelName] = {0};
 
     sprintf(label_string, "label_%d", identification_number);
 
-    AddString(backend_context->strings, label_string);
-
-    return kBackendSuccess;
+    return AddString(backend_context->strings, label_string);
 }
 
 //==============================================================================
@@ -634,6 +1058,28 @@ BackendErrs_t BackendContextInit(BackendContext *backend_context)
 {
     CHECK(backend_context);
 
+    backend_context->cur_address        = 0;
+    backend_context->func_body_address  = 0;
+    backend_context->func_begin_address = 0;
+    backend_context->is_frameless       = false;
+    backend_context->is_hot_function    = false;
+    backend_context->is_double_mode     = false;
+    backend_context->is_fast_trig       = false;
+    backend_context->is_keeping_labels  = false;
+    backend_context->is_debug_info      = false;
+    backend_context->is_profiling       = false;
+    backend_context->profile            = nullptr;
+    backend_context->branch_sites       = nullptr;
+    backend_context->branch_site_pos    = 0;
+    backend_context->cold_blocks        = nullptr;
+    backend_context->cold_block_count   = 0;
+    backend_context->cold_block_capacity = 0;
+    backend_context->source_file_name   = nullptr;
+    backend_context->stack_temporaries  = 0;
+    backend_context->incremental_cache  = nullptr;
+    backend_context->jobs_count         = 1;
+    backend_context->parallel_codegen   = nullptr;
+
     backend_context->instruction_list = (List *) calloc(1, sizeof(List));
 
     if (ListConstructor(backend_context->instruction_list) != kListClear)
@@ -676,6 +1122,21 @@ BackendErrs_t BackendContextInit(BackendContext *backend_context)
         return kBackendFailedAllocation;
     }
 
+    backend_context->stack_frame = (StackFrame *) calloc(1, sizeof(StackFrame));
+
+    if (InitStackFrame(backend_context->stack_frame) != kBackendSuccess)
+    {
+        return kBackendFailedAllocation;
+    }
+
+    backend_context->line_table = (LineTable *) calloc(1, sizeof(LineTable));
+
+    if (backend_context->line_table == nullptr ||
+        InitLineTable(backend_context->line_table) != kBackendSuccess)
+    {
+        return kBackendFailedAllocation;
+    }
+
     return kBackendSuccess;
 }
 
@@ -683,15 +1144,16 @@ BackendErrs_t BackendContextInit(BackendContext *backend_context)
 
 static BackendErrs_t InitStringTable(StringTable *strings)
 {
-    strings->capacity = kBaseStringTableCapacity;
-
-    strings->cur_size = 0;
-
-    strings->string_count = 0;
+    strings->capacity       = kBaseStringTableCapacity;
+    strings->cur_size       = 0;
+    strings->string_count   = 0;
+    strings->index_capacity = 0;
+    strings->index          = nullptr;
 
-    strings->string_array = (char **) calloc(strings->capacity, sizeof(char *));
+    strings->pool = (char *) calloc(strings->capacity, sizeof(char));
 
-    if (strings->string_array == nullptr)
+    if (strings->pool == nullptr ||
+        ReallocStringIndex(strings, kBaseStringIndexCapacity) != kBackendSuccess)
     {
         return kBackendFailedAllocation;
     }
@@ -703,22 +1165,50 @@ static BackendErrs_t InitStringTable(StringTable *strings)
 
 //==============================================================================
 
+// Returns the offset of the string in .strtab. A name that is already in
+// the table is not stored again.
 static size_t AddString(StringTable *strings,
                         const char  *str)
 {
-    size_t old_size = strings->cur_size;
+    if ((strings->string_count + 1) * 2 > strings->index_capacity)
+    {
+        ReallocStringIndex(strings, strings->index_capacity * 2);
+    }
+
+    size_t *slot = FindStringSlot(strings, str);
+
+    if (*slot != kStringIndexEmptySlot)
+    {
+        return *slot;
+    }
 
     size_t size = strlen(str) + 1;
 
-    if (strings->string_count >= strings->string_count)
+    if (strings->cur_size + size > strings->capacity)
     {
-        ReallocStringTable(strings, strings->capacity * 2);
+        size_t new_size = strings->capacity * 2;
+
+        while (strings->cur_size + size > new_size)
+        {
+            new_size *= 2;
+        }
+
+        if (ReallocStringTable(strings, new_size) != kBackendSuccess)
+        {
+            return 0;
+        }
     }
 
-    strings->string_array[strings->string_count++] = strdup(str);
+    size_t old_size = strings->cur_size;
+
+    memcpy(strings->pool + old_size, str, size);
+
+    *slot = old_size;
 
     strings->cur_size += size;
 
+    strings->string_count++;
+
     return old_size;
 }
 
@@ -727,51 +1217,127 @@ static size_t AddString(StringTable *strings,
 static BackendErrs_t ReallocStringTable(StringTable *strings,
                                         size_t       new_size)
 {
-    strings->capacity = new_size;
+    char *new_pool = (char *) realloc(strings->pool, new_size * sizeof(char));
 
-    strings->string_array = (char **) realloc(strings->string_array, strings->capacity * sizeof(char *));
-
-    if (strings->string_array == nullptr)
+    if (new_pool == nullptr)
     {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
         return kBackendFailedAllocation;
     }
 
+    strings->pool     = new_pool;
+    strings->capacity = new_size;
+
     return kBackendSuccess;
 }
 
 //==============================================================================
 
-static BackendErrs_t DestroyStringTable(StringTable *strings)
+static BackendErrs_t ReallocStringIndex(StringTable *strings,
+                                        size_t       new_size)
 {
-    for (size_t i = 0; i < strings->string_count; i++)
+    size_t *old_index          = strings->index;
+    size_t  old_index_capacity = strings->index_capacity;
+
+    strings->index = (size_t *) calloc(new_size, sizeof(size_t));
+
+    if (strings->index == nullptr)
     {
-        free(strings->string_array[i]);
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
 
-        strings->string_array[i] = nullptr;
+        strings->index = old_index;
+
+        return kBackendFailedAllocation;
     }
 
-    free(strings->string_array);
+    strings->index_capacity = new_size;
 
-    strings->string_array = nullptr;
+    for (size_t i = 0; i < new_size; i++)
+    {
+        strings->index[i] = kStringIndexEmptySlot;
+    }
+
+    for (size_t i = 0; i < old_index_capacity; i++)
+    {
+        if (old_index[i] != kStringIndexEmptySlot)
+        {
+            *FindStringSlot(strings, strings->pool + old_index[i]) = old_index[i];
+        }
+    }
 
-    strings->capacity = 0;
-    strings->cur_size = 0;
+    free(old_index);
 
     return kBackendSuccess;
 }
 
 //==============================================================================
 
-BackendErrs_t BackendContextDestroy(BackendContext *backend_context)
+// Open addressing with linear probing. Returns the slot holding the string
+// or the empty slot where it should be inserted.
+static size_t *FindStringSlot(StringTable *strings,
+                              const char  *str)
 {
-    CHECK(backend_context);
+    size_t mask = strings->index_capacity - 1;
+    size_t pos  = HashString(str) & mask;
 
-    if (ListDestructor(backend_context->instruction_list) != kListClear)
+    while (strings->index[pos] != kStringIndexEmptySlot &&
+           strcmp(strings->pool + strings->index[pos], str) != 0)
     {
-        return kListDestructorError;
+        pos = (pos + 1) & mask;
     }
 
-    free(backend_context->instruction_list);
+    return &strings->index[pos];
+}
+
+//==============================================================================
+
+static uint64_t HashString(const char *str)
+{
+    static const uint64_t kFnvOffsetBasis = 0xcbf29ce484222325;
+    static const uint64_t kFnvPrime       = 0x100000001b3;
+
+    uint64_t hash = kFnvOffsetBasis;
+
+    for (; *str != '\0'; str++)
+    {
+        hash ^= (uint8_t) *str;
+        hash *= kFnvPrime;
+    }
+
+    return hash;
+}
+
+//==============================================================================
+
+static BackendErrs_t DestroyStringTable(StringTable *strings)
+{
+    free(strings->pool);
+    free(strings->index);
+
+    strings->pool  = nullptr;
+    strings->index = nullptr;
+
+    strings->capacity       = 0;
+    strings->cur_size       = 0;
+    strings->index_capacity = 0;
+    strings->string_count   = 0;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t BackendContextDestroy(BackendContext *backend_context)
+{
+    CHECK(backend_context);
+
+    if (ListDestructor(backend_context->instruction_list) != kListClear)
+    {
+        return kListDestructorError;
+    }
+
+    free(backend_context->instruction_list);
 
     backend_context->instruction_list = nullptr;
 
@@ -811,6 +1377,24 @@ BackendErrs_t BackendContextDestroy(BackendContext *backend_context)
 
     backend_context->relocation_table = nullptr;
 
+    DestroyStackFrame(backend_context->stack_frame);
+
+    free(backend_context->stack_frame);
+
+    backend_context->stack_frame = nullptr;
+
+    DestroyLineTable(backend_context->line_table);
+
+    free(backend_context->line_table);
+
+    backend_context->line_table = nullptr;
+
+    free(backend_context->cold_blocks);
+
+    backend_context->cold_blocks         = nullptr;
+    backend_context->cold_block_count    = 0;
+    backend_context->cold_block_capacity = 0;
+
     return kBackendSuccess;
 }
 
@@ -853,13 +1437,6 @@ static BackendErrs_t GetVariablePos(TableOfNames *table,
     return kCantFindSuchVariable;
 }
 
-static size_t GetStringsCurPos(BackendContext *backend_context)
-{
-    CHECK(backend_context);
-
-    return backend_context->strings->cur_size;
-}
-
 //==============================================================================
 
 static const char *kFileName = "zxczxczxc.dota";
@@ -888,6 +1465,22 @@ BackendErrs_t GetAsmInstructionsOutLanguageContext(BackendContext  *backend_cont
                                              ELF64_ST_INFO(STB_LOCAL, STT_SECTION),
                                              STV_DEFAULT,
                                              kSectionTextIndex, 0, 0);
+
+    // .debug_info refers to the other debug sections by offsets, which
+    // the linker moves when it merges the sections of several objects
+    if (backend_context->is_debug_info)
+    {
+        AddSymbol(backend_context->symbol_table, AddString(backend_context->strings, kSectionDebugAbbrevName),
+                                                 ELF64_ST_INFO(STB_LOCAL, STT_SECTION),
+                                                 STV_DEFAULT,
+                                                 kSectionDebugAbbrevIndex, 0, 0);
+
+        AddSymbol(backend_context->symbol_table, AddString(backend_context->strings, kSectionDebugLineName),
+                                                 ELF64_ST_INFO(STB_LOCAL, STT_SECTION),
+                                                 STV_DEFAULT,
+                                                 kSectionDebugLineIndex, 0, 0);
+    }
+
     if (root == nullptr)
     {
         printf("%s(): null tree\n", __func__);
@@ -895,12 +1488,37 @@ BackendErrs_t GetAsmInstructionsOutLanguageContext(BackendContext  *backend_cont
         return kBackendNullTree;
     }
 
+    if (backend_context->is_profiling)
+    {
+        AddProfileSymbols(backend_context, language_context, root);
+    }
+
     BEGIN_BACKEND_DUMP();
 
+    ParallelCodegen codegen = {};
+
+    BeginPass("emit instructions");
+
+    if (backend_context->jobs_count > 1 &&
+        CompileFunctionsInParallel(backend_context, language_context, root, &codegen) == kBackendSuccess)
+    {
+        backend_context->parallel_codegen = &codegen;
+    }
+
     AsmExternalDeclarations(backend_context, language_context, root);
 
+    EndPass();
+
+    BeginPass("resolve addresses");
+
     RespondAddressRequests(backend_context);
 
+    EndPass();
+
+    backend_context->parallel_codegen = nullptr;
+
+    DestroyParallelCodegen(&codegen);
+
     END_BACKEND_DUMP();
 
     return kBackendSuccess;
@@ -924,7 +1542,23 @@ static BackendErrs_t AsmExternalDeclarations(BackendContext  *backend_context,
         {
             case kFuncDef:
             {
-                AsmFuncDeclaration(backend_context, language_context, cur_decl);
+                // hot functions start aligned, so their loop heads can be
+                // aligned relative to the function start wherever the
+                // code was generated
+                if (GetFunctionTemperature(backend_context->profile,
+                                           GetFunctionName(language_context, cur_decl->data.variable_pos)) == kFunctionHot)
+                {
+                    AsmAlignHotCode(backend_context, 0);
+                }
+
+                if (backend_context->incremental_cache != nullptr)
+                {
+                    AsmIncrementalFuncDeclaration(backend_context, language_context, cur_decl);
+                }
+                else
+                {
+                    AsmFunction(backend_context, language_context, cur_decl);
+                }
 
                 break;
             }
@@ -954,14 +1588,19 @@ static BackendErrs_t AsmExternalDeclarations(BackendContext  *backend_context,
 
 //==============================================================================
 
-static BackendErrs_t AsmFuncDeclaration(BackendContext  *backend_context,
-                                        LanguageContext *language_context,
-                                        TreeNode        *cur_node)
+// Remembers which part of the output belongs to the function, so that it
+// can be saved for the next run, and takes the code from the previous run
+// when the function hasn't changed since then.
+static BackendErrs_t AsmIncrementalFuncDeclaration(BackendContext  *backend_context,
+                                                   LanguageContext *language_context,
+                                                   TreeNode        *cur_node)
 {
     CHECK(backend_context);
     CHECK(language_context);
     CHECK(cur_node);
 
+    IncrementalCache *cache = backend_context->incremental_cache;
+
     int name_table_pos = GetNameTablePos(&language_context->tables,
                                           cur_node->data.variable_pos);
 
@@ -970,696 +1609,2855 @@ static BackendErrs_t AsmFuncDeclaration(BackendContext  *backend_context,
         return kCantFindNameTable;
     }
 
-    AddLabel(backend_context,
-             language_context,
-             backend_context->cur_address,
-             cur_node->data.variable_pos,
-             kCommonLabelIdentifierPoison);
+    FunctionRange range = {};
 
-    TreeNode *params_node = cur_node->right;
+    HashFunction(language_context,
+                 cur_node,
+                 language_context->tables.name_tables[name_table_pos],
+                 range.hash);
 
-    AsmFuncEntry(backend_context,
-                 language_context,
-                 params_node->left,
-                 language_context->tables.name_tables[name_table_pos]);
+    size_t instruction_count = backend_context->instruction_list->elem_count;
 
-    AsmLanguageInstructions(backend_context,
-                            language_context,
-                            params_node->right,
-                            language_context->tables.name_tables[name_table_pos]);
+    range.prev_tail        = backend_context->instruction_list->tail;
+    range.begin_address    = backend_context->cur_address;
+    range.first_request    = backend_context->address_requests->request_count;
+    range.first_relocation = backend_context->relocation_table->relocation_count;
+    range.first_label      = backend_context->label_table->label_count;
+    range.first_line_row   = backend_context->line_table->row_count;
 
-    return kBackendSuccess;;
+    const CachedFunction *cached_function = FindCachedFunction(cache, range.hash);
+
+    BackendErrs_t error = kBackendSuccess;
+
+    if (cached_function != nullptr)
+    {
+        error = AsmCachedFunction(backend_context, language_context, cur_node, cached_function);
+
+        cache->reused_count++;
+    }
+    else
+    {
+        error = AsmFunction(backend_context, language_context, cur_node);
+
+        cache->compiled_count++;
+    }
+
+    range.instruction_count = backend_context->instruction_list->elem_count - instruction_count;
+    range.end_address       = backend_context->cur_address;
+    range.end_request       = backend_context->address_requests->request_count;
+    range.end_relocation    = backend_context->relocation_table->relocation_count;
+    range.end_label         = backend_context->label_table->label_count;
+    range.end_line_row      = backend_context->line_table->row_count;
+
+    AddFunctionRange(cache, &range);
+
+    return error;
 }
 
 //==============================================================================
 
-#define PUSH_REGISTER(reg)                                                 EncodePushRegister(backend_context, reg)
-
-#define RET()                                                              EncodeRet(backend_context)
-#define LEAVE()                                                            EncodeLeave(backend_context)
-#define POP_IN_REGISTER(reg)                                               EncodePopInRegister(backend_context, reg)
+static BackendErrs_t AsmCachedFunction(BackendContext       *backend_context,
+                                       LanguageContext      *language_context,
+                                       TreeNode             *cur_node,
+                                       const CachedFunction *cached_function)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(cur_node);
+    CHECK(cached_function);
 
-#define MOV_IMM_TO_REGISTER(imm, reg)                                      EncodeMovImmediateToRegister(backend_context, imm, reg)
-#define MOV_REGISTER_TO_REGISTER(source_reg, dest_reg)                     EncodeMovRegisterToRegister(backend_context, source_reg, dest_reg)
-#define MOV_REGISTER_TO_REG_MEMORY(source_reg, receiver_reg, displacement) EncodeMovRegisterToRegisterMemory(backend_context, source_reg, receiver_reg, displacement)
-#define MOV_REG_MEMORY_TO_REGISTER(source_reg, displacement, receiver_reg) EncodeMovRegisterMemoryToRegister(backend_context, receiver_reg, source_reg, displacement)
+    size_t begin_address = backend_context->cur_address;
 
-#define ADD_IMM_TO_REGISTER(imm, receiver_reg)                             EncodeAddImmediateToRegister(backend_context, imm, receiver_reg)
-#define ADD_REGISTER_TO_REGISTER(source_reg, receiver_reg)                 EncodeAddRegisterToRegister(backend_context, source_reg, receiver_reg)
+    AddLabel(backend_context,
+             language_context,
+             begin_address,
+             cur_node->data.variable_pos,
+             kCommonLabelIdentifierPoison);
 
-#define SUB_REGISTER_FROM_REGISTER(source_reg, receiver_reg)               EncodeSubRegisterFromRegister(backend_context, source_reg, receiver_reg)
-#define SUB_IMMEDIATE_FROM_REGISTER(immediate, receiver_reg)               EncodeSubImmediateFromRegister(backend_context, receiver_reg, immediate)
+    size_t call_pos = 0;
 
-#define DIV_REGISTER(reg)                                                  EncodeDivRegister(backend_context, reg)
+    for (size_t i = 0; i < cached_function->instruction_count; i++)
+    {
+        Instruction instruction = {};
 
-#define XOR_REGISTER_WITH_REGISTER(source_reg, receiver_reg)               EncodeXorRegisterWithRegister(backend_context, source_reg, receiver_reg)
+        memcpy(&instruction, cached_function->instructions + i * sizeof(Instruction), sizeof(Instruction));
 
-#define IMUL_ON_REGISTER(receiver_reg)                                     EncodeImulRegister(backend_context, receiver_reg)
+        size_t offset = instruction.begin_address;
 
-#define CMP_REGISTER_TO_IMMEDIATE(dest_reg, immediate)                     EncodeCmpRegisterWithImmediate(backend_context, dest_reg, immediate)
-#define CMP_REGISTER_TO_REGISTER(dest_reg, source_reg)                     EncodeCmpRegisterWithRegister(backend_context, dest_reg, source_reg)
+        instruction.begin_address += begin_address;
 
+        ListAddAfter(backend_context->instruction_list,
+                     backend_context->instruction_list->tail,
+                     &instruction);
 
-#define JUMP_IF_ABOVE(label_id)                                            EncodeJump(backend_context, kLogicJumpIfAbove,        kJaRel32 , label_id)
-#define JUMP_IF_ABOVE_OR_EQUAL(label_id)                                   EncodeJump(backend_context, kLogicJumpIfAboveOrEqual, kJaeRel32, label_id)
+        backend_context->cur_address += instruction.instruction_size;
 
-#define JUMP_IF_LESS_OR_EQUAL(label_id)                                    EncodeJump(backend_context, kLogicJumpIfLessOrEqual,  kJleRel32, label_id)
-#define JUMP_IF_LESS(label_id)                                             EncodeJump(backend_context, kLogicJumpIfLess,         kJlRel32,  label_id)
+        // jumps inside the function are still valid, calls to other
+        // functions are resolved again once the layout is known
+        while (call_pos < cached_function->call_count && cached_function->calls[call_pos].offset == offset)
+        {
+            AddFuncLabelRequest(backend_context,
+                                backend_context->instruction_list->tail,
+                                FindFunctionPos(backend_context->incremental_cache,
+                                                cached_function->calls[call_pos].callee_name));
+            call_pos++;
+        }
+    }
 
-#define JUMP_IF_BELOW_OR_EQUAL(label_id)                                   EncodeJump(backend_context, kLogicJumpIfBelowOrEqual, kJbeRel32, label_id)
-#define JUMP_IF_BELOW(label_id)                                            EncodeJump(backend_context, kLogicJumpIfBelow,        kJbRel32,  label_id)
+    if (backend_context->cur_address - begin_address != cached_function->code_size)
+    {
+        ColorPrintf(kRed, "%s() inconsistent sizes\n", __func__);
 
-#define JUMP_IF_EQUAL(label_id)                                            EncodeJump(backend_context, kLogicJumpIfEqual,        kJeRel32,  label_id)
-#define JUMP_IF_NOT_EQUAL(label_id)                                        EncodeJump(backend_context, kLogicJumpIfNotEqual,     kJneRel32, label_id)
+        return kBackendInconsistentSizes;
+    }
 
-#define JUMP(label_id)                                                     EncodeJump(backend_context, kLogicJmp,                kJmpRel32, label_id)
+    for (size_t i = 0; i < cached_function->relocation_count; i++)
+    {
+        AddSymbolRelocation(backend_context,
+                            cached_function->relocations[i].symbol_name,
+                            begin_address + cached_function->relocations[i].offset,
+                            cached_function->relocations[i].addend);
+    }
 
+    for (size_t i = 0; i < cached_function->label_count; i++)
+    {
+        AddLabel(backend_context,
+                 language_context,
+                 begin_address + cached_function->label_offsets[i],
+                 kFuncLabelPosPoison,
+                 AddLabelIdentifier(backend_context));
+    }
 
-#define CALL(func_pos)                                                     EncodeCall(backend_context, language_context, func_pos)
+    for (size_t i = 0; i < cached_function->line_row_count; i++)
+    {
+        AddLineRow(backend_context,
+                   begin_address + cached_function->line_rows[i].address,
+                   cached_function->line_rows[i].line_number);
+    }
 
-#define AND(dest_reg, source_reg)                                          EncodeRegisterAndRegister(backend_context, dest_reg, source_reg);
+    return kBackendSuccess;
+}
 
-#define OR(dest_reg, source_reg)                                           EncodeRegisterOrRegister(backend_context, dest_reg, source_reg)
 //==============================================================================
 
-static BackendErrs_t AsmLanguageInstructions(BackendContext  *backend_context,
-                                             LanguageContext *language_context,
-                                             TreeNode        *cur_node,
-                                             TableOfNames    *cur_table)
+// Functions share nothing while they are compiled: jumps inside a function
+// are patched right away and calls only leave a request. So each worker
+// compiles functions into a private context, and AsmExternalDeclarations
+// later merges the results in declaration order.
+static BackendErrs_t CompileFunctionsInParallel(BackendContext  *backend_context,
+                                                LanguageContext *language_context,
+                                                TreeNode        *cur_node,
+                                                ParallelCodegen *codegen)
 {
-
     CHECK(backend_context);
     CHECK(language_context);
-    CHECK(cur_node);
-    CHECK(cur_table);
+    CHECK(codegen);
 
-    while (cur_node != nullptr)
+    codegen->language_context = language_context;
+
+    size_t decl_count = 0;
+
+    for (TreeNode *decl_node = cur_node; decl_node != nullptr; decl_node = decl_node->right)
     {
-        TreeNode *instruction_node = cur_node->left;
+        decl_count++;
+    }
 
-        switch(instruction_node->type)
-        {
-            case kOperator:
-            {
-                 AsmOperator(backend_context,
-                             language_context,
-                             instruction_node,
-                             cur_table);
-                break;
-            }
+    codegen->functions = (CompiledFunction *) calloc(decl_count + 1, sizeof(CompiledFunction));
 
-            case kCall:
-            {
-                AsmFunctionCall(backend_context,
-                                language_context,
-                                instruction_node,
-                                cur_table);
-                break;
-            }
+    if (codegen->functions == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
 
-            case kVarDecl:
-            {
-                AsmVariableDeclaration(backend_context,
-                                       language_context,
-                                       instruction_node,
-                                       cur_table);
-                break;
-            }
+        return kBackendFailedAllocation;
+    }
 
-            default:
-            {
-                ColorPrintf(kRed, "%s() unknown node type - %d\n", __func__, instruction_node->type);
+    for (; cur_node != nullptr; cur_node = cur_node->right)
+    {
+        TreeNode *cur_decl = cur_node->left;
 
-                return kBackendUnknownNodeType;
+        if (cur_decl->type != kFuncDef)
+        {
+            continue;
+        }
 
-                break;
+        // unchanged functions are taken from the incremental state instead
+        if (backend_context->incremental_cache != nullptr)
+        {
+            int name_table_pos = GetNameTablePos(&language_context->tables,
+                                                  cur_decl->data.variable_pos);
+
+            uint8_t hash[kSha256DigestSize] = {};
+
+            if (name_table_pos >= 0 &&
+                HashFunction(language_context,
+                             cur_decl,
+                             language_context->tables.name_tables[name_table_pos],
+                             hash) == kBackendSuccess &&
+                FindCachedFunction(backend_context->incremental_cache, hash) != nullptr)
+            {
+                continue;
             }
         }
 
-        cur_node = cur_node->right;
+        codegen->functions[codegen->function_count++].func_node = cur_decl;
     }
 
-    return kBackendSuccess;
-}
-
-static BackendErrs_t AsmVariableDeclaration(BackendContext  *backend_context,
-                                            LanguageContext *language_context,
-                                            TreeNode        *cur_node,
-                                            TableOfNames    *cur_table)
-{
-    CHECK(backend_context);
-    CHECK(language_context);
-    CHECK(cur_node);
-    CHECK(cur_table);
-
-    if (cur_node->type != kVarDecl)
+    if (codegen->function_count == 0)
     {
-        return kBackendNotVarDecl;
+        return kBackendSuccess;
     }
 
-    TreeNode *assign_node = cur_node->right;
+    size_t worker_count = backend_context->jobs_count < codegen->function_count ?
+                          backend_context->jobs_count : codegen->function_count;
 
-    if (assign_node->type               != kOperator ||
-        assign_node->data.key_word_code != kAssign)
+    codegen->workers = (CodegenWorker *) calloc(worker_count, sizeof(CodegenWorker));
+
+    if (codegen->workers == nullptr)
     {
-        return kBackendNotAssign;
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kBackendFailedAllocation;
     }
 
-    AsmOperator(backend_context, language_context, assign_node->left, cur_table);
+    // the workers share one queue of functions, so the ones that did start
+    // are enough to compile everything
+    while (codegen->worker_count < worker_count)
+    {
+        CodegenWorker *worker = &codegen->workers[codegen->worker_count];
 
-    size_t variable_pos = 0;
+        worker->codegen = codegen;
 
-    if (GetVariablePos(cur_table, assign_node->right->data.variable_pos, &variable_pos) != kBackendSuccess)
-    {
-        ColorPrintf(kRed, "%s() cant find variable in current name table\n", __func__);
+        if (BackendContextInit(&worker->context) != kBackendSuccess)
+        {
+            break;
+        }
 
-        return kCantFindVariable;
+        worker->context.is_double_mode    = backend_context->is_double_mode;
+        worker->context.is_fast_trig      = backend_context->is_fast_trig;
+        worker->context.is_keeping_labels = backend_context->is_keeping_labels;
+        worker->context.is_debug_info     = backend_context->is_debug_info;
+        worker->context.is_profiling      = backend_context->is_profiling;
+        worker->context.profile           = backend_context->profile;
+        worker->context.branch_sites      = backend_context->branch_sites;
+
+        if (pthread_create(&worker->thread, nullptr, CodegenWorkerRoutine, worker) != 0)
+        {
+            BackendContextDestroy(&worker->context);
+
+            break;
+        }
+
+        codegen->worker_count++;
+    }
+
+    for (size_t i = 0; i < codegen->worker_count; i++)
+    {
+        pthread_join(codegen->workers[i].thread, nullptr);
     }
 
-    MOV_REGISTER_TO_REG_MEMORY(kRAX, kRBP, - (variable_pos + 1) * 8 );
+    if (codegen->worker_count == 0)
+    {
+        ColorPrintf(kRed, "%s() failed to start worker threads\n", __func__);
+
+        return kBackendThreadError;
+    }
 
     return kBackendSuccess;
 }
 
 //==============================================================================
 
-static int32_t AddLabelIdentifier(BackendContext *backend_context)
+static void *CodegenWorkerRoutine(void *worker_arg)
 {
-    int32_t label_identifier = backend_context->label_table->identify_counter++;
+    CodegenWorker   *worker  = (CodegenWorker *) worker_arg;
+    ParallelCodegen *codegen = worker->codegen;
+    BackendContext  *context = &worker->context;
 
-    return label_identifier;
+    size_t function_index = __atomic_fetch_add(&codegen->next_function, 1, __ATOMIC_RELAXED);
+
+    while (function_index < codegen->function_count)
+    {
+        CompiledFunction *function = &codegen->functions[function_index];
+
+        size_t instruction_count = context->instruction_list->elem_count;
+
+        function->worker_context   = context;
+        function->prev_tail        = context->instruction_list->tail;
+        function->begin_address    = context->cur_address;
+        function->first_request    = context->address_requests->request_count;
+        function->first_relocation = context->relocation_table->relocation_count;
+        function->first_label      = context->label_table->label_count;
+        function->first_identifier = context->label_table->identify_counter;
+        function->first_line_row   = context->line_table->row_count;
+
+        function->error = AsmFuncDeclaration(context, codegen->language_context, function->func_node);
+
+        function->instruction_count = context->instruction_list->elem_count - instruction_count;
+        function->end_request       = context->address_requests->request_count;
+        function->end_relocation    = context->relocation_table->relocation_count;
+        function->end_label         = context->label_table->label_count;
+        function->end_identifier    = context->label_table->identify_counter;
+        function->end_line_row      = context->line_table->row_count;
+
+        function_index = __atomic_fetch_add(&codegen->next_function, 1, __ATOMIC_RELAXED);
+    }
+
+    return nullptr;
 }
 
 //==============================================================================
 
-#define ASM_OPERATOR(node) AsmOperator(backend_context, language_context, node, cur_table)
+static BackendErrs_t DestroyParallelCodegen(ParallelCodegen *codegen)
+{
+    CHECK(codegen);
+
+    for (size_t i = 0; i < codegen->worker_count; i++)
+    {
+        BackendContextDestroy(&codegen->workers[i].context);
+    }
+
+    free(codegen->workers);
+    free(codegen->functions);
+
+    codegen->workers        = nullptr;
+    codegen->functions      = nullptr;
+    codegen->worker_count   = 0;
+    codegen->function_count = 0;
+
+    return kBackendSuccess;
+}
 
 //==============================================================================
 
-static BackendErrs_t AsmOperator(BackendContext  *backend_context,
+static BackendErrs_t AsmFunction(BackendContext  *backend_context,
                                  LanguageContext *language_context,
-                                 TreeNode        *cur_node,
-                                 TableOfNames    *cur_table)
+                                 TreeNode        *cur_node)
 {
     CHECK(backend_context);
     CHECK(language_context);
-    CHECK(cur_table);
+    CHECK(cur_node);
 
-    if (cur_node == nullptr)
-    {
-        return kBackendNullTree;
-    }
-    else if (cur_node->type == kCall)
+    ParallelCodegen *codegen = backend_context->parallel_codegen;
+
+    if (codegen != nullptr &&
+        codegen->merged_count < codegen->function_count &&
+        codegen->functions[codegen->merged_count].func_node == cur_node)
     {
-        AsmFunctionCall(backend_context, language_context, cur_node, cur_table);
+        return MergeCompiledFunction(backend_context,
+                                     language_context,
+                                     &codegen->functions[codegen->merged_count++]);
     }
-    else if (cur_node->type == kConstNumber)
+
+    return AsmFuncDeclaration(backend_context, language_context, cur_node);
+}
+
+//==============================================================================
+
+// Appends the function as if it was compiled right here: instructions and
+// relocations are moved to the current address, calls are requested again
+// and labels get the identifiers the sequential build would have given them.
+static BackendErrs_t MergeCompiledFunction(BackendContext   *backend_context,
+                                           LanguageContext  *language_context,
+                                           CompiledFunction *function)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(function);
+
+    BackendContext  *worker_context = function->worker_context;
+    List            *worker_list    = worker_context->instruction_list;
+    AddressRequests *requests       = worker_context->address_requests;
+
+    size_t begin_address = backend_context->cur_address;
+
+    AddLabel(backend_context,
+             language_context,
+             begin_address,
+             function->func_node->data.variable_pos,
+             kCommonLabelIdentifierPoison);
+
+    size_t request_pos = function->first_request;
+
+    int instruction_pos = worker_list->next[function->prev_tail];
+
+    for (size_t i = 0; i < function->instruction_count; i++)
     {
-        MOV_IMM_TO_REGISTER(cur_node->data.const_val, kRAX);
+        Instruction instruction = worker_list->data[instruction_pos];
+
+        instruction.begin_address = instruction.begin_address - function->begin_address + begin_address;
+
+        ListAddAfter(backend_context->instruction_list,
+                     backend_context->instruction_list->tail,
+                     &instruction);
+
+        backend_context->cur_address += instruction.instruction_size;
+
+        while (request_pos < function->end_request &&
+               requests->requests[request_pos].jmp_instruction_list_pos == (size_t) instruction_pos)
+        {
+            AddFuncLabelRequest(backend_context,
+                                backend_context->instruction_list->tail,
+                                requests->requests[request_pos].func_pos);
+            request_pos++;
+        }
+
+        instruction_pos = worker_list->next[instruction_pos];
     }
-    else if (cur_node->type == kVarDecl)
+
+    for (size_t i = function->first_relocation; i < function->end_relocation; i++)
     {
-        AsmVariableDeclaration (backend_context, language_context, cur_node, cur_table);
+        Elf64_Rela *relocation = &worker_context->relocation_table->relocation_array[i];
+
+        Elf64_Sym  *symbol     = &worker_context->symbol_table->sym_array[ELF64_R_SYM(relocation->r_info)];
+
+        AddSymbolRelocation(backend_context,
+                            GetStringByIndex(worker_context->strings, symbol->st_name),
+                            relocation->r_offset - function->begin_address + begin_address,
+                            relocation->r_addend);
     }
-    else if (cur_node->type == kIdentifier)
+
+    uint32_t identifier_base = backend_context->label_table->identify_counter;
+
+    for (size_t i = function->first_label; i < function->end_label; i++)
     {
-        size_t variable_pos = 0;
+        Label *label = &worker_context->label_table->label_array[i];
 
-        if (GetVariablePos(cur_table, cur_node->data.variable_pos, &variable_pos) != kBackendSuccess)
+        if (label->func_pos != kFuncLabelPosPoison)
         {
-            ColorPrintf(kRed, "%s() failed to find variable. CUR_NODE_PTR - %p\n", __func__, cur_node);
+            continue;
         }
 
-        MOV_REG_MEMORY_TO_REGISTER(kRBP, - (variable_pos + 1) * 8, kRAX);
+        AddLabel(backend_context,
+                 language_context,
+                 label->address - function->begin_address + begin_address,
+                 kFuncLabelPosPoison,
+                 label->identification_number - function->first_identifier + identifier_base);
     }
-    else
+
+    backend_context->label_table->identify_counter += function->end_identifier - function->first_identifier;
+
+    for (size_t i = function->first_line_row; i < function->end_line_row; i++)
     {
-        switch(cur_node->data.key_word_code)
-        {
-            case kEndOfLine:
-            {
-                ASM_OPERATOR(cur_node->left);
+        LineRow *row = &worker_context->line_table->rows[i];
 
-                break;
-            }
+        AddLineRow(backend_context, row->address - function->begin_address + begin_address, row->line_number);
+    }
 
-            case kReturn:
-            {
-                ASM_OPERATOR(cur_node->right);
+    return function->error;
+}
 
-                LEAVE();
+//==============================================================================
 
-                RET();
+static BackendErrs_t AsmFuncDeclaration(BackendContext  *backend_context,
+                                        LanguageContext *language_context,
+                                        TreeNode        *cur_node)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(cur_node);
 
-                break;
-            }
+    int name_table_pos = GetNameTablePos(&language_context->tables,
+                                          cur_node->data.variable_pos);
 
-            case kAdd:
-            {
-                ASM_OPERATOR(cur_node->right);
+    if (name_table_pos < 0)
+    {
+        return kCantFindNameTable;
+    }
 
-                PUSH_REGISTER(kRAX);
+    AddLabel(backend_context,
+             language_context,
+             backend_context->cur_address,
+             cur_node->data.variable_pos,
+             kCommonLabelIdentifierPoison);
 
-                ASM_OPERATOR(cur_node->left);
+    AddLineRow(backend_context, backend_context->cur_address, cur_node->line_number);
 
-                POP_IN_REGISTER(kR11);
+    backend_context->func_begin_address = backend_context->cur_address;
 
-                ADD_REGISTER_TO_REGISTER(kR11, kRAX);
+    backend_context->is_hot_function = GetFunctionTemperature(backend_context->profile,
+                                                              GetFunctionName(language_context,
+                                                                              cur_node->data.variable_pos)) == kFunctionHot;
 
-                break;
-            }
+    const BranchSites *branch_sites = backend_context->branch_sites;
 
-            case kSub:
-            {
-                ASM_OPERATOR(cur_node->right);
+    if (branch_sites != nullptr && cur_node->data.variable_pos < branch_sites->identifier_count)
+    {
+        backend_context->branch_site_pos = branch_sites->first_sites[cur_node->data.variable_pos];
+    }
 
-                PUSH_REGISTER(kRAX);
+    backend_context->cold_block_count = 0;
 
-                ASM_OPERATOR(cur_node->left);
+    TreeNode *params_node = cur_node->right;
 
-                POP_IN_REGISTER(kR11);
+    AllocateStackSlots(backend_context->stack_frame,
+                       params_node,
+                       language_context->tables.name_tables[name_table_pos]);
 
-                SUB_REGISTER_FROM_REGISTER(kR11, kRAX);
+    backend_context->is_frameless = !backend_context->is_profiling &&
+                                    backend_context->stack_frame->slot_count <= kLeafVariableRegisterCount &&
+                                    IsLeafFunction(params_node->right, cur_node->data.variable_pos);
 
-                break;
-            }
+    // leaf functions already keep everything in registers
+    if (!backend_context->is_frameless && backend_context->profile != nullptr && branch_sites != nullptr)
+    {
+        const FunctionProfile *function = FindFunctionProfile(backend_context->profile,
+                                                              GetFunctionName(language_context,
+                                                                              cur_node->data.variable_pos));
+        if (function != nullptr)
+        {
+            PromoteHotSlots(backend_context->stack_frame,
+                            params_node,
+                            language_context->tables.name_tables[name_table_pos],
+                            branch_sites->sites + backend_context->branch_site_pos,
+                            function->calls);
+        }
+    }
 
-            case kDiv:
-            {
-                ASM_OPERATOR(cur_node->right);
+    // profiled functions keep the start timestamp in a slot of their own
+    if (backend_context->is_profiling)
+    {
+        backend_context->stack_frame->slot_count++;
+    }
 
-                PUSH_REGISTER(kRAX);
+    AsmFuncEntry(backend_context,
+                 language_context,
+                 params_node->left,
+                 language_context->tables.name_tables[name_table_pos]);
 
-                ASM_OPERATOR(cur_node->left);
+    AsmLanguageInstructions(backend_context,
+                            language_context,
+                            params_node->right,
+                            language_context->tables.name_tables[name_table_pos]);
 
-                POP_IN_REGISTER(kR11);
+    AsmColdBlocks(backend_context,
+                  language_context,
+                  language_context->tables.name_tables[name_table_pos]);
 
-                XOR_REGISTER_WITH_REGISTER(kRDX, kRDX);
+    return kBackendSuccess;;
+}
 
-                DIV_REGISTER(kR11);
+//==============================================================================
 
-                break;
-            }
+#define PUSH_REGISTER(reg)                                                 EncodePushRegister(backend_context, reg)
 
-            case kMult:
-            {
-                ASM_OPERATOR(cur_node->right);
+#define RET()                                                              EncodeRet(backend_context)
+#define LEAVE()                                                            EncodeLeave(backend_context)
+#define POP_IN_REGISTER(reg)                                               EncodePopInRegister(backend_context, reg)
 
-                PUSH_REGISTER(kRAX);
+#define MOV_IMM_TO_REGISTER(imm, reg)                                      EncodeMovImmediateToRegister(backend_context, imm, reg)
+#define MOV_REGISTER_TO_REGISTER(source_reg, dest_reg)                     EncodeMovRegisterToRegister(backend_context, source_reg, dest_reg)
+#define MOV_REGISTER_TO_REG_MEMORY(source_reg, receiver_reg, displacement) EncodeMovRegisterToRegisterMemory(backend_context, source_reg, receiver_reg, displacement)
+#define MOV_REG_MEMORY_TO_REGISTER(source_reg, displacement, receiver_reg) EncodeMovRegisterMemoryToRegister(backend_context, receiver_reg, source_reg, displacement)
 
-                ASM_OPERATOR(cur_node->left);
+#define ADD_IMM_TO_REGISTER(imm, receiver_reg)                             EncodeAddImmediateToRegister(backend_context, imm, receiver_reg)
+#define ADD_REGISTER_TO_REGISTER(source_reg, receiver_reg)                 EncodeAddRegisterToRegister(backend_context, source_reg, receiver_reg)
 
-                POP_IN_REGISTER(kR11);
+#define SUB_REGISTER_FROM_REGISTER(source_reg, receiver_reg)               EncodeSubRegisterFromRegister(backend_context, source_reg, receiver_reg)
+#define SUB_IMMEDIATE_FROM_REGISTER(immediate, receiver_reg)               EncodeSubImmediateFromRegister(backend_context, receiver_reg, immediate)
 
-                IMUL_ON_REGISTER(kR11);
+#define DIV_REGISTER(reg)                                                  EncodeDivRegister(backend_context, reg)
 
-                break;
-            }
+#define XOR_REGISTER_WITH_REGISTER(source_reg, receiver_reg)               EncodeXorRegisterWithRegister(backend_context, source_reg, receiver_reg)
 
-            case kAssign:
-            {
-                ASM_OPERATOR(cur_node->left);
+#define IMUL_ON_REGISTER(receiver_reg)                                     EncodeImulRegister(backend_context, receiver_reg)
+#define IMUL_REGISTER_BY_IMMEDIATE(source_reg, immediate, receiver_reg)    EncodeImulRegisterByImmediate(backend_context, receiver_reg, source_reg, immediate)
 
-                size_t variable_pos = 0;
+#define SHL_REGISTER(receiver_reg, shift)                                  EncodeShiftRegisterByImmediate(backend_context, kLogicShlRegisterByImmediate, receiver_reg, shift)
+#define SHR_REGISTER(receiver_reg, shift)                                  EncodeShiftRegisterByImmediate(backend_context, kLogicShrRegisterByImmediate, receiver_reg, shift)
+#define SAR_REGISTER(receiver_reg, shift)                                  EncodeShiftRegisterByImmediate(backend_context, kLogicSarRegisterByImmediate, receiver_reg, shift)
 
-                if (GetVariablePos(cur_table, cur_node->right->data.variable_pos, &variable_pos) != kBackendSuccess)
-                {
-                    ColorPrintf(kRed, "%s() cant find variable in current name table. CUR_NODE_PTR - %p\n", __func__, cur_node);
+#define LEA_SCALED_INDEX(base_reg, index_reg, scale, receiver_reg)         EncodeLeaScaledIndex(backend_context, receiver_reg, base_reg, index_reg, scale)
 
-                    return kCantFindVariable;
-                }
+#define NEG_REGISTER(receiver_reg)                                         EncodeNegRegister(backend_context, receiver_reg)
 
-                MOV_REGISTER_TO_REG_MEMORY(kRAX, kRBP, - (variable_pos + 1) * 8 );
+#define CQO()                                                              EncodeCqo(backend_context)
 
-                break;
-            }
+#define MOVSD_MEMORY_TO_XMM(base_reg, displacement, xmm_reg)               EncodeMovsdXmmFromMemory(backend_context, xmm_reg, base_reg, displacement)
+#define MOVSD_XMM_TO_MEMORY(xmm_reg, base_reg, displacement)               EncodeMovsdMemoryFromXmm(backend_context, base_reg, displacement, xmm_reg)
+#define MOVSD_XMM_TO_XMM(source_xmm, receiver_xmm)                         EncodeScalarDoubleOperation(backend_context, kLogicMovsdXmmToXmm, kMovsdXmmFromRm, receiver_xmm, source_xmm)
 
-            case kWhile:
-            {
-                int32_t cycle_body_label_id = AddLabelIdentifier(backend_context);
-                int32_t test_start_label_id = AddLabelIdentifier(backend_context);
-                int32_t test_end_label_id   = AddLabelIdentifier(backend_context);
+#define MOVQ_REGISTER_TO_XMM(source_reg, receiver_xmm)                     EncodeMovqRegisterToXmm(backend_context, source_reg, receiver_xmm)
+#define MOVQ_XMM_TO_REGISTER(source_xmm, receiver_reg)                     EncodeMovqXmmToRegister(backend_context, source_xmm, receiver_reg)
 
-                JUMP(test_start_label_id);
+#define ADDSD(source_xmm, receiver_xmm)                                    EncodeScalarDoubleOperation(backend_context, kLogicAddsd, kAddsd, receiver_xmm, source_xmm)
+#define SUBSD(source_xmm, receiver_xmm)                                    EncodeScalarDoubleOperation(backend_context, kLogicSubsd, kSubsd, receiver_xmm, source_xmm)
+#define MULSD(source_xmm, receiver_xmm)                                    EncodeScalarDoubleOperation(backend_context, kLogicMulsd, kMulsd, receiver_xmm, source_xmm)
+#define DIVSD(source_xmm, receiver_xmm)                                    EncodeScalarDoubleOperation(backend_context, kLogicDivsd, kDivsd, receiver_xmm, source_xmm)
 
-                int32_t jump_on_test_list_pos = backend_context->instruction_list->tail;
+#define UCOMISD(lhs_xmm, rhs_xmm)                                          EncodeUcomisd(backend_context, lhs_xmm, rhs_xmm)
+#define CVTTSD2SI(source_xmm, receiver_reg)                                EncodeCvttsd2si(backend_context, source_xmm, receiver_reg)
+#define CVTSI2SD(source_reg, receiver_xmm)                                 EncodeCvtsi2sd(backend_context, source_reg, receiver_xmm)
 
-                int32_t cycle_body_label_table_pos = AddLabel(backend_context,
-                                                              language_context,
-                                                              backend_context->cur_address,
-                                                              kFuncLabelPosPoison,
-                                                              cycle_body_label_id);
+#define SQRTSD(source_xmm, receiver_xmm)                                   EncodeScalarDoubleOperation(backend_context, kLogicSqrtsd, kSqrtsd, receiver_xmm, source_xmm)
+#define ROUNDSD(source_xmm, receiver_xmm, mode)                            EncodeRoundsd(backend_context, receiver_xmm, source_xmm, mode)
 
-                TreeNode *instruction_node = cur_node->right;
+#define CMP_REGISTER_TO_IMMEDIATE(dest_reg, immediate)                     EncodeCmpRegisterWithImmediate(backend_context, dest_reg, immediate)
+#define CMP_REGISTER_TO_REGISTER(dest_reg, source_reg)                     EncodeCmpRegisterWithRegister(backend_context, dest_reg, source_reg)
 
-                while (instruction_node != nullptr)
-                {
-                    ASM_OPERATOR(instruction_node->left);
 
-                    instruction_node = instruction_node->right;
-                }
+#define JUMP_IF_ABOVE(label_id)                                            EncodeJump(backend_context, kLogicJumpIfAbove,        kJaRel32 , label_id)
+#define JUMP_IF_ABOVE_OR_EQUAL(label_id)                                   EncodeJump(backend_context, kLogicJumpIfAboveOrEqual, kJaeRel32, label_id)
 
-                int32_t test_start_label_table_pos = AddLabel(backend_context,
-                                                              language_context,
-                                                              backend_context->cur_address,
-                                                              kFuncLabelPosPoison,
-                                                              test_start_label_id);
+#define JUMP_IF_GREATER(label_id)                                          EncodeJump(backend_context, kLogicJumpIfGreater,        kJgRel32 , label_id)
+#define JUMP_IF_GREATER_OR_EQUAL(label_id)                                 EncodeJump(backend_context, kLogicJumpIfGreaterOrEqual, kJgeRel32, label_id)
 
-                SetJumpRelativeAddress(&backend_context->instruction_list->data[jump_on_test_list_pos],
-                                       backend_context->label_table->label_array[test_start_label_table_pos].address);
+#define JUMP_IF_LESS_OR_EQUAL(label_id)                                    EncodeJump(backend_context, kLogicJumpIfLessOrEqual,  kJleRel32, label_id)
+#define JUMP_IF_LESS(label_id)                                             EncodeJump(backend_context, kLogicJumpIfLess,         kJlRel32,  label_id)
 
-                ASM_OPERATOR(cur_node->left);
+#define JUMP_IF_BELOW_OR_EQUAL(label_id)                                   EncodeJump(backend_context, kLogicJumpIfBelowOrEqual, kJbeRel32, label_id)
+#define JUMP_IF_BELOW(label_id)                                            EncodeJump(backend_context, kLogicJumpIfBelow,        kJbRel32,  label_id)
 
-                CMP_REGISTER_TO_IMMEDIATE(kRAX, 0);
+#define JUMP_IF_EQUAL(label_id)                                            EncodeJump(backend_context, kLogicJumpIfEqual,        kJeRel32,  label_id)
+#define JUMP_IF_NOT_EQUAL(label_id)                                        EncodeJump(backend_context, kLogicJumpIfNotEqual,     kJneRel32, label_id)
 
-                JUMP_IF_ABOVE(cycle_body_label_id);
+#define JUMP(label_id)                                                     EncodeJump(backend_context, kLogicJmp,                kJmpRel32, label_id)
 
-                int32_t jump_on_cycle_list_pos = backend_context->instruction_list->tail;
 
-                SetJumpRelativeAddress(&backend_context->instruction_list->data[jump_on_cycle_list_pos],
-                                       backend_context->label_table->label_array[cycle_body_label_table_pos].address);
-                break;
-            }
+#define CALL(func_pos)                                                     EncodeCall(backend_context, language_context, func_pos)
+#define JUMP_TO_FUNC(func_pos)                                             EncodeFuncJump(backend_context, language_context, func_pos)
 
-            case kIf:
-            {
-                ASM_OPERATOR(cur_node->left);
+#define AND(dest_reg, source_reg)                                          EncodeRegisterAndRegister(backend_context, dest_reg, source_reg);
 
-                CMP_REGISTER_TO_IMMEDIATE(kRAX, 0);
+#define OR(dest_reg, source_reg)                                           EncodeRegisterOrRegister(backend_context, dest_reg, source_reg)
+//==============================================================================
 
-                int32_t end_label_id = AddLabelIdentifier(backend_context);
+static BackendErrs_t AsmLanguageInstructions(BackendContext  *backend_context,
+                                             LanguageContext *language_context,
+                                             TreeNode        *cur_node,
+                                             TableOfNames    *cur_table)
+{
 
-                JUMP_IF_LESS_OR_EQUAL(end_label_id);
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(cur_node);
+    CHECK(cur_table);
 
-                int32_t jump_on_end_list_pos = backend_context->instruction_list->tail;
+    while (cur_node != nullptr)
+    {
+        TreeNode *instruction_node = cur_node->left;
 
-                TreeNode *instruction_node = cur_node->right;
+        AddLineRow(backend_context, backend_context->cur_address, instruction_node->line_number);
 
-                while (instruction_node != nullptr)
+        switch(instruction_node->type)
+        {
+            case kOperator:
+            {
+                 AsmOperator(backend_context,
+                             language_context,
+                             instruction_node,
+                             cur_table);
+                break;
+            }
+
+            case kCall:
+            {
+                AsmFunctionCall(backend_context,
+                                language_context,
+                                instruction_node,
+                                cur_table);
+                break;
+            }
+
+            case kVarDecl:
+            {
+                AsmVariableDeclaration(backend_context,
+                                       language_context,
+                                       instruction_node,
+                                       cur_table);
+                break;
+            }
+
+            default:
+            {
+                ColorPrintf(kRed, "%s() unknown node type - %d\n", __func__, instruction_node->type);
+
+                return kBackendUnknownNodeType;
+
+                break;
+            }
+        }
+
+        cur_node = cur_node->right;
+    }
+
+    return kBackendSuccess;
+}
+
+static BackendErrs_t AsmVariableDeclaration(BackendContext  *backend_context,
+                                            LanguageContext *language_context,
+                                            TreeNode        *cur_node,
+                                            TableOfNames    *cur_table)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(cur_node);
+    CHECK(cur_table);
+
+    if (cur_node->type != kVarDecl)
+    {
+        return kBackendNotVarDecl;
+    }
+
+    TreeNode *assign_node = cur_node->right;
+
+    if (assign_node->type               != kOperator ||
+        assign_node->data.key_word_code != kAssign)
+    {
+        return kBackendNotAssign;
+    }
+
+    AsmOperator(backend_context, language_context, assign_node->left, cur_table);
+
+    size_t variable_pos = 0;
+
+    if (GetVariablePos(cur_table, assign_node->right->data.variable_pos, &variable_pos) != kBackendSuccess)
+    {
+        ColorPrintf(kRed, "%s() cant find variable in current name table\n", __func__);
+
+        return kCantFindVariable;
+    }
+
+    AsmStoreVariable(backend_context, variable_pos);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static int32_t AddLabelIdentifier(BackendContext *backend_context)
+{
+    int32_t label_identifier = backend_context->label_table->identify_counter++;
+
+    return label_identifier;
+}
+
+//==============================================================================
+
+#define ASM_OPERATOR(node) AsmOperator(backend_context, language_context, node, cur_table)
+
+//==============================================================================
+
+static BackendErrs_t AsmOperator(BackendContext  *backend_context,
+                                 LanguageContext *language_context,
+                                 TreeNode        *cur_node,
+                                 TableOfNames    *cur_table)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(cur_table);
+
+    if (cur_node == nullptr)
+    {
+        return kBackendNullTree;
+    }
+    else if (cur_node->type == kCall)
+    {
+        AsmFunctionCall(backend_context, language_context, cur_node, cur_table);
+    }
+    else if (cur_node->type == kConstNumber)
+    {
+        if (backend_context->is_double_mode)
+        {
+            AsmLoadDoubleConstant(backend_context, cur_node->data.const_val, kXMM0, kRAX);
+        }
+        else
+        {
+            MOV_IMM_TO_REGISTER(cur_node->data.const_val, kRAX);
+        }
+    }
+    else if (cur_node->type == kVarDecl)
+    {
+        AsmVariableDeclaration (backend_context, language_context, cur_node, cur_table);
+    }
+    else if (cur_node->type == kIdentifier)
+    {
+        size_t variable_pos = 0;
+
+        if (GetVariablePos(cur_table, cur_node->data.variable_pos, &variable_pos) != kBackendSuccess)
+        {
+            ColorPrintf(kRed, "%s() failed to find variable. CUR_NODE_PTR - %p\n", __func__, cur_node);
+        }
+
+        AsmLoadVariable(backend_context, variable_pos);
+    }
+    else if (backend_context->is_double_mode && IsLogicalOperator(cur_node->data.key_word_code))
+    {
+        AsmDoubleComparison(backend_context, language_context, cur_node, cur_table);
+    }
+    else
+    {
+        switch(cur_node->data.key_word_code)
+        {
+            case kEndOfLine:
+            {
+                ASM_OPERATOR(cur_node->left);
+
+                break;
+            }
+
+            case kReturn:
+            {
+                if (IsTailCall(cur_node->right))
                 {
-                    ASM_OPERATOR(instruction_node->left);
+                    AsmTailCall(backend_context, language_context, cur_node->right, cur_table);
+
+                    break;
+                }
+
+                ASM_OPERATOR(cur_node->right);
+
+                if (backend_context->is_double_mode &&
+                    cur_table->func_code == (int) language_context->tables.main_id_pos)
+                {
+                    CVTTSD2SI(kXMM0, kRAX);
+                }
+
+                if (backend_context->is_profiling)
+                {
+                    AsmProfileExit(backend_context, language_context, cur_table->func_code);
+                }
+
+                if (!backend_context->is_frameless)
+                {
+                    AsmRestorePromotedRegisters(backend_context);
+
+                    LEAVE();
+                }
+
+                RET();
+
+                break;
+            }
+
+            case kAdd:
+            {
+                if (backend_context->is_double_mode)
+                {
+                    AsmDoubleArithmetic(backend_context, language_context, cur_node, cur_table);
+
+                    break;
+                }
+
+                ASM_OPERATOR(cur_node->right);
+
+                PUSH_REGISTER(kRAX);
+
+                ASM_OPERATOR(cur_node->left);
+
+                POP_IN_REGISTER(kR11);
+
+                ADD_REGISTER_TO_REGISTER(kR11, kRAX);
+
+                break;
+            }
+
+            case kSub:
+            {
+                if (backend_context->is_double_mode)
+                {
+                    AsmDoubleArithmetic(backend_context, language_context, cur_node, cur_table);
+
+                    break;
+                }
+
+                ASM_OPERATOR(cur_node->right);
+
+                PUSH_REGISTER(kRAX);
+
+                ASM_OPERATOR(cur_node->left);
+
+                POP_IN_REGISTER(kR11);
+
+                SUB_REGISTER_FROM_REGISTER(kR11, kRAX);
+
+                break;
+            }
+
+            case kDiv:
+            {
+                if (backend_context->is_double_mode)
+                {
+                    AsmDoubleArithmetic(backend_context, language_context, cur_node, cur_table);
+
+                    break;
+                }
+
+                int64_t divisor = 0;
+
+                if (EvalConstantExpression(cur_node->right, &divisor) && divisor != 0)
+                {
+                    ASM_OPERATOR(cur_node->left);
+
+                    AsmDivByConstant(backend_context, language_context, divisor);
+
+                    break;
+                }
+
+                ASM_OPERATOR(cur_node->right);
+
+                PUSH_REGISTER(kRAX);
+
+                ASM_OPERATOR(cur_node->left);
+
+                POP_IN_REGISTER(kR11);
+
+                CQO();
+
+                DIV_REGISTER(kR11);
+
+                break;
+            }
+
+            case kMult:
+            {
+                if (backend_context->is_double_mode)
+                {
+                    AsmDoubleArithmetic(backend_context, language_context, cur_node, cur_table);
+
+                    break;
+                }
+
+                int64_t multiplier = 0;
+
+                if (EvalConstantExpression(cur_node->right, &multiplier))
+                {
+                    ASM_OPERATOR(cur_node->left);
+
+                    AsmMulByConstant(backend_context, language_context, multiplier);
+
+                    break;
+                }
+
+                if (EvalConstantExpression(cur_node->left, &multiplier))
+                {
+                    ASM_OPERATOR(cur_node->right);
+
+                    AsmMulByConstant(backend_context, language_context, multiplier);
+
+                    break;
+                }
+
+                ASM_OPERATOR(cur_node->right);
+
+                PUSH_REGISTER(kRAX);
+
+                ASM_OPERATOR(cur_node->left);
+
+                POP_IN_REGISTER(kR11);
+
+                IMUL_ON_REGISTER(kR11);
+
+                break;
+            }
+
+            case kAssign:
+            {
+                ASM_OPERATOR(cur_node->left);
+
+                size_t variable_pos = 0;
+
+                if (GetVariablePos(cur_table, cur_node->right->data.variable_pos, &variable_pos) != kBackendSuccess)
+                {
+                    ColorPrintf(kRed, "%s() cant find variable in current name table. CUR_NODE_PTR - %p\n", __func__, cur_node);
+
+                    return kCantFindVariable;
+                }
+
+                AsmStoreVariable(backend_context, variable_pos);
+
+                break;
+            }
+
+            case kWhile:
+            {
+                size_t site_pos = 0;
+
+                const BranchSite *site = GetNextBranchSite(backend_context, &site_pos);
+
+                // a loop is reached once per entry, its body once per iteration
+                if (site != nullptr && backend_context->is_profiling)
+                {
+                    AsmBranchCounter(backend_context, language_context, cur_table->func_code,
+                                     site_pos, kProfileExecutionsOffset);
+                }
+
+                int32_t cycle_body_label_id = AddLabelIdentifier(backend_context);
+                int32_t test_start_label_id = AddLabelIdentifier(backend_context);
+                int32_t test_end_label_id   = AddLabelIdentifier(backend_context);
+
+                JUMP(test_start_label_id);
+
+                int32_t jump_on_test_list_pos = backend_context->instruction_list->tail;
+
+                // the padding sits right after the jump and never runs
+                if (backend_context->is_hot_function)
+                {
+                    AsmAlignHotCode(backend_context, backend_context->func_begin_address);
+                }
+
+                int32_t cycle_body_label_table_pos = AddLabel(backend_context,
+                                                              language_context,
+                                                              backend_context->cur_address,
+                                                              kFuncLabelPosPoison,
+                                                              cycle_body_label_id);
+
+                if (site != nullptr && backend_context->is_profiling)
+                {
+                    AsmBranchCounter(backend_context, language_context, cur_table->func_code,
+                                     site_pos, kProfileTakenOffset);
+                }
+
+                TreeNode *instruction_node = cur_node->right;
+
+                while (instruction_node != nullptr)
+                {
+                    ASM_OPERATOR(instruction_node->left);
+
+                    instruction_node = instruction_node->right;
+                }
+
+                int32_t test_start_label_table_pos = AddLabel(backend_context,
+                                                              language_context,
+                                                              backend_context->cur_address,
+                                                              kFuncLabelPosPoison,
+                                                              test_start_label_id);
+
+                SetJumpRelativeAddress(&backend_context->instruction_list->data[jump_on_test_list_pos],
+                                       backend_context->label_table->label_array[test_start_label_table_pos].address);
+
+                ASM_OPERATOR(cur_node->left);
+
+                AsmResultToRax(backend_context);
+
+                CMP_REGISTER_TO_IMMEDIATE(kRAX, 0);
+
+                JUMP_IF_ABOVE(cycle_body_label_id);
+
+                int32_t jump_on_cycle_list_pos = backend_context->instruction_list->tail;
+
+                SetJumpRelativeAddress(&backend_context->instruction_list->data[jump_on_cycle_list_pos],
+                                       backend_context->label_table->label_array[cycle_body_label_table_pos].address);
+                break;
+            }
+
+            case kIf:
+            {
+                size_t site_pos = 0;
+
+                const BranchSite *site = GetNextBranchSite(backend_context, &site_pos);
+
+                // inc changes the flags, so it goes before the test
+                if (site != nullptr && backend_context->is_profiling)
+                {
+                    AsmBranchCounter(backend_context, language_context, cur_table->func_code,
+                                     site_pos, kProfileExecutionsOffset);
+                }
+
+                ASM_OPERATOR(cur_node->left);
+
+                AsmResultToRax(backend_context);
+
+                CMP_REGISTER_TO_IMMEDIATE(kRAX, 0);
+
+                // a rarely taken body goes after the function, so the usual
+                // path falls through without a taken jump
+                if (IsColdBranch(backend_context, site))
+                {
+                    ColdBlock cold_block = {};
+
+                    cold_block.body         = cur_node->right;
+                    cold_block.label_id     = AddLabelIdentifier(backend_context);
+                    cold_block.end_label_id = AddLabelIdentifier(backend_context);
+                    cold_block.site_pos     = site_pos;
+                    cold_block.line         = cur_node->line_number;
+
+                    JUMP_IF_GREATER(cold_block.label_id);
+
+                    cold_block.jump_list_pos = backend_context->instruction_list->tail;
+                    cold_block.end_address   = backend_context->cur_address;
+
+                    AddLabel(backend_context,
+                             language_context,
+                             backend_context->cur_address,
+                             kFuncLabelPosPoison,
+                             cold_block.end_label_id);
+
+                    AddColdBlock(backend_context, &cold_block);
+
+                    backend_context->branch_site_pos += CountBranchSites(cur_node->right);
+
+                    break;
+                }
+
+                int32_t end_label_id = AddLabelIdentifier(backend_context);
+
+                JUMP_IF_LESS_OR_EQUAL(end_label_id);
+
+                int32_t jump_on_end_list_pos = backend_context->instruction_list->tail;
+
+                if (site != nullptr && backend_context->is_profiling)
+                {
+                    AsmBranchCounter(backend_context, language_context, cur_table->func_code,
+                                     site_pos, kProfileTakenOffset);
+                }
+
+                TreeNode *instruction_node = cur_node->right;
+
+                while (instruction_node != nullptr)
+                {
+                    ASM_OPERATOR(instruction_node->left);
+
+                    instruction_node = instruction_node->right;
+                }
+
+                int32_t end_label_table_pos = AddLabel(backend_context,
+                                                       language_context,
+                                                       backend_context->cur_address,
+                                                       kFuncLabelPosPoison,
+                                                       end_label_id);
+
+                SetJumpRelativeAddress(&backend_context->instruction_list->data[jump_on_end_list_pos],
+                                        backend_context->label_table->label_array[end_label_table_pos].address);
+                break;
+            }
+
+            case kScan:
+            {
+                AsmRuntimeCall(backend_context, kScanPos);
+
+                break;
+            }
+
+            case kAbort:
+            {
+                AsmRuntimeCall(backend_context, kAbortPos);
+
+                break;
+            }
+
+            case kPrint:
+            {
+                ASM_OPERATOR(cur_node->right);
+
+                AsmRuntimeCall(backend_context, kPrintPos);
+
+                break;
+            }
+
+            case kCos:
+            {
+                ASM_OPERATOR(cur_node->right);
+
+                AsmRuntimeCall(backend_context, kCosPos);
+
+                break;
+            }
+
+            case kSin:
+            {
+                ASM_OPERATOR(cur_node->right);
+
+                AsmRuntimeCall(backend_context, kSinPos);
+
+                break;
+            }
+
+            case kSqrt:
+            {
+                ASM_OPERATOR(cur_node->right);
+
+                if (backend_context->is_double_mode)
+                {
+                    SQRTSD(kXMM0, kXMM0);
+
+                    break;
+                }
+
+                // same result as the runtime's (int64_t) sqrt(value)
+                CVTSI2SD(kRAX, kXMM0);
+
+                SQRTSD(kXMM0, kXMM0);
+
+                CVTTSD2SI(kXMM0, kRAX);
+
+                break;
+            }
+
+            case kFloor:
+            {
+                ASM_OPERATOR(cur_node->right);
+
+                // integers are their own floor
+                if (backend_context->is_double_mode)
+                {
+                    ROUNDSD(kXMM0, kXMM0, kRoundDown);
+                }
+
+                break;
+            }
+
+#define LOGICAL_OPERATOR_CODE_GEN(const_name, JumpInstruction, code)                                            \
+            case const_name:                                                                                    \
+            {                                                                                                   \
+                ASM_OPERATOR(cur_node->right);                                                                  \
+                                                                                                                \
+                PUSH_REGISTER(kRAX);                                                                            \
+                                                                                                                \
+                ASM_OPERATOR(cur_node->left);                                                                   \
+                                                                                                                \
+                POP_IN_REGISTER(kR11);                                                                          \
+                                                                                                                \
+                code                                                                                            \
+                                                                                                                \
+                int32_t start_label_id = AddLabelIdentifier(backend_context);                                   \
+                int32_t end_label_id   = AddLabelIdentifier(backend_context);                                   \
+                                                                                                                \
+                JumpInstruction(start_label_id);                                                                \
+                                                                                                                \
+                int32_t jump_on_start_list_pos = backend_context->instruction_list->tail;                       \
+                                                                                                                \
+                MOV_IMM_TO_REGISTER(0, kRAX);                                                                   \
+                                                                                                                \
+                JUMP(end_label_id);                                                                             \
+                                                                                                                \
+                int32_t jump_on_end_list_pos = backend_context->instruction_list->tail;                         \
+                                                                                                                \
+                size_t start_label_pos = AddLabel(backend_context,                                              \
+                                                  language_context,                                             \
+                                                  backend_context->cur_address,                                 \
+                                                  kFuncLabelPosPoison,                                          \
+                                                  start_label_id);                                              \
+                MOV_IMM_TO_REGISTER(1, kRAX);                                                                   \
+                                                                                                                \
+                size_t end_label_pos = AddLabel(backend_context,                                                \
+                                                language_context,                                               \
+                                                backend_context->cur_address,                                   \
+                                                kFuncLabelPosPoison,                                            \
+                                                end_label_id);                                                  \
+                                                                                                                \
+                SetJumpRelativeAddress(&backend_context->instruction_list->data[jump_on_start_list_pos],        \
+                                        backend_context->label_table->label_array[start_label_pos].address);    \
+                                                                                                                \
+                SetJumpRelativeAddress(&backend_context->instruction_list->data[jump_on_end_list_pos],          \
+                                        backend_context->label_table->label_array[end_label_pos].address);      \
+                                                                                                                \
+                break;                                                                                          \
+            }
+
+            #include "logical_operators_code.gen.h"
+
+            default:
+            {
+                ColorPrintf(kRed, "%s() unknown operator. Node pointer - %p\n", __func__, cur_node);
+
+                return kBackendUnknownNodeType;
+
+                break;
+            }
+        }
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmFunctionCall(BackendContext  *backend_context,
+                                     LanguageContext *language_context,
+                                     TreeNode        *cur_node,
+                                     TableOfNames    *cur_table)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(cur_node);
+    CHECK(cur_table);
+
+    PassFuncArgs(backend_context, language_context, cur_node->left, cur_table);
+
+    size_t padding = AsmAlignStackForCall(backend_context);
+
+    CALL(cur_node->right->data.variable_pos);
+
+    AsmRestoreStackAfterCall(backend_context, padding);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static bool IsTailCall(const TreeNode *return_value)
+{
+    if (return_value == nullptr || return_value->type != kCall)
+    {
+        return false;
+    }
+
+    size_t args_count = 0;
+
+    for (const TreeNode *cur_arg = return_value->left; cur_arg != nullptr; cur_arg = cur_arg->right)
+    {
+        if (cur_arg->left != nullptr)
+        {
+            args_count++;
+        }
+    }
+
+    return args_count <= kArgPassingRegisterCount;
+}
+
+//==============================================================================
+
+static bool IsLeafFunction(const TreeNode *cur_node,
+                           size_t          func_pos)
+{
+    if (cur_node == nullptr)
+    {
+        return true;
+    }
+
+    if (cur_node->type == kCall)
+    {
+        return false;
+    }
+
+    if (cur_node->type == kOperator)
+    {
+        switch (cur_node->data.key_word_code)
+        {
+            case kReturn:
+            {
+                const TreeNode *value = cur_node->right;
+
+                if (IsTailCall(value) && value->right->data.variable_pos == func_pos)
+                {
+                    return IsLeafFunction(value->left, func_pos);
+                }
+
+                break;
+            }
+
+            case kScan:
+            case kPrint:
+            case kSin:
+            case kCos:
+            case kAbort:
+            {
+                return false;
+            }
+
+            default:
+            {
+                break;
+            }
+        }
+    }
+
+    return IsLeafFunction(cur_node->left,  func_pos) &&
+           IsLeafFunction(cur_node->right, func_pos);
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmLoadVariable(BackendContext *backend_context,
+                                     size_t          variable_pos)
+{
+    CHECK(backend_context);
+
+    if (backend_context->is_double_mode)
+    {
+        return AsmLoadDoubleVariable(backend_context, variable_pos, kXMM0);
+    }
+
+    size_t slot = backend_context->stack_frame->variable_slots[variable_pos];
+
+    RegisterCode_t slot_register = GetSlotRegister(backend_context, slot);
+
+    if (slot_register != kNotRegister)
+    {
+        MOV_REGISTER_TO_REGISTER(slot_register, kRAX);
+
+        return kBackendSuccess;
+    }
+
+    MOV_REG_MEMORY_TO_REGISTER(kRBP, - (slot + 1) * kSizeOfArg, kRAX);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmStoreVariable(BackendContext *backend_context,
+                                      size_t          variable_pos)
+{
+    CHECK(backend_context);
+
+    size_t slot = backend_context->stack_frame->variable_slots[variable_pos];
+
+    RegisterCode_t slot_register = GetSlotRegister(backend_context, slot);
+
+    if (backend_context->is_double_mode)
+    {
+        if (slot_register != kNotRegister)
+        {
+            MOVQ_XMM_TO_REGISTER(kXMM0, slot_register);
+        }
+        else
+        {
+            MOVSD_XMM_TO_MEMORY(kXMM0, kRBP, - (slot + 1) * kSizeOfArg);
+        }
+
+        return kBackendSuccess;
+    }
+
+    if (slot_register != kNotRegister)
+    {
+        MOV_REGISTER_TO_REGISTER(kRAX, slot_register);
+
+        return kBackendSuccess;
+    }
+
+    MOV_REGISTER_TO_REG_MEMORY(kRAX, kRBP, - (slot + 1) * kSizeOfArg);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmLoadDoubleVariable(BackendContext    *backend_context,
+                                           size_t             variable_pos,
+                                           XmmRegisterCode_t  xmm_reg)
+{
+    CHECK(backend_context);
+
+    size_t slot = backend_context->stack_frame->variable_slots[variable_pos];
+
+    RegisterCode_t slot_register = GetSlotRegister(backend_context, slot);
+
+    if (slot_register != kNotRegister)
+    {
+        MOVQ_REGISTER_TO_XMM(slot_register, xmm_reg);
+
+        return kBackendSuccess;
+    }
+
+    MOVSD_MEMORY_TO_XMM(kRBP, - (slot + 1) * kSizeOfArg, xmm_reg);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static RegisterCode_t GetSlotRegister(BackendContext *backend_context,
+                                      size_t          slot)
+{
+    if (backend_context->is_frameless)
+    {
+        return LeafVariableRegisters[slot];
+    }
+
+    return backend_context->stack_frame->slot_registers[slot];
+}
+
+//==============================================================================
+
+// A variable moved to a callee-saved register no longer needs its slot,
+// so the slot keeps the caller's value of the register until the function
+// leaves
+static BackendErrs_t AsmSavePromotedRegisters(BackendContext *backend_context)
+{
+    CHECK(backend_context);
+
+    StackFrame *stack_frame = backend_context->stack_frame;
+
+    for (size_t slot = 0; slot < stack_frame->slot_count && stack_frame->promoted_count > 0; slot++)
+    {
+        if (stack_frame->slot_registers[slot] != kNotRegister)
+        {
+            MOV_REGISTER_TO_REG_MEMORY(stack_frame->slot_registers[slot], kRBP, - (slot + 1) * kSizeOfArg);
+        }
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmRestorePromotedRegisters(BackendContext *backend_context)
+{
+    CHECK(backend_context);
+
+    StackFrame *stack_frame = backend_context->stack_frame;
+
+    for (size_t slot = 0; slot < stack_frame->slot_count && stack_frame->promoted_count > 0; slot++)
+    {
+        if (stack_frame->slot_registers[slot] != kNotRegister)
+        {
+            MOV_REG_MEMORY_TO_REGISTER(kRBP, - (slot + 1) * kSizeOfArg, stack_frame->slot_registers[slot]);
+        }
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmLoadDoubleConstant(BackendContext    *backend_context,
+                                           NumType_t          value,
+                                           XmmRegisterCode_t  xmm_reg,
+                                           RegisterCode_t     scratch_reg)
+{
+    CHECK(backend_context);
+
+    ImmediateType_t bits = 0;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    MOV_IMM_TO_REGISTER(bits, scratch_reg);
+
+    MOVQ_REGISTER_TO_XMM(scratch_reg, xmm_reg);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// leaves the left operand in xmm0 and the right one in xmm1; a constant or
+// variable on the right is loaded straight into xmm1 without a spill
+static BackendErrs_t AsmDoubleOperands(BackendContext  *backend_context,
+                                       LanguageContext *language_context,
+                                       TreeNode        *cur_node,
+                                       TableOfNames    *cur_table)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(cur_node);
+    CHECK(cur_table);
+
+    TreeNode *rhs = cur_node->right;
+
+    size_t variable_pos = 0;
+
+    if (rhs->type == kConstNumber)
+    {
+        ASM_OPERATOR(cur_node->left);
+
+        return AsmLoadDoubleConstant(backend_context, rhs->data.const_val, kXMM1, kR11);
+    }
+
+    if (rhs->type == kIdentifier &&
+        GetVariablePos(cur_table, rhs->data.variable_pos, &variable_pos) == kBackendSuccess)
+    {
+        ASM_OPERATOR(cur_node->left);
+
+        return AsmLoadDoubleVariable(backend_context, variable_pos, kXMM1);
+    }
+
+    ASM_OPERATOR(rhs);
+
+    MOVQ_XMM_TO_REGISTER(kXMM0, kRAX);
+
+    PUSH_REGISTER(kRAX);
+
+    ASM_OPERATOR(cur_node->left);
+
+    POP_IN_REGISTER(kR11);
+
+    MOVQ_REGISTER_TO_XMM(kR11, kXMM1);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmDoubleArithmetic(BackendContext  *backend_context,
+                                         LanguageContext *language_context,
+                                         TreeNode        *cur_node,
+                                         TableOfNames    *cur_table)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(cur_node);
+    CHECK(cur_table);
+
+    KeyCode_t op = cur_node->data.key_word_code;
+
+    // x / 2^k is exactly x * 2^-k, and mulsd is several times cheaper
+    if (op == kDiv && cur_node->right->type == kConstNumber)
+    {
+        int       exponent = 0;
+        NumType_t mantissa = frexp(cur_node->right->data.const_val, &exponent);
+
+        if ((mantissa > 0.49 && mantissa < 0.51) && exponent > -1020 && exponent < 1020)
+        {
+            ASM_OPERATOR(cur_node->left);
+
+            AsmLoadDoubleConstant(backend_context, 1 / cur_node->right->data.const_val, kXMM1, kR11);
+
+            MULSD(kXMM1, kXMM0);
+
+            return kBackendSuccess;
+        }
+    }
+
+    AsmDoubleOperands(backend_context, language_context, cur_node, cur_table);
+
+    switch (op)
+    {
+        case kAdd:
+        {
+            ADDSD(kXMM1, kXMM0);
+
+            break;
+        }
+
+        case kSub:
+        {
+            SUBSD(kXMM1, kXMM0);
+
+            break;
+        }
+
+        case kMult:
+        {
+            MULSD(kXMM1, kXMM0);
+
+            break;
+        }
+
+        case kDiv:
+        {
+            DIVSD(kXMM1, kXMM0);
+
+            break;
+        }
+
+        default:
+        {
+            ColorPrintf(kRed, "%s() not an arithmetic operator. Node pointer - %p\n", __func__, cur_node);
+
+            return kBackendUnknownNodeType;
+        }
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static bool IsLogicalOperator(KeyCode_t key_word_code)
+{
+    switch (key_word_code)
+    {
+        case kMore:
+        case kEqual:
+        case kLess:
+        case kLessOrEqual:
+        case kMoreOrEqual:
+        case kNotEqual:
+        case kAnd:
+        case kOr:
+        {
+            return true;
+        }
+
+        default:
+        {
+            return false;
+        }
+    }
+}
+
+//==============================================================================
+
+// ucomisd sets the flags like an unsigned compare, so the below/above jumps
+// are used; and/or work on the bit patterns like the integer code does
+static BackendErrs_t AsmDoubleComparison(BackendContext  *backend_context,
+                                         LanguageContext *language_context,
+                                         TreeNode        *cur_node,
+                                         TableOfNames    *cur_table)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(cur_node);
+    CHECK(cur_table);
+
+    AsmDoubleOperands(backend_context, language_context, cur_node, cur_table);
+
+    int32_t start_label_id = AddLabelIdentifier(backend_context);
+    int32_t end_label_id   = AddLabelIdentifier(backend_context);
+
+    switch (cur_node->data.key_word_code)
+    {
+        case kAnd:
+        case kOr:
+        {
+            MOVQ_XMM_TO_REGISTER(kXMM0, kRAX);
+            MOVQ_XMM_TO_REGISTER(kXMM1, kR11);
+
+            if (cur_node->data.key_word_code == kAnd)
+            {
+                AND(kRAX, kR11);
+            }
+            else
+            {
+                OR(kRAX, kR11);
+            }
+
+            CMP_REGISTER_TO_IMMEDIATE(kRAX, 0);
+
+            JUMP_IF_NOT_EQUAL(start_label_id);
+
+            break;
+        }
+
+        case kMore:
+        {
+            UCOMISD(kXMM0, kXMM1);
+
+            JUMP_IF_ABOVE(start_label_id);
+
+            break;
+        }
+
+        case kMoreOrEqual:
+        {
+            UCOMISD(kXMM0, kXMM1);
+
+            JUMP_IF_ABOVE_OR_EQUAL(start_label_id);
+
+            break;
+        }
+
+        case kLess:
+        {
+            UCOMISD(kXMM0, kXMM1);
+
+            JUMP_IF_BELOW(start_label_id);
+
+            break;
+        }
+
+        case kLessOrEqual:
+        {
+            UCOMISD(kXMM0, kXMM1);
+
+            JUMP_IF_BELOW_OR_EQUAL(start_label_id);
+
+            break;
+        }
+
+        case kEqual:
+        {
+            UCOMISD(kXMM0, kXMM1);
+
+            JUMP_IF_EQUAL(start_label_id);
+
+            break;
+        }
+
+        case kNotEqual:
+        {
+            UCOMISD(kXMM0, kXMM1);
+
+            JUMP_IF_NOT_EQUAL(start_label_id);
+
+            break;
+        }
+
+        default:
+        {
+            ColorPrintf(kRed, "%s() not a logical operator. Node pointer - %p\n", __func__, cur_node);
+
+            return kBackendUnknownNodeType;
+        }
+    }
+
+    int32_t jump_on_start_list_pos = backend_context->instruction_list->tail;
+
+    MOV_IMM_TO_REGISTER(0, kRAX);
+
+    JUMP(end_label_id);
+
+    int32_t jump_on_end_list_pos = backend_context->instruction_list->tail;
+
+    size_t start_label_pos = AddLabel(backend_context,
+                                      language_context,
+                                      backend_context->cur_address,
+                                      kFuncLabelPosPoison,
+                                      start_label_id);
+
+    NumType_t true_value = 1;
+    ImmediateType_t true_bits = 0;
+
+    memcpy(&true_bits, &true_value, sizeof(true_bits));
+
+    MOV_IMM_TO_REGISTER(true_bits, kRAX);
+
+    size_t end_label_pos = AddLabel(backend_context,
+                                    language_context,
+                                    backend_context->cur_address,
+                                    kFuncLabelPosPoison,
+                                    end_label_id);
+
+    MOVQ_REGISTER_TO_XMM(kRAX, kXMM0);
+
+    SetJumpRelativeAddress(&backend_context->instruction_list->data[jump_on_start_list_pos],
+                            backend_context->label_table->label_array[start_label_pos].address);
+
+    SetJumpRelativeAddress(&backend_context->instruction_list->data[jump_on_end_list_pos],
+                            backend_context->label_table->label_array[end_label_pos].address);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmResultToRax(BackendContext *backend_context)
+{
+    CHECK(backend_context);
+
+    if (backend_context->is_double_mode)
+    {
+        MOVQ_XMM_TO_REGISTER(kXMM0, kRAX);
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// the runtime library takes its argument in rdi and returns in rax, its
+// double flavour uses xmm0 for both
+static BackendErrs_t AsmRuntimeCall(BackendContext *backend_context,
+                                    size_t          operation_code)
+{
+    CHECK(backend_context);
+
+    if (!backend_context->is_double_mode && operation_code != kScanPos && operation_code != kAbortPos)
+    {
+        MOV_REGISTER_TO_REGISTER(kRAX, ArgPassingRegisters[0]);
+    }
+
+    XOR_REGISTER_WITH_REGISTER(kRAX, kRAX);
+
+    size_t padding = AsmAlignStackForCall(backend_context);
+
+    const char *func_name = GetRuntimeFuncName(backend_context, operation_code);
+
+    EncodeCall(backend_context, nullptr, kCallPoison);
+
+    AddFuncCallRelocation(backend_context, func_name);
+
+    BackendDumpPrintString("\tcall ");
+    BackendDumpPrintString(func_name);
+    BackendDumpPrintString("\n");
+
+    AsmRestoreStackAfterCall(backend_context, padding);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static const char *GetRuntimeFuncName(BackendContext *backend_context,
+                                      size_t          operation_code)
+{
+    CHECK(backend_context);
+
+    if (backend_context->is_double_mode && backend_context->is_fast_trig)
+    {
+        for (size_t i = 0; i < kFastTrigRuntimeFuncsCount; i++)
+        {
+            if (kFastTrigRuntimeFuncs[i].operation_code == operation_code)
+            {
+                return kFastTrigRuntimeFuncs[i].func_name;
+            }
+        }
+    }
+
+    if (backend_context->is_double_mode)
+    {
+        for (size_t i = 0; i < kDoubleRuntimeFuncsCount; i++)
+        {
+            if (kDoubleRuntimeFuncs[i].operation_code == operation_code)
+            {
+                return kDoubleRuntimeFuncs[i].func_name;
+            }
+        }
+    }
+
+    return NameTable[operation_code].key_word;
+}
+
+//==============================================================================
+
+// calls are made with rsp 16-byte aligned, temporaries pushed while an
+// expression is evaluated can break that, so pad the odd case
+static size_t AsmAlignStackForCall(BackendContext *backend_context)
+{
+    CHECK(backend_context);
+
+    if (backend_context->is_frameless || backend_context->stack_temporaries % 2 == 0)
+    {
+        return 0;
+    }
+
+    SUB_IMMEDIATE_FROM_REGISTER(kSizeOfArg, kRSP);
+
+    return kSizeOfArg;
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmRestoreStackAfterCall(BackendContext *backend_context,
+                                              size_t          padding)
+{
+    CHECK(backend_context);
+
+    if (padding > 0)
+    {
+        ADD_IMM_TO_REGISTER(padding, kRSP);
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmTailCall(BackendContext  *backend_context,
+                                 LanguageContext *language_context,
+                                 TreeNode        *cur_node,
+                                 TableOfNames    *cur_table)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(cur_node);
+    CHECK(cur_table);
+
+    int32_t func_pos = (int32_t) cur_node->right->data.variable_pos;
+
+    if (backend_context->is_frameless)
+    {
+        size_t args_count = 0;
+
+        for (TreeNode *cur_arg = cur_node->left; cur_arg != nullptr; cur_arg = cur_arg->right)
+        {
+            if (cur_arg->left == nullptr)
+            {
+                continue;
+            }
+
+            if (args_count > 0)
+            {
+                PUSH_REGISTER(kRAX);
+            }
+
+            ASM_OPERATOR(cur_arg->left);
+
+            AsmResultToRax(backend_context);
+
+            args_count++;
+        }
+
+        for (size_t i = args_count; i > 0; i--)
+        {
+            if (i < args_count)
+            {
+                POP_IN_REGISTER(kRAX);
+            }
+
+            MOV_REGISTER_TO_REGISTER(kRAX, LeafVariableRegisters[i - 1]);
+        }
+    }
+    else
+    {
+        PassFuncArgs(backend_context, language_context, cur_node->left, cur_table);
+    }
+
+    if (func_pos == cur_table->func_code)
+    {
+        int32_t body_label_id  = AddLabelIdentifier(backend_context);
+
+        size_t  body_label_pos = AddLabel(backend_context,
+                                          language_context,
+                                          backend_context->func_body_address,
+                                          kFuncLabelPosPoison,
+                                          body_label_id);
+        JUMP(body_label_id);
+
+        SetJumpRelativeAddress(&backend_context->instruction_list->data[backend_context->instruction_list->tail],
+                                backend_context->label_table->label_array[body_label_pos].address);
+
+        return kBackendSuccess;
+    }
+
+    if (backend_context->is_profiling)
+    {
+        AsmProfileExit(backend_context, language_context, cur_table->func_code);
+    }
+
+    if (!backend_context->is_frameless)
+    {
+        AsmRestorePromotedRegisters(backend_context);
+
+        LEAVE();
+    }
+
+    JUMP_TO_FUNC(func_pos);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static uint8_t GetPowerOfTwo(uint64_t value)
+{
+    if (value == 0 || (value & (value - 1)) != 0)
+    {
+        return 0;
+    }
+
+    uint8_t power = 0;
+
+    while (value > 1)
+    {
+        value >>= 1;
+        power++;
+    }
+
+    return power;
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmMulByConstant(BackendContext  *backend_context,
+                                      LanguageContext *language_context,
+                                      int64_t          multiplier)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+
+    uint64_t abs_multiplier = multiplier < 0 ? 0 - (uint64_t) multiplier : (uint64_t) multiplier;
+
+    uint8_t power = GetPowerOfTwo(abs_multiplier);
+
+    if (multiplier == 0)
+    {
+        XOR_REGISTER_WITH_REGISTER(kRAX, kRAX);
+    }
+    else if (abs_multiplier == 1 || power != 0)
+    {
+        if (power != 0)
+        {
+            SHL_REGISTER(kRAX, power);
+        }
+
+        if (multiplier < 0)
+        {
+            NEG_REGISTER(kRAX);
+        }
+    }
+    else if (multiplier == 3 || multiplier == 5 || multiplier == 9)
+    {
+        LEA_SCALED_INDEX(kRAX, kRAX, (uint8_t) (multiplier - 1), kRAX);
+    }
+    else if (multiplier >= INT32_MIN && multiplier <= INT32_MAX)
+    {
+        IMUL_REGISTER_BY_IMMEDIATE(kRAX, (int32_t) multiplier, kRAX);
+    }
+    else
+    {
+        MOV_IMM_TO_REGISTER(multiplier, kR11);
+
+        IMUL_ON_REGISTER(kR11);
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmDivByConstant(BackendContext  *backend_context,
+                                      LanguageContext *language_context,
+                                      int64_t          divisor)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+
+    uint64_t abs_divisor = divisor < 0 ? 0 - (uint64_t) divisor : (uint64_t) divisor;
+
+    uint8_t power = GetPowerOfTwo(abs_divisor);
+
+    if (abs_divisor == 1 || power != 0)
+    {
+        if (power != 0)
+        {
+            MOV_REGISTER_TO_REGISTER(kRAX, kR10);
+
+            SAR_REGISTER(kR10, 63);
+
+            SHR_REGISTER(kR10, (uint8_t) (64 - power));
+
+            ADD_REGISTER_TO_REGISTER(kR10, kRAX);
+
+            SAR_REGISTER(kRAX, power);
+        }
+
+        if (divisor < 0)
+        {
+            NEG_REGISTER(kRAX);
+        }
+
+        return kBackendSuccess;
+    }
+
+    int64_t magic = 0;
+    uint8_t shift = 0;
+
+    GetSignedDivisionMagic(divisor, &magic, &shift);
+
+    MOV_REGISTER_TO_REGISTER(kRAX, kR10);
+
+    MOV_IMM_TO_REGISTER(magic, kR11);
+
+    IMUL_ON_REGISTER(kR11);
+
+    if (divisor > 0 && magic < 0)
+    {
+        ADD_REGISTER_TO_REGISTER(kR10, kRDX);
+    }
+    else if (divisor < 0 && magic > 0)
+    {
+        SUB_REGISTER_FROM_REGISTER(kR10, kRDX);
+    }
+
+    if (shift != 0)
+    {
+        SAR_REGISTER(kRDX, shift);
+    }
+
+    MOV_REGISTER_TO_REGISTER(kRDX, kRAX);
+
+    SHR_REGISTER(kRDX, 63);
+
+    ADD_REGISTER_TO_REGISTER(kRDX, kRAX);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static bool GetSignedDivisionMagic(int64_t  divisor,
+                                   int64_t *magic,
+                                   uint8_t *shift)
+{
+    CHECK(magic);
+    CHECK(shift);
+
+    const uint64_t kTwo63 = 1ULL << 63;
+
+    uint64_t abs_divisor = divisor < 0 ? 0 - (uint64_t) divisor : (uint64_t) divisor;
+
+    if (abs_divisor < 2)
+    {
+        return false;
+    }
+
+    uint64_t t   = kTwo63 + ((uint64_t) divisor >> 63);
+    uint64_t anc = t - 1 - t % abs_divisor;
+
+    uint64_t q1 = kTwo63 / anc;
+    uint64_t r1 = kTwo63 - q1 * anc;
+    uint64_t q2 = kTwo63 / abs_divisor;
+    uint64_t r2 = kTwo63 - q2 * abs_divisor;
+
+    uint64_t delta = 0;
+    int      p     = 63;
+
+    do
+    {
+        p++;
+
+        q1 *= 2;
+        r1 *= 2;
+
+        if (r1 >= anc)
+        {
+            q1++;
+            r1 -= anc;
+        }
+
+        q2 *= 2;
+        r2 *= 2;
+
+        if (r2 >= abs_divisor)
+        {
+            q2++;
+            r2 -= abs_divisor;
+        }
+
+        delta = abs_divisor - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    *magic = (int64_t) (q2 + 1);
+
+    if (divisor < 0)
+    {
+        *magic = -*magic;
+    }
+
+    *shift = (uint8_t) (p - 64);
+
+    return true;
+}
+
+//==============================================================================
+
+static BackendErrs_t PassFuncArgs(BackendContext  *backend_context,
+                                  LanguageContext *language_context,
+                                  TreeNode        *cur_node,
+                                  TableOfNames    *cur_table)
+{
+    if (backend_context->is_double_mode)
+    {
+        // arguments are evaluated into xmm0, so every one except the last
+        // waits on the stack until all of them are ready
+        size_t args_count = 0;
+
+        for (TreeNode *cur_arg = cur_node; cur_arg != nullptr && args_count < kArgPassingRegisterCount; cur_arg = cur_arg->right)
+        {
+            if (cur_arg->left == nullptr)
+            {
+                continue;
+            }
+
+            if (args_count > 0)
+            {
+                MOVQ_XMM_TO_REGISTER(kXMM0, kRAX);
+
+                PUSH_REGISTER(kRAX);
+            }
+
+            ASM_OPERATOR(cur_arg->left);
+
+            args_count++;
+        }
+
+        if (args_count == 0)
+        {
+            return kBackendSuccess;
+        }
+
+        MOVSD_XMM_TO_XMM(kXMM0, XmmArgPassingRegisters[args_count - 1]);
+
+        for (size_t i = args_count - 1; i > 0; i--)
+        {
+            POP_IN_REGISTER(kR11);
+
+            MOVQ_REGISTER_TO_XMM(kR11, XmmArgPassingRegisters[i - 1]);
+        }
+
+        return kBackendSuccess;
+    }
+
+    for (size_t i = 0; (i < kArgPassingRegisterCount) && (cur_node != nullptr); i++)
+    {
+        ASM_OPERATOR(cur_node->left);
+
+        MOV_REGISTER_TO_REGISTER(kRAX, ArgPassingRegisters[i]);
+
+        cur_node = cur_node->right;
+    }
+
+    while (cur_node != nullptr)
+    {
+        ASM_OPERATOR(cur_node->left);
+
+        PUSH_REGISTER(kRAX);
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t SetJumpRelativeAddress(Instruction *jump_instruction,
+                                            int32_t      label_pos)
+{
+    jump_instruction->immediate_arg = label_pos -
+                                      jump_instruction->begin_address -
+                                      jump_instruction->instruction_size;
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static size_t GetCurSize(BackendContext *backend_context)
+{
+    return backend_context->cur_address;
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmGetFuncParams(BackendContext  *backend_context,
+                                      LanguageContext *language_context,
+                                      TreeNode        *cur_node,
+                                      TableOfNames    *cur_table)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(cur_node);
+    CHECK(cur_table);
+
+
+    TreeNode *cur_arg_node = cur_node;
+
+    size_t args_count = 0;
+
+    while (cur_arg_node != nullptr)
+    {
+
+        if (cur_arg_node->left != nullptr)
+        {
+            args_count++;
+        }
+
+        cur_arg_node = cur_arg_node->right;
+    }
+
+    if (args_count == 0 && cur_node->left == nullptr)
+    {
+        return kBackendNullArgs;
+    }
+
+    if (backend_context->is_frameless)
+    {
+        for (size_t i = args_count; i > 0; i--)
+        {
+            if (backend_context->is_double_mode)
+            {
+                MOVQ_XMM_TO_REGISTER(XmmArgPassingRegisters[i - 1], LeafVariableRegisters[i - 1]);
+            }
+            else if (ArgPassingRegisters[i - 1] != LeafVariableRegisters[i - 1])
+            {
+                MOV_REGISTER_TO_REGISTER(ArgPassingRegisters[i - 1], LeafVariableRegisters[i - 1]);
+            }
+        }
+
+        return kBackendSuccess;
+    }
+
+    size_t passed_args_count = 0;
+
+    for (; (passed_args_count < args_count) && (passed_args_count < kArgPassingRegisterCount); passed_args_count++)
+    {
+        size_t slot = backend_context->stack_frame->variable_slots[passed_args_count];
+
+        RegisterCode_t slot_register = GetSlotRegister(backend_context, slot);
+
+        if (slot_register != kNotRegister)
+        {
+            if (backend_context->is_double_mode)
+            {
+                MOVQ_XMM_TO_REGISTER(XmmArgPassingRegisters[passed_args_count], slot_register);
+            }
+            else
+            {
+                MOV_REGISTER_TO_REGISTER(ArgPassingRegisters[passed_args_count], slot_register);
+            }
+        }
+        else if (backend_context->is_double_mode)
+        {
+            MOVSD_XMM_TO_MEMORY(XmmArgPassingRegisters[passed_args_count], kRBP, (slot + 1) * (-kSizeOfArg));
+        }
+        else
+        {
+            MOV_REGISTER_TO_REG_MEMORY(ArgPassingRegisters[passed_args_count], kRBP, (slot + 1) * (-kSizeOfArg));
+        }
+    }
+
+    if (passed_args_count < kArgPassingRegisterCount)
+    {
+        return kBackendSuccess;
+    }
+
+    while (passed_args_count < args_count)
+    {
+        MOV_REG_MEMORY_TO_REGISTER(kRBP, (passed_args_count - kArgPassingRegisterCount + 3) * kSizeOfArg, kRAX);
+
+        size_t slot = backend_context->stack_frame->variable_slots[passed_args_count];
+
+        RegisterCode_t slot_register = GetSlotRegister(backend_context, slot);
+
+        if (slot_register != kNotRegister)
+        {
+            MOV_REGISTER_TO_REGISTER(kRAX, slot_register);
+        }
+        else
+        {
+            MOV_REGISTER_TO_REG_MEMORY(kRAX, kRBP, (slot + 1) * (-kSizeOfArg));
+        }
+
+        passed_args_count++;
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AsmFuncEntry(BackendContext  *backend_context,
+                                  LanguageContext *language_context,
+                                  TreeNode        *cur_node,
+                                  TableOfNames    *cur_table)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(cur_node);
+
+    if (backend_context->is_frameless)
+    {
+        AsmGetFuncParams(backend_context, language_context, cur_node, cur_table);
+
+        backend_context->func_body_address = backend_context->cur_address;
+
+        return kBackendSuccess;
+    }
+
+    PUSH_REGISTER(kRBP);
+
+    MOV_REGISTER_TO_REGISTER(kRSP, kRBP);
 
-                    instruction_node = instruction_node->right;
-                }
+    size_t frame_size = GetStackFrameSize(backend_context->stack_frame);
 
-                int32_t end_label_table_pos = AddLabel(backend_context,
-                                                       language_context,
-                                                       backend_context->cur_address,
-                                                       kFuncLabelPosPoison,
-                                                       end_label_id);
+    if (frame_size > 0)
+    {
+        SUB_IMMEDIATE_FROM_REGISTER(frame_size, kRSP);
+    }
 
-                SetJumpRelativeAddress(&backend_context->instruction_list->data[jump_on_end_list_pos],
-                                        backend_context->label_table->label_array[end_label_table_pos].address);
-                break;
-            }
+    AsmSavePromotedRegisters(backend_context);
 
-            case kScan:
-            {
-                XOR_REGISTER_WITH_REGISTER(kRAX, kRAX);
+    backend_context->stack_temporaries = 0;
 
-                CALL(kCallPoison);
+    // before the body label, so self tail calls are not counted as calls
+    if (backend_context->is_profiling)
+    {
+        AsmProfileEntry(backend_context, language_context, cur_table->func_code);
+    }
 
-                AddFuncCallRelocation(backend_context, kScanPos);
+    backend_context->func_body_address = backend_context->cur_address;
 
-                BackendDumpPrintString("\tcall скажи_мне\n");
+    AsmGetFuncParams(backend_context, language_context, cur_node, cur_table);
 
-                break;
-            }
+    return kBackendSuccess;
+}
 
-            case kPrint:
-            {
-                AsmOperator(backend_context, language_context, cur_node->right, cur_table);
+//==============================================================================
 
-                MOV_REGISTER_TO_REGISTER(kRAX, ArgPassingRegisters[0]);
+// A ".data" section symbol for the registration of the section, a
+// "<function>.profile" symbol for the counters of every function, in
+// declaration order, and a "<function>.branches" symbol for the branch
+// counters of every function that has any.
+static BackendErrs_t AddProfileSymbols(BackendContext  *backend_context,
+                                       LanguageContext *language_context,
+                                       TreeNode        *cur_node)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
 
-                XOR_REGISTER_WITH_REGISTER(kRAX, kRAX);
+    size_t section_index = GetProfileSectionIndex(backend_context);
 
-                CALL(kCallPoison);
+    AddSymbol(backend_context->symbol_table, AddString(backend_context->strings, kSectionProfileName),
+                                             ELF64_ST_INFO(STB_LOCAL, STT_SECTION),
+                                             STV_DEFAULT,
+                                             (Elf64_Section) section_index, 0, 0);
 
-                AddFuncCallRelocation(backend_context, kPrintPos);
+    TreeNode *first_node = cur_node;
 
-                BackendDumpPrintString("\tcall пишу_твоей_матери\n");
+    size_t entry_offset = kProfileHeaderSize;
 
-                break;
-            }
+    for ( ; cur_node != nullptr; cur_node = cur_node->right)
+    {
+        if (cur_node->left->type != kFuncDef)
+        {
+            continue;
+        }
 
-            case kCos:
-            {
-                AsmOperator(backend_context, language_context, cur_node->right, cur_table);
+        char symbol_name[kMaxProfileSymbolName] = "";
 
-                MOV_REGISTER_TO_REGISTER(kRAX, ArgPassingRegisters[0]);
+        if (GetProfileSymbolName(language_context, cur_node->left->data.variable_pos, kProfileSymbolSuffix,
+                                 symbol_name, sizeof(symbol_name)) != kBackendSuccess)
+        {
+            return kBackendFailedAllocation;
+        }
 
-                XOR_REGISTER_WITH_REGISTER(kRAX, kRAX);
+        AddSymbol(backend_context->symbol_table, AddString(backend_context->strings, symbol_name),
+                                                 ELF64_ST_INFO(STB_LOCAL, STT_OBJECT),
+                                                 STV_DEFAULT,
+                                                 (Elf64_Section) section_index,
+                                                 entry_offset, kProfileEntrySize);
 
-                CALL(kCallPoison);
+        entry_offset += kProfileEntrySize;
+    }
 
-                AddFuncCallRelocation(backend_context, kCosPos);
+    const BranchSites *branch_sites = backend_context->branch_sites;
 
-                BackendDumpPrintString("\tcall пишу_твоей_матери\n");
+    if (branch_sites == nullptr)
+    {
+        return kBackendSuccess;
+    }
 
-                break;
-            }
+    // the branch array follows the entries and its count
+    size_t branches_offset = entry_offset + sizeof(uint64_t);
 
-            case kSin:
-            {
-                AsmOperator(backend_context, language_context, cur_node->right, cur_table);
+    for (cur_node = first_node; cur_node != nullptr; cur_node = cur_node->right)
+    {
+        if (cur_node->left->type != kFuncDef)
+        {
+            continue;
+        }
 
-                MOV_REGISTER_TO_REGISTER(kRAX, ArgPassingRegisters[0]);
+        size_t func_pos    = cur_node->left->data.variable_pos;
+        size_t first_site  = branch_sites->first_sites[func_pos];
+        size_t site_count  = CountBranchSites(cur_node->left->right->right);
 
-                XOR_REGISTER_WITH_REGISTER(kRAX, kRAX);
+        if (site_count == 0)
+        {
+            continue;
+        }
 
-                CALL(kCallPoison);
+        char symbol_name[kMaxProfileSymbolName] = "";
 
-                AddFuncCallRelocation(backend_context, kSinPos);
+        if (GetProfileSymbolName(language_context, (int32_t) func_pos, kBranchSymbolSuffix,
+                                 symbol_name, sizeof(symbol_name)) != kBackendSuccess)
+        {
+            return kBackendFailedAllocation;
+        }
 
-                BackendDumpPrintString("\tcall пишу_твоей_матери\n");
+        AddSymbol(backend_context->symbol_table, AddString(backend_context->strings, symbol_name),
+                                                 ELF64_ST_INFO(STB_LOCAL, STT_OBJECT),
+                                                 STV_DEFAULT,
+                                                 (Elf64_Section) section_index,
+                                                 branches_offset + first_site * kProfileBranchSize,
+                                                 site_count * kProfileBranchSize);
+    }
 
-                break;
-            }
+    return kBackendSuccess;
+}
 
-            case kSqrt:
-            {
-                AsmOperator(backend_context, language_context, cur_node->right, cur_table);
+//==============================================================================
 
-                MOV_REGISTER_TO_REGISTER(kRAX, ArgPassingRegisters[0]);
+// main registers the section with the runtime first, then every function
+// counts the call and remembers the timestamp. rax and rdx are free here,
+// the arguments are still in registers and rdx is one of them.
+static BackendErrs_t AsmProfileEntry(BackendContext  *backend_context,
+                                     LanguageContext *language_context,
+                                     int32_t          func_pos)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
 
-                XOR_REGISTER_WITH_REGISTER(kRAX, kRAX);
+    if ((size_t) func_pos == language_context->tables.main_id_pos)
+    {
+        EncodeRipRelative(backend_context, kLogicLeaRipRelative, kLeaR64FromM, kRDI);
 
-                CALL(kCallPoison);
+        AddSymbolRelocation(backend_context, kSectionProfileName,
+                            backend_context->cur_address - sizeof(DisplacementType_t), -0x4);
 
-                AddFuncCallRelocation(backend_context, kSqrtPos);
+        EncodeCall(backend_context, nullptr, kCallPoison);
 
-                BackendDumpPrintString("\tcall трент_ультует\n");
+        AddFuncCallRelocation(backend_context, kProfileStartFuncName);
 
-                break;
-            }
+        BackendDumpPrintString("\tcall ");
+        BackendDumpPrintString(kProfileStartFuncName);
+        BackendDumpPrintString("\n");
+    }
 
-#define LOGICAL_OPERATOR_CODE_GEN(const_name, JumpInstruction, code)                                            \
-            case const_name:                                                                                    \
-            {                                                                                                   \
-                ASM_OPERATOR(cur_node->right);                                                                  \
-                                                                                                                \
-                MOV_REGISTER_TO_REGISTER(kRAX, kR11);                                                           \
-                                                                                                                \
-                ASM_OPERATOR(cur_node->left);                                                                   \
-                                                                                                                \
-                code                                                                                            \
-                                                                                                                \
-                int32_t start_label_id = AddLabelIdentifier(backend_context);                                   \
-                int32_t end_label_id   = AddLabelIdentifier(backend_context);                                   \
-                                                                                                                \
-                JumpInstruction(start_label_id);                                                                \
-                                                                                                                \
-                int32_t jump_on_start_list_pos = backend_context->instruction_list->tail;                       \
-                                                                                                                \
-                MOV_IMM_TO_REGISTER(0, kRAX);                                                                   \
-                                                                                                                \
-                JUMP(end_label_id);                                                                             \
-                                                                                                                \
-                int32_t jump_on_end_list_pos = backend_context->instruction_list->tail;                         \
-                                                                                                                \
-                size_t start_label_pos = AddLabel(backend_context,                                              \
-                                                  language_context,                                             \
-                                                  backend_context->cur_address,                                 \
-                                                  kFuncLabelPosPoison,                                          \
-                                                  start_label_id);                                              \
-                MOV_IMM_TO_REGISTER(1, kRAX);                                                                   \
-                                                                                                                \
-                size_t end_label_pos = AddLabel(backend_context,                                                \
-                                                language_context,                                               \
-                                                backend_context->cur_address,                                   \
-                                                kFuncLabelPosPoison,                                            \
-                                                end_label_id);                                                  \
-                                                                                                                \
-                SetJumpRelativeAddress(&backend_context->instruction_list->data[jump_on_start_list_pos],        \
-                                        backend_context->label_table->label_array[start_label_pos].address);    \
-                                                                                                                \
-                SetJumpRelativeAddress(&backend_context->instruction_list->data[jump_on_end_list_pos],          \
-                                        backend_context->label_table->label_array[end_label_pos].address);      \
-                                                                                                                \
-                break;                                                                                          \
-            }
+    AsmProfileCounterAccess(backend_context, language_context, func_pos, kProfileSymbolSuffix,
+                            kLogicIncRipMemory, kIncRm64, kRAX, kProfileCallsOffset);
 
-            #include "logical_operators_code.gen.h"
+    MOV_REGISTER_TO_REGISTER(kRDX, kR11);
 
-            default:
-            {
-                ColorPrintf(kRed, "%s() unknown operator. Node pointer - %p\n", __func__, cur_node);
+    AsmReadTimestamp(backend_context);
 
-                return kBackendUnknownNodeType;
+    MOV_REGISTER_TO_REG_MEMORY(kRAX, kRBP, GetProfileSlotDisplacement(backend_context));
 
-                break;
-            }
-        }
-    }
+    MOV_REGISTER_TO_REGISTER(kR11, kRDX);
 
     return kBackendSuccess;
 }
 
 //==============================================================================
 
-static BackendErrs_t AsmFunctionCall(BackendContext  *backend_context,
-                                     LanguageContext *language_context,
-                                     TreeNode        *cur_node,
-                                     TableOfNames    *cur_table)
+// Adds the cycles since the entry to the counters of the function. Runs
+// right before leave, where rax and rdx may hold the result.
+static BackendErrs_t AsmProfileExit(BackendContext  *backend_context,
+                                    LanguageContext *language_context,
+                                    int32_t          func_pos)
 {
     CHECK(backend_context);
     CHECK(language_context);
-    CHECK(cur_node);
-    CHECK(cur_table);
 
-    PassFuncArgs(backend_context, language_context, cur_node->left, cur_table);
+    MOV_REGISTER_TO_REGISTER(kRAX, kR10);
+    MOV_REGISTER_TO_REGISTER(kRDX, kR11);
 
-    CALL(cur_node->right->data.variable_pos);
+    AsmReadTimestamp(backend_context);
+
+    MOV_REG_MEMORY_TO_REGISTER(kRBP, GetProfileSlotDisplacement(backend_context), kRDX);
+
+    SUB_REGISTER_FROM_REGISTER(kRDX, kRAX);
+
+    AsmProfileCounterAccess(backend_context, language_context, func_pos, kProfileSymbolSuffix,
+                            kLogicAddRegisterToRipMemory, kAddR64ToRm64, kRAX, kProfileCyclesOffset);
+
+    MOV_REGISTER_TO_REGISTER(kR10, kRAX);
+    MOV_REGISTER_TO_REGISTER(kR11, kRDX);
 
     return kBackendSuccess;
 }
 
 //==============================================================================
 
-static BackendErrs_t PassFuncArgs(BackendContext  *backend_context,
-                                  LanguageContext *language_context,
-                                  TreeNode        *cur_node,
-                                  TableOfNames    *cur_table)
+static BackendErrs_t AsmProfileCounterAccess(BackendContext  *backend_context,
+                                             LanguageContext *language_context,
+                                             int32_t          func_pos,
+                                             const char      *symbol_suffix,
+                                             LogicalOpcode_t  logical_opcode,
+                                             Opcode_t         op_code,
+                                             RegisterCode_t   reg,
+                                             size_t           field_offset)
 {
-    for (size_t i = 0; (i < kArgPassingRegisterCount) && (cur_node != nullptr); i++)
-    {
-        ASM_OPERATOR(cur_node->left);
-
-        MOV_REGISTER_TO_REGISTER(kRAX, ArgPassingRegisters[i]);
+    CHECK(backend_context);
+    CHECK(language_context);
 
-        cur_node = cur_node->right;
-    }
+    char symbol_name[kMaxProfileSymbolName] = "";
 
-    while (cur_node != nullptr)
+    if (GetProfileSymbolName(language_context, func_pos, symbol_suffix,
+                             symbol_name, sizeof(symbol_name)) != kBackendSuccess)
     {
-        ASM_OPERATOR(cur_node->left);
-
-        PUSH_REGISTER(kRAX);
+        return kBackendFailedAllocation;
     }
 
-    return kBackendSuccess;
+    EncodeRipRelative(backend_context, logical_opcode, op_code, reg);
+
+    // rip points past the displacement, which ends the instruction
+    return AddSymbolRelocation(backend_context, symbol_name,
+                               backend_context->cur_address - sizeof(DisplacementType_t),
+                               (int64_t) field_offset - (int64_t) sizeof(DisplacementType_t));
 }
 
 //==============================================================================
 
-static BackendErrs_t SetJumpRelativeAddress(Instruction *jump_instruction,
-                                            int32_t      label_pos)
+// The sites are consumed in the order CollectBranchSites numbered them
+static const BranchSite *GetNextBranchSite(BackendContext *backend_context,
+                                           size_t         *site_pos)
 {
-    jump_instruction->immediate_arg = label_pos -
-                                      jump_instruction->begin_address -
-                                      jump_instruction->instruction_size;
-    return kBackendSuccess;
+    CHECK(backend_context);
+    CHECK(site_pos);
+
+    const BranchSites *branch_sites = backend_context->branch_sites;
+
+    if (branch_sites == nullptr || backend_context->branch_site_pos >= branch_sites->site_count)
+    {
+        return nullptr;
+    }
+
+    *site_pos = backend_context->branch_site_pos++;
+
+    return &branch_sites->sites[*site_pos];
 }
 
 //==============================================================================
 
-static size_t GetCurSize(BackendContext *backend_context)
+static bool IsColdBranch(const BackendContext *backend_context,
+                         const BranchSite     *site)
 {
-    return backend_context->cur_address;
+    return backend_context->profile != nullptr &&
+           site != nullptr && site->is_profiled && site->executions > 0 &&
+           site->taken * kColdBranchFraction <= site->executions;
 }
 
 //==============================================================================
 
-static BackendErrs_t AsmGetFuncParams(BackendContext  *backend_context,
+// The counters of a site are reached through the branch symbol of its
+// function, so the offset does not depend on the functions before it
+static BackendErrs_t AsmBranchCounter(BackendContext  *backend_context,
                                       LanguageContext *language_context,
-                                      TreeNode        *cur_node,
-                                      TableOfNames    *cur_table)
+                                      int32_t          func_pos,
+                                      size_t           site_pos,
+                                      size_t           field_offset)
 {
     CHECK(backend_context);
     CHECK(language_context);
-    CHECK(cur_node);
-    CHECK(cur_table);
 
+    size_t first_site = backend_context->branch_sites->first_sites[func_pos];
 
-    TreeNode *cur_arg_node = cur_node;
+    return AsmProfileCounterAccess(backend_context, language_context, func_pos, kBranchSymbolSuffix,
+                                   kLogicIncRipMemory, kIncRm64, kRAX,
+                                   (site_pos - first_site) * kProfileBranchSize + field_offset);
+}
 
-    size_t args_count = 0;
+//==============================================================================
 
-    while (cur_arg_node != nullptr)
+static BackendErrs_t AddColdBlock(BackendContext  *backend_context,
+                                  const ColdBlock *cold_block)
+{
+    CHECK(backend_context);
+    CHECK(cold_block);
+
+    if (backend_context->cold_block_count == backend_context->cold_block_capacity)
     {
+        size_t new_capacity = backend_context->cold_block_capacity == 0 ? kBaseColdBlocksCapacity :
+                                                                          backend_context->cold_block_capacity * 2;
 
-        if (cur_arg_node->left != nullptr)
+        ColdBlock *new_blocks = (ColdBlock *) realloc(backend_context->cold_blocks, new_capacity * sizeof(ColdBlock));
+
+        if (new_blocks == nullptr)
         {
-            args_count++;
+            ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+            return kBackendFailedAllocation;
         }
 
-        cur_arg_node = cur_arg_node->right;
+        backend_context->cold_blocks         = new_blocks;
+        backend_context->cold_block_capacity = new_capacity;
     }
 
-    if (args_count == 0 && cur_node->left == nullptr)
+    backend_context->cold_blocks[backend_context->cold_block_count++] = *cold_block;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// Cold bodies follow the last instruction of the function and jump back
+// after their ???. Cold blocks nested in them are appended while the loop
+// runs, so it goes by index.
+static BackendErrs_t AsmColdBlocks(BackendContext  *backend_context,
+                                   LanguageContext *language_context,
+                                   TableOfNames    *cur_table)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(cur_table);
+
+    if (backend_context->cold_block_count == 0)
     {
-        return kBackendNullArgs;
+        return kBackendSuccess;
     }
 
-    size_t passed_args_count = 0;
+    // a function without a final return keeps falling through past them
+    LogicalOpcode_t last_op_code = backend_context->instruction_list->data[backend_context->instruction_list->tail].logical_op_code;
 
-    for (; (passed_args_count < args_count) && (passed_args_count < kArgPassingRegisterCount); passed_args_count++)
+    bool    is_jumping_over      = last_op_code != kLogicRet && last_op_code != kLogicJmp;
+    int32_t jump_over_label_id   = AddLabelIdentifier(backend_context);
+    int32_t jump_over_list_pos   = 0;
+
+    if (is_jumping_over)
     {
-        MOV_REGISTER_TO_REG_MEMORY(ArgPassingRegisters[passed_args_count], kRBP, (passed_args_count + 1) * (-kSizeOfArg));
+        JUMP(jump_over_label_id);
+
+        jump_over_list_pos = backend_context->instruction_list->tail;
     }
 
-    if (passed_args_count < kArgPassingRegisterCount)
+    for (size_t i = 0; i < backend_context->cold_block_count; i++)
     {
-        return kBackendSuccess;
+        ColdBlock cold_block = backend_context->cold_blocks[i];
+
+        int32_t label_table_pos = AddLabel(backend_context,
+                                           language_context,
+                                           backend_context->cur_address,
+                                           kFuncLabelPosPoison,
+                                           cold_block.label_id);
+
+        SetJumpRelativeAddress(&backend_context->instruction_list->data[cold_block.jump_list_pos],
+                               backend_context->label_table->label_array[label_table_pos].address);
+
+        AddLineRow(backend_context, backend_context->cur_address, cold_block.line);
+
+        backend_context->branch_site_pos = cold_block.site_pos + 1;
+
+        if (backend_context->is_profiling)
+        {
+            AsmBranchCounter(backend_context, language_context, cur_table->func_code,
+                             cold_block.site_pos, kProfileTakenOffset);
+        }
+
+        for (TreeNode *instruction_node = cold_block.body; instruction_node != nullptr;
+             instruction_node = instruction_node->right)
+        {
+            ASM_OPERATOR(instruction_node->left);
+        }
+
+        // a body that ends with a return never gets back
+        last_op_code = backend_context->instruction_list->data[backend_context->instruction_list->tail].logical_op_code;
+
+        if (last_op_code != kLogicRet && last_op_code != kLogicJmp)
+        {
+            JUMP(cold_block.end_label_id);
+
+            SetJumpRelativeAddress(&backend_context->instruction_list->data[backend_context->instruction_list->tail],
+                                   (int32_t) cold_block.end_address);
+        }
     }
 
-    while (passed_args_count < args_count)
+    if (is_jumping_over)
     {
-        MOV_REG_MEMORY_TO_REGISTER(kRBP, (passed_args_count - kArgPassingRegisterCount + 3) * kSizeOfArg, kRAX);
+        AddLabel(backend_context,
+                 language_context,
+                 backend_context->cur_address,
+                 kFuncLabelPosPoison,
+                 jump_over_label_id);
 
-        MOV_REGISTER_TO_REG_MEMORY(kRAX, kRBP, (passed_args_count + 1) * (-8));
+        SetJumpRelativeAddress(&backend_context->instruction_list->data[jump_over_list_pos],
+                               (int32_t) backend_context->cur_address);
     }
 
+    backend_context->cold_block_count = 0;
+
     return kBackendSuccess;
 }
 
 //==============================================================================
 
-static BackendErrs_t AsmFuncEntry(BackendContext  *backend_context,
-                                  LanguageContext *language_context,
-                                  TreeNode        *cur_node,
-                                  TableOfNames    *cur_table)
+// rdtsc leaves the counter split between edx and eax
+static BackendErrs_t AsmReadTimestamp(BackendContext *backend_context)
 {
     CHECK(backend_context);
-    CHECK(language_context);
-    CHECK(cur_node);
 
-    PUSH_REGISTER(kRBP);
+    EncodeRdtsc(backend_context);
 
-    MOV_REGISTER_TO_REGISTER(kRSP, kRBP);
+    SHL_REGISTER(kRDX, 32);
 
-    if (cur_table->name_count == 1)
-    {
-        SUB_IMMEDIATE_FROM_REGISTER(kStackAlignSize, kRSP);
-    }
-    else if (cur_table->name_count > 0)
+    OR(kRAX, kRDX);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// Pads with nops up to kHotCodeAlignment counted from base_address, the
+// callers only put it where execution never falls through
+static BackendErrs_t AsmAlignHotCode(BackendContext *backend_context,
+                                     size_t          base_address)
+{
+    CHECK(backend_context);
+
+    while ((backend_context->cur_address - base_address) % kHotCodeAlignment != 0)
     {
-        SUB_IMMEDIATE_FROM_REGISTER((cur_table->name_count - (1 - cur_table->name_count % 2)) * kStackAlignSize, kRSP);
+        EncodeNop(backend_context);
     }
 
-    AsmGetFuncParams(backend_context, language_context, cur_node, cur_table);
-
     return kBackendSuccess;
 }
 
+//==============================================================================
+
+// the slot reserved last in AsmFuncDeclaration
+static DisplacementType_t GetProfileSlotDisplacement(BackendContext *backend_context)
+{
+    CHECK(backend_context);
+
+    return -(DisplacementType_t) (backend_context->stack_frame->slot_count * kSizeOfArg);
+}
+
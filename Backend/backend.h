@@ -6,6 +6,7 @@
 #include "../Common/trees.h"
 #include "../Common/NameTable.h"
 #include "backend_common.h"
+#include "pgo.h"
 
 #include "FastList/list.h"
 #include "ListDump/list_dump.h"
@@ -16,6 +17,15 @@ static const int32_t kStackAlignSize = 16;
 
 static const int32_t kSizeOfArg = 8;
 
+static const char *kDoubleModeFlag = "--double";
+static const char *kFastTrigFlag   = "--fast-trig";
+static const char *kExecutableFlag = "--exec";
+static const char *kJitFlag        = "--jit";
+static const char *kJobsFlag       = "--jobs";
+static const char *kKeepLabelsFlag = "--keep-labels";
+static const char *kDebugInfoFlag  = "--debug-info";
+static const char *kProfileFlag    = "--profile";
+
 typedef enum
 {
     kBackendSuccess,
@@ -43,6 +53,11 @@ typedef enum
     kBackendInconsistentSizes,
     kBackendUnknownOpcodeSize,
     kBackendNullDumpFile,
+    kBackendUnsupportedAddressing,
+    kBackendUnsupportedRuntimeCall,
+    kBackendMissingMain,
+    kBackendInvalidIncrementalState,
+    kBackendThreadError,
 } BackendErrs_t;
 
 static const size_t kBaseRelocationTableCapacity = 16;
@@ -57,6 +72,9 @@ struct RelocationTable
 };
 
 static const size_t kBaseSymbolTableCapacity = 16;
+static const size_t kBaseSymbolIndexCapacity = 64;
+
+static const size_t kSymbolIndexEmptySlot = (size_t) -1;
 
 struct SymbolTable
 {
@@ -65,19 +83,32 @@ struct SymbolTable
     size_t     sym_count;
 
     size_t     capacity;
+
+    size_t    *name_index;
+
+    size_t     name_index_capacity;
 };
 
-static const size_t kBaseStringTableCapacity = 16;
+static const size_t kBaseStringTableCapacity = 256;
+static const size_t kBaseStringIndexCapacity = 64;
+
+static const size_t kStringIndexEmptySlot = (size_t) -1;
 
+// Contents of .strtab: names packed one after another with their zero
+// bytes, plus a hash index from a name to its offset in the pool.
 struct StringTable
 {
-    char    **string_array;
+    char     *pool;
 
     size_t    capacity;
 
-    size_t    string_count;
-
     size_t    cur_size;
+
+    size_t   *index;
+
+    size_t    index_capacity;
+
+    size_t    string_count;
 };
 
 static const int32_t kFuncLabelPosPoison          = -1;
@@ -125,6 +156,95 @@ struct AddressRequests
     size_t request_count;
 };
 
+static const size_t kBaseStackFrameCapacity = 16;
+
+struct StackFrame
+{
+    size_t         *variable_slots;
+
+    // kNotRegister for slots that stay in memory
+    RegisterCode_t *slot_registers;
+
+    size_t          capacity;
+
+    size_t          slot_count;
+
+    // a promoted slot keeps the caller's value of its register instead
+    size_t          promoted_count;
+};
+
+static const size_t kBaseLineTableCapacity = 64;
+
+// Address of the first instruction of a statement and the source line of
+// the statement, in the order the code was generated
+struct LineRow
+{
+    uint32_t address;
+
+    uint32_t line_number;
+};
+
+struct LineTable
+{
+    LineRow *rows;
+
+    size_t   capacity;
+
+    size_t   row_count;
+};
+
+static const size_t kBaseBranchSitesCapacity = 32;
+
+// A ??? or пока in the order the code generator meets them: functions in
+// declaration order, a block before the blocks nested in it
+struct BranchSite
+{
+    uint32_t function_index; // in declaration order
+    uint32_t line;
+    uint32_t ordinal;        // sites of the function on the same line before it
+
+    bool     is_profiled;
+
+    uint64_t executions;
+    uint64_t taken;
+};
+
+struct BranchSites
+{
+    BranchSite *sites;
+
+    size_t      capacity;
+
+    size_t      site_count;
+
+    // first site of every function, by the identifier of the function
+    size_t     *first_sites;
+
+    size_t      identifier_count;
+};
+
+static const size_t kBaseColdBlocksCapacity = 4;
+
+// A rarely entered ??? body, generated after the rest of its function
+struct ColdBlock
+{
+    TreeNode *body;
+
+    int32_t   label_id;
+    int32_t   end_label_id;
+
+    size_t    jump_list_pos; // the conditional jump to the body
+
+    size_t    end_address;   // where the body jumps back to
+
+    size_t    site_pos;      // the ??? the body belongs to
+
+    size_t    line;
+};
+
+struct IncrementalCache;
+struct ParallelCodegen;
+
 struct BackendContext
 {
     RelocationTable *relocation_table;
@@ -137,9 +257,53 @@ struct BackendContext
 
     size_t           cur_address;
 
+    size_t           func_body_address;
+
+    size_t           func_begin_address;
+
+    bool             is_frameless;
+
+    bool             is_hot_function;
+
+    bool             is_double_mode;
+
+    bool             is_fast_trig;
+
+    bool             is_keeping_labels;
+
+    bool             is_debug_info;
+
+    bool             is_profiling;
+
+    const ProfileData *profile;
+
+    const BranchSites *branch_sites;
+
+    size_t           branch_site_pos;
+
+    ColdBlock       *cold_blocks;
+
+    size_t           cold_block_count;
+
+    size_t           cold_block_capacity;
+
+    const char      *source_file_name;
+
+    size_t           stack_temporaries;
+
+    StackFrame      *stack_frame;
+
     LabelTable      *label_table;
 
     AddressRequests *address_requests;
+
+    LineTable       *line_table;
+
+    IncrementalCache *incremental_cache;
+
+    size_t           jobs_count;
+
+    ParallelCodegen *parallel_codegen;
 };
 
 TreeErrs_t WriteAsmCodeInFile(LanguageContext *language_context,
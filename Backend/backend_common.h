@@ -32,6 +32,25 @@ typedef enum
     kNotRegister,
 } RegisterCode_t;
 
+typedef enum
+{
+    kXMM0 = 0x0,
+    kXMM1 = 0x1,
+    kXMM2 = 0x2,
+    kXMM3 = 0x3,
+    kXMM4 = 0x4,
+    kXMM5 = 0x5,
+    kXMM6 = 0x6,
+    kXMM7 = 0x7,
+} XmmRegisterCode_t;
+
+typedef enum
+{
+    kNoLegacyPrefix     = 0x00,
+    kOperandSizePrefix  = 0x66,
+    kScalarDoublePrefix = 0xf2,
+} LegacyPrefixCode_t;
+
 typedef enum
 {
     kPushR64          = 0x50,
@@ -47,6 +66,7 @@ typedef enum
 
     kRet              = 0xc3,
     kLeave            = 0xc9,
+    kNop              = 0x90,
 
     kAddR64ToRm64     = 0x01,
     kAddImmToRm64     = 0x81,
@@ -71,6 +91,9 @@ typedef enum
     kJaeRel32         = 0x830f,
     kJaRel32          = 0x870f,
 
+    kJgeRel32         = 0x8d0f,
+    kJgRel32          = 0x8f0f,
+
     kJeRel32          = 0x840f,
     kJneRel32         = 0x850f,
 
@@ -80,8 +103,38 @@ typedef enum
 
     kAndR64Rm64       = 0x23,
     kOrR64Rm64        = 0x0b,
+
+    kShiftRm64ByImm8  = 0xc1,
+    kLeaR64FromM      = 0x8d,
+    kImulR64Rm64Imm32 = 0x69,
+    kNegRm64          = 0xf7,
+    kCqo              = 0x99,
+    kIncRm64          = 0xff,
+    kRdtsc            = 0x310f,
+
+    kMovsdXmmFromRm   = 0x100f,
+    kMovsdRmFromXmm   = 0x110f,
+    kMovqXmmFromRm64  = 0x6e0f,
+    kMovqRm64FromXmm  = 0x7e0f,
+    kAddsd            = 0x580f,
+    kMulsd            = 0x590f,
+    kSubsd            = 0x5c0f,
+    kDivsd            = 0x5e0f,
+    kUcomisd          = 0x2e0f,
+    kCvttsd2si        = 0x2c0f,
+    kCvtsi2sd         = 0x2a0f,
+    kSqrtsd           = 0x510f,
+    kRoundsd          = 0x0b3a0f,
 } Opcode_t;
 
+typedef enum
+{
+    kRoundToNearest = 0x08,
+    kRoundDown      = 0x09,
+    kRoundUp        = 0x0a,
+    kRoundToZero    = 0x0b,
+} RoundingMode_t;
+
 typedef enum
 {
     kNotOpcode,
@@ -124,12 +177,44 @@ typedef enum
     kLogicJumpIfAbove,
     kLogicJumpIfAboveOrEqual,
 
+    kLogicJumpIfGreater,
+    kLogicJumpIfGreaterOrEqual,
+
     kLogicJumpIfEqual,
     kLogicJumpIfNotEqual,
 
     kLogicJmp,
     kLogicRegisterAndRegister,
     kLogicRegisterOrRegister,
+
+    kLogicShlRegisterByImmediate,
+    kLogicShrRegisterByImmediate,
+    kLogicSarRegisterByImmediate,
+
+    kLogicLeaScaledIndex,
+    kLogicImulRegisterByImmediate,
+    kLogicNegRegister,
+    kLogicCqo,
+    kLogicRdtsc,
+    kLogicNop,
+    kLogicIncRipMemory,
+    kLogicAddRegisterToRipMemory,
+    kLogicLeaRipRelative,
+
+    kLogicMovsdMemoryToXmm,
+    kLogicMovsdXmmToMemory,
+    kLogicMovsdXmmToXmm,
+    kLogicMovqRegisterToXmm,
+    kLogicMovqXmmToRegister,
+    kLogicAddsd,
+    kLogicSubsd,
+    kLogicMulsd,
+    kLogicDivsd,
+    kLogicUcomisd,
+    kLogicCvttsd2si,
+    kLogicCvtsi2sd,
+    kLogicSqrtsd,
+    kLogicRoundsd,
 } LogicalOpcode_t;
 
 typedef enum
@@ -163,12 +248,16 @@ struct Instruction
     size_t             displacement_size;
     size_t             op_code_size;
 
+    uint8_t            legacy_prefix;
+
     uint8_t            rex_prefix;
 
-    uint16_t           op_code;
+    uint32_t           op_code;
 
     uint8_t            mod_rm;
 
+    uint8_t            sib;
+
     DisplacementType_t displacement;
 
     ImmediateType_t    immediate_arg;
@@ -186,6 +275,42 @@ static const RegisterCode_t ArgPassingRegisters[] =
 
 static const size_t kArgPassingRegisterCount = sizeof(ArgPassingRegisters) / sizeof(RegisterCode_t);
 
+static const XmmRegisterCode_t XmmArgPassingRegisters[] =
+{
+    kXMM0,
+    kXMM1,
+    kXMM2,
+    kXMM3,
+    kXMM4,
+    kXMM5
+};
+
+// caller-saved registers that the code generator never uses as scratch,
+// so a leaf function can keep its variables in them and skip the frame
+static const RegisterCode_t LeafVariableRegisters[] =
+{
+    kRDI,
+    kRSI,
+    kRCX,
+    kR8,
+    kR9
+};
+
+static const size_t kLeafVariableRegisterCount = sizeof(LeafVariableRegisters) / sizeof(RegisterCode_t);
+
+// callee-saved registers the code generator never uses either, the hottest
+// variables of a profiled function with a frame move there
+static const RegisterCode_t PromotedVariableRegisters[] =
+{
+    kRBX,
+    kR12,
+    kR13,
+    kR14,
+    kR15
+};
+
+static const size_t kPromotedVariableRegisterCount = sizeof(PromotedVariableRegisters) / sizeof(RegisterCode_t);
+
 struct Jump
 {
     LogicalOpcode_t  logical_op_code;
@@ -203,6 +328,9 @@ static const Jump kJumpsArray[] =
     kLogicJumpIfAbove,       "ja",
     kLogicJumpIfAboveOrEqual,"jae",
 
+    kLogicJumpIfGreater,       "jg",
+    kLogicJumpIfGreaterOrEqual,"jge",
+
     kLogicJumpIfEqual,       "je",
     kLogicJumpIfNotEqual,    "jne",
 
@@ -4,6 +4,8 @@ static FILE *BackendDumpFile = nullptr;
 
 static uint8_t GetDestRegister(Instruction *instruction);
 static uint8_t GetSrcRegister (Instruction *instruction);
+
+static const char *GetScalarDoubleMnemonic(LogicalOpcode_t logical_op_code);
 //==============================================================================
 
 #define DUMP_PRINT(...) fprintf(BackendDumpFile, __VA_ARGS__)
@@ -15,6 +17,9 @@ static uint8_t GetSrcRegister (Instruction *instruction);
 
 #define DISPLACEMENT instruction->displacement
 
+#define SOURCE_XMM_REGISTER   kXmmRegisterArray[source_register   & kDestRegisterMask]
+#define RECEIVER_XMM_REGISTER kXmmRegisterArray[receiver_register & kDestRegisterMask]
+
 //==============================================================================
 
 BackendErrs_t BeginBackendDump()
@@ -156,6 +161,21 @@ BackendErrs_t BackendDumpPrintCall(LanguageContext *language_context,
 
 //==============================================================================
 
+BackendErrs_t BackendDumpPrintFuncJump(LanguageContext *language_context,
+                                       int32_t          func_pos)
+{
+    if (BackendDumpFile == nullptr)
+    {
+        return kBackendNullDumpFile;
+    }
+
+    DUMP_PRINT("\tjmp %s\n\n", language_context->identifiers.identifier_array[func_pos].id);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
 BackendErrs_t DumpPrintCommonLabel(int32_t identification_number)
 {
     if (BackendDumpFile == nullptr)
@@ -193,6 +213,54 @@ BackendErrs_t BackendDumpPrintJump(Instruction *instruction,
 
 //==============================================================================
 
+static const char *GetScalarDoubleMnemonic(LogicalOpcode_t logical_op_code)
+{
+    switch (logical_op_code)
+    {
+        case kLogicMovsdXmmToXmm:
+        {
+            return "movsd";
+        }
+
+        case kLogicAddsd:
+        {
+            return "addsd";
+        }
+
+        case kLogicSubsd:
+        {
+            return "subsd";
+        }
+
+        case kLogicMulsd:
+        {
+            return "mulsd";
+        }
+
+        case kLogicDivsd:
+        {
+            return "divsd";
+        }
+
+        case kLogicUcomisd:
+        {
+            return "ucomisd";
+        }
+
+        case kLogicSqrtsd:
+        {
+            return "sqrtsd";
+        }
+
+        default:
+        {
+            return "unknown";
+        }
+    }
+}
+
+//==============================================================================
+
 BackendErrs_t BackendDumpPrintInstruction(BackendContext  *backend_context,
                                           Instruction     *instruction)
 {
@@ -294,7 +362,7 @@ BackendErrs_t BackendDumpPrintInstruction(BackendContext  *backend_context,
 
         case kLogicDivRegisterOnRax:
         {
-            DUMP_PRINT("\tdiv %s\n", RECEIVER_REGISTER);
+            DUMP_PRINT("\tidiv %s\n", RECEIVER_REGISTER);
 
             break;
         }
@@ -348,6 +416,159 @@ BackendErrs_t BackendDumpPrintInstruction(BackendContext  *backend_context,
             break;
         }
 
+        case kLogicShlRegisterByImmediate:
+        {
+            DUMP_PRINT("\tshl %s, %d\n", RECEIVER_REGISTER,
+                                         IMMEDIATE);
+            break;
+        }
+
+        case kLogicShrRegisterByImmediate:
+        {
+            DUMP_PRINT("\tshr %s, %d\n", RECEIVER_REGISTER,
+                                         IMMEDIATE);
+            break;
+        }
+
+        case kLogicSarRegisterByImmediate:
+        {
+            DUMP_PRINT("\tsar %s, %d\n", RECEIVER_REGISTER,
+                                         IMMEDIATE);
+            break;
+        }
+
+        case kLogicLeaScaledIndex:
+        {
+            DUMP_PRINT("\tlea %s, [%s + %s * %d]\n", SOURCE_REGISTER,
+                                                    kRegisterArray[instruction->sib & kDestRegisterMask].name,
+                                                    kRegisterArray[(instruction->sib & kSrcRegisterMask) >> 3].name,
+                                                    1 << (instruction->sib >> 6));
+            break;
+        }
+
+        case kLogicImulRegisterByImmediate:
+        {
+            DUMP_PRINT("\timul %s, %s, %d\n", SOURCE_REGISTER,
+                                              RECEIVER_REGISTER,
+                                              IMMEDIATE);
+            break;
+        }
+
+        case kLogicNegRegister:
+        {
+            DUMP_PRINT("\tneg %s\n", RECEIVER_REGISTER);
+
+            break;
+        }
+
+        case kLogicCqo:
+        {
+            DUMP_PRINT("\tcqo\n");
+
+            break;
+        }
+
+        case kLogicRdtsc:
+        {
+            DUMP_PRINT("\trdtsc\n");
+
+            break;
+        }
+
+        case kLogicNop:
+        {
+            DUMP_PRINT("\tnop\n");
+
+            break;
+        }
+
+        case kLogicIncRipMemory:
+        {
+            DUMP_PRINT("\tinc qword [rip + profile]\n");
+
+            break;
+        }
+
+        case kLogicAddRegisterToRipMemory:
+        {
+            DUMP_PRINT("\tadd [rip + profile], %s\n", SOURCE_REGISTER);
+
+            break;
+        }
+
+        case kLogicLeaRipRelative:
+        {
+            DUMP_PRINT("\tlea %s, [rip + profile]\n", SOURCE_REGISTER);
+
+            break;
+        }
+
+        case kLogicMovsdMemoryToXmm:
+        {
+            DUMP_PRINT("\tmovsd %s, [%s + (%d)]\n", SOURCE_XMM_REGISTER,
+                                                    RECEIVER_REGISTER,
+                                                    DISPLACEMENT);
+            break;
+        }
+
+        case kLogicMovsdXmmToMemory:
+        {
+            DUMP_PRINT("\tmovsd [%s + (%d)], %s\n", RECEIVER_REGISTER,
+                                                    DISPLACEMENT,
+                                                    SOURCE_XMM_REGISTER);
+            break;
+        }
+
+        case kLogicMovqRegisterToXmm:
+        {
+            DUMP_PRINT("\tmovq %s, %s\n", SOURCE_XMM_REGISTER,
+                                          RECEIVER_REGISTER);
+            break;
+        }
+
+        case kLogicMovqXmmToRegister:
+        {
+            DUMP_PRINT("\tmovq %s, %s\n", RECEIVER_REGISTER,
+                                          SOURCE_XMM_REGISTER);
+            break;
+        }
+
+        case kLogicCvttsd2si:
+        {
+            DUMP_PRINT("\tcvttsd2si %s, %s\n", SOURCE_REGISTER,
+                                               RECEIVER_XMM_REGISTER);
+            break;
+        }
+
+        case kLogicCvtsi2sd:
+        {
+            DUMP_PRINT("\tcvtsi2sd %s, %s\n", SOURCE_XMM_REGISTER,
+                                              RECEIVER_REGISTER);
+            break;
+        }
+
+        case kLogicRoundsd:
+        {
+            DUMP_PRINT("\troundsd %s, %s, %d\n", SOURCE_XMM_REGISTER,
+                                                RECEIVER_XMM_REGISTER,
+                                                IMMEDIATE);
+            break;
+        }
+
+        case kLogicMovsdXmmToXmm:
+        case kLogicAddsd:
+        case kLogicSubsd:
+        case kLogicMulsd:
+        case kLogicDivsd:
+        case kLogicUcomisd:
+        case kLogicSqrtsd:
+        {
+            DUMP_PRINT("\t%s %s, %s\n", GetScalarDoubleMnemonic(instruction->logical_op_code),
+                                        SOURCE_XMM_REGISTER,
+                                        RECEIVER_XMM_REGISTER);
+            break;
+        }
+
         default:
         {
             ColorPrintf(kRed, "%s() - unknown opcode %d\n", __func__, instruction->logical_op_code);
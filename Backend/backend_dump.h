@@ -20,6 +20,9 @@ BackendErrs_t DumpPrintCommonLabel(int32_t identification_number);
 BackendErrs_t BackendDumpPrintCall(LanguageContext *language_context,
                                    int32_t          func_pos);
 
+BackendErrs_t BackendDumpPrintFuncJump(LanguageContext *language_context,
+                                       int32_t          func_pos);
+
 BackendErrs_t BackendDumpPrintFuncLabel(LanguageContext *language_context,
                                         int32_t          func_pos);
 
@@ -68,4 +71,16 @@ static const Register kRegisterArray[] =
 
 static size_t kRegisterArraySize = sizeof(kRegisterArray) / sizeof(Register);
 
+static const char *kXmmRegisterArray[] =
+{
+    "xmm0",
+    "xmm1",
+    "xmm2",
+    "xmm3",
+    "xmm4",
+    "xmm5",
+    "xmm6",
+    "xmm7",
+};
+
 #endif
@@ -0,0 +1,246 @@
+#ifndef BUILTIN_RUNTIME_HEADER
+#define BUILTIN_RUNTIME_HEADER
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Runtime that CreateElfExecutableFile() places after the program code.
+// It talks to the kernel with raw syscalls, so executables need neither
+// libc nor a dynamic loader. Only the integer I/O entry points exist here:
+// sin/cos and the double mode runtime still need lib/GVN.c.
+//
+// All functions follow the SysV calling convention. The state they share
+// lives in a separate read-write segment:
+//
+//     +0x00      output buffer fill
+//     +0x08      input buffer read position
+//     +0x10      input buffer fill
+//     +0x18      input end of file flag
+//     +0x20      output buffer, 64 KiB
+//     +0x10020   input buffer,  64 KiB
+//
+// Output is flushed when the buffer fills, before blocking on input, at
+// exit and on иди_нахуй.
+
+static constexpr uint8_t kBuiltinRuntimeCode[] =
+{
+    // _start:  (0x000)
+    0x31, 0xed,                                             // xor ebp,ebp
+    0x48, 0x83, 0xe4, 0xf0,                                 // and rsp,0xfffffffffffffff0
+    0xe8, 0x00, 0x00, 0x00, 0x00,                           // call main                       (patched)
+    0x48, 0x89, 0xc7,                                       // mov rdi,rax
+    0xeb, 0x00,                                             // jmp exit
+
+    // exit:  (0x010)
+    0x57,                                                   // push rdi
+    0xe8, 0x10, 0x00, 0x00, 0x00,                           // call flush
+    0x5f,                                                   // pop rdi
+    0xb8, 0xe7, 0x00, 0x00, 0x00,                           // mov eax,0xe7
+    0x0f, 0x05,                                             // syscall
+
+    // state:  (0x01e)
+    0x48, 0x8d, 0x05, 0x00, 0x00, 0x00, 0x00,               // lea rax, [rip + state]          (patched)
+    0xc3,                                                   // ret
+
+    // flush:  (0x026)
+    0x53,                                                   // push rbx
+    0xe8, 0xf2, 0xff, 0xff, 0xff,                           // call state
+    0x48, 0x89, 0xc3,                                       // mov rbx,rax
+    0x45, 0x31, 0xc0,                                       // xor r8d,r8d
+    0x48, 0x8b, 0x13,                                       // mov rdx,qword [rbx]
+    0x4c, 0x29, 0xc2,                                       // sub rdx,r8
+    0x7e, 0x21,                                             // jle flush+0x35
+    0x4a, 0x8d, 0x74, 0x03, 0x20,                           // lea rsi,[rbx+r8*1+0x20]
+    0xbf, 0x01, 0x00, 0x00, 0x00,                           // mov edi,0x1
+    0xb8, 0x01, 0x00, 0x00, 0x00,                           // mov eax,0x1
+    0x0f, 0x05,                                             // syscall
+    0x48, 0x83, 0xf8, 0xfc,                                 // cmp rax,0xfffffffffffffffc
+    0x74, 0xe1,                                             // je flush+0xc
+    0x48, 0x85, 0xc0,                                       // test rax,rax
+    0x7e, 0x05,                                             // jle flush+0x35
+    0x49, 0x01, 0xc0,                                       // add r8,rax
+    0xeb, 0xd7,                                             // jmp flush+0xc
+    0x48, 0xc7, 0x03, 0x00, 0x00, 0x00, 0x00,               // mov qword [rbx],0x0
+    0x5b,                                                   // pop rbx
+    0xc3,                                                   // ret
+
+    // peek:  (0x064)
+    0x48, 0x8b, 0x43, 0x08,                                 // mov rax,qword [rbx+0x8]
+    0x48, 0x3b, 0x43, 0x10,                                 // cmp rax,qword [rbx+0x10]
+    0x73, 0x09,                                             // jae peek+0x13
+    0x0f, 0xb6, 0x84, 0x03, 0x20, 0x00, 0x01, 0x00,         // movzx eax,byte [rbx+rax*1+0x10020]
+    0xc3,                                                   // ret
+    0x48, 0x83, 0x7b, 0x18, 0x00,                           // cmp qword [rbx+0x18],0x0
+    0x75, 0x46,                                             // jne peek+0x60
+    0xe8, 0xa3, 0xff, 0xff, 0xff,                           // call flush
+    0x31, 0xff,                                             // xor edi,edi
+    0x48, 0x8d, 0xb3, 0x20, 0x00, 0x01, 0x00,               // lea rsi,[rbx+0x10020]
+    0xba, 0x00, 0x00, 0x01, 0x00,                           // mov edx,0x10000
+    0x31, 0xc0,                                             // xor eax,eax
+    0x0f, 0x05,                                             // syscall
+    0x48, 0x83, 0xf8, 0xfc,                                 // cmp rax,0xfffffffffffffffc
+    0x74, 0xe8,                                             // je peek+0x1f
+    0x48, 0xc7, 0x43, 0x08, 0x00, 0x00, 0x00, 0x00,         // mov qword [rbx+0x8],0x0
+    0x48, 0x85, 0xc0,                                       // test rax,rax
+    0x7e, 0x0c,                                             // jle peek+0x50
+    0x48, 0x89, 0x43, 0x10,                                 // mov qword [rbx+0x10],rax
+    0x0f, 0xb6, 0x83, 0x20, 0x00, 0x01, 0x00,               // movzx eax,byte [rbx+0x10020]
+    0xc3,                                                   // ret
+    0x48, 0xc7, 0x43, 0x10, 0x00, 0x00, 0x00, 0x00,         // mov qword [rbx+0x10],0x0
+    0x48, 0xc7, 0x43, 0x18, 0x01, 0x00, 0x00, 0x00,         // mov qword [rbx+0x18],0x1
+    0xb8, 0xff, 0xff, 0xff, 0xff,                           // mov eax,0xffffffff
+    0xc3,                                                   // ret
+
+    // пишу_твоей_матери:  (0x0ca)
+    0x53,                                                   // push rbx
+    0xe8, 0x4e, 0xff, 0xff, 0xff,                           // call state
+    0x48, 0x89, 0xc3,                                       // mov rbx,rax
+    0x48, 0x81, 0x3b, 0xe0, 0xff, 0x00, 0x00,               // cmp qword [rbx],0xffe0
+    0x76, 0x07,                                             // jbe print+0x19
+    0x57,                                                   // push rdi
+    0xe8, 0x44, 0xff, 0xff, 0xff,                           // call flush
+    0x5f,                                                   // pop rdi
+    0x48, 0x83, 0xec, 0x20,                                 // sub rsp,0x20
+    0x48, 0x8d, 0x74, 0x24, 0x1f,                           // lea rsi,[rsp+0x1f]
+    0xc6, 0x06, 0x0a,                                       // mov byte [rsi],0xa
+    0x48, 0x89, 0xf8,                                       // mov rax,rdi
+    0x48, 0x85, 0xc0,                                       // test rax,rax
+    0x79, 0x03,                                             // jns print+0x30
+    0x48, 0xf7, 0xd8,                                       // neg rax
+    0xb9, 0x0a, 0x00, 0x00, 0x00,                           // mov ecx,0xa
+    0x31, 0xd2,                                             // xor edx,edx
+    0x48, 0xf7, 0xf1,                                       // div rcx
+    0x80, 0xc2, 0x30,                                       // add dl,0x30
+    0x48, 0xff, 0xce,                                       // dec rsi
+    0x88, 0x16,                                             // mov byte [rsi],dl
+    0x48, 0x85, 0xc0,                                       // test rax,rax
+    0x75, 0xee,                                             // jne print+0x35
+    0x48, 0x85, 0xff,                                       // test rdi,rdi
+    0x79, 0x06,                                             // jns print+0x52
+    0x48, 0xff, 0xce,                                       // dec rsi
+    0xc6, 0x06, 0x2d,                                       // mov byte [rsi],0x2d
+    0x48, 0x8d, 0x4c, 0x24, 0x20,                           // lea rcx,[rsp+0x20]
+    0x48, 0x29, 0xf1,                                       // sub rcx,rsi
+    0x48, 0x8b, 0x3b,                                       // mov rdi,qword [rbx]
+    0x48, 0x8d, 0x7c, 0x3b, 0x20,                           // lea rdi,[rbx+rdi*1+0x20]
+    0x48, 0x89, 0xc8,                                       // mov rax,rcx
+    0x48, 0x01, 0x0b,                                       // add qword [rbx],rcx
+    0xf3, 0xa4,                                             // rep movs byte es:[rdi],byte ds:[rsi]
+    0x48, 0x83, 0xc4, 0x20,                                 // add rsp,0x20
+    0x5b,                                                   // pop rbx
+    0xc3,                                                   // ret
+
+    // скажи_мне:  (0x13a)
+    0x53,                                                   // push rbx
+    0x41, 0x54,                                             // push r12
+    0x41, 0x55,                                             // push r13
+    0xe8, 0xda, 0xfe, 0xff, 0xff,                           // call state
+    0x48, 0x89, 0xc3,                                       // mov rbx,rax
+    0x45, 0x31, 0xe4,                                       // xor r12d,r12d
+    0x45, 0x31, 0xed,                                       // xor r13d,r13d
+    0xe8, 0x12, 0xff, 0xff, 0xff,                           // call peek
+    0x83, 0xf8, 0xff,                                       // cmp eax,0xffffffff
+    0x74, 0x3f,                                             // je scan+0x5c
+    0x83, 0xf8, 0x20,                                       // cmp eax,0x20
+    0x77, 0x06,                                             // ja scan+0x28
+    0x48, 0xff, 0x43, 0x08,                                 // inc qword [rbx+0x8]
+    0xeb, 0xeb,                                             // jmp scan+0x13
+    0x83, 0xf8, 0x2d,                                       // cmp eax,0x2d
+    0x75, 0x0c,                                             // jne scan+0x39
+    0x41, 0xbc, 0x01, 0x00, 0x00, 0x00,                     // mov r12d,0x1
+    0x48, 0xff, 0x43, 0x08,                                 // inc qword [rbx+0x8]
+    0xeb, 0x09,                                             // jmp scan+0x42
+    0x83, 0xf8, 0x2b,                                       // cmp eax,0x2b
+    0x75, 0x04,                                             // jne scan+0x42
+    0x48, 0xff, 0x43, 0x08,                                 // inc qword [rbx+0x8]
+    0xe8, 0xe3, 0xfe, 0xff, 0xff,                           // call peek
+    0x83, 0xe8, 0x30,                                       // sub eax,0x30
+    0x83, 0xf8, 0x09,                                       // cmp eax,0x9
+    0x77, 0x0d,                                             // ja scan+0x5c
+    0x4d, 0x6b, 0xed, 0x0a,                                 // imul r13,r13,0xa
+    0x49, 0x01, 0xc5,                                       // add r13,rax
+    0x48, 0xff, 0x43, 0x08,                                 // inc qword [rbx+0x8]
+    0xeb, 0xe6,                                             // jmp scan+0x42
+    0x4c, 0x89, 0xe8,                                       // mov rax,r13
+    0x4d, 0x85, 0xe4,                                       // test r12,r12
+    0x74, 0x03,                                             // je scan+0x67
+    0x48, 0xf7, 0xd8,                                       // neg rax
+    0x41, 0x5d,                                             // pop r13
+    0x41, 0x5c,                                             // pop r12
+    0x5b,                                                   // pop rbx
+    0xc3,                                                   // ret
+
+    // иди_нахуй:  (0x1a7)
+    0xe8, 0x7a, 0xfe, 0xff, 0xff,                           // call flush
+    0xb8, 0x27, 0x00, 0x00, 0x00,                           // mov eax,0x27
+    0x0f, 0x05,                                             // syscall
+    0x48, 0x89, 0xc7,                                       // mov rdi,rax
+    0xbe, 0x06, 0x00, 0x00, 0x00,                           // mov esi,0x6
+    0xb8, 0x3e, 0x00, 0x00, 0x00,                           // mov eax,0x3e
+    0x0f, 0x05,                                             // syscall
+    0xbf, 0x86, 0x00, 0x00, 0x00,                           // mov edi,0x86
+    0xb8, 0xe7, 0x00, 0x00, 0x00,                           // mov eax,0xe7
+    0x0f, 0x05,                                             // syscall
+};
+
+static constexpr size_t kBuiltinRuntimeSize = sizeof(kBuiltinRuntimeCode);
+
+static constexpr size_t kBuiltinStartOffset = 0x000;
+
+// rel32 of "call main" and disp32 of "lea rax, [rip + state]", both filled
+// in by the ELF writer, and the addresses they are relative to
+static constexpr size_t kBuiltinMainCallPatchOffset   = 0x007;
+static constexpr size_t kBuiltinMainCallNextOffset    = 0x00b;
+static constexpr size_t kBuiltinStatePatchOffset      = 0x021;
+static constexpr size_t kBuiltinStateNextOffset       = 0x025;
+
+static constexpr size_t kBuiltinStateSize = 0x20 + 2 * 0x10000;
+
+static constexpr size_t kBuiltinPrintOffset = 0x0ca;
+static constexpr size_t kBuiltinScanOffset  = 0x13a;
+static constexpr size_t kBuiltinAbortOffset = 0x1a7;
+
+struct BuiltinRuntimeFunc
+{
+    const char *func_name;
+
+    size_t      offset;
+};
+
+static const BuiltinRuntimeFunc kBuiltinRuntimeFuncs[] =
+{
+    {"пишу_твоей_матери", kBuiltinPrintOffset},
+    {"скажи_мне",         kBuiltinScanOffset},
+    {"иди_нахуй",         kBuiltinAbortOffset},
+};
+
+static constexpr size_t kBuiltinRuntimeFuncsCount = sizeof(kBuiltinRuntimeFuncs) / sizeof(BuiltinRuntimeFunc);
+
+// The offsets above are counted by hand, editing the code without updating
+// them must not build: every entry starts right after the ret of the code
+// before it and the patched fields follow their opcodes
+static_assert(kBuiltinRuntimeSize == 0x1ce, "builtin runtime size changed, recount the offsets");
+
+static_assert(kBuiltinRuntimeCode[kBuiltinMainCallPatchOffset - 1] == 0xe8 &&
+              kBuiltinMainCallNextOffset == kBuiltinMainCallPatchOffset + sizeof(int32_t),
+              "call main patch offset is off");
+static_assert(kBuiltinRuntimeCode[kBuiltinStatePatchOffset - 3] == 0x48 &&
+              kBuiltinRuntimeCode[kBuiltinStatePatchOffset - 2] == 0x8d &&
+              kBuiltinRuntimeCode[kBuiltinStatePatchOffset - 1] == 0x05 &&
+              kBuiltinStateNextOffset == kBuiltinStatePatchOffset + sizeof(int32_t),
+              "state lea patch offset is off");
+
+static_assert(kBuiltinRuntimeFuncsCount == 3, "builtin runtime entry added, check its offset below");
+
+static_assert(kBuiltinRuntimeCode[kBuiltinPrintOffset - 1] == 0xc3 &&
+              kBuiltinRuntimeCode[kBuiltinPrintOffset]     == 0x53,
+              "пишу_твоей_матери offset is off");
+static_assert(kBuiltinRuntimeCode[kBuiltinScanOffset - 1] == 0xc3 &&
+              kBuiltinRuntimeCode[kBuiltinScanOffset]     == 0x53 &&
+              kBuiltinRuntimeCode[kBuiltinScanOffset + 1] == 0x41,
+              "скажи_мне offset is off");
+static_assert(kBuiltinRuntimeCode[kBuiltinAbortOffset - 1] == 0xc3 &&
+              kBuiltinRuntimeCode[kBuiltinAbortOffset]     == 0xe8,
+              "иди_нахуй offset is off");
+
+#endif
@@ -0,0 +1,547 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include "compile_cache.h"
+#include "../debug/debug.h"
+#include "../debug/color_print.h"
+
+// bumped whenever the layout of cached files changes
+static const char   *kCompileCacheVersion    = "dota-compile-cache-1";
+
+static const char   *kCacheStatsFileName     = "stats";
+
+static const size_t  kBaseCacheEntryCapacity = 32;
+
+static const size_t  kHashReadBlockSize      = 64 * 1024;
+
+struct CacheEntry
+{
+    char   name[kCacheKeyLength + 1];
+
+    size_t size;
+
+    time_t last_use;
+};
+
+static BackendErrs_t HashFile(Sha256Context *sha_context,
+                              const char    *file_name);
+
+static BackendErrs_t CopyFile(const char *src_file_name,
+                              const char *dest_file_name,
+                              mode_t      mode);
+
+static BackendErrs_t UpdateCacheStats(CompileCache *cache,
+                                      bool          is_hit);
+
+static BackendErrs_t EvictCompileCache(CompileCache *cache);
+
+static bool IsCacheEntryName(const char *name);
+
+static int CompareCacheEntries(const void *lhs, const void *rhs);
+
+//==============================================================================
+
+BackendErrs_t CompileCacheInit(CompileCache *cache,
+                               const char   *dir,
+                               size_t        max_size)
+{
+    CHECK(cache);
+    CHECK(dir);
+
+    if (strlen(dir) >= kMaxCacheDirLength)
+    {
+        ColorPrintf(kRed, "%s() cache directory name is too long\n", __func__);
+
+        return kBackendFailedToOpenFile;
+    }
+
+    if (mkdir(dir, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) != 0 && errno != EEXIST)
+    {
+        ColorPrintf(kRed, "%s() failed to create cache directory %s\n", __func__, dir);
+
+        return kBackendFailedToOpenFile;
+    }
+
+    strcpy(cache->dir, dir);
+
+    cache->max_size = max_size;
+    cache->key[0]   = '\0';
+    cache->hits     = 0;
+    cache->misses   = 0;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// the key covers everything that can change the output: both frontend
+// files, the options and the compiler itself
+BackendErrs_t ComputeCompileCacheKey(CompileCache              *cache,
+                                     const char                *tree_file_name,
+                                     const char                *names_file_name,
+                                     const CompileCacheOptions *options)
+{
+    CHECK(cache);
+    CHECK(tree_file_name);
+    CHECK(names_file_name);
+    CHECK(options);
+
+    Sha256Context sha_context = {};
+
+    Sha256Init(&sha_context);
+
+    Sha256Update(&sha_context, kCompileCacheVersion, strlen(kCompileCacheVersion) + 1);
+
+    HashCompilerBinary(&sha_context);
+
+    uint8_t option_bytes[] =
+    {
+        options->is_double_mode,
+        options->is_fast_trig,
+        options->is_executable_output,
+        options->is_keeping_labels,
+        options->is_profiling,
+        options->debug_lines_file_name != nullptr,
+        options->profile_file_name     != nullptr,
+    };
+
+    Sha256Update(&sha_context, option_bytes, sizeof(option_bytes));
+
+    if (HashFile(&sha_context, tree_file_name)  != kBackendSuccess ||
+        HashFile(&sha_context, names_file_name) != kBackendSuccess ||
+        (options->debug_lines_file_name != nullptr &&
+         HashFile(&sha_context, options->debug_lines_file_name) != kBackendSuccess) ||
+        (options->profile_file_name != nullptr &&
+         HashFile(&sha_context, options->profile_file_name) != kBackendSuccess))
+    {
+        ColorPrintf(kRed, "%s() failed to read input files\n", __func__);
+
+        return kBackendFailedToOpenFile;
+    }
+
+    uint8_t digest[kSha256DigestSize] = {};
+
+    Sha256Final(&sha_context, digest);
+
+    for (size_t i = 0; i < kSha256DigestSize; i++)
+    {
+        snprintf(cache->key + 2 * i, 3, "%02x", digest[i]);
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t LookupCompileCache(CompileCache *cache,
+                                 const char   *output_file_name,
+                                 bool         *is_hit)
+{
+    CHECK(cache);
+    CHECK(output_file_name);
+    CHECK(is_hit);
+
+    char entry_file_name[kMaxCachePathLength] = {};
+
+    snprintf(entry_file_name, sizeof(entry_file_name), "%s/%s", cache->dir, cache->key);
+
+    struct stat entry_stat = {};
+
+    *is_hit = stat(entry_file_name, &entry_stat) == 0 &&
+              CopyFile(entry_file_name, output_file_name, entry_stat.st_mode & 0777) == kBackendSuccess;
+
+    if (*is_hit)
+    {
+        // mtime serves as the last use time for eviction
+        utimensat(AT_FDCWD, entry_file_name, nullptr, 0);
+    }
+
+    return UpdateCacheStats(cache, *is_hit);
+}
+
+//==============================================================================
+
+BackendErrs_t StoreCompileCache(CompileCache *cache,
+                                const char   *output_file_name)
+{
+    CHECK(cache);
+    CHECK(output_file_name);
+
+    struct stat output_stat = {};
+
+    if (stat(output_file_name, &output_stat) != 0)
+    {
+        ColorPrintf(kRed, "%s() there is no output file to store\n", __func__);
+
+        return kBackendFailedToOpenFile;
+    }
+
+    char entry_file_name[kMaxCachePathLength] = {};
+    char temp_file_name [kMaxCachePathLength] = {};
+
+    snprintf(entry_file_name, sizeof(entry_file_name), "%s/%s",        cache->dir, cache->key);
+    snprintf(temp_file_name,  sizeof(temp_file_name),  "%s/%s.%d.tmp", cache->dir, cache->key, (int) getpid());
+
+    // concurrent builds only ever see complete entries
+    if (CopyFile(output_file_name, temp_file_name, output_stat.st_mode & 0777) != kBackendSuccess ||
+        rename(temp_file_name, entry_file_name) != 0)
+    {
+        ColorPrintf(kRed, "%s() failed to store cache entry\n", __func__);
+
+        unlink(temp_file_name);
+
+        return kBackendFailedToOpenFile;
+    }
+
+    return EvictCompileCache(cache);
+}
+
+//==============================================================================
+
+static BackendErrs_t UpdateCacheStats(CompileCache *cache,
+                                      bool          is_hit)
+{
+    CHECK(cache);
+
+    char stats_file_name[kMaxCachePathLength] = {};
+
+    snprintf(stats_file_name, sizeof(stats_file_name), "%s/%s", cache->dir, kCacheStatsFileName);
+
+    int stats_fd = open(stats_file_name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+    if (stats_fd < 0)
+    {
+        ColorPrintf(kRed, "%s() failed to open cache stats\n", __func__);
+
+        return kBackendFailedToOpenFile;
+    }
+
+    flock(stats_fd, LOCK_EX);
+
+    char stats_text[128] = {};
+
+    ssize_t read_size = pread(stats_fd, stats_text, sizeof(stats_text) - 1, 0);
+
+    if (read_size <= 0 || sscanf(stats_text, "hits %zu misses %zu", &cache->hits, &cache->misses) != 2)
+    {
+        cache->hits   = 0;
+        cache->misses = 0;
+    }
+
+    if (is_hit)
+    {
+        cache->hits++;
+    }
+    else
+    {
+        cache->misses++;
+    }
+
+    int text_size = snprintf(stats_text, sizeof(stats_text), "hits %zu misses %zu\n", cache->hits, cache->misses);
+
+    if (ftruncate(stats_fd, 0) != 0 || pwrite(stats_fd, stats_text, (size_t) text_size, 0) != text_size)
+    {
+        ColorPrintf(kRed, "%s() failed to write cache stats\n", __func__);
+    }
+
+    flock(stats_fd, LOCK_UN);
+    close(stats_fd);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// drops least recently used entries until the cache fits into its limit,
+// the stats file lock keeps two builds from evicting at once
+static BackendErrs_t EvictCompileCache(CompileCache *cache)
+{
+    CHECK(cache);
+
+    char stats_file_name[kMaxCachePathLength] = {};
+
+    snprintf(stats_file_name, sizeof(stats_file_name), "%s/%s", cache->dir, kCacheStatsFileName);
+
+    int lock_fd = open(stats_file_name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+    DIR *cache_dir = opendir(cache->dir);
+
+    if (lock_fd < 0 || cache_dir == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed to open cache directory\n", __func__);
+
+        if (lock_fd >= 0)
+        {
+            close(lock_fd);
+        }
+
+        if (cache_dir != nullptr)
+        {
+            closedir(cache_dir);
+        }
+
+        return kBackendFailedToOpenFile;
+    }
+
+    flock(lock_fd, LOCK_EX);
+
+    CacheEntry *entries     = nullptr;
+    size_t      entry_count = 0;
+    size_t      capacity    = 0;
+    size_t      total_size  = 0;
+
+    BackendErrs_t error = kBackendSuccess;
+
+    for (struct dirent *dir_entry = readdir(cache_dir); dir_entry != nullptr; dir_entry = readdir(cache_dir))
+    {
+        if (!IsCacheEntryName(dir_entry->d_name))
+        {
+            continue;
+        }
+
+        char        entry_file_name[kMaxCachePathLength] = {};
+        struct stat entry_stat                = {};
+
+        snprintf(entry_file_name, sizeof(entry_file_name), "%s/%.*s", cache->dir, (int) kCacheKeyLength, dir_entry->d_name);
+
+        if (stat(entry_file_name, &entry_stat) != 0)
+        {
+            continue;
+        }
+
+        if (entry_count >= capacity)
+        {
+            size_t new_capacity = capacity == 0 ? kBaseCacheEntryCapacity : capacity * 2;
+
+            CacheEntry *new_entries = (CacheEntry *) realloc(entries, new_capacity * sizeof(CacheEntry));
+
+            if (new_entries == nullptr)
+            {
+                error = kBackendFailedAllocation;
+
+                break;
+            }
+
+            entries  = new_entries;
+            capacity = new_capacity;
+        }
+
+        strcpy(entries[entry_count].name, dir_entry->d_name);
+
+        entries[entry_count].size     = (size_t) entry_stat.st_size;
+        entries[entry_count].last_use = entry_stat.st_mtime;
+
+        total_size += entries[entry_count].size;
+
+        entry_count++;
+    }
+
+    if (error == kBackendSuccess && total_size > cache->max_size)
+    {
+        qsort(entries, entry_count, sizeof(CacheEntry), CompareCacheEntries);
+
+        for (size_t i = 0; i < entry_count && total_size > cache->max_size; i++)
+        {
+            char entry_file_name[kMaxCachePathLength] = {};
+
+            snprintf(entry_file_name, sizeof(entry_file_name), "%s/%s", cache->dir, entries[i].name);
+
+            if (unlink(entry_file_name) == 0)
+            {
+                total_size -= entries[i].size;
+            }
+        }
+    }
+
+    free(entries);
+
+    closedir(cache_dir);
+
+    flock(lock_fd, LOCK_UN);
+    close(lock_fd);
+
+    return error;
+}
+
+//==============================================================================
+
+static bool IsCacheEntryName(const char *name)
+{
+    CHECK(name);
+
+    if (strlen(name) != kCacheKeyLength)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < kCacheKeyLength; i++)
+    {
+        if (!((name[i] >= '0' && name[i] <= '9') || (name[i] >= 'a' && name[i] <= 'f')))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//==============================================================================
+
+static int CompareCacheEntries(const void *lhs, const void *rhs)
+{
+    const CacheEntry *lhs_entry = (const CacheEntry *) lhs;
+    const CacheEntry *rhs_entry = (const CacheEntry *) rhs;
+
+    if (lhs_entry->last_use != rhs_entry->last_use)
+    {
+        return lhs_entry->last_use < rhs_entry->last_use ? -1 : 1;
+    }
+
+    return strcmp(lhs_entry->name, rhs_entry->name);
+}
+
+//==============================================================================
+
+static BackendErrs_t CopyFile(const char *src_file_name,
+                              const char *dest_file_name,
+                              mode_t      mode)
+{
+    CHECK(src_file_name);
+    CHECK(dest_file_name);
+
+    FILE *src_file = fopen(src_file_name, "rb");
+
+    if (src_file == nullptr)
+    {
+        return kBackendFailedToOpenFile;
+    }
+
+    FILE *dest_file = fopen(dest_file_name, "wb");
+
+    if (dest_file == nullptr)
+    {
+        fclose(src_file);
+
+        return kBackendFailedToOpenFile;
+    }
+
+    uint8_t *buffer = (uint8_t *) malloc(kHashReadBlockSize);
+
+    BackendErrs_t error = buffer == nullptr ? kBackendFailedAllocation : kBackendSuccess;
+
+    size_t read_size = 0;
+
+    while (error == kBackendSuccess && (read_size = fread(buffer, sizeof(uint8_t), kHashReadBlockSize, src_file)) > 0)
+    {
+        if (fwrite(buffer, sizeof(uint8_t), read_size, dest_file) != read_size)
+        {
+            error = kBackendFailedToOpenFile;
+        }
+    }
+
+    if (error == kBackendSuccess && ferror(src_file))
+    {
+        error = kBackendFailedToOpenFile;
+    }
+
+    free(buffer);
+
+    fclose(src_file);
+
+    if (fclose(dest_file) != 0)
+    {
+        error = kBackendFailedToOpenFile;
+    }
+
+    if (error != kBackendSuccess)
+    {
+        unlink(dest_file_name);
+
+        return error;
+    }
+
+    chmod(dest_file_name, mode);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t HashFile(Sha256Context *sha_context,
+                              const char    *file_name)
+{
+    CHECK(sha_context);
+    CHECK(file_name);
+
+    FILE *file = fopen(file_name, "rb");
+
+    if (file == nullptr)
+    {
+        return kBackendFailedToOpenFile;
+    }
+
+    uint8_t *buffer = (uint8_t *) malloc(kHashReadBlockSize);
+
+    if (buffer == nullptr)
+    {
+        fclose(file);
+
+        return kBackendFailedAllocation;
+    }
+
+    uint64_t file_size = 0;
+    size_t   read_size = 0;
+
+    while ((read_size = fread(buffer, sizeof(uint8_t), kHashReadBlockSize, file)) > 0)
+    {
+        Sha256Update(sha_context, buffer, read_size);
+
+        file_size += read_size;
+    }
+
+    // the size terminates the file so that the boundary between the two
+    // inputs can't be shifted
+    Sha256Update(sha_context, &file_size, sizeof(file_size));
+
+    free(buffer);
+
+    BackendErrs_t error = ferror(file) ? kBackendFailedToOpenFile : kBackendSuccess;
+
+    fclose(file);
+
+    return error;
+}
+
+//==============================================================================
+
+// hashing the whole binary on every run would cost more than a cache hit
+// saves, its size and modification time identify a rebuild well enough
+BackendErrs_t HashCompilerBinary(Sha256Context *sha_context)
+{
+    CHECK(sha_context);
+
+    struct stat binary_stat = {};
+
+    if (stat("/proc/self/exe", &binary_stat) != 0)
+    {
+        return kBackendFailedToOpenFile;
+    }
+
+    int64_t binary_id[] =
+    {
+        (int64_t) binary_stat.st_size,
+        (int64_t) binary_stat.st_mtim.tv_sec,
+        (int64_t) binary_stat.st_mtim.tv_nsec,
+    };
+
+    return Sha256Update(sha_context, binary_id, sizeof(binary_id));
+}
+
+//==============================================================================
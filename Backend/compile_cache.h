@@ -0,0 +1,67 @@
+#ifndef COMPILE_CACHE_HEADER
+#define COMPILE_CACHE_HEADER
+
+#include "backend.h"
+#include "sha256.h"
+
+static const char   *kCacheFlag          = "--cache";
+static const char   *kCacheSizeFlag      = "--cache-size";
+
+static const size_t  kDefaultCacheSizeMb = 256;
+
+static const size_t  kCacheKeyLength     = 64;
+
+static const size_t  kMaxCacheDirLength  = 1024;
+
+// directory, slash, key and a temporary file suffix
+static const size_t  kMaxCachePathLength = kMaxCacheDirLength + kCacheKeyLength + 32;
+
+struct CompileCacheOptions
+{
+    bool is_double_mode;
+
+    bool is_fast_trig;
+
+    bool is_executable_output;
+
+    bool is_keeping_labels;
+
+    bool is_profiling;
+
+    const char *debug_lines_file_name;
+
+    const char *profile_file_name;
+};
+
+struct CompileCache
+{
+    char   dir[kMaxCacheDirLength];
+
+    size_t max_size;
+
+    char   key[kCacheKeyLength + 1];
+
+    size_t hits;
+
+    size_t misses;
+};
+
+BackendErrs_t CompileCacheInit(CompileCache *cache,
+                               const char   *dir,
+                               size_t        max_size);
+
+BackendErrs_t ComputeCompileCacheKey(CompileCache              *cache,
+                                     const char                *tree_file_name,
+                                     const char                *names_file_name,
+                                     const CompileCacheOptions *options);
+
+BackendErrs_t LookupCompileCache(CompileCache *cache,
+                                 const char   *output_file_name,
+                                 bool         *is_hit);
+
+BackendErrs_t StoreCompileCache(CompileCache *cache,
+                                const char   *output_file_name);
+
+BackendErrs_t HashCompilerBinary(Sha256Context *sha_context);
+
+#endif
@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tree_optimizer.h"
+#include "../debug/debug.h"
+#include "../debug/color_print.h"
+
+static TreeErrs_t EliminateFuncDeadCode(LanguageContext *language_context,
+                                        TreeNode        *func_node);
+
+static TreeErrs_t SimplifyStatementList(TreeNode **list);
+
+static TreeErrs_t SpliceBranchBody(TreeNode **statement_link);
+
+static TreeErrs_t MarkReadVariables(const TreeNode *node,
+                                    bool           *is_read);
+
+static TreeErrs_t RemoveDeadStores(TreeNode   **list,
+                                   const bool  *is_read);
+
+static bool GetStoreTarget(TreeNode   *statement,
+                           size_t     *target_pos,
+                           TreeNode ***value_link);
+
+//==============================================================================
+
+TreeErrs_t EliminateDeadCode(LanguageContext *language_context)
+{
+    CHECK(language_context);
+
+    TreeErrs_t status = kTreeNotOptimized;
+
+    for (TreeNode *cur_decl = language_context->syntax_tree.root;
+                   cur_decl != nullptr;
+                   cur_decl = cur_decl->right)
+    {
+        if (cur_decl->left != nullptr && cur_decl->left->type == kFuncDef)
+        {
+            if (EliminateFuncDeadCode(language_context, cur_decl->left) == kTreeOptimized)
+            {
+                status = kTreeOptimized;
+            }
+        }
+    }
+
+    return status;
+}
+
+//==============================================================================
+
+static TreeErrs_t EliminateFuncDeadCode(LanguageContext *language_context,
+                                        TreeNode        *func_node)
+{
+    CHECK(language_context);
+    CHECK(func_node);
+
+    TreeNode *params_node = func_node->right;
+
+    if (params_node == nullptr)
+    {
+        return kTreeNotOptimized;
+    }
+
+    bool *is_read = (bool *) calloc(language_context->identifiers.identifier_count, sizeof(bool));
+
+    if (is_read == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kFailedAllocation;
+    }
+
+    TreeErrs_t status  = kTreeNotOptimized;
+    bool       changed = true;
+
+    while (changed)
+    {
+        changed = false;
+
+        if (SimplifyStatementList(&params_node->right) == kTreeOptimized)
+        {
+            changed = true;
+        }
+
+        for (size_t i = 0; i < language_context->identifiers.identifier_count; i++)
+        {
+            is_read[i] = false;
+        }
+
+        MarkReadVariables(params_node->right, is_read);
+
+        if (RemoveDeadStores(&params_node->right, is_read) == kTreeOptimized)
+        {
+            changed = true;
+        }
+
+        if (changed)
+        {
+            status = kTreeOptimized;
+        }
+    }
+
+    free(is_read);
+
+    return status;
+}
+
+//==============================================================================
+
+static TreeErrs_t SimplifyStatementList(TreeNode **list)
+{
+    CHECK(list);
+
+    TreeErrs_t status = kTreeNotOptimized;
+
+    TreeNode **link = list;
+
+    while (*link != nullptr)
+    {
+        TreeNode *statement = (*link)->left;
+
+        if (statement != nullptr && statement->type == kOperator &&
+            (statement->data.key_word_code == kIf || statement->data.key_word_code == kWhile))
+        {
+            int64_t condition = 0;
+
+            if (EvalConstantExpression(statement->left, &condition))
+            {
+                if (condition == 0)
+                {
+                    RemoveStatement(link);
+
+                    status = kTreeOptimized;
+
+                    continue;
+                }
+
+                if (statement->data.key_word_code == kIf)
+                {
+                    SpliceBranchBody(link);
+
+                    status = kTreeOptimized;
+
+                    continue;
+                }
+            }
+
+            if (SimplifyStatementList(&statement->right) == kTreeOptimized)
+            {
+                status = kTreeOptimized;
+            }
+        }
+
+        if (IsTerminatorStatement(statement) && (*link)->right != nullptr)
+        {
+            TreeDtor((*link)->right);
+
+            (*link)->right = nullptr;
+
+            status = kTreeOptimized;
+        }
+
+        link = &(*link)->right;
+    }
+
+    return status;
+}
+
+//==============================================================================
+
+static TreeErrs_t SpliceBranchBody(TreeNode **statement_link)
+{
+    CHECK(statement_link);
+
+    TreeNode *list_node = *statement_link;
+    TreeNode *body      = list_node->left->right;
+
+    if (body == nullptr)
+    {
+        return RemoveStatement(statement_link);
+    }
+
+    list_node->left->right = nullptr;
+
+    TreeNode *body_tail = body;
+
+    while (body_tail->right != nullptr)
+    {
+        body_tail = body_tail->right;
+    }
+
+    body_tail->right = list_node->right;
+    list_node->right = nullptr;
+
+    *statement_link = body;
+
+    TreeDtor(list_node);
+
+    return kTreeOptimized;
+}
+
+//==============================================================================
+
+static TreeErrs_t MarkReadVariables(const TreeNode *node,
+                                    bool           *is_read)
+{
+    CHECK(is_read);
+
+    if (node == nullptr)
+    {
+        return kTreeSuccess;
+    }
+
+    switch (node->type)
+    {
+        case kIdentifier:
+        {
+            is_read[node->data.variable_pos] = true;
+
+            break;
+        }
+
+        case kVarDecl:
+        {
+            if (node->right != nullptr && node->right->type != kIdentifier)
+            {
+                MarkReadVariables(node->right, is_read);
+            }
+
+            break;
+        }
+
+        case kCall:
+        {
+            MarkReadVariables(node->left, is_read);
+
+            break;
+        }
+
+        case kOperator:
+        {
+            if (node->data.key_word_code == kAssign)
+            {
+                MarkReadVariables(node->left, is_read);
+
+                break;
+            }
+
+            MarkReadVariables(node->left,  is_read);
+            MarkReadVariables(node->right, is_read);
+
+            break;
+        }
+
+        case kConstNumber:
+        case kFuncDef:
+        case kParamsNode:
+        default:
+        {
+            MarkReadVariables(node->left,  is_read);
+            MarkReadVariables(node->right, is_read);
+
+            break;
+        }
+    }
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+static bool GetStoreTarget(TreeNode   *statement,
+                           size_t     *target_pos,
+                           TreeNode ***value_link)
+{
+    CHECK(target_pos);
+    CHECK(value_link);
+
+    if (statement == nullptr)
+    {
+        return false;
+    }
+
+    if (statement->type == kOperator && statement->data.key_word_code == kAssign &&
+        statement->right != nullptr  && statement->right->type == kIdentifier)
+    {
+        *target_pos = statement->right->data.variable_pos;
+        *value_link = &statement->left;
+
+        return true;
+    }
+
+    if (statement->type == kVarDecl && statement->right != nullptr)
+    {
+        *target_pos = statement->data.variable_pos;
+        *value_link = nullptr;
+
+        if (statement->right->type != kIdentifier)
+        {
+            *value_link = &statement->right->left;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+//==============================================================================
+
+static TreeErrs_t RemoveDeadStores(TreeNode   **list,
+                                   const bool  *is_read)
+{
+    CHECK(list);
+    CHECK(is_read);
+
+    TreeErrs_t status = kTreeNotOptimized;
+
+    TreeNode **link = list;
+
+    while (*link != nullptr)
+    {
+        TreeNode *statement = (*link)->left;
+
+        size_t     target_pos = 0;
+        TreeNode **value_link = nullptr;
+
+        if (GetStoreTarget(statement, &target_pos, &value_link) && !is_read[target_pos])
+        {
+            if (value_link == nullptr || IsPureExpression(*value_link))
+            {
+                RemoveStatement(link);
+            }
+            else
+            {
+                (*link)->left = *value_link;
+                *value_link   = nullptr;
+
+                TreeDtor(statement);
+
+                link = &(*link)->right;
+            }
+
+            status = kTreeOptimized;
+
+            continue;
+        }
+
+        if (statement != nullptr && statement->type == kOperator &&
+            (statement->data.key_word_code == kIf || statement->data.key_word_code == kWhile))
+        {
+            if (RemoveDeadStores(&statement->right, is_read) == kTreeOptimized)
+            {
+                status = kTreeOptimized;
+            }
+        }
+
+        link = &(*link)->right;
+    }
+
+    return status;
+}
+
+//==============================================================================
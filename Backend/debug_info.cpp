@@ -0,0 +1,490 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug_info.h"
+#include "elf_ctor.h"
+#include "../debug/debug.h"
+#include "../debug/color_print.h"
+
+static BackendErrs_t BuildDebugAbbrev(DebugSections *sections);
+
+static BackendErrs_t BuildDebugInfo(BackendContext  *backend_context,
+                                    LanguageContext *language_context,
+                                    DebugSections   *sections);
+
+static BackendErrs_t BuildDebugLine(BackendContext *backend_context,
+                                    DebugSections  *sections);
+
+static BackendErrs_t WriteLineRow(DebugBuffer *line,
+                                  size_t       address_delta,
+                                  int64_t      line_delta);
+
+
+static const uint8_t kCompileUnitAbbrev = 1;
+static const uint8_t kSubprogramAbbrev  = 2;
+
+//==============================================================================
+
+// Expects the symbol table to be sorted already, the relocations refer to
+// the final symbol indices.
+BackendErrs_t BuildDebugSections(BackendContext  *backend_context,
+                                 LanguageContext *language_context,
+                                 DebugSections   *sections)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(sections);
+
+    BackendErrs_t error = BuildDebugAbbrev(sections);
+
+    if (error == kBackendSuccess)
+    {
+        error = BuildDebugInfo(backend_context, language_context, sections);
+    }
+
+    if (error == kBackendSuccess)
+    {
+        error = BuildDebugLine(backend_context, sections);
+    }
+
+    return error;
+}
+
+//==============================================================================
+
+BackendErrs_t DestroyDebugSections(DebugSections *sections)
+{
+    CHECK(sections);
+
+    free(sections->abbrev.data);
+    free(sections->info.data);
+    free(sections->line.data);
+    free(sections->info_relocations.relocation_array);
+    free(sections->line_relocations.relocation_array);
+
+    memset(sections, 0, sizeof(DebugSections));
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t BuildDebugAbbrev(DebugSections *sections)
+{
+    CHECK(sections);
+
+    static const uint8_t kAbbrevTable[] =
+    {
+        kCompileUnitAbbrev, kDwTagCompileUnit, kDwChildrenYes,
+            kDwAtProducer, kDwFormString,
+            kDwAtLanguage, kDwFormData2,
+            kDwAtName,     kDwFormString,
+            kDwAtLowPc,    kDwFormAddr,
+            kDwAtHighPc,   kDwFormData8,
+            kDwAtStmtList, kDwFormSecOffset,
+            0, 0,
+
+        kSubprogramAbbrev, kDwTagSubprogram, kDwChildrenNo,
+            kDwAtName,     kDwFormString,
+            kDwAtExternal, kDwFormFlagPresent,
+            kDwAtLowPc,    kDwFormAddr,
+            kDwAtHighPc,   kDwFormData8,
+            0, 0,
+
+        0,
+    };
+
+    return WriteDebugData(&sections->abbrev, kAbbrevTable, sizeof(kAbbrevTable));
+}
+
+//==============================================================================
+
+// One compile unit covering the whole .text with a subprogram per function
+static BackendErrs_t BuildDebugInfo(BackendContext  *backend_context,
+                                    LanguageContext *language_context,
+                                    DebugSections   *sections)
+{
+    CHECK(backend_context);
+    CHECK(language_context);
+    CHECK(sections);
+
+    DebugBuffer *info = &sections->info;
+
+    size_t text_symbol   = FindSectionSymbol(backend_context->symbol_table, kSectionTextIndex);
+    size_t abbrev_symbol = FindSectionSymbol(backend_context->symbol_table, kSectionDebugAbbrevIndex);
+    size_t line_symbol   = FindSectionSymbol(backend_context->symbol_table, kSectionDebugLineIndex);
+
+    uint32_t unit_length   = 0;
+    uint32_t null_offset   = 0;
+    uint64_t null_address  = 0;
+    uint64_t text_size     = backend_context->cur_address;
+
+    WriteDebugData(info, &unit_length,   sizeof(unit_length));
+    WriteDebugData(info, &kDwarfVersion, sizeof(kDwarfVersion));
+
+    AddDebugRelocation(&sections->info_relocations, info->size, abbrev_symbol, R_X86_64_32, 0);
+
+    WriteDebugData(info, &null_offset, sizeof(null_offset));
+    WriteDebugByte(info, kDwarfAddressSize);
+
+    WriteUleb128    (info, kCompileUnitAbbrev);
+    WriteDebugString(info, kDebugProducer);
+    WriteDebugData  (info, &kDwLangMipsAssembler, sizeof(kDwLangMipsAssembler));
+    WriteDebugString(info, backend_context->source_file_name);
+
+    AddDebugRelocation(&sections->info_relocations, info->size, text_symbol, R_X86_64_64, 0);
+
+    WriteDebugData(info, &null_address, sizeof(null_address));
+    WriteDebugData(info, &text_size,    sizeof(text_size));
+
+    AddDebugRelocation(&sections->info_relocations, info->size, line_symbol, R_X86_64_32, 0);
+
+    WriteDebugData(info, &null_offset, sizeof(null_offset));
+
+    // functions are laid out one after another, so a function ends where
+    // the next one begins
+    LabelTable  *label_table = backend_context->label_table;
+    const Label *func_label  = nullptr;
+
+    for (size_t i = 0; i <= label_table->label_count; i++)
+    {
+        const Label *label = i < label_table->label_count ? &label_table->label_array[i] : nullptr;
+
+        if (label != nullptr && label->func_pos == kFuncLabelPosPoison)
+        {
+            continue;
+        }
+
+        if (func_label != nullptr)
+        {
+            uint64_t func_size = (label != nullptr ? label->address : backend_context->cur_address) - func_label->address;
+
+            WriteUleb128    (info, kSubprogramAbbrev);
+            WriteDebugString(info, GetFunctionName(language_context, func_label->func_pos));
+
+            AddDebugRelocation(&sections->info_relocations, info->size, text_symbol, R_X86_64_64, func_label->address);
+
+            WriteDebugData(info, &null_address, sizeof(null_address));
+            WriteDebugData(info, &func_size,    sizeof(func_size));
+        }
+
+        func_label = label;
+    }
+
+    WriteDebugByte(info, 0);
+
+    return PatchDebugWord(info, 0, (uint32_t) (info->size - sizeof(unit_length)));
+}
+
+//==============================================================================
+
+// A single sequence over .text. Statements that produced no code give
+// their address to the next statement, and rows that don't change the
+// line are dropped.
+static BackendErrs_t BuildDebugLine(BackendContext *backend_context,
+                                    DebugSections  *sections)
+{
+    CHECK(backend_context);
+    CHECK(sections);
+
+    DebugBuffer *line = &sections->line;
+
+    size_t text_symbol = FindSectionSymbol(backend_context->symbol_table, kSectionTextIndex);
+
+    uint32_t unit_length   = 0;
+    uint32_t header_length = 0;
+    uint64_t null_address  = 0;
+
+    WriteDebugData(line, &unit_length,   sizeof(unit_length));
+    WriteDebugData(line, &kDwarfVersion, sizeof(kDwarfVersion));
+
+    size_t header_length_pos = line->size;
+
+    WriteDebugData(line, &header_length, sizeof(header_length));
+
+    WriteDebugByte(line, 1);                    // minimum_instruction_length
+    WriteDebugByte(line, 1);                    // maximum_operations_per_instruction
+    WriteDebugByte(line, 1);                    // default_is_stmt
+    WriteDebugByte(line, (uint8_t) kLineBase);
+    WriteDebugByte(line, kLineRange);
+    WriteDebugByte(line, kOpcodeBase);
+    WriteDebugData(line, kStandardOpcodeLengths, sizeof(kStandardOpcodeLengths));
+
+    WriteDebugByte(line, 0);                    // no include directories
+
+    WriteDebugString(line, backend_context->source_file_name);
+    WriteUleb128    (line, 0);                  // directory
+    WriteUleb128    (line, 0);                  // modification time
+    WriteUleb128    (line, 0);                  // file size
+    WriteDebugByte  (line, 0);
+
+    PatchDebugWord(line, header_length_pos, (uint32_t) (line->size - header_length_pos - sizeof(header_length)));
+
+    WriteDebugByte(line, 0);
+    WriteUleb128  (line, 1 + sizeof(null_address));
+    WriteDebugByte(line, kDwLneSetAddress);
+
+    AddDebugRelocation(&sections->line_relocations, line->size, text_symbol, R_X86_64_64, 0);
+
+    WriteDebugData(line, &null_address, sizeof(null_address));
+
+    LineTable *line_table = backend_context->line_table;
+
+    // the state machine starts at line 1, but nothing is emitted yet
+    size_t  cur_address  = 0;
+    int64_t cur_line     = 1;
+    bool    is_first_row = true;
+
+    for (size_t i = 0; i < line_table->row_count; i++)
+    {
+        LineRow *row = &line_table->rows[i];
+
+        if ((i + 1 < line_table->row_count && line_table->rows[i + 1].address == row->address) ||
+            row->address < cur_address || (!is_first_row && (int64_t) row->line_number == cur_line))
+        {
+            continue;
+        }
+
+        WriteLineRow(line, row->address - cur_address, (int64_t) row->line_number - cur_line);
+
+        cur_address  = row->address;
+        cur_line     = row->line_number;
+        is_first_row = false;
+    }
+
+    WriteDebugByte(line, kDwLnsAdvancePc);
+    WriteUleb128  (line, backend_context->cur_address - cur_address);
+
+    WriteDebugByte(line, 0);
+    WriteUleb128  (line, 1);
+    WriteDebugByte(line, kDwLneEndSequence);
+
+    return PatchDebugWord(line, 0, (uint32_t) (line->size - sizeof(unit_length)));
+}
+
+//==============================================================================
+
+// Uses a one byte special opcode when the deltas fit into it
+static BackendErrs_t WriteLineRow(DebugBuffer *line,
+                                  size_t       address_delta,
+                                  int64_t      line_delta)
+{
+    CHECK(line);
+
+    if (line_delta >= kLineBase && line_delta < kLineBase + kLineRange)
+    {
+        size_t special_opcode = (size_t) (line_delta - kLineBase) + kLineRange * address_delta + kOpcodeBase;
+
+        if (special_opcode <= UINT8_MAX)
+        {
+            return WriteDebugByte(line, (uint8_t) special_opcode);
+        }
+    }
+
+    if (address_delta != 0)
+    {
+        WriteDebugByte(line, kDwLnsAdvancePc);
+        WriteUleb128  (line, address_delta);
+    }
+
+    if (line_delta != 0)
+    {
+        WriteDebugByte(line, kDwLnsAdvanceLine);
+        WriteSleb128  (line, line_delta);
+    }
+
+    return WriteDebugByte(line, kDwLnsCopy);
+}
+
+//==============================================================================
+
+BackendErrs_t WriteDebugData(DebugBuffer *buffer,
+                             const void  *data,
+                             size_t       size)
+{
+    CHECK(buffer);
+    CHECK(data);
+
+    if (buffer->size + size > buffer->capacity)
+    {
+        size_t new_capacity = buffer->capacity == 0 ? kBaseDebugBufferCapacity : buffer->capacity;
+
+        while (buffer->size + size > new_capacity)
+        {
+            new_capacity *= 2;
+        }
+
+        uint8_t *new_data = (uint8_t *) realloc(buffer->data, new_capacity);
+
+        if (new_data == nullptr)
+        {
+            ColorPrintf(kRed, "%s() failed reallocation\n", __func__);
+
+            return kBackendFailedAllocation;
+        }
+
+        buffer->data     = new_data;
+        buffer->capacity = new_capacity;
+    }
+
+    memcpy(buffer->data + buffer->size, data, size);
+
+    buffer->size += size;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t WriteDebugByte(DebugBuffer *buffer,
+                             uint8_t      byte)
+{
+    return WriteDebugData(buffer, &byte, sizeof(byte));
+}
+
+//==============================================================================
+
+BackendErrs_t WriteDebugString(DebugBuffer *buffer,
+                               const char  *str)
+{
+    CHECK(str);
+
+    return WriteDebugData(buffer, str, strlen(str) + 1);
+}
+
+//==============================================================================
+
+BackendErrs_t WriteUleb128(DebugBuffer *buffer,
+                           uint64_t     value)
+{
+    do
+    {
+        uint8_t byte = value & 0x7f;
+
+        value >>= 7;
+
+        if (value != 0)
+        {
+            byte |= 0x80;
+        }
+
+        WriteDebugByte(buffer, byte);
+    }
+    while (value != 0);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t WriteSleb128(DebugBuffer *buffer,
+                           int64_t      value)
+{
+    bool is_last_byte = false;
+
+    while (!is_last_byte)
+    {
+        uint8_t byte = value & 0x7f;
+
+        value >>= 7;
+
+        is_last_byte = (value ==  0 && (byte & 0x40) == 0) ||
+                       (value == -1 && (byte & 0x40) != 0);
+
+        if (!is_last_byte)
+        {
+            byte |= 0x80;
+        }
+
+        WriteDebugByte(buffer, byte);
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t PatchDebugWord(DebugBuffer *buffer,
+                             size_t       pos,
+                             uint32_t     value)
+{
+    CHECK(buffer);
+
+    memcpy(buffer->data + pos, &value, sizeof(value));
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t AddDebugRelocation(RelocationTable *relocation_table,
+                                 Elf64_Addr       offset,
+                                 size_t           symbol_index,
+                                 uint32_t         type,
+                                 Elf64_Sxword     addend)
+{
+    CHECK(relocation_table);
+
+    if (relocation_table->relocation_count >= relocation_table->capacity)
+    {
+        size_t new_capacity = relocation_table->capacity == 0 ? kBaseRelocationTableCapacity :
+                                                                relocation_table->capacity * 2;
+
+        Elf64_Rela *new_array = (Elf64_Rela *) realloc(relocation_table->relocation_array,
+                                                       new_capacity * sizeof(Elf64_Rela));
+
+        if (new_array == nullptr)
+        {
+            ColorPrintf(kRed, "%s() failed reallocation\n", __func__);
+
+            return kBackendFailedAllocation;
+        }
+
+        relocation_table->relocation_array = new_array;
+        relocation_table->capacity         = new_capacity;
+    }
+
+    Elf64_Rela *relocation = &relocation_table->relocation_array[relocation_table->relocation_count++];
+
+    relocation->r_offset = offset;
+    relocation->r_info   = ELF64_R_INFO(symbol_index, type);
+    relocation->r_addend = addend;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+size_t FindSectionSymbol(SymbolTable *symbol_table,
+                         size_t       section_index)
+{
+    CHECK(symbol_table);
+
+    for (size_t i = 0; i < symbol_table->sym_count; i++)
+    {
+        if (ELF64_ST_TYPE(symbol_table->sym_array[i].st_info) == STT_SECTION &&
+            symbol_table->sym_array[i].st_shndx == section_index)
+        {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+//==============================================================================
+
+const char *GetFunctionName(LanguageContext *language_context,
+                            int32_t          func_pos)
+{
+    CHECK(language_context);
+
+    if ((size_t) func_pos == language_context->tables.main_id_pos)
+    {
+        return kAsmMainName;
+    }
+
+    return language_context->identifiers.identifier_array[func_pos].id;
+}
+
+//==============================================================================
@@ -0,0 +1,114 @@
+#ifndef DEBUG_INFO_HEADER
+#define DEBUG_INFO_HEADER
+
+#include "backend.h"
+
+static const size_t   kBaseDebugBufferCapacity = 256;
+
+static const uint16_t kDwarfVersion            = 4;
+static const uint8_t  kDwarfAddressSize        = 8;
+
+static const uint8_t  kDwTagCompileUnit        = 0x11;
+static const uint8_t  kDwTagSubprogram         = 0x2e;
+
+static const uint8_t  kDwChildrenNo            = 0x00;
+static const uint8_t  kDwChildrenYes           = 0x01;
+
+static const uint8_t  kDwAtName                = 0x03;
+static const uint8_t  kDwAtStmtList            = 0x10;
+static const uint8_t  kDwAtLowPc               = 0x11;
+static const uint8_t  kDwAtHighPc              = 0x12;
+static const uint8_t  kDwAtLanguage            = 0x13;
+static const uint8_t  kDwAtProducer            = 0x25;
+static const uint8_t  kDwAtExternal            = 0x3f;
+
+static const uint8_t  kDwFormAddr              = 0x01;
+static const uint8_t  kDwFormData2             = 0x05;
+static const uint8_t  kDwFormData8             = 0x07;
+static const uint8_t  kDwFormString            = 0x08;
+static const uint8_t  kDwFormSecOffset         = 0x17;
+static const uint8_t  kDwFormFlagPresent       = 0x19;
+
+// the language has no types, so it is described the way assemblers do
+static const uint16_t kDwLangMipsAssembler     = 0x8001;
+
+static const uint8_t  kDwLnsCopy               = 0x01;
+static const uint8_t  kDwLnsAdvancePc          = 0x02;
+static const uint8_t  kDwLnsAdvanceLine        = 0x03;
+
+static const uint8_t  kDwLneEndSequence        = 0x01;
+static const uint8_t  kDwLneSetAddress         = 0x02;
+
+static const int8_t   kLineBase                = -5;
+static const uint8_t  kLineRange               = 14;
+static const uint8_t  kOpcodeBase              = 13;
+
+static const uint8_t  kStandardOpcodeLengths[kOpcodeBase - 1] = {0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1};
+
+static const char    *kDebugProducer           = "DOTA compiler";
+
+struct DebugBuffer
+{
+    uint8_t *data;
+
+    size_t   size;
+
+    size_t   capacity;
+};
+
+// Contents of the debug sections and of the relocations that tie them to
+// .text and to each other
+struct DebugSections
+{
+    DebugBuffer     abbrev;
+
+    DebugBuffer     info;
+
+    DebugBuffer     line;
+
+    RelocationTable info_relocations;
+
+    RelocationTable line_relocations;
+};
+
+BackendErrs_t BuildDebugSections(BackendContext  *backend_context,
+                                 LanguageContext *language_context,
+                                 DebugSections   *sections);
+
+BackendErrs_t DestroyDebugSections(DebugSections *sections);
+
+// shared with the .eh_frame builder
+
+BackendErrs_t WriteDebugData(DebugBuffer *buffer,
+                             const void  *data,
+                             size_t       size);
+
+BackendErrs_t WriteDebugByte(DebugBuffer *buffer,
+                             uint8_t      byte);
+
+BackendErrs_t WriteDebugString(DebugBuffer *buffer,
+                               const char  *str);
+
+BackendErrs_t WriteUleb128(DebugBuffer *buffer,
+                           uint64_t     value);
+
+BackendErrs_t WriteSleb128(DebugBuffer *buffer,
+                           int64_t      value);
+
+BackendErrs_t PatchDebugWord(DebugBuffer *buffer,
+                             size_t       pos,
+                             uint32_t     value);
+
+BackendErrs_t AddDebugRelocation(RelocationTable *relocation_table,
+                                 Elf64_Addr       offset,
+                                 size_t           symbol_index,
+                                 uint32_t         type,
+                                 Elf64_Sxword     addend);
+
+size_t FindSectionSymbol(SymbolTable *symbol_table,
+                         size_t       section_index);
+
+const char *GetFunctionName(LanguageContext *language_context,
+                            int32_t          func_pos);
+
+#endif
@@ -1,16 +1,34 @@
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 #include "elf_ctor.h"
+#include "profile.h"
+#include "../debug/time_passes.h"
+#include "builtin_runtime.h"
 
 #include "instruction_encoding.h"
 
-static BackendErrs_t SetRelocatableFileHeader(RelocatableFile *rel_file);
+static BackendErrs_t SetRelocatableFileHeader(RelocatableFile *rel_file,
+                                              uint16_t         section_header_count);
+
+static BackendErrs_t WriteElf(BackendContext      *backend_context,
+                              RelocatableFile     *rel_file,
+                              const UnwindSection *unwind_section,
+                              const DebugSections *debug_sections,
+                              const DebugBuffer   *profile_section,
+                              uint8_t             *file_image);
+
+static size_t GetRelocatableFileSize(RelocatableFile *rel_file);
 
-static BackendErrs_t WriteElf(BackendContext  *backend_context,
-                              LanguageContext *language_context,
-                              RelocatableFile *rel_file,
-                              FILE            *output_file);
+static size_t GetHeadersSize(RelocatableFile *rel_file);
 
-static BackendErrs_t WriteElfHeadersInFile(RelocatableFile *rel_file,
-                                           FILE            *output_file);
+static BackendErrs_t CommitFileImage(const char    *file_name,
+                                     const uint8_t *file_image,
+                                     size_t         file_size,
+                                     mode_t         file_mode);
 
 static BackendErrs_t SetSectionHeaders(BackendContext  *backend_context,
                                        LanguageContext *language_context,
@@ -49,10 +67,45 @@ static BackendErrs_t SetSectionRelaTextHeader(BackendContext  *backend_context,
                                               LanguageContext *language_context,
                                               RelocatableFile *rel_file);
 
+static BackendErrs_t SetEhFrameSectionHeaders(RelocatableFile     *rel_file,
+                                              const UnwindSection *unwind_section);
+
+static BackendErrs_t SetDebugSectionHeaders(RelocatableFile     *rel_file,
+                                            const DebugSections *debug_sections);
+
+static BackendErrs_t SetProfileSectionHeader(RelocatableFile   *rel_file,
+                                             const DebugBuffer *profile_section,
+                                             bool               is_debug_info);
+
 static BackendErrs_t WriteSectionTextData(BackendContext *backend_context,
-                                          FILE           *output_file);
+                                          uint8_t        *section_data);
 
-static BackendErrs_t WriteSectionHeaderStringTableData(FILE *output_file);
+static BackendErrs_t WriteSectionHeaderStringTableData(uint8_t *section_data,
+                                                       bool     is_debug_info,
+                                                       bool     is_profiling);
+
+static BackendErrs_t WriteEhFrameSectionData(RelocatableFile     *rel_file,
+                                             const UnwindSection *unwind_section,
+                                             uint8_t             *file_image);
+
+static BackendErrs_t WriteDebugSectionsData(RelocatableFile     *rel_file,
+                                            const DebugSections *debug_sections,
+                                            uint8_t             *file_image);
+
+static BackendErrs_t SetExecutableFileHeaders(ExecutableFile *exec_file,
+                                              size_t          file_size,
+                                              Elf64_Addr      entry_address,
+                                              Elf64_Addr      state_address);
+
+static BackendErrs_t ResolveRuntimeRelocations(BackendContext *backend_context,
+                                               uint8_t        *text,
+                                               Elf64_Addr      text_address,
+                                               Elf64_Addr      runtime_address);
+
+static BackendErrs_t PatchRelativeAddress(uint8_t    *buffer,
+                                          size_t      patch_pos,
+                                          Elf64_Addr  next_instruction_address,
+                                          Elf64_Addr  target_address);
 
 static BackendErrs_t WriteInstruction(BackendContext *backend_context,
                                       Instruction    *instruction,
@@ -60,27 +113,18 @@ static BackendErrs_t WriteInstruction(BackendContext *backend_context,
                                       size_t         *buffer_pos);
 
 static BackendErrs_t WriteSectionSymbolTableData(SymbolTable *symbol_table,
-                                                 FILE        *output_file);
-
-static BackendErrs_t WriteDataAlign(size_t  data_size,
-                                    FILE   *output_file);
+                                                 uint8_t     *section_data);
 
 static BackendErrs_t WriteSectionStringTableData(StringTable *strings,
-                                                 FILE        *output_file);
+                                                 uint8_t     *section_data);
 
-static BackendErrs_t WriteSectionRelaTextData(RelocationTable *rel_table,
-                                              FILE            *output_file);
+static BackendErrs_t WriteSectionRelaTextData(const RelocationTable *rel_table,
+                                              uint8_t               *section_data);
 
 static size_t GetAlignedSize(size_t data_size);
 
 static size_t GetLastLocalSymbolIndex(SymbolTable* sym_table);
 
-static BackendErrs_t ChangeRelocationSymbolIndex(RelocationTable *relocation_table,
-                                                 Elf64_Rela      *new_relocation_table_array,
-                                                 size_t          *pos,
-                                                 size_t           old_index,
-                                                 size_t           new_index);
-
 static BackendErrs_t SortSymbolTable(SymbolTable     *symbol_table,
                                      RelocationTable *relocation_table);
 
@@ -93,27 +137,148 @@ BackendErrs_t CreateElfRelocatableFile(BackendContext  *backend_context,
     CHECK(backend_context);
     CHECK(language_context);
 
-    RelocatableFile rel_file = {0};
+    RelocatableFile rel_file        = {0};
+    UnwindSection   unwind_section  = {};
+    DebugSections   debug_sections  = {};
+    DebugBuffer     profile_section = {};
+
+    BeginPass("build sections");
 
     SortSymbolTable(backend_context->symbol_table,
                     backend_context->relocation_table);
 
-    InitRelocatableFile(backend_context, language_context, &rel_file);
+    bool is_built = BuildUnwindSection(backend_context, &unwind_section) == kBackendSuccess &&
+                    (!backend_context->is_debug_info ||
+                     BuildDebugSections(backend_context, language_context, &debug_sections) == kBackendSuccess) &&
+                    (!backend_context->is_profiling ||
+                     BuildProfileSection(backend_context, &profile_section) == kBackendSuccess);
+
+    EndPass();
+
+    if (!is_built)
+    {
+        DestroyUnwindSection(&unwind_section);
+        DestroyDebugSections(&debug_sections);
+        free(profile_section.data);
+
+        return kBackendFailedAllocation;
+    }
+
+    InitRelocatableFile(backend_context, language_context, &rel_file, &unwind_section,
+                        backend_context->is_debug_info ? &debug_sections  : nullptr,
+                        backend_context->is_profiling  ? &profile_section : nullptr);
+
+    size_t file_size = GetRelocatableFileSize(&rel_file);
+
+    // the padding between sections is left as zeros from calloc
+    uint8_t *file_image = (uint8_t *) calloc(file_size, sizeof(uint8_t));
+
+    if (file_image == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        DestroyUnwindSection(&unwind_section);
+        DestroyDebugSections(&debug_sections);
+        free(profile_section.data);
+
+        return kBackendFailedAllocation;
+    }
+
+    BeginPass("encode image");
+
+    BackendErrs_t error = WriteElf(backend_context, &rel_file, &unwind_section,
+                                   backend_context->is_debug_info ? &debug_sections  : nullptr,
+                                   backend_context->is_profiling  ? &profile_section : nullptr,
+                                   file_image);
+
+    EndPass();
+
+    if (error == kBackendSuccess)
+    {
+        BeginPass("commit file");
+
+        error = CommitFileImage(file_name, file_image, file_size, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+        EndPass();
+    }
+
+    free(file_image);
+
+    DestroyUnwindSection(&unwind_section);
+    DestroyDebugSections(&debug_sections);
+    free(profile_section.data);
+
+    return error;
+}
+
+//==============================================================================
+
+// Writes the whole file with a single write() into a temporary file next to
+// the target and renames it over the target, so readers never see a
+// partially written output.
+static BackendErrs_t CommitFileImage(const char    *file_name,
+                                     const uint8_t *file_image,
+                                     size_t         file_size,
+                                     mode_t         file_mode)
+{
+    CHECK(file_name);
+    CHECK(file_image);
+
+    size_t temp_file_name_size = strlen(file_name) + sizeof(".tmp");
+
+    char *temp_file_name = (char *) calloc(temp_file_name_size, sizeof(char));
+
+    if (temp_file_name == nullptr)
+    {
+        return kBackendFailedAllocation;
+    }
+
+    snprintf(temp_file_name, temp_file_name_size, "%s.tmp", file_name);
 
-    FILE *output_file = fopen(file_name, "wb");
+    int output_fd = open(temp_file_name, O_WRONLY | O_CREAT | O_TRUNC, file_mode);
 
-    if (output_file == nullptr)
+    if (output_fd < 0)
     {
-        ColorPrintf(kRed, "%s() failed to open file\n", __func__);
+        ColorPrintf(kRed, "%s() failed to open file %s\n", __func__, temp_file_name);
+
+        free(temp_file_name);
 
         return kBackendFailedToOpenFile;
     }
 
-    WriteElf(backend_context, language_context, &rel_file, output_file);
+    size_t written_size = 0;
 
-    fclose(output_file);
+    while (written_size < file_size)
+    {
+        ssize_t write_result = write(output_fd, file_image + written_size, file_size - written_size);
 
-    return kBackendSuccess;
+        if (write_result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (write_result <= 0)
+        {
+            break;
+        }
+
+        written_size += (size_t) write_result;
+    }
+
+    BackendErrs_t error = kBackendSuccess;
+
+    if (close(output_fd) != 0 || written_size != file_size || rename(temp_file_name, file_name) != 0)
+    {
+        ColorPrintf(kRed, "%s() failed to write file %s\n", __func__, file_name);
+
+        unlink(temp_file_name);
+
+        error = kBackendFailedToOpenFile;
+    }
+
+    free(temp_file_name);
+
+    return error;
 }
 
 //==============================================================================
@@ -125,30 +290,54 @@ static const uint64_t kNullPadding              = 0;
 static const uint16_t kFileHeaderSize           = 64;
 static const uint16_t kProgramHeaderSize        = 56;
 static const uint16_t kSectionHeaderSize        = 64;
-static const uint16_t kSectionHeaderCount       = 6;
+static const uint16_t kSectionHeaderCount       = 8;
+static const uint16_t kDebugSectionHeaderCount  = 13;
 static const uint16_t kSectionStringHeaderIndex = 2;
 
 //==============================================================================
 
-BackendErrs_t InitRelocatableFile(BackendContext  *backend_context,
-                                  LanguageContext *language_context,
-                                  RelocatableFile *rel_file)
+BackendErrs_t InitRelocatableFile(BackendContext      *backend_context,
+                                  LanguageContext     *language_context,
+                                  RelocatableFile     *rel_file,
+                                  const UnwindSection *unwind_section,
+                                  const DebugSections *debug_sections,
+                                  const DebugBuffer   *profile_section)
 {
     CHECK(backend_context);
     CHECK(language_context);
     CHECK(rel_file);
+    CHECK(unwind_section);
 
-    SetRelocatableFileHeader(rel_file);
+    uint16_t section_header_count = debug_sections != nullptr ? kDebugSectionHeaderCount :
+                                                                kSectionHeaderCount;
+
+    SetRelocatableFileHeader(rel_file, profile_section != nullptr ? section_header_count + 1 :
+                                                                    section_header_count);
 
     SetSectionHeaders(backend_context,
                       language_context,
                       rel_file);
 
+    SetEhFrameSectionHeaders(rel_file, unwind_section);
+
+    if (debug_sections != nullptr)
+    {
+        SetDebugSectionHeaders(rel_file, debug_sections);
+    }
+
+    if (profile_section != nullptr)
+    {
+        SetProfileSectionHeader(rel_file, profile_section, debug_sections != nullptr);
+    }
+
     return kBackendSuccess;
 }
 
 //==============================================================================
 
+// ELF wants local symbols before global ones. The symbols are partitioned
+// stably, and relocations and the name index are moved to the new symbol
+// indices in one pass each.
 static BackendErrs_t SortSymbolTable(SymbolTable     *symbol_table,
                                      RelocationTable *relocation_table)
 {
@@ -157,9 +346,17 @@ static BackendErrs_t SortSymbolTable(SymbolTable     *symbol_table,
 
     Elf64_Sym *new_sym_array = (Elf64_Sym *) calloc(symbol_table->capacity, sizeof(Elf64_Sym));
 
-    Elf64_Rela *new_rel_table_array = (Elf64_Rela *) calloc(relocation_table->capacity, sizeof(Elf64_Rela));
+    size_t *new_sym_index = (size_t *) calloc(symbol_table->sym_count, sizeof(size_t));
 
-    size_t new_rel_table_array_cur_pos = 0;
+    if (new_sym_array == nullptr || new_sym_index == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        free(new_sym_array);
+        free(new_sym_index);
+
+        return kBackendFailedAllocation;
+    }
 
     size_t new_sym_table_cur_pos = 0;
 
@@ -169,9 +366,7 @@ static BackendErrs_t SortSymbolTable(SymbolTable     *symbol_table,
         {
             new_sym_array[new_sym_table_cur_pos] = symbol_table->sym_array[i];
 
-            ChangeRelocationSymbolIndex(relocation_table, new_rel_table_array, &new_rel_table_array_cur_pos, i, new_sym_table_cur_pos);
-
-            new_sym_table_cur_pos++;
+            new_sym_index[i] = new_sym_table_cur_pos++;
         }
     }
 
@@ -181,59 +376,38 @@ static BackendErrs_t SortSymbolTable(SymbolTable     *symbol_table,
         {
             new_sym_array[new_sym_table_cur_pos] = symbol_table->sym_array[i];
 
-            ChangeRelocationSymbolIndex(relocation_table, new_rel_table_array, &new_rel_table_array_cur_pos, i, new_sym_table_cur_pos);
-
-            new_sym_table_cur_pos++;
+            new_sym_index[i] = new_sym_table_cur_pos++;
         }
     }
 
-    if (new_sym_table_cur_pos != symbol_table->sym_count)
+    for (size_t i = 0; i < relocation_table->relocation_count; i++)
     {
-        ColorPrintf(kRed, "%s() failed sort\n", __func__);
+        Elf64_Rela *relocation = &relocation_table->relocation_array[i];
 
-        free(new_sym_array);
+        relocation->r_info = ELF64_R_INFO(new_sym_index[ELF64_R_SYM(relocation->r_info)],
+                                          ELF64_R_TYPE(relocation->r_info));
     }
 
-    if (new_rel_table_array_cur_pos != relocation_table->relocation_count)
+    for (size_t i = 0; i < symbol_table->name_index_capacity; i++)
     {
-        ColorPrintf(kRed, "%s() failed to sort fucking relocations\n", __func__);
+        if (symbol_table->name_index[i] != kSymbolIndexEmptySlot)
+        {
+            symbol_table->name_index[i] = new_sym_index[symbol_table->name_index[i]];
+        }
     }
 
     free(symbol_table->sym_array);
+    free(new_sym_index);
 
     symbol_table->sym_array = new_sym_array;
 
-    free(relocation_table->relocation_array);
-
-    relocation_table->relocation_array = new_rel_table_array;
-
     return kBackendSuccess;
 }
 
 //==============================================================================
 
-static BackendErrs_t ChangeRelocationSymbolIndex(RelocationTable *relocation_table,
-                                                 Elf64_Rela      *new_relocation_table_array,
-                                                 size_t          *pos,
-                                                 size_t           old_index,
-                                                 size_t           new_index)
-{
-    for (size_t i = 0; i < relocation_table->relocation_count; i++)
-    {
-        if (ELF64_R_SYM(relocation_table->relocation_array[i].r_info) == old_index)
-        {
-            new_relocation_table_array[*pos] = relocation_table->relocation_array[i];
-
-            new_relocation_table_array[(*pos)++].r_info = ELF64_R_INFO(new_index, ELF64_R_TYPE(relocation_table->relocation_array[i].r_info));
-        }
-    }
-
-    return kBackendSuccess;
-}
-
-//==============================================================================
-
-static BackendErrs_t SetRelocatableFileHeader(RelocatableFile *rel_file)
+static BackendErrs_t SetRelocatableFileHeader(RelocatableFile *rel_file,
+                                              uint16_t         section_header_count)
 {
     CHECK(rel_file);
 
@@ -266,7 +440,7 @@ static BackendErrs_t SetRelocatableFileHeader(RelocatableFile *rel_file)
     rel_file->header.e_phentsize = 0; //because there is no program headers
     rel_file->header.e_phnum     = 0; // same reason
     rel_file->header.e_shentsize = kSectionHeaderSize;
-    rel_file->header.e_shnum     = kSectionHeaderCount;
+    rel_file->header.e_shnum     = section_header_count;
     rel_file->header.e_shstrndx  = kSectionStringHeaderIndex;
 
     return kBackendSuccess;
@@ -274,21 +448,59 @@ static BackendErrs_t SetRelocatableFileHeader(RelocatableFile *rel_file)
 
 //==============================================================================
 
-static BackendErrs_t WriteElf(BackendContext  *backend_context,
-                              LanguageContext *language_context,
-                              RelocatableFile *rel_file,
-                              FILE            *output_file)
+static BackendErrs_t WriteElf(BackendContext      *backend_context,
+                              RelocatableFile     *rel_file,
+                              const UnwindSection *unwind_section,
+                              const DebugSections *debug_sections,
+                              const DebugBuffer   *profile_section,
+                              uint8_t             *file_image)
 {
     CHECK(rel_file);
-    CHECK(output_file);
+    CHECK(file_image);
+
+    // the headers of the debug sections are only there in debug builds,
+    // the profile header takes the last slot whichever it is
+    size_t headers_size = GetHeadersSize(rel_file);
+
+    if (profile_section != nullptr)
+    {
+        headers_size -= kSectionHeaderSize;
 
-    WriteElfHeadersInFile(rel_file, output_file);
+        memcpy(file_image + headers_size, &rel_file->section_profile_header, kSectionHeaderSize);
+    }
+
+    memcpy(file_image, rel_file, headers_size);
+
+    BackendErrs_t error = WriteSectionTextData(backend_context,
+                                               file_image + rel_file->section_text_header.sh_offset);
+
+    if (error != kBackendSuccess)
+    {
+        return error;
+    }
+
+    WriteSectionHeaderStringTableData(file_image + rel_file->section_header_string_table_header.sh_offset,
+                                      debug_sections  != nullptr,
+                                      profile_section != nullptr);
+    WriteSectionSymbolTableData      (backend_context->symbol_table,
+                                      file_image + rel_file->section_symbol_table_header.sh_offset);
+    WriteSectionStringTableData      (backend_context->strings,
+                                      file_image + rel_file->section_string_table_header.sh_offset);
+    WriteSectionRelaTextData         (backend_context->relocation_table,
+                                      file_image + rel_file->section_rela_rext_header.sh_offset);
+
+    WriteEhFrameSectionData(rel_file, unwind_section, file_image);
+
+    if (debug_sections != nullptr)
+    {
+        WriteDebugSectionsData(rel_file, debug_sections, file_image);
+    }
 
-    WriteSectionTextData             (backend_context, output_file);
-    WriteSectionHeaderStringTableData(output_file);
-    WriteSectionSymbolTableData      (backend_context->symbol_table, output_file);
-    WriteSectionStringTableData      (backend_context->strings, output_file);
-    WriteSectionRelaTextData         (backend_context->relocation_table, output_file);
+    if (profile_section != nullptr)
+    {
+        memcpy(file_image + rel_file->section_profile_header.sh_offset,
+               profile_section->data, profile_section->size);
+    }
 
     return kBackendSuccess;
 }
@@ -297,40 +509,106 @@ static const size_t kAlignSize = 16;
 
 //==============================================================================
 
-static BackendErrs_t WriteSectionRelaTextData(RelocationTable *rel_table,
-                                              FILE            *output_file)
+static size_t GetRelocatableFileSize(RelocatableFile *rel_file)
 {
-    fwrite(rel_table->relocation_array, sizeof(Elf64_Rela), rel_table->relocation_count, output_file);
+    CHECK(rel_file);
+
+    const Elf64_Shdr *last_header = &rel_file->section_rela_eh_frame_header;
+
+    if (rel_file->section_profile_header.sh_type != SHT_NULL)
+    {
+        last_header = &rel_file->section_profile_header;
+    }
+    else if (rel_file->section_rela_debug_line_header.sh_type != SHT_NULL)
+    {
+        last_header = &rel_file->section_rela_debug_line_header;
+    }
+
+    return last_header->sh_offset + GetAlignedSize(last_header->sh_size);
+}
+
+//==============================================================================
+
+static size_t GetHeadersSize(RelocatableFile *rel_file)
+{
+    CHECK(rel_file);
+
+    return kFileHeaderSize + (size_t) rel_file->header.e_shnum * kSectionHeaderSize;
+}
+
+//==============================================================================
+
+static BackendErrs_t WriteEhFrameSectionData(RelocatableFile     *rel_file,
+                                             const UnwindSection *unwind_section,
+                                             uint8_t             *file_image)
+{
+    CHECK(rel_file);
+    CHECK(unwind_section);
+    CHECK(file_image);
 
-    WriteDataAlign(rel_table->relocation_count * sizeof(Elf64_Rela), output_file);
+    memcpy(file_image + rel_file->section_eh_frame_header.sh_offset,
+           unwind_section->eh_frame.data, unwind_section->eh_frame.size);
+
+    WriteSectionRelaTextData(&unwind_section->relocations,
+                             file_image + rel_file->section_rela_eh_frame_header.sh_offset);
 
     return kBackendSuccess;
 }
 
 //==============================================================================
 
-static BackendErrs_t WriteSectionStringTableData(StringTable *strings,
-                                                 FILE        *output_file)
+static BackendErrs_t WriteDebugSectionsData(RelocatableFile     *rel_file,
+                                            const DebugSections *debug_sections,
+                                            uint8_t             *file_image)
 {
-    for (size_t i = 0; i < strings->string_count; i++)
-    {
-        fwrite(strings->string_array[i], sizeof(char), strlen(strings->string_array[i]) + 1, output_file);
-    }
+    CHECK(rel_file);
+    CHECK(debug_sections);
+    CHECK(file_image);
+
+    memcpy(file_image + rel_file->section_debug_abbrev_header.sh_offset,
+           debug_sections->abbrev.data, debug_sections->abbrev.size);
 
-    WriteDataAlign(strings->cur_size, output_file);
+    memcpy(file_image + rel_file->section_debug_info_header.sh_offset,
+           debug_sections->info.data, debug_sections->info.size);
+
+    memcpy(file_image + rel_file->section_debug_line_header.sh_offset,
+           debug_sections->line.data, debug_sections->line.size);
+
+    WriteSectionRelaTextData(&debug_sections->info_relocations,
+                             file_image + rel_file->section_rela_debug_info_header.sh_offset);
+
+    WriteSectionRelaTextData(&debug_sections->line_relocations,
+                             file_image + rel_file->section_rela_debug_line_header.sh_offset);
 
     return kBackendSuccess;
 }
 
 //==============================================================================
 
-static BackendErrs_t WriteSectionSymbolTableData(SymbolTable *symbol_table,
-                                                 FILE        *output_file)
+static BackendErrs_t WriteSectionRelaTextData(const RelocationTable *rel_table,
+                                              uint8_t               *section_data)
 {
-    fwrite(symbol_table->sym_array, sizeof(Elf64_Sym), symbol_table->sym_count, output_file);
+    memcpy(section_data, rel_table->relocation_array, rel_table->relocation_count * sizeof(Elf64_Rela));
 
+    return kBackendSuccess;
+}
 
-    WriteDataAlign(sizeof(Elf64_Sym) * symbol_table->sym_count, output_file);
+//==============================================================================
+
+static BackendErrs_t WriteSectionStringTableData(StringTable *strings,
+                                                 uint8_t     *section_data)
+{
+    memcpy(section_data, strings->pool, strings->cur_size);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t WriteSectionSymbolTableData(SymbolTable *symbol_table,
+                                                 uint8_t     *section_data)
+{
+    memcpy(section_data, symbol_table->sym_array, symbol_table->sym_count * sizeof(Elf64_Sym));
 
     return kBackendSuccess;
 }
@@ -349,45 +627,47 @@ static size_t GetAlignedSize(size_t data_size)
 
 //==============================================================================
 
-static BackendErrs_t WriteDataAlign(size_t  data_size,
-                                    FILE   *output_file)
+static BackendErrs_t WriteSectionHeaderStringTableData(uint8_t *section_data,
+                                                       bool     is_debug_info,
+                                                       bool     is_profiling)
 {
-    size_t align_size = kAlignSize - ftell(output_file) % kAlignSize;
+    memcpy(section_data, HeaderStringTable, kHeaderStringTableSize);
 
-    if (align_size == kAlignSize)
-    {
-        return kBackendSuccess;
-    }
+    size_t data_size = kHeaderStringTableSize;
 
-    uint8_t *null_array = (uint8_t *) calloc(align_size, sizeof(uint8_t));
+    if (is_debug_info)
+    {
+        memcpy(section_data + data_size, DebugHeaderStringTable, kDebugHeaderStringTableSize);
 
-    fwrite(null_array, sizeof(uint8_t), align_size, output_file);
+        data_size += kDebugHeaderStringTableSize;
+    }
 
-    free(null_array);
+    if (is_profiling)
+    {
+        memcpy(section_data + data_size, ProfileHeaderStringTable, kProfileHeaderStringTableSize);
+    }
 
     return kBackendSuccess;
 }
 
 //==============================================================================
 
-static BackendErrs_t WriteSectionHeaderStringTableData(FILE *output_file)
+static BackendErrs_t WriteSectionTextData(BackendContext *backend_context,
+                                          uint8_t        *section_data)
 {
-    fwrite(HeaderStringTable, sizeof(char), kHeaderStringTableSize, output_file);
-
-    WriteDataAlign(kHeaderStringTableSize, output_file);
+    CHECK(backend_context);
+    CHECK(section_data);
 
-    return kBackendSuccess;
+    return EncodeTextSection(backend_context, section_data);
 }
 
 //==============================================================================
 
-static BackendErrs_t WriteSectionTextData(BackendContext *backend_context,
-                                          FILE           *output_file)
+BackendErrs_t EncodeTextSection(BackendContext *backend_context,
+                                uint8_t        *instruction_buffer)
 {
     CHECK(backend_context);
-    CHECK(output_file);
-
-    uint8_t *instruction_buffer = (uint8_t *) calloc(backend_context->cur_address, sizeof(uint8_t));
+    CHECK(instruction_buffer);
 
     size_t cur_buffer_pos = 0;
 
@@ -410,11 +690,257 @@ static BackendErrs_t WriteSectionTextData(BackendContext *backend_context,
         return kBackendInconsistentSizes;
     }
 
-    fwrite(instruction_buffer, sizeof(uint8_t), cur_buffer_pos, output_file);
+    return kBackendSuccess;
+}
 
-    free(instruction_buffer);
+//==============================================================================
 
-    WriteDataAlign(cur_buffer_pos, output_file);
+// The executable is a single file image loaded at kExecutableBaseAddress:
+//
+//     ELF header, two program headers | program code | builtin runtime
+//
+// mapped read-execute, plus a zero-filled read-write segment on the next
+// page for the runtime state. Calls into the runtime are the same
+// relocations the relocatable output carries; here they are resolved
+// against the builtin runtime instead of being left to the linker.
+BackendErrs_t CreateElfExecutableFile(BackendContext *backend_context,
+                                      const char     *file_name)
+{
+    CHECK(backend_context);
+    CHECK(file_name);
+
+    const Elf64_Sym *main_symbol = FindMainSymbol(backend_context);
+
+    if (main_symbol == nullptr)
+    {
+        ColorPrintf(kRed, "%s() program has no main function\n", __func__);
+
+        return kBackendMissingMain;
+    }
+
+    size_t text_offset    = sizeof(ExecutableFile);
+    size_t runtime_offset = GetAlignedSize(text_offset + backend_context->cur_address);
+    size_t file_size      = runtime_offset + kBuiltinRuntimeSize;
+
+    Elf64_Addr text_address    = kExecutableBaseAddress + text_offset;
+    Elf64_Addr runtime_address = kExecutableBaseAddress + runtime_offset;
+    Elf64_Addr state_address   = (kExecutableBaseAddress + file_size + kPageSize - 1) / kPageSize * kPageSize;
+
+    uint8_t *file_image = (uint8_t *) calloc(file_size, sizeof(uint8_t));
+
+    if (file_image == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kBackendFailedAllocation;
+    }
+
+    BackendErrs_t error = EncodeTextSection(backend_context, file_image + text_offset);
+
+    if (error == kBackendSuccess)
+    {
+        error = ResolveRuntimeRelocations(backend_context, file_image + text_offset, text_address, runtime_address);
+    }
+
+    if (error != kBackendSuccess)
+    {
+        free(file_image);
+
+        return error;
+    }
+
+    uint8_t *runtime = file_image + runtime_offset;
+
+    memcpy(runtime, kBuiltinRuntimeCode, kBuiltinRuntimeSize);
+
+    PatchRelativeAddress(runtime,
+                         kBuiltinMainCallPatchOffset,
+                         runtime_address + kBuiltinMainCallNextOffset,
+                         text_address + main_symbol->st_value);
+
+    PatchRelativeAddress(runtime,
+                         kBuiltinStatePatchOffset,
+                         runtime_address + kBuiltinStateNextOffset,
+                         state_address);
+
+    ExecutableFile exec_file = {};
+
+    SetExecutableFileHeaders(&exec_file, file_size, runtime_address + kBuiltinStartOffset, state_address);
+
+    memcpy(file_image, &exec_file, sizeof(exec_file));
+
+    error = CommitFileImage(file_name, file_image, file_size, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
+
+    free(file_image);
+
+    return error;
+}
+
+//==============================================================================
+
+const Elf64_Sym *FindMainSymbol(BackendContext *backend_context)
+{
+    CHECK(backend_context);
+
+    for (size_t i = 0; i < backend_context->symbol_table->sym_count; i++)
+    {
+        const char *name = GetStringByIndex(backend_context->strings,
+                                            backend_context->symbol_table->sym_array[i].st_name);
+
+        if (name != nullptr && strcmp(name, kAsmMainName) == 0)
+        {
+            return &backend_context->symbol_table->sym_array[i];
+        }
+    }
+
+    return nullptr;
+}
+
+//==============================================================================
+
+static BackendErrs_t SetExecutableFileHeaders(ExecutableFile *exec_file,
+                                              size_t          file_size,
+                                              Elf64_Addr      entry_address,
+                                              Elf64_Addr      state_address)
+{
+    CHECK(exec_file);
+
+    // ExecutableFile is packed, the headers are filled in locals and copied in
+    Elf64_Ehdr header = {};
+
+    header.e_ident[EI_MAG0]    = ELFMAG0;
+    header.e_ident[EI_MAG1]    = ELFMAG1;
+    header.e_ident[EI_MAG2]    = ELFMAG2;
+    header.e_ident[EI_MAG3]    = ELFMAG3;
+    header.e_ident[EI_CLASS]   = ELFCLASS64;
+    header.e_ident[EI_DATA]    = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI]   = ELFOSABI_NONE;
+
+    header.e_type    = ET_EXEC;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+
+    header.e_entry = entry_address;
+    header.e_phoff = kFileHeaderSize;
+    header.e_shoff = kNullPadding;     // no section headers, loaders do not need them
+
+    header.e_flags  = 0;
+    header.e_ehsize = kFileHeaderSize;
+
+    header.e_phentsize = kProgramHeaderSize;
+    header.e_phnum     = 2;
+    header.e_shentsize = kSectionHeaderSize;
+    header.e_shnum     = 0;
+    header.e_shstrndx  = SHN_UNDEF;
+
+    Elf64_Phdr text_segment = {};
+
+    text_segment.p_type   = PT_LOAD;
+    text_segment.p_flags  = PF_R | PF_X;
+    text_segment.p_offset = 0;
+    text_segment.p_vaddr  = kExecutableBaseAddress;
+    text_segment.p_paddr  = kExecutableBaseAddress;
+    text_segment.p_filesz = file_size;
+    text_segment.p_memsz  = file_size;
+    text_segment.p_align  = kPageSize;
+
+    // nothing of it is in the file, the kernel maps zeroed pages
+    Elf64_Phdr state_segment = {};
+
+    state_segment.p_type   = PT_LOAD;
+    state_segment.p_flags  = PF_R | PF_W;
+    state_segment.p_offset = 0;
+    state_segment.p_vaddr  = state_address;
+    state_segment.p_paddr  = state_address;
+    state_segment.p_filesz = 0;
+    state_segment.p_memsz  = kBuiltinStateSize;
+    state_segment.p_align  = kPageSize;
+
+    exec_file->header               = header;
+    exec_file->text_segment_header  = text_segment;
+    exec_file->state_segment_header = state_segment;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t ResolveRuntimeRelocations(BackendContext *backend_context,
+                                               uint8_t        *text,
+                                               Elf64_Addr      text_address,
+                                               Elf64_Addr      runtime_address)
+{
+    CHECK(backend_context);
+    CHECK(text);
+
+    RelocationTable *relocation_table = backend_context->relocation_table;
+
+    for (size_t i = 0; i < relocation_table->relocation_count; i++)
+    {
+        const Elf64_Rela *relocation = &relocation_table->relocation_array[i];
+
+        const Elf64_Sym  *symbol     = &backend_context->symbol_table->sym_array[ELF64_R_SYM(relocation->r_info)];
+
+        const char       *func_name  = GetStringByIndex(backend_context->strings, symbol->st_name);
+
+        size_t func_pos = 0;
+
+        while (func_pos < kBuiltinRuntimeFuncsCount &&
+               (func_name == nullptr || strcmp(kBuiltinRuntimeFuncs[func_pos].func_name, func_name) != 0))
+        {
+            func_pos++;
+        }
+
+        if (func_pos == kBuiltinRuntimeFuncsCount)
+        {
+            ColorPrintf(kRed, "%s() %s is not available in executables, link the object with lib/GVN.o instead\n",
+                              __func__, func_name == nullptr ? "(null)" : func_name);
+
+            return kBackendUnsupportedRuntimeCall;
+        }
+
+        // S + A - P, the addend already accounts for the rel32 being 4 bytes
+        // before the next instruction
+        Elf64_Sxword value = (Elf64_Sxword) (runtime_address + kBuiltinRuntimeFuncs[func_pos].offset) +
+                             relocation->r_addend -
+                             (Elf64_Sxword) (text_address + relocation->r_offset);
+
+        int32_t relative_address = (int32_t) value;
+
+        memcpy(text + relocation->r_offset, &relative_address, sizeof(relative_address));
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+const char *GetStringByIndex(StringTable *strings,
+                             size_t       string_index)
+{
+    CHECK(strings);
+
+    if (string_index >= strings->cur_size)
+    {
+        return nullptr;
+    }
+
+    return strings->pool + string_index;
+}
+
+//==============================================================================
+
+static BackendErrs_t PatchRelativeAddress(uint8_t    *buffer,
+                                          size_t      patch_pos,
+                                          Elf64_Addr  next_instruction_address,
+                                          Elf64_Addr  target_address)
+{
+    CHECK(buffer);
+
+    int32_t relative_address = (int32_t) (target_address - next_instruction_address);
+
+    memcpy(buffer + patch_pos, &relative_address, sizeof(relative_address));
 
     return kBackendSuccess;
 }
@@ -429,6 +955,13 @@ static BackendErrs_t WriteInstruction(BackendContext *backend_context,
     CHECK(backend_context);
     CHECK(instruction);
 
+    if (instruction->legacy_prefix != 0)
+    {
+        *(uint8_t *) (instruction_buffer + *buffer_pos) = instruction->legacy_prefix;
+
+        *buffer_pos += sizeof(instruction->legacy_prefix);
+    }
+
     if (instruction->rex_prefix != 0)
     {
         *(uint8_t *) (instruction_buffer + *buffer_pos) = instruction->rex_prefix;
@@ -442,7 +975,11 @@ static BackendErrs_t WriteInstruction(BackendContext *backend_context,
     }
     else if (instruction->op_code_size == 2)
     {
-        *(uint16_t *) (instruction_buffer + *buffer_pos) = instruction->op_code;
+        *(uint16_t *) (instruction_buffer + *buffer_pos) = (uint16_t) instruction->op_code;
+    }
+    else if (instruction->op_code_size == 3)
+    {
+        memcpy(instruction_buffer + *buffer_pos, &instruction->op_code, instruction->op_code_size);
     }
     else
     {
@@ -460,9 +997,16 @@ static BackendErrs_t WriteInstruction(BackendContext *backend_context,
         *buffer_pos += sizeof(instruction->mod_rm);
     }
 
+    if (instruction->sib != 0)
+    {
+        *(uint8_t *) (instruction_buffer + *buffer_pos) = instruction->sib;
+
+        *buffer_pos += sizeof(instruction->sib);
+    }
+
     if (instruction->immediate_size != 0)
     {
-        *(ImmediateType_t *) (instruction_buffer + *buffer_pos) = instruction->immediate_arg;
+        memcpy(instruction_buffer + *buffer_pos, &instruction->immediate_arg, instruction->immediate_size);
 
         *buffer_pos += instruction->immediate_size;
     }
@@ -479,19 +1023,6 @@ static BackendErrs_t WriteInstruction(BackendContext *backend_context,
 
 //==============================================================================
 
-static BackendErrs_t WriteElfHeadersInFile(RelocatableFile *rel_file,
-                                           FILE            *output_file)
-{
-    CHECK(rel_file);
-    CHECK(output_file);
-
-    fwrite(rel_file, sizeof(RelocatableFile), 1, output_file);
-
-    return kBackendSuccess;
-}
-
-//==============================================================================
-
 static BackendErrs_t SetSectionHeaders(BackendContext  *backend_context,
                                        LanguageContext *language_context,
                                        RelocatableFile *rel_file)
@@ -524,7 +1055,7 @@ static BackendErrs_t SetSectionTextHeader(BackendContext  *backend_context,
                      SHT_PROGBITS,
                      SHF_ALLOC | SHF_EXECINSTR,
                      kNullAddress,
-                     sizeof(RelocatableFile),
+                     GetHeadersSize(file),
                      backend_context->cur_address,
                      0,
                      0,
@@ -550,7 +1081,8 @@ static BackendErrs_t SetSectionHeaderStringTableHeader(BackendContext  *backend_
                      0,
                      kNullAddress,
                      file->section_text_header.sh_offset + GetAlignedSize(file->section_text_header.sh_size),
-                     sizeof(HeaderStringTable),
+                     kHeaderStringTableSize + (backend_context->is_debug_info ? kDebugHeaderStringTableSize   : 0)
+                                            + (backend_context->is_profiling  ? kProfileHeaderStringTableSize : 0),
                      0,
                      0,
                      1,
@@ -652,6 +1184,140 @@ static BackendErrs_t SetSectionRelaTextHeader(BackendContext  *backend_context,
 
 //==============================================================================
 
+// .eh_frame is allocated so the linker can build .eh_frame_hdr from it
+static BackendErrs_t SetEhFrameSectionHeaders(RelocatableFile     *file,
+                                              const UnwindSection *unwind_section)
+{
+    CHECK(file);
+    CHECK(unwind_section);
+
+    SetSectionHeader(&file->section_eh_frame_header,
+                     kSectionEhFrameTableIndex,
+                     SHT_X86_64_UNWIND,
+                     SHF_ALLOC,
+                     kNullAddress,
+                     file->section_rela_rext_header.sh_offset + GetAlignedSize(file->section_rela_rext_header.sh_size),
+                     unwind_section->eh_frame.size,
+                     0,
+                     0,
+                     kEhFrameAlignment,
+                     0);
+
+    SetSectionHeader(&file->section_rela_eh_frame_header,
+                     kSectionRelaEhFrameTableIndex,
+                     SHT_RELA,
+                     SHF_INFO_LINK,
+                     kNullAddress,
+                     file->section_eh_frame_header.sh_offset + GetAlignedSize(file->section_eh_frame_header.sh_size),
+                     unwind_section->relocations.relocation_count * sizeof(Elf64_Rela),
+                     kSectionSymtabIndex,
+                     kSectionEhFrameIndex,
+                     0x8,
+                     sizeof(Elf64_Rela));
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// The debug sections go after .rela.eh_frame, each relocation table right
+// after the section it patches.
+static BackendErrs_t SetDebugSectionHeaders(RelocatableFile     *file,
+                                            const DebugSections *debug_sections)
+{
+    CHECK(file);
+    CHECK(debug_sections);
+
+    SetSectionHeader(&file->section_debug_abbrev_header,
+                     kSectionDebugAbbrevTableIndex,
+                     SHT_PROGBITS,
+                     0,
+                     kNullAddress,
+                     file->section_rela_eh_frame_header.sh_offset + GetAlignedSize(file->section_rela_eh_frame_header.sh_size),
+                     debug_sections->abbrev.size,
+                     0,
+                     0,
+                     1,
+                     0);
+
+    SetSectionHeader(&file->section_debug_info_header,
+                     kSectionDebugInfoTableIndex,
+                     SHT_PROGBITS,
+                     0,
+                     kNullAddress,
+                     file->section_debug_abbrev_header.sh_offset + GetAlignedSize(file->section_debug_abbrev_header.sh_size),
+                     debug_sections->info.size,
+                     0,
+                     0,
+                     1,
+                     0);
+
+    SetSectionHeader(&file->section_rela_debug_info_header,
+                     kSectionRelaDebugInfoTableIndex,
+                     SHT_RELA,
+                     SHF_INFO_LINK,
+                     kNullAddress,
+                     file->section_debug_info_header.sh_offset + GetAlignedSize(file->section_debug_info_header.sh_size),
+                     debug_sections->info_relocations.relocation_count * sizeof(Elf64_Rela),
+                     kSectionSymtabIndex,
+                     kSectionDebugInfoIndex,
+                     0x8,
+                     sizeof(Elf64_Rela));
+
+    SetSectionHeader(&file->section_debug_line_header,
+                     kSectionDebugLineTableIndex,
+                     SHT_PROGBITS,
+                     0,
+                     kNullAddress,
+                     file->section_rela_debug_info_header.sh_offset + GetAlignedSize(file->section_rela_debug_info_header.sh_size),
+                     debug_sections->line.size,
+                     0,
+                     0,
+                     1,
+                     0);
+
+    SetSectionHeader(&file->section_rela_debug_line_header,
+                     kSectionRelaDebugLineTableIndex,
+                     SHT_RELA,
+                     SHF_INFO_LINK,
+                     kNullAddress,
+                     file->section_debug_line_header.sh_offset + GetAlignedSize(file->section_debug_line_header.sh_size),
+                     debug_sections->line_relocations.relocation_count * sizeof(Elf64_Rela),
+                     kSectionSymtabIndex,
+                     kSectionDebugLineIndex,
+                     0x8,
+                     sizeof(Elf64_Rela));
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// Writable counters of --profile, placed after every other section
+static BackendErrs_t SetProfileSectionHeader(RelocatableFile   *file,
+                                             const DebugBuffer *profile_section,
+                                             bool               is_debug_info)
+{
+    CHECK(file);
+    CHECK(profile_section);
+
+    SetSectionHeader(&file->section_profile_header,
+                     kHeaderStringTableSize + (is_debug_info ? kDebugHeaderStringTableSize : 0),
+                     SHT_PROGBITS,
+                     SHF_ALLOC | SHF_WRITE,
+                     kNullAddress,
+                     GetRelocatableFileSize(file),
+                     profile_section->size,
+                     0,
+                     0,
+                     0x8,
+                     0);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
 static BackendErrs_t SetSectionHeader(Elf64_Shdr *header,
                                       Elf64_Word  header_name_index,
                                       Elf64_Word  header_type,
@@ -3,6 +3,8 @@
 
 #include <elf.h>
 #include "backend.h"
+#include "debug_info.h"
+#include "unwind_info.h"
 
 typedef struct
 {
@@ -14,31 +16,100 @@ typedef struct
     Elf64_Shdr section_symbol_table_header;
     Elf64_Shdr section_string_table_header;
     Elf64_Shdr section_rela_rext_header;
+    Elf64_Shdr section_eh_frame_header;
+    Elf64_Shdr section_rela_eh_frame_header;
+
+    // only written with --debug-info
+    Elf64_Shdr section_debug_abbrev_header;
+    Elf64_Shdr section_debug_info_header;
+    Elf64_Shdr section_rela_debug_info_header;
+    Elf64_Shdr section_debug_line_header;
+    Elf64_Shdr section_rela_debug_line_header;
+
+    // only written with --profile, always the last section
+    Elf64_Shdr section_profile_header;
 } __attribute__((packed)) RelocatableFile;
 
 static const char HeaderStringTable[] = {'\0','.', 't', 'e', 'x', 't', '\0',
                                               '.', 's', 'h', 's', 't', 'r', 't', 'a', 'b', '\0',
                                               '.', 's', 'y', 'm', 't', 'a', 'b', '\0',
                                               '.', 's', 't', 'r', 't', 'a', 'b', '\0',
-                                              '.', 'r', 'e', 'l', 'a', '.', 't', 'e', 'x', 't', '\0'};
+                                              '.', 'r', 'e', 'l', 'a', '.', 't', 'e', 'x', 't', '\0',
+                                              '.', 'r', 'e', 'l', 'a', '.', 'e', 'h', '_', 'f', 'r', 'a', 'm', 'e', '\0'};
 
 static const size_t kHeaderStringTableSize = sizeof(HeaderStringTable);
 
-static const size_t kSectionTextTableIndex         = 1;
-static const size_t kSectionHeaderStringTableIndex = 7;
-static const size_t kSectionSymbolTableIndex       = 17;
-static const size_t kSectionStringTableIndex       = 25;
-static const size_t kSectionRelaTextTableIndex     = 33;
+// continues HeaderStringTable in debug builds
+static const char DebugHeaderStringTable[] = {'.', 'd', 'e', 'b', 'u', 'g', '_', 'a', 'b', 'b', 'r', 'e', 'v', '\0',
+                                              '.', 'd', 'e', 'b', 'u', 'g', '_', 'i', 'n', 'f', 'o', '\0',
+                                              '.', 'r', 'e', 'l', 'a', '.', 'd', 'e', 'b', 'u', 'g', '_', 'i', 'n', 'f', 'o', '\0',
+                                              '.', 'd', 'e', 'b', 'u', 'g', '_', 'l', 'i', 'n', 'e', '\0',
+                                              '.', 'r', 'e', 'l', 'a', '.', 'd', 'e', 'b', 'u', 'g', '_', 'l', 'i', 'n', 'e', '\0'};
+
+static const size_t kDebugHeaderStringTableSize = sizeof(DebugHeaderStringTable);
+
+// continues the section names of the sections before it
+static const char ProfileHeaderStringTable[] = {'.', 'd', 'a', 't', 'a', '\0'};
+
+static const size_t kProfileHeaderStringTableSize = sizeof(ProfileHeaderStringTable);
 
+static const size_t kSectionTextTableIndex          = 1;
+static const size_t kSectionHeaderStringTableIndex  = 7;
+static const size_t kSectionSymbolTableIndex        = 17;
+static const size_t kSectionStringTableIndex        = 25;
+static const size_t kSectionRelaTextTableIndex      = 33;
+static const size_t kSectionRelaEhFrameTableIndex   = 44;
+static const size_t kSectionEhFrameTableIndex       = 49; // tail of ".rela.eh_frame"
+static const size_t kSectionDebugAbbrevTableIndex   = kHeaderStringTableSize;
+static const size_t kSectionDebugInfoTableIndex     = kHeaderStringTableSize + 14;
+static const size_t kSectionRelaDebugInfoTableIndex = kHeaderStringTableSize + 26;
+static const size_t kSectionDebugLineTableIndex     = kHeaderStringTableSize + 43;
+static const size_t kSectionRelaDebugLineTableIndex = kHeaderStringTableSize + 55;
 
-static const size_t kSectionTextIndex = 1;
+
+static const size_t kSectionTextIndex         = 1;
+static const size_t kSectionSymtabIndex       = 3;
+static const size_t kSectionEhFrameIndex      = 6;
+static const size_t kSectionDebugAbbrevIndex  = 8;
+static const size_t kSectionDebugInfoIndex    = 9;
+static const size_t kSectionDebugLineIndex    = 11;
+static const size_t kSectionProfileIndex      = 8;  // .data after .rela.eh_frame
+static const size_t kSectionProfileDebugIndex = 13; // .data after .rela.debug_line
+
+static const char *kSectionDebugAbbrevName = ".debug_abbrev";
+static const char *kSectionDebugLineName   = ".debug_line";
+
+typedef struct
+{
+    Elf64_Ehdr header;
+
+    Elf64_Phdr text_segment_header;
+    Elf64_Phdr state_segment_header;
+} __attribute__((packed)) ExecutableFile;
+
+static const Elf64_Addr  kExecutableBaseAddress = 0x400000;
+static const Elf64_Xword kPageSize              = 0x1000;
 
 BackendErrs_t CreateElfRelocatableFile(BackendContext  *backend_context,
                                        LanguageContext *language_context,
                                        const char      *file_name);
 
-BackendErrs_t InitRelocatableFile(BackendContext  *backend_context,
-                                  LanguageContext *language_context,
-                                  RelocatableFile *rel_file);
+BackendErrs_t InitRelocatableFile(BackendContext      *backend_context,
+                                  LanguageContext     *language_context,
+                                  RelocatableFile     *rel_file,
+                                  const UnwindSection *unwind_section,
+                                  const DebugSections *debug_sections,
+                                  const DebugBuffer   *profile_section);
+
+BackendErrs_t CreateElfExecutableFile(BackendContext *backend_context,
+                                      const char     *file_name);
+
+BackendErrs_t EncodeTextSection(BackendContext *backend_context,
+                                uint8_t        *instruction_buffer);
+
+const Elf64_Sym *FindMainSymbol(BackendContext *backend_context);
+
+const char *GetStringByIndex(StringTable *strings,
+                             size_t       string_index);
 
 #endif
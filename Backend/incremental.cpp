@@ -0,0 +1,965 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "incremental.h"
+#include "compile_cache.h"
+#include "elf_ctor.h"
+#include "../debug/debug.h"
+#include "../debug/color_print.h"
+
+// bumped whenever the layout of the state file or of Instruction changes
+static const char    *kIncrementalVersion     = "dota-incremental-2";
+
+static const char     kStateFileMagic[8]      = {'D', 'O', 'T', 'A', 'I', 'N', 'C', '2'};
+
+static const size_t   kBaseFunctionRangeCount = 64;
+
+struct StateReader
+{
+    const uint8_t *buffer;
+
+    size_t         size;
+
+    size_t         pos;
+};
+
+static BackendErrs_t LoadIncrementalState(IncrementalCache *cache);
+
+static BackendErrs_t ParseIncrementalState(IncrementalCache *cache,
+                                           StateReader      *reader);
+
+static BackendErrs_t ParseCachedFunction(CachedFunction *function,
+                                         StateReader    *reader);
+
+static BackendErrs_t ReadStateData(StateReader *reader,
+                                   void        *dest,
+                                   size_t       size);
+
+static BackendErrs_t SkipStateData(StateReader    *reader,
+                                   size_t          size,
+                                   const uint8_t **data);
+
+static BackendErrs_t ReadStateString(StateReader  *reader,
+                                     const char  **str);
+
+static BackendErrs_t DestroyCachedFunctions(IncrementalCache *cache);
+
+static BackendErrs_t HashOptions(IncrementalCache *cache,
+                                 BackendContext   *backend_context);
+
+static BackendErrs_t HashTreeNode(Sha256Context   *sha_context,
+                                  LanguageContext *language_context,
+                                  const TreeNode  *node);
+
+static BackendErrs_t HashIdentifier(Sha256Context   *sha_context,
+                                    LanguageContext *language_context,
+                                    size_t           pos);
+
+static BackendErrs_t CollectFunctionNames(IncrementalCache *cache,
+                                          LanguageContext  *language_context);
+
+static BackendErrs_t WriteFunctionRange(FILE                *state_file,
+                                        const FunctionRange *range,
+                                        BackendContext      *backend_context,
+                                        LanguageContext     *language_context);
+
+static BackendErrs_t WriteStateString(FILE       *state_file,
+                                      const char *str);
+
+static int CompareCachedFunctions(const void *lhs, const void *rhs);
+static int CompareFunctionNames  (const void *lhs, const void *rhs);
+
+//==============================================================================
+
+BackendErrs_t IncrementalCacheInit(IncrementalCache *cache,
+                                   const char       *state_file_name,
+                                   BackendContext   *backend_context,
+                                   LanguageContext  *language_context)
+{
+    CHECK(cache);
+    CHECK(state_file_name);
+    CHECK(backend_context);
+    CHECK(language_context);
+
+    cache->state_file_name = state_file_name;
+    cache->state_buffer    = nullptr;
+    cache->functions       = nullptr;
+    cache->function_count  = 0;
+    cache->reused_count    = 0;
+    cache->compiled_count  = 0;
+
+    cache->range_count     = 0;
+    cache->range_capacity  = kBaseFunctionRangeCount;
+    cache->ranges          = (FunctionRange *) calloc(cache->range_capacity, sizeof(FunctionRange));
+
+    if (cache->ranges == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kBackendFailedAllocation;
+    }
+
+    HashOptions(cache, backend_context);
+
+    BackendErrs_t error = CollectFunctionNames(cache, language_context);
+
+    if (error != kBackendSuccess)
+    {
+        return error;
+    }
+
+    // a missing or stale state only means that everything gets compiled
+    if (LoadIncrementalState(cache) != kBackendSuccess)
+    {
+        DestroyCachedFunctions(cache);
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t IncrementalCacheDestroy(IncrementalCache *cache)
+{
+    CHECK(cache);
+
+    DestroyCachedFunctions(cache);
+
+    free(cache->function_names);
+    free(cache->ranges);
+
+    cache->function_names      = nullptr;
+    cache->function_name_count = 0;
+
+    cache->ranges              = nullptr;
+    cache->range_count         = 0;
+    cache->range_capacity      = 0;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t DestroyCachedFunctions(IncrementalCache *cache)
+{
+    CHECK(cache);
+
+    if (cache->functions != nullptr)
+    {
+        for (size_t i = 0; i < cache->function_count; i++)
+        {
+            free(cache->functions[i].calls);
+            free(cache->functions[i].relocations);
+            free(cache->functions[i].label_offsets);
+            free(cache->functions[i].line_rows);
+        }
+    }
+
+    free(cache->functions);
+    free(cache->state_buffer);
+
+    cache->functions      = nullptr;
+    cache->function_count = 0;
+    cache->state_buffer   = nullptr;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// functions are hashed by identifier names rather than positions, so
+// that adding a variable to one function doesn't shift all the others
+BackendErrs_t HashFunction(LanguageContext    *language_context,
+                           const TreeNode     *func_node,
+                           const TableOfNames *cur_table,
+                           uint8_t            *hash)
+{
+    CHECK(language_context);
+    CHECK(func_node);
+    CHECK(cur_table);
+    CHECK(hash);
+
+    Sha256Context sha_context = {};
+
+    Sha256Init(&sha_context);
+
+    uint8_t is_main = func_node->data.variable_pos == language_context->tables.main_id_pos;
+
+    Sha256Update(&sha_context, &is_main, sizeof(is_main));
+
+    uint64_t name_count = cur_table->name_count;
+
+    Sha256Update(&sha_context, &name_count, sizeof(name_count));
+
+    for (size_t i = 0; i < cur_table->name_count; i++)
+    {
+        int32_t name_type = cur_table->names[i].type;
+
+        HashIdentifier(&sha_context, language_context, cur_table->names[i].pos);
+
+        Sha256Update(&sha_context, &name_type, sizeof(name_type));
+    }
+
+    HashTreeNode(&sha_context, language_context, func_node);
+
+    return Sha256Final(&sha_context, hash);
+}
+
+//==============================================================================
+
+static BackendErrs_t HashTreeNode(Sha256Context   *sha_context,
+                                  LanguageContext *language_context,
+                                  const TreeNode  *node)
+{
+    CHECK(sha_context);
+    CHECK(language_context);
+
+    uint8_t is_present = node != nullptr;
+
+    Sha256Update(sha_context, &is_present, sizeof(is_present));
+
+    if (node == nullptr)
+    {
+        return kBackendSuccess;
+    }
+
+    int32_t node_type = node->type;
+
+    Sha256Update(sha_context, &node_type, sizeof(node_type));
+
+    // lines are only known with --debug-info, where moving a function
+    // has to refresh its line rows
+    uint64_t line_number = node->line_number;
+
+    Sha256Update(sha_context, &line_number, sizeof(line_number));
+
+    switch (node->type)
+    {
+        case kConstNumber:
+        {
+            Sha256Update(sha_context, &node->data.const_val, sizeof(node->data.const_val));
+
+            break;
+        }
+
+        case kOperator:
+        case kParamsNode:
+        {
+            int32_t key_word_code = node->data.key_word_code;
+
+            Sha256Update(sha_context, &key_word_code, sizeof(key_word_code));
+
+            break;
+        }
+
+        case kIdentifier:
+        case kVarDecl:
+        case kFuncDef:
+        {
+            HashIdentifier(sha_context, language_context, node->data.variable_pos);
+
+            break;
+        }
+
+        case kCall:
+        default:
+        {
+            break;
+        }
+    }
+
+    HashTreeNode(sha_context, language_context, node->left);
+    HashTreeNode(sha_context, language_context, node->right);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t HashIdentifier(Sha256Context   *sha_context,
+                                    LanguageContext *language_context,
+                                    size_t           pos)
+{
+    CHECK(sha_context);
+    CHECK(language_context);
+
+    if (pos >= language_context->identifiers.identifier_count)
+    {
+        uint64_t raw_pos = pos;
+
+        return Sha256Update(sha_context, &raw_pos, sizeof(raw_pos));
+    }
+
+    const char *id = language_context->identifiers.identifier_array[pos].id;
+
+    return Sha256Update(sha_context, id, strlen(id) + 1);
+}
+
+//==============================================================================
+
+static BackendErrs_t HashOptions(IncrementalCache *cache,
+                                 BackendContext   *backend_context)
+{
+    CHECK(cache);
+    CHECK(backend_context);
+
+    Sha256Context sha_context = {};
+
+    Sha256Init(&sha_context);
+
+    Sha256Update(&sha_context, kIncrementalVersion, strlen(kIncrementalVersion) + 1);
+
+    HashCompilerBinary(&sha_context);
+
+    uint8_t option_bytes[] =
+    {
+        backend_context->is_double_mode,
+        backend_context->is_fast_trig,
+        backend_context->is_debug_info,
+        backend_context->is_profiling,
+        (uint8_t) sizeof(Instruction),
+    };
+
+    Sha256Update(&sha_context, option_bytes, sizeof(option_bytes));
+
+    // hot functions get aligned loop heads, the call and branch counters
+    // decide the layout of ??? bodies and which variables get registers,
+    // the rest of what the profile changes is in the trees
+    const ProfileData *profile = backend_context->profile;
+
+    for (size_t i = 0; profile != nullptr && i < profile->function_count; i++)
+    {
+        const FunctionProfile *function = &profile->functions[i];
+
+        uint8_t is_hot = GetFunctionTemperature(profile, function->name) == kFunctionHot;
+
+        Sha256Update(&sha_context, function->name, strlen(function->name) + 1);
+        Sha256Update(&sha_context, &is_hot,          sizeof(is_hot));
+        Sha256Update(&sha_context, &function->calls, sizeof(function->calls));
+    }
+
+    for (size_t i = 0; profile != nullptr && i < profile->branch_count; i++)
+    {
+        const BranchProfile *branch = &profile->branches[i];
+
+        uint64_t counters[] = {branch->line, branch->ordinal, branch->executions, branch->taken};
+
+        Sha256Update(&sha_context, branch->function, strlen(branch->function) + 1);
+        Sha256Update(&sha_context, counters, sizeof(counters));
+    }
+
+    return Sha256Final(&sha_context, cache->options_hash);
+}
+
+//==============================================================================
+
+const CachedFunction *FindCachedFunction(const IncrementalCache *cache,
+                                         const uint8_t          *hash)
+{
+    CHECK(cache);
+    CHECK(hash);
+
+    if (cache->function_count == 0)
+    {
+        return nullptr;
+    }
+
+    CachedFunction key = {};
+
+    memcpy(key.hash, hash, kSha256DigestSize);
+
+    const CachedFunction *function = (const CachedFunction *) bsearch(&key,
+                                                                      cache->functions,
+                                                                      cache->function_count,
+                                                                      sizeof(CachedFunction),
+                                                                      CompareCachedFunctions);
+    if (function == nullptr)
+    {
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < function->call_count; i++)
+    {
+        if (FindFunctionPos(cache, function->calls[i].callee_name) < 0)
+        {
+            return nullptr;
+        }
+    }
+
+    return function;
+}
+
+//==============================================================================
+
+int32_t FindFunctionPos(const IncrementalCache *cache,
+                        const char             *func_name)
+{
+    CHECK(cache);
+    CHECK(func_name);
+
+    if (cache->function_name_count == 0)
+    {
+        return -1;
+    }
+
+    FunctionName key = {func_name, 0};
+
+    const FunctionName *function_name = (const FunctionName *) bsearch(&key,
+                                                                       cache->function_names,
+                                                                       cache->function_name_count,
+                                                                       sizeof(FunctionName),
+                                                                       CompareFunctionNames);
+
+    return function_name == nullptr ? -1 : (int32_t) function_name->pos;
+}
+
+//==============================================================================
+
+static BackendErrs_t CollectFunctionNames(IncrementalCache *cache,
+                                          LanguageContext  *language_context)
+{
+    CHECK(cache);
+    CHECK(language_context);
+
+    size_t function_count = 0;
+
+    for (const TreeNode *cur_node = language_context->syntax_tree.root; cur_node != nullptr; cur_node = cur_node->right)
+    {
+        function_count++;
+    }
+
+    cache->function_names      = (FunctionName *) calloc(function_count + 1, sizeof(FunctionName));
+    cache->function_name_count = 0;
+
+    if (cache->function_names == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kBackendFailedAllocation;
+    }
+
+    for (const TreeNode *cur_node = language_context->syntax_tree.root; cur_node != nullptr; cur_node = cur_node->right)
+    {
+        const TreeNode *decl = cur_node->left;
+
+        if (decl == nullptr || decl->type != kFuncDef ||
+            decl->data.variable_pos >= language_context->identifiers.identifier_count)
+        {
+            continue;
+        }
+
+        cache->function_names[cache->function_name_count].name = language_context->identifiers.identifier_array[decl->data.variable_pos].id;
+        cache->function_names[cache->function_name_count].pos  = decl->data.variable_pos;
+
+        cache->function_name_count++;
+    }
+
+    qsort(cache->function_names, cache->function_name_count, sizeof(FunctionName), CompareFunctionNames);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t AddFunctionRange(IncrementalCache    *cache,
+                               const FunctionRange *range)
+{
+    CHECK(cache);
+    CHECK(range);
+
+    if (cache->range_count >= cache->range_capacity)
+    {
+        size_t new_capacity = cache->range_capacity * 2;
+
+        FunctionRange *new_ranges = (FunctionRange *) realloc(cache->ranges, new_capacity * sizeof(FunctionRange));
+
+        if (new_ranges == nullptr)
+        {
+            ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+            return kBackendFailedAllocation;
+        }
+
+        cache->ranges         = new_ranges;
+        cache->range_capacity = new_capacity;
+    }
+
+    cache->ranges[cache->range_count++] = *range;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t LoadIncrementalState(IncrementalCache *cache)
+{
+    CHECK(cache);
+
+    FILE *state_file = fopen(cache->state_file_name, "rb");
+
+    if (state_file == nullptr)
+    {
+        return kBackendFailedToOpenFile;
+    }
+
+    struct stat state_stat = {};
+
+    if (fstat(fileno(state_file), &state_stat) != 0 || state_stat.st_size <= 0)
+    {
+        fclose(state_file);
+
+        return kBackendInvalidIncrementalState;
+    }
+
+    size_t state_size = (size_t) state_stat.st_size;
+
+    cache->state_buffer = (uint8_t *) malloc(state_size);
+
+    if (cache->state_buffer == nullptr)
+    {
+        fclose(state_file);
+
+        return kBackendFailedAllocation;
+    }
+
+    size_t read_size = fread(cache->state_buffer, sizeof(uint8_t), state_size, state_file);
+
+    fclose(state_file);
+
+    if (read_size != state_size)
+    {
+        return kBackendInvalidIncrementalState;
+    }
+
+    StateReader reader = {cache->state_buffer, state_size, 0};
+
+    BackendErrs_t error = ParseIncrementalState(cache, &reader);
+
+    if (error != kBackendSuccess)
+    {
+        return error;
+    }
+
+    qsort(cache->functions, cache->function_count, sizeof(CachedFunction), CompareCachedFunctions);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t ParseIncrementalState(IncrementalCache *cache,
+                                           StateReader      *reader)
+{
+    CHECK(cache);
+    CHECK(reader);
+
+    char     magic[sizeof(kStateFileMagic)]     = {};
+    uint8_t  options_hash[kSha256DigestSize]    = {};
+    uint64_t function_count                     = 0;
+
+    if (ReadStateData(reader, magic,           sizeof(magic))          != kBackendSuccess ||
+        ReadStateData(reader, options_hash,    sizeof(options_hash))   != kBackendSuccess ||
+        ReadStateData(reader, &function_count, sizeof(function_count)) != kBackendSuccess)
+    {
+        return kBackendInvalidIncrementalState;
+    }
+
+    // code built with other options or by another backend can't be reused
+    if (memcmp(magic,        kStateFileMagic,     sizeof(magic))        != 0 ||
+        memcmp(options_hash, cache->options_hash, sizeof(options_hash)) != 0 ||
+        function_count > reader->size)
+    {
+        return kBackendInvalidIncrementalState;
+    }
+
+    cache->functions = (CachedFunction *) calloc(function_count + 1, sizeof(CachedFunction));
+
+    if (cache->functions == nullptr)
+    {
+        return kBackendFailedAllocation;
+    }
+
+    for (size_t i = 0; i < function_count; i++)
+    {
+        cache->function_count++;
+
+        BackendErrs_t error = ParseCachedFunction(&cache->functions[i], reader);
+
+        if (error != kBackendSuccess)
+        {
+            return error;
+        }
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t ParseCachedFunction(CachedFunction *function,
+                                         StateReader    *reader)
+{
+    CHECK(function);
+    CHECK(reader);
+
+    uint64_t counts[6] = {};
+
+    if (ReadStateData(reader, function->hash, sizeof(function->hash)) != kBackendSuccess ||
+        ReadStateData(reader, counts,         sizeof(counts))         != kBackendSuccess)
+    {
+        return kBackendInvalidIncrementalState;
+    }
+
+    // every record takes at least a byte, so no count can exceed the file
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+    {
+        if (i != 1 && counts[i] > reader->size)
+        {
+            return kBackendInvalidIncrementalState;
+        }
+    }
+
+    function->instruction_count = counts[0];
+    function->code_size         = counts[1];
+
+    if (SkipStateData(reader, function->instruction_count * sizeof(Instruction), &function->instructions) != kBackendSuccess)
+    {
+        return kBackendInvalidIncrementalState;
+    }
+
+    function->calls         = (CachedCall *)       calloc(counts[2] + 1, sizeof(CachedCall));
+    function->relocations   = (CachedRelocation *) calloc(counts[3] + 1, sizeof(CachedRelocation));
+    function->label_offsets = (size_t *)           calloc(counts[4] + 1, sizeof(size_t));
+    function->line_rows     = (LineRow *)          calloc(counts[5] + 1, sizeof(LineRow));
+
+    if (function->calls == nullptr || function->relocations == nullptr || function->label_offsets == nullptr ||
+        function->line_rows == nullptr)
+    {
+        return kBackendFailedAllocation;
+    }
+
+    for (; function->call_count < counts[2]; function->call_count++)
+    {
+        CachedCall *call   = &function->calls[function->call_count];
+        uint64_t    offset = 0;
+
+        if (ReadStateData  (reader, &offset, sizeof(offset)) != kBackendSuccess ||
+            ReadStateString(reader, &call->callee_name)      != kBackendSuccess)
+        {
+            return kBackendInvalidIncrementalState;
+        }
+
+        call->offset = offset;
+    }
+
+    for (; function->relocation_count < counts[3]; function->relocation_count++)
+    {
+        CachedRelocation *relocation = &function->relocations[function->relocation_count];
+        uint64_t          offset     = 0;
+
+        if (ReadStateData  (reader, &offset,             sizeof(offset))             != kBackendSuccess ||
+            ReadStateData  (reader, &relocation->addend, sizeof(relocation->addend)) != kBackendSuccess ||
+            ReadStateString(reader, &relocation->symbol_name)                        != kBackendSuccess)
+        {
+            return kBackendInvalidIncrementalState;
+        }
+
+        relocation->offset = offset;
+    }
+
+    for (; function->label_count < counts[4]; function->label_count++)
+    {
+        uint64_t offset = 0;
+
+        if (ReadStateData(reader, &offset, sizeof(offset)) != kBackendSuccess)
+        {
+            return kBackendInvalidIncrementalState;
+        }
+
+        function->label_offsets[function->label_count] = offset;
+    }
+
+    for (; function->line_row_count < counts[5]; function->line_row_count++)
+    {
+        if (ReadStateData(reader, &function->line_rows[function->line_row_count], sizeof(LineRow)) != kBackendSuccess)
+        {
+            return kBackendInvalidIncrementalState;
+        }
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t ReadStateData(StateReader *reader,
+                                   void        *dest,
+                                   size_t       size)
+{
+    CHECK(reader);
+    CHECK(dest);
+
+    const uint8_t *data = nullptr;
+
+    if (SkipStateData(reader, size, &data) != kBackendSuccess)
+    {
+        return kBackendInvalidIncrementalState;
+    }
+
+    memcpy(dest, data, size);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t SkipStateData(StateReader    *reader,
+                                   size_t          size,
+                                   const uint8_t **data)
+{
+    CHECK(reader);
+    CHECK(data);
+
+    if (size > reader->size - reader->pos)
+    {
+        return kBackendInvalidIncrementalState;
+    }
+
+    *data = reader->buffer + reader->pos;
+
+    reader->pos += size;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t ReadStateString(StateReader  *reader,
+                                     const char  **str)
+{
+    CHECK(reader);
+    CHECK(str);
+
+    uint64_t       size = 0;
+    const uint8_t *data = nullptr;
+
+    if (ReadStateData(reader, &size, sizeof(size))   != kBackendSuccess ||
+        size == 0                                                       ||
+        SkipStateData(reader, (size_t) size, &data) != kBackendSuccess ||
+        data[size - 1] != '\0')
+    {
+        return kBackendInvalidIncrementalState;
+    }
+
+    *str = (const char *) data;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t SaveIncrementalState(IncrementalCache *cache,
+                                   BackendContext   *backend_context,
+                                   LanguageContext  *language_context)
+{
+    CHECK(cache);
+    CHECK(backend_context);
+    CHECK(language_context);
+
+    size_t temp_file_name_size = strlen(cache->state_file_name) + sizeof(".tmp");
+
+    char *temp_file_name = (char *) calloc(temp_file_name_size, sizeof(char));
+
+    if (temp_file_name == nullptr)
+    {
+        return kBackendFailedAllocation;
+    }
+
+    snprintf(temp_file_name, temp_file_name_size, "%s.tmp", cache->state_file_name);
+
+    FILE *state_file = fopen(temp_file_name, "wb");
+
+    if (state_file == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed to open file %s\n", __func__, temp_file_name);
+
+        free(temp_file_name);
+
+        return kBackendFailedToOpenFile;
+    }
+
+    uint64_t function_count = cache->range_count;
+
+    fwrite(kStateFileMagic,     sizeof(char),    sizeof(kStateFileMagic),     state_file);
+    fwrite(cache->options_hash, sizeof(uint8_t), sizeof(cache->options_hash), state_file);
+    fwrite(&function_count,     sizeof(uint64_t), 1,                          state_file);
+
+    for (size_t i = 0; i < cache->range_count; i++)
+    {
+        WriteFunctionRange(state_file, &cache->ranges[i], backend_context, language_context);
+    }
+
+    BackendErrs_t error = kBackendSuccess;
+
+    if (ferror(state_file) || fclose(state_file) != 0 || rename(temp_file_name, cache->state_file_name) != 0)
+    {
+        ColorPrintf(kRed, "%s() failed to write incremental state\n", __func__);
+
+        unlink(temp_file_name);
+
+        error = kBackendFailedToOpenFile;
+    }
+
+    free(temp_file_name);
+
+    return error;
+}
+
+//==============================================================================
+
+static BackendErrs_t WriteFunctionRange(FILE                *state_file,
+                                        const FunctionRange *range,
+                                        BackendContext      *backend_context,
+                                        LanguageContext     *language_context)
+{
+    CHECK(state_file);
+    CHECK(range);
+    CHECK(backend_context);
+    CHECK(language_context);
+
+    const List            *instruction_list = backend_context->instruction_list;
+    const Request         *requests         = backend_context->address_requests->requests;
+    const Label           *labels           = backend_context->label_table->label_array;
+    const RelocationTable *relocation_table = backend_context->relocation_table;
+
+    uint64_t call_count  = 0;
+    uint64_t label_count = 0;
+
+    for (size_t i = range->first_request; i < range->end_request; i++)
+    {
+        call_count += requests[i].func_pos != kFuncLabelPosPoison;
+    }
+
+    for (size_t i = range->first_label; i < range->end_label; i++)
+    {
+        label_count += labels[i].func_pos == kFuncLabelPosPoison;
+    }
+
+    uint64_t counts[6] =
+    {
+        range->instruction_count,
+        range->end_address - range->begin_address,
+        call_count,
+        range->end_relocation - range->first_relocation,
+        label_count,
+        range->end_line_row - range->first_line_row,
+    };
+
+    fwrite(range->hash, sizeof(uint8_t),  sizeof(range->hash), state_file);
+    fwrite(counts,      sizeof(uint64_t), 6,                   state_file);
+
+    int cur_node_pos = instruction_list->next[range->prev_tail];
+
+    for (size_t i = 0; i < range->instruction_count; i++)
+    {
+        Instruction instruction = instruction_list->data[cur_node_pos];
+
+        instruction.begin_address -= range->begin_address;
+
+        fwrite(&instruction, sizeof(Instruction), 1, state_file);
+
+        cur_node_pos = instruction_list->next[cur_node_pos];
+    }
+
+    for (size_t i = range->first_request; i < range->end_request; i++)
+    {
+        if (requests[i].func_pos == kFuncLabelPosPoison)
+        {
+            continue;
+        }
+
+        uint64_t offset = instruction_list->data[requests[i].jmp_instruction_list_pos].begin_address - range->begin_address;
+
+        fwrite(&offset, sizeof(uint64_t), 1, state_file);
+
+        WriteStateString(state_file, language_context->identifiers.identifier_array[requests[i].func_pos].id);
+    }
+
+    for (size_t i = range->first_relocation; i < range->end_relocation; i++)
+    {
+        const Elf64_Rela *relocation = &relocation_table->relocation_array[i];
+        const Elf64_Sym  *symbol     = &backend_context->symbol_table->sym_array[ELF64_R_SYM(relocation->r_info)];
+
+        uint64_t offset = relocation->r_offset - range->begin_address;
+
+        fwrite(&offset,              sizeof(uint64_t), 1, state_file);
+        fwrite(&relocation->r_addend, sizeof(int64_t), 1, state_file);
+
+        WriteStateString(state_file, GetStringByIndex(backend_context->strings, symbol->st_name));
+    }
+
+    for (size_t i = range->first_label; i < range->end_label; i++)
+    {
+        if (labels[i].func_pos != kFuncLabelPosPoison)
+        {
+            continue;
+        }
+
+        uint64_t offset = labels[i].address - range->begin_address;
+
+        fwrite(&offset, sizeof(uint64_t), 1, state_file);
+    }
+
+    for (size_t i = range->first_line_row; i < range->end_line_row; i++)
+    {
+        LineRow row = backend_context->line_table->rows[i];
+
+        row.address -= (uint32_t) range->begin_address;
+
+        fwrite(&row, sizeof(LineRow), 1, state_file);
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t WriteStateString(FILE       *state_file,
+                                      const char *str)
+{
+    CHECK(state_file);
+
+    if (str == nullptr)
+    {
+        str = "";
+    }
+
+    uint64_t size = strlen(str) + 1;
+
+    fwrite(&size, sizeof(uint64_t), 1,            state_file);
+    fwrite(str,   sizeof(char),     (size_t) size, state_file);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static int CompareCachedFunctions(const void *lhs, const void *rhs)
+{
+    return memcmp(((const CachedFunction *) lhs)->hash,
+                  ((const CachedFunction *) rhs)->hash,
+                  kSha256DigestSize);
+}
+
+//==============================================================================
+
+static int CompareFunctionNames(const void *lhs, const void *rhs)
+{
+    return strcmp(((const FunctionName *) lhs)->name,
+                  ((const FunctionName *) rhs)->name);
+}
+
+//==============================================================================
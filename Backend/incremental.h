@@ -0,0 +1,129 @@
+#ifndef INCREMENTAL_HEADER
+#define INCREMENTAL_HEADER
+
+#include "backend.h"
+#include "sha256.h"
+
+static const char *kIncrementalFlag = "--incremental";
+
+struct CachedCall
+{
+    size_t      offset;
+
+    const char *callee_name;
+};
+
+struct CachedRelocation
+{
+    size_t      offset;
+
+    int64_t     addend;
+
+    const char *symbol_name;
+};
+
+// Everything that is needed to put a function back into the program
+// without generating it again. Offsets are relative to the function
+// start; instructions are stored with their jumps already resolved.
+struct CachedFunction
+{
+    uint8_t           hash[kSha256DigestSize];
+
+    const uint8_t    *instructions;
+    size_t            instruction_count;
+
+    size_t            code_size;
+
+    CachedCall       *calls;
+    size_t            call_count;
+
+    CachedRelocation *relocations;
+    size_t            relocation_count;
+
+    size_t           *label_offsets;
+    size_t            label_count;
+
+    LineRow          *line_rows;
+    size_t            line_row_count;
+};
+
+// Where a function ended up in the current run
+struct FunctionRange
+{
+    uint8_t hash[kSha256DigestSize];
+
+    int     prev_tail;
+
+    size_t  instruction_count;
+
+    size_t  begin_address;
+    size_t  end_address;
+
+    size_t  first_request;
+    size_t  end_request;
+
+    size_t  first_relocation;
+    size_t  end_relocation;
+
+    size_t  first_label;
+    size_t  end_label;
+
+    size_t  first_line_row;
+    size_t  end_line_row;
+};
+
+struct FunctionName
+{
+    const char *name;
+
+    size_t      pos;
+};
+
+struct IncrementalCache
+{
+    const char     *state_file_name;
+
+    uint8_t         options_hash[kSha256DigestSize];
+
+    uint8_t        *state_buffer;
+
+    CachedFunction *functions;
+    size_t          function_count;
+
+    FunctionName   *function_names;
+    size_t          function_name_count;
+
+    FunctionRange  *ranges;
+    size_t          range_count;
+    size_t          range_capacity;
+
+    size_t          reused_count;
+    size_t          compiled_count;
+};
+
+BackendErrs_t IncrementalCacheInit(IncrementalCache *cache,
+                                   const char       *state_file_name,
+                                   BackendContext   *backend_context,
+                                   LanguageContext  *language_context);
+
+BackendErrs_t IncrementalCacheDestroy(IncrementalCache *cache);
+
+BackendErrs_t HashFunction(LanguageContext    *language_context,
+                           const TreeNode     *func_node,
+                           const TableOfNames *cur_table,
+                           uint8_t            *hash);
+
+const CachedFunction *FindCachedFunction(const IncrementalCache *cache,
+                                         const uint8_t          *hash);
+
+int32_t FindFunctionPos(const IncrementalCache *cache,
+                        const char             *func_name);
+
+BackendErrs_t AddFunctionRange(IncrementalCache    *cache,
+                               const FunctionRange *range);
+
+BackendErrs_t SaveIncrementalState(IncrementalCache *cache,
+                                   BackendContext   *backend_context,
+                                   LanguageContext  *language_context);
+
+#endif
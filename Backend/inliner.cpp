@@ -0,0 +1,782 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tree_optimizer.h"
+#include "../debug/debug.h"
+#include "../debug/color_print.h"
+
+static const size_t kInlineLeafNodeLimit = 48;
+static const size_t kInlineHotNodeLimit  = 160;
+static const size_t kInlineOnceNodeLimit = 256;
+static const size_t kInlineFuncNodeLimit = 4096;
+
+static const size_t kNotRemapped = (size_t) -1;
+
+static const size_t kMaxInlinedNameLen = 256;
+
+struct InlineContext
+{
+    LanguageContext *language_context;
+
+    const ProfileData *profile;
+
+    TreeNode **func_defs;
+    size_t    *call_counts;
+
+    size_t funcs_size;
+    size_t inlined_count;
+};
+
+static TreeErrs_t InlineContextInit(InlineContext     *inline_context,
+                                    LanguageContext   *language_context,
+                                    const ProfileData *profile);
+
+static TreeErrs_t InlineContextDtor(InlineContext *inline_context);
+
+static TreeErrs_t CountCalls(const TreeNode *node,
+                             size_t         *call_counts,
+                             size_t          funcs_size);
+
+static size_t CountNodes(const TreeNode *node);
+
+static bool ContainsReturn(const TreeNode *node);
+
+static bool HasSideEffects(const TreeNode *node);
+
+static size_t CountListItems(const TreeNode *list);
+
+static bool IsInlinableBody(const TreeNode *body);
+
+static bool IsInlineCandidate(InlineContext  *inline_context,
+                              const TreeNode *call_node,
+                              size_t          caller_pos);
+
+static bool IsReorderableCall(InlineContext  *inline_context,
+                              const TreeNode *call_node);
+
+static TreeNode **FindInlineSite(InlineContext  *inline_context,
+                                 TreeNode      **link,
+                                 size_t          caller_pos);
+
+static TreeErrs_t InlineFuncCalls(InlineContext *inline_context,
+                                  TreeNode      *func_node);
+
+static TreeErrs_t InlineStatementList(InlineContext *inline_context,
+                                      TreeNode      *func_node,
+                                      TreeNode     **list);
+
+static TreeErrs_t InlineCallSite(InlineContext  *inline_context,
+                                 TableOfNames   *caller_table,
+                                 TreeNode      **call_link,
+                                 TreeNode      **inlined_head,
+                                 TreeNode      **inlined_tail);
+
+static size_t AddInlinedName(InlineContext *inline_context,
+                             TableOfNames  *caller_table,
+                             size_t         callee_pos,
+                             size_t         var_pos);
+
+static TreeErrs_t RemapIdentifiers(TreeNode     *node,
+                                   const size_t *remap,
+                                   size_t        remap_size);
+
+static TreeErrs_t AppendStatement(TreeNode **head,
+                                  TreeNode **tail,
+                                  TreeNode  *statement);
+
+static TreeErrs_t RemoveInlinedFunctions(InlineContext *inline_context,
+                                         const size_t  *old_call_counts);
+
+//==============================================================================
+
+TreeErrs_t InlineFunctions(LanguageContext   *language_context,
+                           const ProfileData *profile)
+{
+    CHECK(language_context);
+
+    InlineContext inline_context = {};
+
+    if (InlineContextInit(&inline_context, language_context, profile) != kTreeSuccess)
+    {
+        return kFailedAllocation;
+    }
+
+    for (TreeNode *cur_decl = language_context->syntax_tree.root;
+                   cur_decl != nullptr;
+                   cur_decl = cur_decl->right)
+    {
+        if (cur_decl->left != nullptr && cur_decl->left->type == kFuncDef)
+        {
+            InlineFuncCalls(&inline_context, cur_decl->left);
+        }
+    }
+
+    TreeErrs_t status = kTreeNotOptimized;
+
+    if (inline_context.inlined_count > 0)
+    {
+        RemoveInlinedFunctions(&inline_context, inline_context.call_counts);
+
+        status = kTreeOptimized;
+    }
+
+    InlineContextDtor(&inline_context);
+
+    return status;
+}
+
+//==============================================================================
+
+static TreeErrs_t InlineContextInit(InlineContext     *inline_context,
+                                    LanguageContext   *language_context,
+                                    const ProfileData *profile)
+{
+    CHECK(inline_context);
+    CHECK(language_context);
+
+    inline_context->language_context = language_context;
+    inline_context->profile          = profile;
+    inline_context->funcs_size       = language_context->identifiers.identifier_count;
+    inline_context->inlined_count    = 0;
+
+    inline_context->func_defs   = (TreeNode **) calloc(inline_context->funcs_size, sizeof(TreeNode *));
+    inline_context->call_counts = (size_t *)    calloc(inline_context->funcs_size, sizeof(size_t));
+
+    if (inline_context->func_defs == nullptr || inline_context->call_counts == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        InlineContextDtor(inline_context);
+
+        return kFailedAllocation;
+    }
+
+    for (TreeNode *cur_decl = language_context->syntax_tree.root;
+                   cur_decl != nullptr;
+                   cur_decl = cur_decl->right)
+    {
+        if (cur_decl->left != nullptr && cur_decl->left->type == kFuncDef &&
+            cur_decl->left->data.variable_pos < inline_context->funcs_size)
+        {
+            inline_context->func_defs[cur_decl->left->data.variable_pos] = cur_decl->left;
+        }
+    }
+
+    CountCalls(language_context->syntax_tree.root,
+               inline_context->call_counts,
+               inline_context->funcs_size);
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+static TreeErrs_t InlineContextDtor(InlineContext *inline_context)
+{
+    CHECK(inline_context);
+
+    free(inline_context->func_defs);
+    free(inline_context->call_counts);
+
+    inline_context->func_defs   = nullptr;
+    inline_context->call_counts = nullptr;
+    inline_context->funcs_size  = 0;
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+static TreeErrs_t CountCalls(const TreeNode *node,
+                             size_t         *call_counts,
+                             size_t          funcs_size)
+{
+    CHECK(call_counts);
+
+    if (node == nullptr)
+    {
+        return kTreeSuccess;
+    }
+
+    if (node->type == kCall && node->right != nullptr &&
+        node->right->data.variable_pos < funcs_size)
+    {
+        call_counts[node->right->data.variable_pos]++;
+    }
+
+    CountCalls(node->left,  call_counts, funcs_size);
+    CountCalls(node->right, call_counts, funcs_size);
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+static size_t CountNodes(const TreeNode *node)
+{
+    if (node == nullptr)
+    {
+        return 0;
+    }
+
+    return 1 + CountNodes(node->left) + CountNodes(node->right);
+}
+
+//==============================================================================
+
+static bool ContainsReturn(const TreeNode *node)
+{
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    if (node->type == kOperator && node->data.key_word_code == kReturn)
+    {
+        return true;
+    }
+
+    return ContainsReturn(node->left) ||
+           ContainsReturn(node->right);
+}
+
+//==============================================================================
+
+static bool HasSideEffects(const TreeNode *node)
+{
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    if (node->type == kCall)
+    {
+        return true;
+    }
+
+    if (node->type == kOperator &&
+        (node->data.key_word_code == kScan  ||
+         node->data.key_word_code == kPrint ||
+         node->data.key_word_code == kAbort))
+    {
+        return true;
+    }
+
+    return HasSideEffects(node->left) ||
+           HasSideEffects(node->right);
+}
+
+//==============================================================================
+
+static size_t CountListItems(const TreeNode *list)
+{
+    size_t count = 0;
+
+    for (; list != nullptr; list = list->right)
+    {
+        if (list->left != nullptr)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+//==============================================================================
+
+static bool IsInlinableBody(const TreeNode *body)
+{
+    if (body == nullptr)
+    {
+        return false;
+    }
+
+    const TreeNode *cur_node = body;
+
+    while (cur_node->right != nullptr)
+    {
+        if (ContainsReturn(cur_node->left))
+        {
+            return false;
+        }
+
+        cur_node = cur_node->right;
+    }
+
+    const TreeNode *last_statement = cur_node->left;
+
+    return last_statement != nullptr && last_statement->type == kOperator &&
+           last_statement->data.key_word_code == kReturn &&
+           last_statement->right != nullptr;
+}
+
+//==============================================================================
+
+static bool IsInlineCandidate(InlineContext  *inline_context,
+                              const TreeNode *call_node,
+                              size_t          caller_pos)
+{
+    CHECK(inline_context);
+    CHECK(call_node);
+
+    size_t callee_pos = call_node->right->data.variable_pos;
+
+    if (callee_pos >= inline_context->funcs_size ||
+        callee_pos == caller_pos                 ||
+        callee_pos == inline_context->language_context->tables.main_id_pos)
+    {
+        return false;
+    }
+
+    const TreeNode *callee = inline_context->func_defs[callee_pos];
+
+    if (callee == nullptr || callee->right == nullptr ||
+        !IsInlinableBody(callee->right->right))
+    {
+        return false;
+    }
+
+    if (CountListItems(callee->right->left) != CountListItems(call_node->left))
+    {
+        return false;
+    }
+
+    size_t body_size = CountNodes(callee->right->right);
+
+    // the profile lets hot leaves grow their callers more and keeps calls
+    // the program never made out of line
+    size_t leaf_node_limit = kInlineLeafNodeLimit;
+
+    switch (GetFunctionTemperature(inline_context->profile,
+                                   inline_context->language_context->identifiers.identifier_array[callee_pos].id))
+    {
+        case kFunctionHot:
+        {
+            leaf_node_limit = kInlineHotNodeLimit;
+
+            break;
+        }
+
+        case kFunctionCold:
+        {
+            leaf_node_limit = 0;
+
+            break;
+        }
+
+        case kFunctionUnprofiled:
+        case kFunctionWarm:
+        default:
+        {
+            break;
+        }
+    }
+
+    if (!ContainsCall(callee->right->right, -1) && body_size <= leaf_node_limit)
+    {
+        return true;
+    }
+
+    return inline_context->call_counts[callee_pos] == 1 &&
+           body_size <= kInlineOnceNodeLimit            &&
+           !ContainsCall(callee->right->right, (int) callee_pos);
+}
+
+//==============================================================================
+
+static bool IsReorderableCall(InlineContext  *inline_context,
+                              const TreeNode *call_node)
+{
+    CHECK(inline_context);
+    CHECK(call_node);
+
+    const TreeNode *callee = inline_context->func_defs[call_node->right->data.variable_pos];
+
+    return !HasSideEffects(call_node->left) &&
+           !HasSideEffects(callee->right->right);
+}
+
+//==============================================================================
+
+static TreeNode **FindInlineSite(InlineContext  *inline_context,
+                                 TreeNode      **link,
+                                 size_t          caller_pos)
+{
+    CHECK(inline_context);
+    CHECK(link);
+
+    TreeNode *node = *link;
+
+    if (node == nullptr)
+    {
+        return nullptr;
+    }
+
+    if (node->type == kCall && IsInlineCandidate(inline_context, node, caller_pos))
+    {
+        return link;
+    }
+
+    if (node->type == kVarDecl)
+    {
+        return FindInlineSite(inline_context, &node->right, caller_pos);
+    }
+
+    TreeNode **site = FindInlineSite(inline_context, &node->left, caller_pos);
+
+    if (site != nullptr && (!HasSideEffects(node->right) || IsReorderableCall(inline_context, *site)))
+    {
+        return site;
+    }
+
+    site = FindInlineSite(inline_context, &node->right, caller_pos);
+
+    if (site != nullptr && (!HasSideEffects(node->left) || IsReorderableCall(inline_context, *site)))
+    {
+        return site;
+    }
+
+    return nullptr;
+}
+
+//==============================================================================
+
+static TreeErrs_t InlineFuncCalls(InlineContext *inline_context,
+                                  TreeNode      *func_node)
+{
+    CHECK(inline_context);
+    CHECK(func_node);
+
+    if (func_node->right == nullptr)
+    {
+        return kTreeNotOptimized;
+    }
+
+    return InlineStatementList(inline_context, func_node, &func_node->right->right);
+}
+
+//==============================================================================
+
+static TreeErrs_t InlineStatementList(InlineContext *inline_context,
+                                      TreeNode      *func_node,
+                                      TreeNode     **list)
+{
+    CHECK(inline_context);
+    CHECK(func_node);
+    CHECK(list);
+
+    TableOfNames *caller_table = GetFuncNameTable(&inline_context->language_context->tables,
+                                                  func_node->data.variable_pos);
+
+    if (caller_table == nullptr)
+    {
+        return kFailedToFind;
+    }
+
+    TreeErrs_t status = kTreeNotOptimized;
+
+    TreeNode **link = list;
+
+    while (*link != nullptr)
+    {
+        TreeNode *statement = (*link)->left;
+
+        TreeNode **site = nullptr;
+
+        if (statement != nullptr && statement->type == kOperator &&
+            (statement->data.key_word_code == kIf || statement->data.key_word_code == kWhile))
+        {
+            if (statement->data.key_word_code == kIf)
+            {
+                site = FindInlineSite(inline_context, &statement->left, func_node->data.variable_pos);
+            }
+
+            if (site == nullptr)
+            {
+                InlineStatementList(inline_context, func_node, &statement->right);
+            }
+        }
+        else
+        {
+            site = FindInlineSite(inline_context, &(*link)->left, func_node->data.variable_pos);
+        }
+
+        if (site != nullptr && CountNodes(func_node) <= kInlineFuncNodeLimit)
+        {
+            TreeNode *inlined_head = nullptr;
+            TreeNode *inlined_tail = nullptr;
+
+            if (InlineCallSite(inline_context, caller_table, site,
+                               &inlined_head, &inlined_tail) == kTreeOptimized)
+            {
+                status = kTreeOptimized;
+
+                if (inlined_head != nullptr)
+                {
+                    inlined_tail->right = *link;
+                    *link               = inlined_head;
+                }
+
+                continue;
+            }
+        }
+
+        link = &(*link)->right;
+    }
+
+    return status;
+}
+
+//==============================================================================
+
+static TreeErrs_t InlineCallSite(InlineContext  *inline_context,
+                                 TableOfNames   *caller_table,
+                                 TreeNode      **call_link,
+                                 TreeNode      **inlined_head,
+                                 TreeNode      **inlined_tail)
+{
+    CHECK(inline_context);
+    CHECK(caller_table);
+    CHECK(call_link);
+    CHECK(inlined_head);
+    CHECK(inlined_tail);
+
+    TreeNode *call_node  = *call_link;
+    size_t    callee_pos = call_node->right->data.variable_pos;
+    TreeNode *callee     = inline_context->func_defs[callee_pos];
+
+    TableOfNames *callee_table = GetFuncNameTable(&inline_context->language_context->tables, callee_pos);
+
+    if (callee_table == nullptr)
+    {
+        return kFailedToFind;
+    }
+
+    size_t  remap_size = inline_context->language_context->identifiers.identifier_count;
+    size_t *remap      = (size_t *) calloc(remap_size, sizeof(size_t));
+
+    if (remap == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kFailedAllocation;
+    }
+
+    for (size_t i = 0; i < remap_size; i++)
+    {
+        remap[i] = kNotRemapped;
+    }
+
+    for (size_t i = 0; i < callee_table->name_count; i++)
+    {
+        if (callee_table->names[i].type == kVar && callee_table->names[i].pos < remap_size)
+        {
+            remap[callee_table->names[i].pos] = AddInlinedName(inline_context, caller_table,
+                                                               callee_pos,
+                                                               callee_table->names[i].pos);
+        }
+    }
+
+    TreeNode *param_node = callee->right->left;
+    TreeNode *arg_node   = call_node->left;
+
+    while (param_node != nullptr && arg_node != nullptr)
+    {
+        if (param_node->left == nullptr)
+        {
+            param_node = param_node->right;
+
+            continue;
+        }
+
+        if (arg_node->left == nullptr)
+        {
+            arg_node = arg_node->right;
+
+            continue;
+        }
+
+        size_t param_pos = remap[param_node->left->data.variable_pos];
+
+        TreeNode *param_ident = NodeCtor(nullptr, nullptr, nullptr, kIdentifier, (double) param_pos);
+        TreeNode *assign_node = NodeCtor(nullptr, arg_node->left, param_ident, kOperator, kAssign);
+
+        AppendStatement(inlined_head, inlined_tail,
+                        NodeCtor(nullptr, CopyNode(param_node->left->left), assign_node, kVarDecl, (double) param_pos));
+
+        arg_node->left = nullptr;
+
+        param_node = param_node->right;
+        arg_node   = arg_node->right;
+    }
+
+    TreeNode *cur_statement = callee->right->right;
+
+    for (; cur_statement->right != nullptr; cur_statement = cur_statement->right)
+    {
+        if (cur_statement->left == nullptr)
+        {
+            continue;
+        }
+
+        TreeNode *statement_copy = CopyNode(cur_statement->left);
+
+        RemapIdentifiers(statement_copy, remap, remap_size);
+
+        AppendStatement(inlined_head, inlined_tail, statement_copy);
+    }
+
+    TreeNode *return_value = CopyNode(cur_statement->left->right);
+
+    RemapIdentifiers(return_value, remap, remap_size);
+
+    *call_link = return_value;
+
+    TreeDtor(call_node);
+
+    free(remap);
+
+    inline_context->inlined_count++;
+
+    return kTreeOptimized;
+}
+
+//==============================================================================
+
+static size_t AddInlinedName(InlineContext *inline_context,
+                             TableOfNames  *caller_table,
+                             size_t         callee_pos,
+                             size_t         var_pos)
+{
+    CHECK(inline_context);
+    CHECK(caller_table);
+
+    Identifiers *identifiers = &inline_context->language_context->identifiers;
+
+    char name[kMaxInlinedNameLen] = {0};
+
+    snprintf(name, kMaxInlinedNameLen, "%s.%s.%lu", identifiers->identifier_array[callee_pos].id,
+                                                    identifiers->identifier_array[var_pos].id,
+                                                    inline_context->inlined_count);
+
+    size_t new_pos = AddIdentifier(identifiers, strdup(name));
+
+    identifiers->identifier_array[new_pos].declaration_state = true;
+    identifiers->identifier_array[new_pos].id_type           = kVar;
+
+    AddName(caller_table, new_pos, kVar);
+
+    return new_pos;
+}
+
+//==============================================================================
+
+static TreeErrs_t RemapIdentifiers(TreeNode     *node,
+                                   const size_t *remap,
+                                   size_t        remap_size)
+{
+    CHECK(remap);
+
+    if (node == nullptr)
+    {
+        return kTreeSuccess;
+    }
+
+    if ((node->type == kIdentifier || node->type == kVarDecl) &&
+         node->data.variable_pos < remap_size &&
+         remap[node->data.variable_pos] != kNotRemapped)
+    {
+        node->data.variable_pos = remap[node->data.variable_pos];
+    }
+
+    if (node->type == kCall)
+    {
+        return RemapIdentifiers(node->left, remap, remap_size);
+    }
+
+    RemapIdentifiers(node->left,  remap, remap_size);
+    RemapIdentifiers(node->right, remap, remap_size);
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+static TreeErrs_t AppendStatement(TreeNode **head,
+                                  TreeNode **tail,
+                                  TreeNode  *statement)
+{
+    CHECK(head);
+    CHECK(tail);
+
+    TreeNode *list_node = NodeCtor(nullptr, statement, nullptr, kOperator, kEndOfLine);
+
+    if (list_node == nullptr)
+    {
+        return kFailedAllocation;
+    }
+
+    if (*head == nullptr)
+    {
+        *head = list_node;
+    }
+    else
+    {
+        (*tail)->right = list_node;
+    }
+
+    *tail = list_node;
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+static TreeErrs_t RemoveInlinedFunctions(InlineContext *inline_context,
+                                         const size_t  *old_call_counts)
+{
+    CHECK(inline_context);
+    CHECK(old_call_counts);
+
+    size_t *new_call_counts = (size_t *) calloc(inline_context->funcs_size, sizeof(size_t));
+
+    if (new_call_counts == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kFailedAllocation;
+    }
+
+    CountCalls(inline_context->language_context->syntax_tree.root,
+               new_call_counts,
+               inline_context->funcs_size);
+
+    TreeNode **link = &inline_context->language_context->syntax_tree.root;
+
+    while (*link != nullptr)
+    {
+        TreeNode *decl = (*link)->left;
+
+        if (decl != nullptr && decl->type == kFuncDef &&
+            decl->data.variable_pos < inline_context->funcs_size &&
+            old_call_counts[decl->data.variable_pos] > 0          &&
+            new_call_counts[decl->data.variable_pos] == 0)
+        {
+            inline_context->func_defs[decl->data.variable_pos] = nullptr;
+
+            RemoveStatement(link);
+
+            continue;
+        }
+
+        link = &(*link)->right;
+    }
+
+    free(new_call_counts);
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
@@ -4,6 +4,7 @@
 
 #include "backend_common.h"
 #include "backend_dump.h"
+#include "../debug/color_print.h"
 
 #include "instruction_encoding.h"
 
@@ -12,6 +13,11 @@ static RegisterCode_t GetRegisterBase(RegisterCode_t reg);
 
 static bool IsNewRegister(RegisterCode_t reg);
 
+static BackendErrs_t SetSib(Instruction    *instruction,
+                            uint8_t         scale,
+                            RegisterCode_t  index_register,
+                            RegisterCode_t  base_register);
+
 //==============================================================================
 
 static bool IsNewRegister(RegisterCode_t reg)
@@ -27,6 +33,11 @@ BackendErrs_t SetInstructionSize(Instruction *instruction)
 
     instruction->instruction_size = 0;
 
+    if (instruction->legacy_prefix != 0)
+    {
+        instruction->instruction_size += sizeof(instruction->legacy_prefix);
+    }
+
     if (instruction->rex_prefix != 0)
     {
         instruction->instruction_size += sizeof(instruction->rex_prefix);
@@ -36,10 +47,14 @@ BackendErrs_t SetInstructionSize(Instruction *instruction)
     {
         instruction->op_code_size = 1;
     }
-    else
+    else if (instruction->op_code <= 0xffff)
     {
         instruction->op_code_size = 2;
     }
+    else
+    {
+        instruction->op_code_size = 3;
+    }
 
     instruction->instruction_size += instruction->op_code_size;
 
@@ -48,6 +63,11 @@ BackendErrs_t SetInstructionSize(Instruction *instruction)
         instruction->instruction_size += sizeof(instruction->mod_rm);
     }
 
+    if (instruction->sib != 0)
+    {
+        instruction->instruction_size += sizeof(instruction->sib);
+    }
+
     instruction->instruction_size += instruction->displacement_size;
 
     instruction->instruction_size += instruction->immediate_size;
@@ -59,7 +79,7 @@ BackendErrs_t SetInstructionSize(Instruction *instruction)
 
 BackendErrs_t SetInstruction(Instruction        *instruction,
                              BackendContext     *backend_context,
-                             uint16_t            op_code,
+                             uint32_t            op_code,
                              DisplacementType_t  displacement,
                              ImmediateType_t     immediate_arg,
                              LogicalOpcode_t     logical_op_code,
@@ -133,6 +153,27 @@ BackendErrs_t SetModRm(Instruction    *instruction,
 
 //==============================================================================
 
+static BackendErrs_t SetSib(Instruction    *instruction,
+                            uint8_t         scale,
+                            RegisterCode_t  index_register,
+                            RegisterCode_t  base_register)
+{
+    CHECK(instruction);
+
+    uint8_t scale_bits = 0;
+
+    while ((1 << scale_bits) < scale)
+    {
+        scale_bits++;
+    }
+
+    instruction->sib = (uint8_t) ((scale_bits << 6) | ((index_register & 0x7) << 3) | (base_register & 0x7));
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
 #define ADD_INSTRUCTION(instr) ListAddAfter(backend_context->instruction_list,       \
                                             backend_context->instruction_list->tail, \
                                             instr);
@@ -151,6 +192,8 @@ BackendErrs_t SetModRm(Instruction    *instruction,
                                                              source_reg,   \
                                                              receiver_reg)
 
+#define SET_SIB(scale, index_reg, base_reg) SetSib(&instruction, scale, index_reg, base_reg)
+
 #define SET_REX_PREFIX(qword_usage, register_extension, sib_extension, mod_rm_extension) SetRexPrefix(&instruction,        \
                                                                                                        qword_usage,        \
                                                                                                        register_extension, \
@@ -192,6 +235,27 @@ BackendErrs_t EncodeCall(BackendContext  *backend_context,
 
 //==============================================================================
 
+BackendErrs_t EncodeFuncJump(BackendContext  *backend_context,
+                             LanguageContext *language_context,
+                             int32_t          func_pos)
+{
+    Instruction instruction = {0};
+
+    SET_INSTRUCTION(kJmpRel32, 0, kJmpPoison, kLogicJmp, sizeof(RelativeAddrType_t), 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    AddFuncLabelRequest(backend_context,
+                        backend_context->instruction_list->tail,
+                        func_pos);
+
+    BackendDumpPrintFuncJump(language_context, func_pos);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
 BackendErrs_t EncodePushRegister(BackendContext *backend_context,
                                  RegisterCode_t  reg)
 {
@@ -206,6 +270,8 @@ BackendErrs_t EncodePushRegister(BackendContext *backend_context,
 
     ADD_INSTRUCTION(&instruction);
 
+    backend_context->stack_temporaries++;
+
     BackendDumpPrintInstruction(backend_context, &instruction);
 
     return kBackendSuccess;
@@ -297,6 +363,11 @@ BackendErrs_t EncodePopInRegister(BackendContext *backend_context,
 
     ADD_INSTRUCTION(&instruction);
 
+    if (backend_context->stack_temporaries > 0)
+    {
+        backend_context->stack_temporaries--;
+    }
+
     BackendDumpPrintInstruction(backend_context, &instruction);
 
     return kBackendSuccess;
@@ -325,7 +396,7 @@ BackendErrs_t EncodeMovImmediateToRegister(BackendContext  *backend_context,
                        kRexPrefixNoOptions);
     }
 
-    SET_INSTRUCTION(kMovImmToR64, 0, immediate, kLogicMovImmediateToRegister, sizeof(ImmediateType_t), 0);
+    SET_INSTRUCTION(kMovImmToR64 + GetRegisterBase(dest_reg), 0, immediate, kLogicMovImmediateToRegister, sizeof(ImmediateType_t), 0);
 
     ADD_INSTRUCTION(&instruction);
 
@@ -390,7 +461,7 @@ BackendErrs_t EncodeAddImmediateToRegister(BackendContext  *backend_context,
 
     SET_MOD_RM(kRegister, kRAX, GetRegisterBase(dest_reg));
 
-    SET_INSTRUCTION(kAddImmToRm64, 0, immediate, kLogicAddImmediateToRegister, sizeof(ImmediateType_t), 0);
+    SET_INSTRUCTION(kAddImmToRm64, 0, immediate, kLogicAddImmediateToRegister, sizeof(int32_t), 0);
 
     ADD_INSTRUCTION(&instruction);
 
@@ -560,6 +631,8 @@ BackendErrs_t EncodeRegisterAndRegister(BackendContext *backend_context,
 
     SET_INSTRUCTION(kAndR64Rm64, 0, 0, kLogicRegisterAndRegister, 0, 0);
 
+    ADD_INSTRUCTION(&instruction);
+
     BackendDumpPrintInstruction(backend_context, &instruction);
 
     return kBackendSuccess;
@@ -590,7 +663,9 @@ BackendErrs_t EncodeRegisterOrRegister(BackendContext *backend_context,
 
     SET_MOD_RM(kRegister, GetRegisterBase(dest_reg), GetRegisterBase(src_reg));
 
-    SET_INSTRUCTION(kOrR64Rm64, 0, 0, kLogicRegisterAndRegister, 0, 0);
+    SET_INSTRUCTION(kOrR64Rm64, 0, 0, kLogicRegisterOrRegister, 0, 0);
+
+    ADD_INSTRUCTION(&instruction);
 
     BackendDumpPrintInstruction(backend_context, &instruction);
 
@@ -662,7 +737,7 @@ BackendErrs_t EncodeDivRegister(BackendContext *backend_context,
 
 //==============================================================================
 
-static const uint8_t kImulRegisterModRmRegisterCode = 0x04;
+static const uint8_t kImulRegisterModRmRegisterCode = 0x05;
 
 BackendErrs_t EncodeImulRegister(BackendContext *backend_context,
                                  RegisterCode_t  dest_reg)
@@ -769,3 +844,498 @@ BackendErrs_t EncodeLeave(BackendContext *backend_context)
 }
 
 //==============================================================================
+
+static const uint8_t kShlModRmRegisterCode = 0x04;
+static const uint8_t kShrModRmRegisterCode = 0x05;
+static const uint8_t kSarModRmRegisterCode = 0x07;
+
+BackendErrs_t EncodeShiftRegisterByImmediate(BackendContext  *backend_context,
+                                             LogicalOpcode_t  logical_opcode,
+                                             RegisterCode_t   dest_reg,
+                                             uint8_t          shift)
+{
+    Instruction instruction = {0};
+
+    uint8_t mod_rm_code = kShlModRmRegisterCode;
+
+    if (logical_opcode == kLogicShrRegisterByImmediate)
+    {
+        mod_rm_code = kShrModRmRegisterCode;
+    }
+    else if (logical_opcode == kLogicSarRegisterByImmediate)
+    {
+        mod_rm_code = kSarModRmRegisterCode;
+    }
+
+    RexPrefixCode_t rm_extension = kRexPrefixNoOptions;
+
+    if (IsNewRegister(dest_reg))
+    {
+        rm_extension = kModRmExtension;
+    }
+
+    SET_REX_PREFIX(kQwordUsing, kRexPrefixNoOptions, kRexPrefixNoOptions, rm_extension);
+
+    SET_MOD_RM(kRegister, (RegisterCode_t) mod_rm_code, GetRegisterBase(dest_reg));
+
+    SET_INSTRUCTION(kShiftRm64ByImm8, 0, shift, logical_opcode, sizeof(uint8_t), 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static const uint8_t kSibModRmRegisterCode = 0x04;
+
+BackendErrs_t EncodeLeaScaledIndex(BackendContext *backend_context,
+                                   RegisterCode_t  dest_reg,
+                                   RegisterCode_t  base_reg,
+                                   RegisterCode_t  index_reg,
+                                   uint8_t         scale)
+{
+    Instruction instruction = {0};
+
+    if (GetRegisterBase(base_reg) == kRBP || index_reg == kRSP ||
+        (scale != 2 && scale != 4 && scale != 8))
+    {
+        ColorPrintf(kRed, "%s() unsupported addressing\n", __func__);
+
+        return kBackendUnsupportedAddressing;
+    }
+
+    RexPrefixCode_t reg_extension   = kRexPrefixNoOptions;
+    RexPrefixCode_t index_extension = kRexPrefixNoOptions;
+    RexPrefixCode_t base_extension  = kRexPrefixNoOptions;
+
+    if (IsNewRegister(dest_reg))
+    {
+        reg_extension = kRegisterExtension;
+    }
+
+    if (IsNewRegister(index_reg))
+    {
+        index_extension = kSibExtension;
+    }
+
+    if (IsNewRegister(base_reg))
+    {
+        base_extension = kModRmExtension;
+    }
+
+    SET_REX_PREFIX(kQwordUsing, reg_extension, index_extension, base_extension);
+
+    SET_MOD_RM(kRegisterMemoryMode, GetRegisterBase(dest_reg), (RegisterCode_t) kSibModRmRegisterCode);
+
+    SET_SIB(scale, GetRegisterBase(index_reg), GetRegisterBase(base_reg));
+
+    SET_INSTRUCTION(kLeaR64FromM, 0, 0, kLogicLeaScaledIndex, 0, 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t EncodeImulRegisterByImmediate(BackendContext *backend_context,
+                                            RegisterCode_t  dest_reg,
+                                            RegisterCode_t  src_reg,
+                                            int32_t         immediate)
+{
+    Instruction instruction = {0};
+
+    RexPrefixCode_t reg_extension = kRexPrefixNoOptions;
+    RexPrefixCode_t rm_extension  = kRexPrefixNoOptions;
+
+    if (IsNewRegister(dest_reg))
+    {
+        reg_extension = kRegisterExtension;
+    }
+
+    if (IsNewRegister(src_reg))
+    {
+        rm_extension = kModRmExtension;
+    }
+
+    SET_REX_PREFIX(kQwordUsing, reg_extension, kRexPrefixNoOptions, rm_extension);
+
+    SET_MOD_RM(kRegister, GetRegisterBase(dest_reg), GetRegisterBase(src_reg));
+
+    SET_INSTRUCTION(kImulR64Rm64Imm32, 0, immediate, kLogicImulRegisterByImmediate, sizeof(int32_t), 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static const uint8_t kNegModRmRegisterCode = 0x03;
+
+BackendErrs_t EncodeNegRegister(BackendContext *backend_context,
+                                RegisterCode_t  dest_reg)
+{
+    Instruction instruction = {0};
+
+    RexPrefixCode_t rm_extension = kRexPrefixNoOptions;
+
+    if (IsNewRegister(dest_reg))
+    {
+        rm_extension = kModRmExtension;
+    }
+
+    SET_REX_PREFIX(kQwordUsing, kRexPrefixNoOptions, kRexPrefixNoOptions, rm_extension);
+
+    SET_MOD_RM(kRegister, (RegisterCode_t) kNegModRmRegisterCode, GetRegisterBase(dest_reg));
+
+    SET_INSTRUCTION(kNegRm64, 0, 0, kLogicNegRegister, 0, 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t EncodeCqo(BackendContext *backend_context)
+{
+    Instruction instruction = {0};
+
+    SET_REX_PREFIX(kQwordUsing, kRexPrefixNoOptions, kRexPrefixNoOptions, kRexPrefixNoOptions);
+
+    SET_INSTRUCTION(kCqo, 0, 0, kLogicCqo, 0, 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t EncodeRdtsc(BackendContext *backend_context)
+{
+    Instruction instruction = {0};
+
+    SET_INSTRUCTION(kRdtsc, 0, 0, kLogicRdtsc, 0, 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t EncodeNop(BackendContext *backend_context)
+{
+    Instruction instruction = {0};
+
+    SET_INSTRUCTION(kNop, 0, 0, kLogicNop, 0, 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// [rip + disp32] operand; the displacement is the last field of the
+// instruction and is left to a relocation
+BackendErrs_t EncodeRipRelative(BackendContext  *backend_context,
+                                LogicalOpcode_t  logical_opcode,
+                                Opcode_t         op_code,
+                                RegisterCode_t   reg)
+{
+    Instruction instruction = {0};
+
+    RexPrefixCode_t reg_extension = kRexPrefixNoOptions;
+
+    if (IsNewRegister(reg))
+    {
+        reg_extension = kRegisterExtension;
+    }
+
+    SET_REX_PREFIX(kQwordUsing, reg_extension, kRexPrefixNoOptions, kRexPrefixNoOptions);
+
+    // mode 00 with rbp as the base means rip-relative in 64-bit mode
+    SET_MOD_RM(kRegisterMemoryMode, GetRegisterBase(reg), kRBP);
+
+    SET_INSTRUCTION(op_code, 0, 0, logical_opcode, 0, sizeof(DisplacementType_t));
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t EncodeMovsdXmmFromMemory(BackendContext     *backend_context,
+                                       XmmRegisterCode_t   dest_reg,
+                                       RegisterCode_t      base_reg,
+                                       DisplacementType_t  displacement)
+{
+    Instruction instruction = {0};
+
+    if (GetRegisterBase(base_reg) == kRSP)
+    {
+        ColorPrintf(kRed, "%s() rsp based addressing needs sib\n", __func__);
+
+        return kBackendUnsupportedAddressing;
+    }
+
+    instruction.legacy_prefix = kScalarDoublePrefix;
+
+    if (IsNewRegister(base_reg))
+    {
+        SET_REX_PREFIX(kRexPrefixNoOptions, kRexPrefixNoOptions, kRexPrefixNoOptions, kModRmExtension);
+    }
+
+    SET_MOD_RM(kRegisterMemory32Displacement, (RegisterCode_t) dest_reg, GetRegisterBase(base_reg));
+
+    SET_INSTRUCTION(kMovsdXmmFromRm, displacement, 0, kLogicMovsdMemoryToXmm, 0, sizeof(DisplacementType_t));
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t EncodeMovsdMemoryFromXmm(BackendContext     *backend_context,
+                                       RegisterCode_t      base_reg,
+                                       DisplacementType_t  displacement,
+                                       XmmRegisterCode_t   src_reg)
+{
+    Instruction instruction = {0};
+
+    if (GetRegisterBase(base_reg) == kRSP)
+    {
+        ColorPrintf(kRed, "%s() rsp based addressing needs sib\n", __func__);
+
+        return kBackendUnsupportedAddressing;
+    }
+
+    instruction.legacy_prefix = kScalarDoublePrefix;
+
+    if (IsNewRegister(base_reg))
+    {
+        SET_REX_PREFIX(kRexPrefixNoOptions, kRexPrefixNoOptions, kRexPrefixNoOptions, kModRmExtension);
+    }
+
+    SET_MOD_RM(kRegisterMemory32Displacement, (RegisterCode_t) src_reg, GetRegisterBase(base_reg));
+
+    SET_INSTRUCTION(kMovsdRmFromXmm, displacement, 0, kLogicMovsdXmmToMemory, 0, sizeof(DisplacementType_t));
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t EncodeMovqRegisterToXmm(BackendContext    *backend_context,
+                                      RegisterCode_t     src_reg,
+                                      XmmRegisterCode_t  dest_reg)
+{
+    Instruction instruction = {0};
+
+    RexPrefixCode_t rm_extension = kRexPrefixNoOptions;
+
+    if (IsNewRegister(src_reg))
+    {
+        rm_extension = kModRmExtension;
+    }
+
+    instruction.legacy_prefix = kOperandSizePrefix;
+
+    SET_REX_PREFIX(kQwordUsing, kRexPrefixNoOptions, kRexPrefixNoOptions, rm_extension);
+
+    SET_MOD_RM(kRegister, (RegisterCode_t) dest_reg, GetRegisterBase(src_reg));
+
+    SET_INSTRUCTION(kMovqXmmFromRm64, 0, 0, kLogicMovqRegisterToXmm, 0, 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t EncodeMovqXmmToRegister(BackendContext    *backend_context,
+                                      XmmRegisterCode_t  src_reg,
+                                      RegisterCode_t     dest_reg)
+{
+    Instruction instruction = {0};
+
+    RexPrefixCode_t rm_extension = kRexPrefixNoOptions;
+
+    if (IsNewRegister(dest_reg))
+    {
+        rm_extension = kModRmExtension;
+    }
+
+    instruction.legacy_prefix = kOperandSizePrefix;
+
+    SET_REX_PREFIX(kQwordUsing, kRexPrefixNoOptions, kRexPrefixNoOptions, rm_extension);
+
+    SET_MOD_RM(kRegister, (RegisterCode_t) src_reg, GetRegisterBase(dest_reg));
+
+    SET_INSTRUCTION(kMovqRm64FromXmm, 0, 0, kLogicMovqXmmToRegister, 0, 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t EncodeScalarDoubleOperation(BackendContext    *backend_context,
+                                          LogicalOpcode_t    logical_opcode,
+                                          Opcode_t           op_code,
+                                          XmmRegisterCode_t  dest_reg,
+                                          XmmRegisterCode_t  src_reg)
+{
+    Instruction instruction = {0};
+
+    instruction.legacy_prefix = kScalarDoublePrefix;
+
+    SET_MOD_RM(kRegister, (RegisterCode_t) dest_reg, (RegisterCode_t) src_reg);
+
+    SET_INSTRUCTION(op_code, 0, 0, logical_opcode, 0, 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t EncodeUcomisd(BackendContext    *backend_context,
+                            XmmRegisterCode_t  lhs_reg,
+                            XmmRegisterCode_t  rhs_reg)
+{
+    Instruction instruction = {0};
+
+    instruction.legacy_prefix = kOperandSizePrefix;
+
+    SET_MOD_RM(kRegister, (RegisterCode_t) lhs_reg, (RegisterCode_t) rhs_reg);
+
+    SET_INSTRUCTION(kUcomisd, 0, 0, kLogicUcomisd, 0, 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t EncodeCvttsd2si(BackendContext    *backend_context,
+                              XmmRegisterCode_t  src_reg,
+                              RegisterCode_t     dest_reg)
+{
+    Instruction instruction = {0};
+
+    RexPrefixCode_t reg_extension = kRexPrefixNoOptions;
+
+    if (IsNewRegister(dest_reg))
+    {
+        reg_extension = kRegisterExtension;
+    }
+
+    instruction.legacy_prefix = kScalarDoublePrefix;
+
+    SET_REX_PREFIX(kQwordUsing, reg_extension, kRexPrefixNoOptions, kRexPrefixNoOptions);
+
+    SET_MOD_RM(kRegister, GetRegisterBase(dest_reg), (RegisterCode_t) src_reg);
+
+    SET_INSTRUCTION(kCvttsd2si, 0, 0, kLogicCvttsd2si, 0, 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t EncodeCvtsi2sd(BackendContext    *backend_context,
+                             RegisterCode_t     src_reg,
+                             XmmRegisterCode_t  dest_reg)
+{
+    Instruction instruction = {0};
+
+    RexPrefixCode_t rm_extension = kRexPrefixNoOptions;
+
+    if (IsNewRegister(src_reg))
+    {
+        rm_extension = kModRmExtension;
+    }
+
+    instruction.legacy_prefix = kScalarDoublePrefix;
+
+    SET_REX_PREFIX(kQwordUsing, kRexPrefixNoOptions, kRexPrefixNoOptions, rm_extension);
+
+    SET_MOD_RM(kRegister, (RegisterCode_t) dest_reg, GetRegisterBase(src_reg));
+
+    SET_INSTRUCTION(kCvtsi2sd, 0, 0, kLogicCvtsi2sd, 0, 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t EncodeRoundsd(BackendContext    *backend_context,
+                            XmmRegisterCode_t  dest_reg,
+                            XmmRegisterCode_t  src_reg,
+                            RoundingMode_t     rounding_mode)
+{
+    Instruction instruction = {0};
+
+    instruction.legacy_prefix = kOperandSizePrefix;
+
+    SET_MOD_RM(kRegister, (RegisterCode_t) dest_reg, (RegisterCode_t) src_reg);
+
+    SET_INSTRUCTION(kRoundsd, 0, rounding_mode, kLogicRoundsd, sizeof(uint8_t), 0);
+
+    ADD_INSTRUCTION(&instruction);
+
+    BackendDumpPrintInstruction(backend_context, &instruction);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
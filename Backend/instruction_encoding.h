@@ -31,6 +31,77 @@ BackendErrs_t EncodeImulRegister(BackendContext *backend_context,
 BackendErrs_t EncodeDivRegister(BackendContext *backend_context,
                                 RegisterCode_t  dest_reg);
 
+BackendErrs_t EncodeShiftRegisterByImmediate(BackendContext  *backend_context,
+                                             LogicalOpcode_t  logical_opcode,
+                                             RegisterCode_t   dest_reg,
+                                             uint8_t          shift);
+
+BackendErrs_t EncodeLeaScaledIndex(BackendContext *backend_context,
+                                   RegisterCode_t  dest_reg,
+                                   RegisterCode_t  base_reg,
+                                   RegisterCode_t  index_reg,
+                                   uint8_t         scale);
+
+BackendErrs_t EncodeImulRegisterByImmediate(BackendContext *backend_context,
+                                            RegisterCode_t  dest_reg,
+                                            RegisterCode_t  src_reg,
+                                            int32_t         immediate);
+
+BackendErrs_t EncodeNegRegister(BackendContext *backend_context,
+                                RegisterCode_t  dest_reg);
+
+BackendErrs_t EncodeCqo(BackendContext *backend_context);
+
+BackendErrs_t EncodeRdtsc(BackendContext *backend_context);
+
+BackendErrs_t EncodeNop(BackendContext *backend_context);
+
+BackendErrs_t EncodeRipRelative(BackendContext  *backend_context,
+                                LogicalOpcode_t  logical_opcode,
+                                Opcode_t         op_code,
+                                RegisterCode_t   reg);
+
+BackendErrs_t EncodeMovsdXmmFromMemory(BackendContext     *backend_context,
+                                       XmmRegisterCode_t   dest_reg,
+                                       RegisterCode_t      base_reg,
+                                       DisplacementType_t  displacement);
+
+BackendErrs_t EncodeMovsdMemoryFromXmm(BackendContext     *backend_context,
+                                       RegisterCode_t      base_reg,
+                                       DisplacementType_t  displacement,
+                                       XmmRegisterCode_t   src_reg);
+
+BackendErrs_t EncodeMovqRegisterToXmm(BackendContext    *backend_context,
+                                      RegisterCode_t     src_reg,
+                                      XmmRegisterCode_t  dest_reg);
+
+BackendErrs_t EncodeMovqXmmToRegister(BackendContext    *backend_context,
+                                      XmmRegisterCode_t  src_reg,
+                                      RegisterCode_t     dest_reg);
+
+BackendErrs_t EncodeScalarDoubleOperation(BackendContext    *backend_context,
+                                          LogicalOpcode_t    logical_opcode,
+                                          Opcode_t           op_code,
+                                          XmmRegisterCode_t  dest_reg,
+                                          XmmRegisterCode_t  src_reg);
+
+BackendErrs_t EncodeUcomisd(BackendContext    *backend_context,
+                            XmmRegisterCode_t  lhs_reg,
+                            XmmRegisterCode_t  rhs_reg);
+
+BackendErrs_t EncodeCvttsd2si(BackendContext    *backend_context,
+                              XmmRegisterCode_t  src_reg,
+                              RegisterCode_t     dest_reg);
+
+BackendErrs_t EncodeCvtsi2sd(BackendContext    *backend_context,
+                             RegisterCode_t     src_reg,
+                             XmmRegisterCode_t  dest_reg);
+
+BackendErrs_t EncodeRoundsd(BackendContext    *backend_context,
+                            XmmRegisterCode_t  dest_reg,
+                            XmmRegisterCode_t  src_reg,
+                            RoundingMode_t     rounding_mode);
+
 BackendErrs_t EncodeXorRegisterWithRegister(BackendContext *backend_context,
                                             RegisterCode_t  dest_reg,
                                             RegisterCode_t  src_reg);
@@ -81,9 +152,13 @@ BackendErrs_t EncodeCall(BackendContext  *backend_context,
                          LanguageContext *language_context,
                          int32_t          func_pos);
 
+BackendErrs_t EncodeFuncJump(BackendContext  *backend_context,
+                             LanguageContext *language_context,
+                             int32_t          func_pos);
+
 BackendErrs_t SetInstruction(Instruction        *instruction,
                              BackendContext     *backend_context,
-                             uint16_t            op_code,
+                             uint32_t            op_code,
                              DisplacementType_t  displacement,
                              ImmediateType_t     immediate_arg,
                              LogicalOpcode_t     logical_op_code,
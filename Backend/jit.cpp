@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "jit.h"
+#include "elf_ctor.h"
+#include "../debug/debug.h"
+#include "../debug/color_print.h"
+
+// Runtime calls are resolved to these functions of the backend itself.
+// They behave like their lib/GVN.c namesakes; the fast sin/cos variants
+// simply map to libm.
+
+static int64_t JitScan();
+static int64_t JitPrint(int64_t value);
+static int64_t JitSin  (int64_t value);
+static int64_t JitCos  (int64_t value);
+
+static double  JitScanDouble();
+static int64_t JitPrintDouble(double value);
+static double  JitSqrtDouble (double value);
+static double  JitSinDouble  (double value);
+static double  JitCosDouble  (double value);
+
+static void    JitAbort();
+
+struct JitRuntimeFunc
+{
+    const char *func_name;
+
+    void       *address;
+};
+
+static const JitRuntimeFunc kJitRuntimeFuncs[] =
+{
+    {"скажи_мне",                (void *) JitScan},
+    {"пишу_твоей_матери",        (void *) JitPrint},
+    {"углы_вымеряет",            (void *) JitSin},
+    {"это_все_преломления",      (void *) JitCos},
+    {"скажи_мне_f64",            (void *) JitScanDouble},
+    {"пишу_твоей_матери_f64",    (void *) JitPrintDouble},
+    {"трент_ультует_f64",        (void *) JitSqrtDouble},
+    {"углы_вымеряет_f64",        (void *) JitSinDouble},
+    {"это_все_преломления_f64",  (void *) JitCosDouble},
+    {"углы_вымеряет_fast",       (void *) JitSinDouble},
+    {"это_все_преломления_fast", (void *) JitCosDouble},
+    {"иди_нахуй",                (void *) JitAbort},
+};
+
+static const size_t kJitRuntimeFuncsCount = sizeof(kJitRuntimeFuncs) / sizeof(JitRuntimeFunc);
+
+// jmp [rip + 0] followed by the absolute target: libc is usually mapped
+// too far from the code for a rel32 call to reach it directly
+static const uint8_t kTrampolineCode[] = {0xff, 0x25, 0x00, 0x00, 0x00, 0x00};
+
+static const size_t  kTrampolineSize   = sizeof(kTrampolineCode) + sizeof(uint64_t);
+
+typedef int64_t (*JitMainFunc_t)();
+
+static BackendErrs_t LinkRuntimeCalls(BackendContext *backend_context,
+                                      uint8_t        *code,
+                                      size_t          trampolines_offset);
+
+static int32_t FindJitRuntimeFunc(const char *func_name);
+
+//==============================================================================
+
+BackendErrs_t RunJitCompiledProgram(BackendContext *backend_context,
+                                    int64_t        *exit_code)
+{
+    CHECK(backend_context);
+    CHECK(exit_code);
+
+    const Elf64_Sym *main_symbol = FindMainSymbol(backend_context);
+
+    if (main_symbol == nullptr)
+    {
+        ColorPrintf(kRed, "%s() program has no main function\n", __func__);
+
+        return kBackendMissingMain;
+    }
+
+    size_t page_size          = (size_t) sysconf(_SC_PAGESIZE);
+    size_t trampolines_offset = (backend_context->cur_address + kTrampolineSize - 1) / kTrampolineSize * kTrampolineSize;
+    size_t code_size          = trampolines_offset + kJitRuntimeFuncsCount * kTrampolineSize;
+    size_t mapping_size       = (code_size + page_size - 1) / page_size * page_size;
+
+    // the pages are writable while the code is put together and executable
+    // only after that, never both at once
+    uint8_t *code = (uint8_t *) mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (code == MAP_FAILED)
+    {
+        ColorPrintf(kRed, "%s() failed to map code pages\n", __func__);
+
+        return kBackendFailedAllocation;
+    }
+
+    BackendErrs_t error = EncodeTextSection(backend_context, code);
+
+    if (error == kBackendSuccess)
+    {
+        error = LinkRuntimeCalls(backend_context, code, trampolines_offset);
+    }
+
+    if (error == kBackendSuccess && mprotect(code, mapping_size, PROT_READ | PROT_EXEC) != 0)
+    {
+        ColorPrintf(kRed, "%s() failed to make code executable\n", __func__);
+
+        error = kBackendFailedAllocation;
+    }
+
+    if (error != kBackendSuccess)
+    {
+        munmap(code, mapping_size);
+
+        return error;
+    }
+
+    JitMainFunc_t main_func = nullptr;
+
+    uint8_t *main_address = code + main_symbol->st_value;
+
+    memcpy(&main_func, &main_address, sizeof(main_func));
+
+    *exit_code = main_func();
+
+    fflush(stdout);
+
+    munmap(code, mapping_size);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t LinkRuntimeCalls(BackendContext *backend_context,
+                                      uint8_t        *code,
+                                      size_t          trampolines_offset)
+{
+    CHECK(backend_context);
+    CHECK(code);
+
+    for (size_t i = 0; i < kJitRuntimeFuncsCount; i++)
+    {
+        uint8_t *trampoline = code + trampolines_offset + i * kTrampolineSize;
+
+        uint64_t address = (uint64_t) kJitRuntimeFuncs[i].address;
+
+        memcpy(trampoline, kTrampolineCode, sizeof(kTrampolineCode));
+        memcpy(trampoline + sizeof(kTrampolineCode), &address, sizeof(address));
+    }
+
+    RelocationTable *relocation_table = backend_context->relocation_table;
+
+    for (size_t i = 0; i < relocation_table->relocation_count; i++)
+    {
+        const Elf64_Rela *relocation = &relocation_table->relocation_array[i];
+
+        const Elf64_Sym  *symbol     = &backend_context->symbol_table->sym_array[ELF64_R_SYM(relocation->r_info)];
+
+        const char       *func_name  = GetStringByIndex(backend_context->strings, symbol->st_name);
+
+        int32_t func_pos = FindJitRuntimeFunc(func_name);
+
+        if (func_pos < 0)
+        {
+            ColorPrintf(kRed, "%s() unknown runtime function %s\n", __func__, func_name == nullptr ? "(null)" : func_name);
+
+            return kBackendUnsupportedRuntimeCall;
+        }
+
+        // S + A - P with the trampoline standing in for the function
+        int64_t value = (int64_t) (trampolines_offset + (size_t) func_pos * kTrampolineSize) +
+                        relocation->r_addend -
+                        (int64_t) relocation->r_offset;
+
+        int32_t relative_address = (int32_t) value;
+
+        memcpy(code + relocation->r_offset, &relative_address, sizeof(relative_address));
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static int32_t FindJitRuntimeFunc(const char *func_name)
+{
+    if (func_name == nullptr)
+    {
+        return -1;
+    }
+
+    for (size_t i = 0; i < kJitRuntimeFuncsCount; i++)
+    {
+        if (strcmp(kJitRuntimeFuncs[i].func_name, func_name) == 0)
+        {
+            return (int32_t) i;
+        }
+    }
+
+    return -1;
+}
+
+//==============================================================================
+
+static int64_t JitScan()
+{
+    long value = 0;
+
+    if (scanf("%ld", &value) != 1)
+    {
+        return 0;
+    }
+
+    return value;
+}
+
+//==============================================================================
+
+static int64_t JitPrint(int64_t value)
+{
+    return printf("%ld\n", (long) value);
+}
+
+//==============================================================================
+
+static int64_t JitSin(int64_t value)
+{
+    return (int64_t) sin((double) value);
+}
+
+//==============================================================================
+
+static int64_t JitCos(int64_t value)
+{
+    return (int64_t) cos((double) value);
+}
+
+//==============================================================================
+
+static double JitScanDouble()
+{
+    double value = 0;
+
+    if (scanf("%lf", &value) != 1)
+    {
+        return 0;
+    }
+
+    return value;
+}
+
+//==============================================================================
+
+static int64_t JitPrintDouble(double value)
+{
+    return printf("%.17g\n", value);
+}
+
+//==============================================================================
+
+static double JitSqrtDouble(double value)
+{
+    return sqrt(value);
+}
+
+//==============================================================================
+
+static double JitSinDouble(double value)
+{
+    return sin(value);
+}
+
+//==============================================================================
+
+static double JitCosDouble(double value)
+{
+    return cos(value);
+}
+
+//==============================================================================
+
+static void JitAbort()
+{
+    fflush(stdout);
+
+    abort();
+}
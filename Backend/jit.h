@@ -0,0 +1,9 @@
+#ifndef JIT_HEADER
+#define JIT_HEADER
+
+#include "backend.h"
+
+BackendErrs_t RunJitCompiledProgram(BackendContext *backend_context,
+                                    int64_t        *exit_code);
+
+#endif
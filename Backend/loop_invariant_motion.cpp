@@ -0,0 +1,490 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tree_optimizer.h"
+#include "../debug/debug.h"
+#include "../debug/color_print.h"
+
+static const size_t kMaxHoistedNameLen = 64;
+
+struct LoopContext
+{
+    LanguageContext *language_context;
+
+    TableOfNames    *func_table;
+    const TreeNode  *type_node;
+
+    bool            *is_written;
+    size_t           written_size;
+
+    TreeNode        *preheader_head;
+    TreeNode        *preheader_tail;
+
+    size_t           hoisted_count;
+};
+
+static TreeErrs_t HoistFuncLoopInvariants(LanguageContext *language_context,
+                                          TreeNode        *func_node,
+                                          size_t          *hoisted_count);
+
+static TreeErrs_t HoistStatementList(LoopContext  *loop_context,
+                                     TreeNode    **list);
+
+static TreeErrs_t HoistLoop(LoopContext *loop_context,
+                            TreeNode    *loop_node);
+
+static TreeErrs_t MarkWrittenVariables(const TreeNode *node,
+                                       bool           *is_written,
+                                       size_t          written_size);
+
+static bool IsLoopInvariant(const LoopContext *loop_context,
+                            const TreeNode    *node);
+
+static bool IsHoistableExpression(const LoopContext *loop_context,
+                                  const TreeNode    *node);
+
+static TreeErrs_t HoistInvariantExpressions(LoopContext  *loop_context,
+                                            TreeNode    **link);
+
+static TreeErrs_t HoistStatementExpressions(LoopContext *loop_context,
+                                            TreeNode    *statement);
+
+static size_t FindHoistedExpression(const LoopContext *loop_context,
+                                    const TreeNode    *node);
+
+static bool IsSameExpression(const TreeNode *lhs,
+                             const TreeNode *rhs);
+
+//==============================================================================
+
+TreeErrs_t HoistLoopInvariants(LanguageContext *language_context)
+{
+    CHECK(language_context);
+
+    size_t hoisted_count = 0;
+
+    for (TreeNode *cur_decl = language_context->syntax_tree.root;
+                   cur_decl != nullptr;
+                   cur_decl = cur_decl->right)
+    {
+        if (cur_decl->left != nullptr && cur_decl->left->type == kFuncDef)
+        {
+            HoistFuncLoopInvariants(language_context, cur_decl->left, &hoisted_count);
+        }
+    }
+
+    return hoisted_count > 0 ? kTreeOptimized : kTreeNotOptimized;
+}
+
+//==============================================================================
+
+static TreeErrs_t HoistFuncLoopInvariants(LanguageContext *language_context,
+                                          TreeNode        *func_node,
+                                          size_t          *hoisted_count)
+{
+    CHECK(language_context);
+    CHECK(func_node);
+    CHECK(hoisted_count);
+
+    if (func_node->right == nullptr)
+    {
+        return kTreeNotOptimized;
+    }
+
+    LoopContext loop_context = {};
+
+    loop_context.language_context = language_context;
+    loop_context.type_node        = func_node->left;
+    loop_context.hoisted_count    = *hoisted_count;
+    loop_context.func_table       = GetFuncNameTable(&language_context->tables,
+                                                     func_node->data.variable_pos);
+
+    if (loop_context.func_table == nullptr)
+    {
+        return kFailedToFind;
+    }
+
+    TreeErrs_t status = HoistStatementList(&loop_context, &func_node->right->right);
+
+    *hoisted_count = loop_context.hoisted_count;
+
+    return status;
+}
+
+//==============================================================================
+
+static TreeErrs_t HoistStatementList(LoopContext  *loop_context,
+                                     TreeNode    **list)
+{
+    CHECK(loop_context);
+    CHECK(list);
+
+    TreeErrs_t status = kTreeNotOptimized;
+
+    TreeNode **link = list;
+
+    while (*link != nullptr)
+    {
+        TreeNode *statement = (*link)->left;
+
+        if (statement == nullptr || statement->type != kOperator ||
+            (statement->data.key_word_code != kIf && statement->data.key_word_code != kWhile))
+        {
+            link = &(*link)->right;
+
+            continue;
+        }
+
+        if (HoistStatementList(loop_context, &statement->right) == kTreeOptimized)
+        {
+            status = kTreeOptimized;
+        }
+
+        if (statement->data.key_word_code == kIf)
+        {
+            link = &(*link)->right;
+
+            continue;
+        }
+
+        loop_context->preheader_head = nullptr;
+        loop_context->preheader_tail = nullptr;
+
+        HoistLoop(loop_context, statement);
+
+        if (loop_context->preheader_head != nullptr)
+        {
+            loop_context->preheader_tail->right = *link;
+            *link                               = loop_context->preheader_head;
+
+            link = &loop_context->preheader_tail->right;
+
+            status = kTreeOptimized;
+        }
+
+        link = &(*link)->right;
+    }
+
+    return status;
+}
+
+//==============================================================================
+
+static TreeErrs_t HoistLoop(LoopContext *loop_context,
+                            TreeNode    *loop_node)
+{
+    CHECK(loop_context);
+    CHECK(loop_node);
+
+    loop_context->written_size = loop_context->language_context->identifiers.identifier_count;
+    loop_context->is_written   = (bool *) calloc(loop_context->written_size, sizeof(bool));
+
+    if (loop_context->is_written == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kFailedAllocation;
+    }
+
+    MarkWrittenVariables(loop_node->right, loop_context->is_written, loop_context->written_size);
+
+    HoistInvariantExpressions(loop_context, &loop_node->left);
+
+    for (TreeNode *cur_node = loop_node->right; cur_node != nullptr; cur_node = cur_node->right)
+    {
+        HoistStatementExpressions(loop_context, cur_node->left);
+    }
+
+    free(loop_context->is_written);
+
+    loop_context->is_written   = nullptr;
+    loop_context->written_size = 0;
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+static TreeErrs_t HoistStatementExpressions(LoopContext *loop_context,
+                                            TreeNode    *statement)
+{
+    CHECK(loop_context);
+
+    if (statement == nullptr)
+    {
+        return kTreeSuccess;
+    }
+
+    if (statement->type == kVarDecl)
+    {
+        if (statement->right != nullptr && statement->right->type != kIdentifier)
+        {
+            HoistInvariantExpressions(loop_context, &statement->right->left);
+        }
+
+        return kTreeSuccess;
+    }
+
+    if (statement->type == kOperator &&
+        (statement->data.key_word_code == kIf || statement->data.key_word_code == kWhile))
+    {
+        HoistInvariantExpressions(loop_context, &statement->left);
+
+        for (TreeNode *cur_node = statement->right; cur_node != nullptr; cur_node = cur_node->right)
+        {
+            HoistStatementExpressions(loop_context, cur_node->left);
+        }
+
+        return kTreeSuccess;
+    }
+
+    if (statement->type == kOperator && statement->data.key_word_code == kAssign)
+    {
+        return HoistInvariantExpressions(loop_context, &statement->left);
+    }
+
+    HoistInvariantExpressions(loop_context, &statement->left);
+    HoistInvariantExpressions(loop_context, &statement->right);
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+static TreeErrs_t HoistInvariantExpressions(LoopContext  *loop_context,
+                                            TreeNode    **link)
+{
+    CHECK(loop_context);
+    CHECK(link);
+
+    TreeNode *node = *link;
+
+    if (node == nullptr)
+    {
+        return kTreeSuccess;
+    }
+
+    if (!IsHoistableExpression(loop_context, node))
+    {
+        if (node->type == kCall)
+        {
+            return HoistInvariantExpressions(loop_context, &node->left);
+        }
+
+        HoistInvariantExpressions(loop_context, &node->left);
+        HoistInvariantExpressions(loop_context, &node->right);
+
+        return kTreeSuccess;
+    }
+
+    size_t hoisted_pos = FindHoistedExpression(loop_context, node);
+
+    if (hoisted_pos == loop_context->language_context->identifiers.identifier_count)
+    {
+        char name[kMaxHoistedNameLen] = {0};
+
+        snprintf(name, kMaxHoistedNameLen, "licm.%lu", loop_context->hoisted_count++);
+
+        Identifiers *identifiers = &loop_context->language_context->identifiers;
+
+        hoisted_pos = AddIdentifier(identifiers, strdup(name));
+
+        identifiers->identifier_array[hoisted_pos].declaration_state = true;
+        identifiers->identifier_array[hoisted_pos].id_type           = kVar;
+
+        AddName(loop_context->func_table, hoisted_pos, kVar);
+
+        TreeNode *assign_node = NodeCtor(nullptr, node,
+                                         NodeCtor(nullptr, nullptr, nullptr, kIdentifier, (double) hoisted_pos),
+                                         kOperator, kAssign);
+
+        TreeNode *decl_node   = NodeCtor(nullptr, CopyNode(loop_context->type_node), assign_node,
+                                         kVarDecl, (double) hoisted_pos);
+
+        TreeNode *list_node   = NodeCtor(nullptr, decl_node, nullptr, kOperator, kEndOfLine);
+
+        if (loop_context->preheader_head == nullptr)
+        {
+            loop_context->preheader_head = list_node;
+        }
+        else
+        {
+            loop_context->preheader_tail->right = list_node;
+        }
+
+        loop_context->preheader_tail = list_node;
+    }
+    else
+    {
+        TreeDtor(node);
+    }
+
+    *link = NodeCtor(nullptr, nullptr, nullptr, kIdentifier, (double) hoisted_pos);
+
+    return kTreeOptimized;
+}
+
+//==============================================================================
+
+static size_t FindHoistedExpression(const LoopContext *loop_context,
+                                    const TreeNode    *node)
+{
+    CHECK(loop_context);
+
+    for (const TreeNode *cur_node = loop_context->preheader_head;
+                         cur_node != nullptr;
+                         cur_node = cur_node->right)
+    {
+        if (IsSameExpression(cur_node->left->right->left, node))
+        {
+            return cur_node->left->data.variable_pos;
+        }
+    }
+
+    return loop_context->language_context->identifiers.identifier_count;
+}
+
+//==============================================================================
+
+static bool IsSameExpression(const TreeNode *lhs,
+                             const TreeNode *rhs)
+{
+    if (lhs == nullptr || rhs == nullptr)
+    {
+        return lhs == rhs;
+    }
+
+    if (lhs->type != rhs->type)
+    {
+        return false;
+    }
+
+    switch (lhs->type)
+    {
+        case kConstNumber:
+        {
+            if (memcmp(&lhs->data.const_val, &rhs->data.const_val, sizeof(NumType_t)) != 0)
+            {
+                return false;
+            }
+
+            break;
+        }
+
+        case kOperator:
+        {
+            if (lhs->data.key_word_code != rhs->data.key_word_code)
+            {
+                return false;
+            }
+
+            break;
+        }
+
+        case kIdentifier:
+        case kVarDecl:
+        case kFuncDef:
+        case kParamsNode:
+        case kCall:
+        default:
+        {
+            if (lhs->data.variable_pos != rhs->data.variable_pos)
+            {
+                return false;
+            }
+
+            break;
+        }
+    }
+
+    return IsSameExpression(lhs->left,  rhs->left) &&
+           IsSameExpression(lhs->right, rhs->right);
+}
+
+//==============================================================================
+
+static bool IsHoistableExpression(const LoopContext *loop_context,
+                                  const TreeNode    *node)
+{
+    CHECK(loop_context);
+
+    if (node == nullptr || node->type != kOperator)
+    {
+        return false;
+    }
+
+    int64_t value = 0;
+
+    if (EvalConstantExpression(node, &value))
+    {
+        return false;
+    }
+
+    return IsPureExpression(node) && IsLoopInvariant(loop_context, node);
+}
+
+//==============================================================================
+
+static bool IsLoopInvariant(const LoopContext *loop_context,
+                            const TreeNode    *node)
+{
+    CHECK(loop_context);
+
+    if (node == nullptr)
+    {
+        return true;
+    }
+
+    if (node->type == kIdentifier)
+    {
+        return node->data.variable_pos < loop_context->written_size &&
+               !loop_context->is_written[node->data.variable_pos];
+    }
+
+    if (node->type == kOperator && node->data.key_word_code == kDiv)
+    {
+        int64_t divisor = 0;
+
+        if (!EvalConstantExpression(node->right, &divisor) || divisor == 0)
+        {
+            return false;
+        }
+    }
+
+    return IsLoopInvariant(loop_context, node->left) &&
+           IsLoopInvariant(loop_context, node->right);
+}
+
+//==============================================================================
+
+static TreeErrs_t MarkWrittenVariables(const TreeNode *node,
+                                       bool           *is_written,
+                                       size_t          written_size)
+{
+    CHECK(is_written);
+
+    if (node == nullptr)
+    {
+        return kTreeSuccess;
+    }
+
+    if (node->type == kVarDecl && node->data.variable_pos < written_size)
+    {
+        is_written[node->data.variable_pos] = true;
+    }
+
+    if (node->type == kOperator && node->data.key_word_code == kAssign &&
+        node->right != nullptr && node->right->type == kIdentifier &&
+        node->right->data.variable_pos < written_size)
+    {
+        is_written[node->right->data.variable_pos] = true;
+    }
+
+    MarkWrittenVariables(node->left,  is_written, written_size);
+    MarkWrittenVariables(node->right, is_written, written_size);
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
@@ -1,35 +1,289 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "backend.h"
 #include "../Common/tree_dump.h"
 #include "../Common/trees.h"
+#include "../debug/color_print.h"
+#include "../debug/time_passes.h"
 #include "elf_ctor.h"
+#include "tree_optimizer.h"
+#include "jit.h"
+#include "compile_cache.h"
+#include "incremental.h"
+#include "profile.h"
+
+static const char *kTimePassesFlag     = "--time-passes";
+static const char *kTimePassesJsonFlag = "--time-passes-json";
+
+static const char *kProfileUseFlag     = "--profile-use";
 
 int main(int argc, char *argv[])
 {
     InitTreeGraphDump();
     BeginListGraphDump();
 
+    CompileCacheOptions options        = {};
+    PassTimingOptions   timing_options = {};
+
+    bool        is_jit_mode   = false;
+    const char *cache_dir     = nullptr;
+    size_t      cache_size_mb = kDefaultCacheSizeMb;
+    const char *state_file    = nullptr;
+    size_t      jobs_count    = 1;
+
+    for (int i = 4; i < argc; i++)
+    {
+        if (strcmp(argv[i], kDoubleModeFlag) == 0)
+        {
+            options.is_double_mode = true;
+        }
+        else if (strcmp(argv[i], kFastTrigFlag) == 0)
+        {
+            options.is_fast_trig = true;
+        }
+        else if (strcmp(argv[i], kExecutableFlag) == 0)
+        {
+            options.is_executable_output = true;
+        }
+        else if (strcmp(argv[i], kKeepLabelsFlag) == 0)
+        {
+            options.is_keeping_labels = true;
+        }
+        else if (strcmp(argv[i], kProfileFlag) == 0)
+        {
+            options.is_profiling = true;
+        }
+        else if (strcmp(argv[i], kJitFlag) == 0)
+        {
+            is_jit_mode = true;
+        }
+        else if (strcmp(argv[i], kCacheFlag) == 0 && i + 1 < argc)
+        {
+            cache_dir = argv[++i];
+        }
+        else if (strcmp(argv[i], kCacheSizeFlag) == 0 && i + 1 < argc)
+        {
+            cache_size_mb = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], kIncrementalFlag) == 0 && i + 1 < argc)
+        {
+            state_file = argv[++i];
+        }
+        else if (strcmp(argv[i], kDebugInfoFlag) == 0 && i + 1 < argc)
+        {
+            options.debug_lines_file_name = argv[++i];
+        }
+        else if (strcmp(argv[i], kProfileUseFlag) == 0 && i + 1 < argc)
+        {
+            options.profile_file_name = argv[++i];
+        }
+        else if (strcmp(argv[i], kJobsFlag) == 0 && i + 1 < argc)
+        {
+            jobs_count = strtoul(argv[++i], nullptr, 10);
+
+            if (jobs_count == 0)
+            {
+                jobs_count = (size_t) sysconf(_SC_NPROCESSORS_ONLN);
+            }
+        }
+        else if (strcmp(argv[i], kTimePassesFlag) == 0)
+        {
+            timing_options.is_table = true;
+
+            EnablePassTiming();
+        }
+        else if (strcmp(argv[i], kTimePassesJsonFlag) == 0 && i + 1 < argc)
+        {
+            timing_options.json_file_name = argv[++i];
+
+            EnablePassTiming();
+        }
+    }
+
+    BeginPass("back");
+
+    // only the double runtime has polynomial sin/cos, integer mode keeps
+    // calling the libm based ones
+    if (options.is_fast_trig && !options.is_double_mode)
+    {
+        ColorPrintf(kRed, "%s works only with %s, building with the default sin/cos\n",
+                    kFastTrigFlag, kDoubleModeFlag);
+
+        options.is_fast_trig = false;
+    }
+
+    // the counters live in .data and the report is printed by lib/GVN.o,
+    // neither exists without the linker
+    if (options.is_profiling && (is_jit_mode || options.is_executable_output))
+    {
+        ColorPrintf(kRed, "%s needs an object file linked with lib/GVN.o, building without profiling\n",
+                    kProfileFlag);
+
+        options.is_profiling = false;
+    }
+
+    // a jit run leaves no artifact behind, so there is nothing to cache
+    CompileCache cache    = {};
+    bool         is_cached = cache_dir != nullptr && !is_jit_mode &&
+                             CompileCacheInit(&cache, cache_dir, cache_size_mb * 1024 * 1024) == kBackendSuccess &&
+                             ComputeCompileCacheKey(&cache, argv[1], argv[2], &options) == kBackendSuccess;
+
+    if (is_cached)
+    {
+        bool is_hit = false;
+
+        LookupCompileCache(&cache, argv[3], &is_hit);
+
+        ColorPrintf(kGreen, "compile cache %s: %zu hits, %zu misses\n",
+                    is_hit ? "hit" : "miss", cache.hits, cache.misses);
+
+        if (is_hit)
+        {
+            ReportPassTimes(&timing_options, "back");
+
+            EndListGraphDump();
+            EndTreeGraphDump();
+
+            return 0;
+        }
+    }
+
     LanguageContext      language_context = {0};
     LanguageContextInit(&language_context);
 
+    BeginPass("read tree");
+
     ReadLanguageContextOutOfFile(&language_context, argv[1], argv[2]);
 
+    EndPass();
+
+    char *source_file_name = nullptr;
+
+    if (options.debug_lines_file_name != nullptr &&
+        ReadTreeLinesOutOfFile(&language_context, options.debug_lines_file_name, &source_file_name) != kTreeSuccess)
+    {
+        ColorPrintf(kRed, "failed to read line numbers from %s, building without debug info\n",
+                    options.debug_lines_file_name);
+    }
+
+    ProfileData profile = {};
+
+    if (options.profile_file_name != nullptr &&
+        ReadProfileData(&profile, options.profile_file_name) != kTreeSuccess)
+    {
+        ColorPrintf(kRed, "failed to read profile from %s, building without it\n",
+                    options.profile_file_name);
+    }
+
+    const ProfileData *used_profile = profile.function_count > 0 ? &profile : nullptr;
+
+    BeginPass("optimize tree");
+
+    OptimizeSyntaxTree(&language_context, used_profile);
+
+    EndPass();
+
+    // sites are numbered on the final tree, the code generator walks it in
+    // the same order
+    BranchSites branch_sites = {};
+
+    bool is_using_branch_sites = (options.is_profiling || used_profile != nullptr) &&
+                                 CollectBranchSites(&branch_sites, &language_context, used_profile) == kBackendSuccess;
+
     BackendContext      backend_context = {0};
     BackendContextInit(&backend_context);
 
+    backend_context.is_double_mode    = options.is_double_mode;
+    backend_context.is_fast_trig      = options.is_fast_trig;
+    backend_context.is_keeping_labels = options.is_keeping_labels;
+    backend_context.is_debug_info     = source_file_name != nullptr;
+    backend_context.is_profiling      = options.is_profiling;
+    backend_context.profile           = used_profile;
+    backend_context.branch_sites      = is_using_branch_sites ? &branch_sites : nullptr;
+    backend_context.source_file_name  = source_file_name;
+    backend_context.jobs_count        = jobs_count;
+
+    IncrementalCache incremental_cache = {};
+
+    if (state_file != nullptr &&
+        IncrementalCacheInit(&incremental_cache, state_file, &backend_context, &language_context) == kBackendSuccess)
+    {
+        backend_context.incremental_cache = &incremental_cache;
+    }
+
+    BeginPass("codegen");
+
     GetAsmInstructionsOutLanguageContext(&backend_context,
                                          &language_context);
 
-    CreateElfRelocatableFile(&backend_context,
-                             &language_context,
-                              argv[3]);
+    EndPass();
+
+    int64_t       exit_code = 0;
+    BackendErrs_t error     = kBackendSuccess;
+
+    if (is_jit_mode)
+    {
+        BeginPass("jit run");
+
+        error = RunJitCompiledProgram(&backend_context, &exit_code);
+    }
+    else if (options.is_executable_output)
+    {
+        BeginPass("write executable");
+
+        error = CreateElfExecutableFile(&backend_context, argv[3]);
+    }
+    else
+    {
+        BeginPass("write object");
+
+        error = CreateElfRelocatableFile(&backend_context,
+                                         &language_context,
+                                          argv[3]);
+    }
+
+    EndPass();
+
+    if (is_cached && error == kBackendSuccess)
+    {
+        StoreCompileCache(&cache, argv[3]);
+    }
+
+    if (backend_context.incremental_cache != nullptr)
+    {
+        if (error == kBackendSuccess)
+        {
+            SaveIncrementalState(&incremental_cache, &backend_context, &language_context);
+        }
+
+        ColorPrintf(kGreen, "incremental build: %zu functions reused, %zu recompiled\n",
+                    incremental_cache.reused_count, incremental_cache.compiled_count);
+
+        IncrementalCacheDestroy(&incremental_cache);
+    }
 
     LanguageContextDtor(&language_context);
     BackendContextDestroy(&backend_context);
 
+    free(source_file_name);
+
+    DestroyBranchSites(&branch_sites);
+
+    DestroyProfileData(&profile);
+
+    ReportPassTimes(&timing_options, "back");
+
     EndListGraphDump();
     EndTreeGraphDump();
 
-    return 0;
+    // the program's own status is only meaningful after a successful jit run
+    if (error != kBackendSuccess)
+    {
+        return -1;
+    }
+
+    return (int) exit_code;
 }
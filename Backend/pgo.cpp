@@ -0,0 +1,401 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pgo.h"
+#include "../debug/debug.h"
+#include "../debug/color_print.h"
+
+static const size_t kBaseProfileCapacity = 32;
+
+static const char   *kBranchLinePrefix    = "branch";
+
+// what FindBranchProfile() looks up, the name stays owned by the caller
+struct BranchSite
+{
+    const char *function;
+
+    uint32_t    line;
+    uint32_t    ordinal;
+};
+
+static TreeErrs_t AddFunctionProfile(ProfileData *profile,
+                                     size_t      *capacity,
+                                     const char  *name,
+                                     uint64_t     calls,
+                                     uint64_t     cycles);
+
+static TreeErrs_t AddBranchProfile(ProfileData         *profile,
+                                   size_t              *capacity,
+                                   const BranchProfile *branch);
+
+static TreeErrs_t ReadBranchLine(ProfileData *profile,
+                                 size_t      *capacity,
+                                 char        *line);
+
+static int CompareNameWithProfile(const void *name, const void *function);
+
+static int CompareFunctionProfiles(const void *lhs, const void *rhs);
+
+static int CompareSiteWithProfile(const void *site, const void *branch);
+
+static int CompareBranchProfiles(const void *lhs, const void *rhs);
+
+static int CompareBranchSites(const char          *function,
+                              uint32_t             line,
+                              uint32_t             ordinal,
+                              const BranchProfile *branch);
+
+//==============================================================================
+
+// Lines are "calls cycles cycles_per_call name" for functions and
+// "branch executions taken line ordinal name" for branches, '#' starts
+// a comment
+TreeErrs_t ReadProfileData(ProfileData *profile,
+                           const char  *file_name)
+{
+    CHECK(profile);
+    CHECK(file_name);
+
+    FILE *profile_file = fopen(file_name, "r");
+
+    if (profile_file == nullptr)
+    {
+        return kFailedToOpenFile;
+    }
+
+    char   *line            = nullptr;
+    size_t  line_capacity   = 0;
+    size_t  capacity        = 0;
+    size_t  branch_capacity = 0;
+
+    TreeErrs_t error = kTreeSuccess;
+
+    while (error == kTreeSuccess && getline(&line, &line_capacity, profile_file) > 0)
+    {
+        unsigned long long calls           = 0;
+        unsigned long long cycles          = 0;
+        unsigned long long cycles_per_call = 0;
+        int                name_pos        = 0;
+
+        if (strncmp(line, kBranchLinePrefix, strlen(kBranchLinePrefix)) == 0)
+        {
+            error = ReadBranchLine(profile, &branch_capacity, line + strlen(kBranchLinePrefix));
+
+            continue;
+        }
+
+        if (line[0] == '#' ||
+            sscanf(line, "%llu %llu %llu %n", &calls, &cycles, &cycles_per_call, &name_pos) != 3)
+        {
+            continue;
+        }
+
+        char *name = line + name_pos;
+
+        name[strcspn(name, "\r\n")] = '\0';
+
+        if (*name != '\0')
+        {
+            error = AddFunctionProfile(profile, &capacity, name, calls, cycles);
+        }
+    }
+
+    free(line);
+
+    fclose(profile_file);
+
+    if (error != kTreeSuccess)
+    {
+        DestroyProfileData(profile);
+
+        return error;
+    }
+
+    qsort(profile->functions, profile->function_count, sizeof(FunctionProfile), CompareFunctionProfiles);
+    qsort(profile->branches,  profile->branch_count,   sizeof(BranchProfile),   CompareBranchProfiles);
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+TreeErrs_t DestroyProfileData(ProfileData *profile)
+{
+    CHECK(profile);
+
+    for (size_t i = 0; i < profile->function_count; i++)
+    {
+        free(profile->functions[i].name);
+    }
+
+    for (size_t i = 0; i < profile->branch_count; i++)
+    {
+        free(profile->branches[i].function);
+    }
+
+    free(profile->functions);
+    free(profile->branches);
+
+    memset(profile, 0, sizeof(ProfileData));
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+// Functions missing from the profile are left to the usual heuristics:
+// they may have been inlined in the profiled build or be new.
+FunctionTemperature GetFunctionTemperature(const ProfileData *profile,
+                                           const char        *func_name)
+{
+    if (profile == nullptr || func_name == nullptr)
+    {
+        return kFunctionUnprofiled;
+    }
+
+    const FunctionProfile *function = FindFunctionProfile(profile, func_name);
+
+    if (function == nullptr)
+    {
+        return kFunctionUnprofiled;
+    }
+
+    if (function->calls == 0)
+    {
+        return kFunctionCold;
+    }
+
+    if (function->cycles * kHotFunctionFraction >= profile->max_cycles ||
+        function->calls  * kHotFunctionFraction >= profile->total_calls)
+    {
+        return kFunctionHot;
+    }
+
+    return kFunctionWarm;
+}
+
+//==============================================================================
+
+static TreeErrs_t AddFunctionProfile(ProfileData *profile,
+                                     size_t      *capacity,
+                                     const char  *name,
+                                     uint64_t     calls,
+                                     uint64_t     cycles)
+{
+    CHECK(profile);
+    CHECK(capacity);
+    CHECK(name);
+
+    if (profile->function_count == *capacity)
+    {
+        size_t new_capacity = *capacity == 0 ? kBaseProfileCapacity : *capacity * 2;
+
+        FunctionProfile *new_functions = (FunctionProfile *) realloc(profile->functions,
+                                                                     new_capacity * sizeof(FunctionProfile));
+
+        if (new_functions == nullptr)
+        {
+            ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+            return kFailedRealloc;
+        }
+
+        profile->functions = new_functions;
+
+        *capacity = new_capacity;
+    }
+
+    char *name_copy = strdup(name);
+
+    if (name_copy == nullptr)
+    {
+        return kFailedAllocation;
+    }
+
+    profile->functions[profile->function_count++] = {name_copy, calls, cycles};
+
+    profile->total_calls += calls;
+
+    if (cycles > profile->max_cycles)
+    {
+        profile->max_cycles = cycles;
+    }
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+static TreeErrs_t ReadBranchLine(ProfileData *profile,
+                                 size_t      *capacity,
+                                 char        *line)
+{
+    CHECK(profile);
+    CHECK(capacity);
+    CHECK(line);
+
+    unsigned long long executions = 0;
+    unsigned long long taken      = 0;
+    unsigned int       line_pos   = 0;
+    unsigned int       ordinal    = 0;
+    int                name_pos   = 0;
+
+    if (sscanf(line, "%llu %llu %u %u %n", &executions, &taken, &line_pos, &ordinal, &name_pos) != 4)
+    {
+        return kTreeSuccess;
+    }
+
+    char *name = line + name_pos;
+
+    name[strcspn(name, "\r\n")] = '\0';
+
+    if (*name == '\0')
+    {
+        return kTreeSuccess;
+    }
+
+    BranchProfile branch = {name, line_pos, ordinal, executions, taken};
+
+    return AddBranchProfile(profile, capacity, &branch);
+}
+
+//==============================================================================
+
+static TreeErrs_t AddBranchProfile(ProfileData         *profile,
+                                   size_t              *capacity,
+                                   const BranchProfile *branch)
+{
+    CHECK(profile);
+    CHECK(capacity);
+    CHECK(branch);
+
+    if (profile->branch_count == *capacity)
+    {
+        size_t new_capacity = *capacity == 0 ? kBaseProfileCapacity : *capacity * 2;
+
+        BranchProfile *new_branches = (BranchProfile *) realloc(profile->branches,
+                                                                new_capacity * sizeof(BranchProfile));
+
+        if (new_branches == nullptr)
+        {
+            ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+            return kFailedRealloc;
+        }
+
+        profile->branches = new_branches;
+
+        *capacity = new_capacity;
+    }
+
+    char *name_copy = strdup(branch->function);
+
+    if (name_copy == nullptr)
+    {
+        return kFailedAllocation;
+    }
+
+    profile->branches[profile->branch_count] = *branch;
+
+    profile->branches[profile->branch_count++].function = name_copy;
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+const FunctionProfile *FindFunctionProfile(const ProfileData *profile,
+                                          const char        *func_name)
+{
+    if (profile == nullptr || func_name == nullptr)
+    {
+        return nullptr;
+    }
+
+    return (const FunctionProfile *) bsearch(func_name, profile->functions, profile->function_count,
+                                             sizeof(FunctionProfile), CompareNameWithProfile);
+}
+
+//==============================================================================
+
+const BranchProfile *FindBranchProfile(const ProfileData *profile,
+                                       const char        *func_name,
+                                       uint32_t           line,
+                                       uint32_t           ordinal)
+{
+    if (profile == nullptr || func_name == nullptr)
+    {
+        return nullptr;
+    }
+
+    BranchSite site = {func_name, line, ordinal};
+
+    return (const BranchProfile *) bsearch(&site, profile->branches, profile->branch_count,
+                                           sizeof(BranchProfile), CompareSiteWithProfile);
+}
+
+//==============================================================================
+
+static int CompareNameWithProfile(const void *name, const void *function)
+{
+    return strcmp((const char *) name,
+                  ((const FunctionProfile *) function)->name);
+}
+
+//==============================================================================
+
+static int CompareFunctionProfiles(const void *lhs, const void *rhs)
+{
+    return strcmp(((const FunctionProfile *) lhs)->name,
+                  ((const FunctionProfile *) rhs)->name);
+}
+
+//==============================================================================
+
+static int CompareSiteWithProfile(const void *site, const void *branch)
+{
+    const BranchSite *branch_site = (const BranchSite *) site;
+
+    return CompareBranchSites(branch_site->function, branch_site->line, branch_site->ordinal,
+                              (const BranchProfile *) branch);
+}
+
+//==============================================================================
+
+static int CompareBranchProfiles(const void *lhs, const void *rhs)
+{
+    const BranchProfile *lhs_branch = (const BranchProfile *) lhs;
+
+    return CompareBranchSites(lhs_branch->function, lhs_branch->line, lhs_branch->ordinal,
+                              (const BranchProfile *) rhs);
+}
+
+//==============================================================================
+
+static int CompareBranchSites(const char          *function,
+                              uint32_t             line,
+                              uint32_t             ordinal,
+                              const BranchProfile *branch)
+{
+    int name_order = strcmp(function, branch->function);
+
+    if (name_order != 0)
+    {
+        return name_order;
+    }
+
+    if (line != branch->line)
+    {
+        return line < branch->line ? -1 : 1;
+    }
+
+    if (ordinal != branch->ordinal)
+    {
+        return ordinal < branch->ordinal ? -1 : 1;
+    }
+
+    return 0;
+}
+
+//==============================================================================
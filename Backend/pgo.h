@@ -0,0 +1,86 @@
+#ifndef PGO_HEADER
+#define PGO_HEADER
+
+#include <stdint.h>
+
+#include "../Common/trees.h"
+
+// a function is hot when it takes this share of the run or of the calls
+static const uint64_t  kHotFunctionFraction   = 16;
+
+// hot code starts on a fetch block boundary
+static const size_t    kHotCodeAlignment      = 16;
+
+// a ??? body entered at most this share of the times is moved out of line
+static const uint64_t  kColdBranchFraction    = 8;
+
+// saving and restoring a register costs two moves per call, a variable
+// has to be used more often than that to get one
+static const uint64_t  kPromotionCostPerCall  = 2;
+
+// One line of the report lib/GVN.o writes for --profile builds
+struct FunctionProfile
+{
+    char     *name;
+
+    uint64_t  calls;
+
+    uint64_t  cycles;
+};
+
+// One ??? or пока: how many times it was reached and how many times its
+// body ran. Sites are told apart by the source line and by the number of
+// sites of the same function on that line before them.
+struct BranchProfile
+{
+    char     *function;
+
+    uint32_t  line;
+    uint32_t  ordinal;
+
+    uint64_t  executions;
+
+    uint64_t  taken;
+};
+
+// Both arrays are sorted by name, branches then by line and ordinal
+struct ProfileData
+{
+    FunctionProfile *functions;
+
+    size_t           function_count;
+
+    BranchProfile   *branches;
+
+    size_t           branch_count;
+
+    uint64_t         total_calls;
+
+    uint64_t         max_cycles;
+};
+
+enum FunctionTemperature
+{
+    kFunctionUnprofiled,
+    kFunctionCold,
+    kFunctionWarm,
+    kFunctionHot,
+};
+
+TreeErrs_t ReadProfileData(ProfileData *profile,
+                           const char  *file_name);
+
+TreeErrs_t DestroyProfileData(ProfileData *profile);
+
+const FunctionProfile *FindFunctionProfile(const ProfileData *profile,
+                                          const char        *func_name);
+
+const BranchProfile *FindBranchProfile(const ProfileData *profile,
+                                       const char        *func_name,
+                                       uint32_t           line,
+                                       uint32_t           ordinal);
+
+FunctionTemperature GetFunctionTemperature(const ProfileData *profile,
+                                           const char        *func_name);
+
+#endif
@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+#include "elf_ctor.h"
+#include "../debug/debug.h"
+#include "../debug/color_print.h"
+
+static bool IsProfileSymbol(const BackendContext *backend_context,
+                            const Elf64_Sym      *symbol);
+
+static BackendErrs_t CollectStatementSites(BranchSites       *branch_sites,
+                                           const TreeNode    *list,
+                                           uint32_t           function_index,
+                                           size_t             first_site,
+                                           const char        *func_name,
+                                           const ProfileData *profile);
+
+static BackendErrs_t AddBranchSite(BranchSites      *branch_sites,
+                                   const BranchSite *site);
+
+static BackendErrs_t WriteBranchEntries(const BackendContext *backend_context,
+                                        DebugBuffer          *section);
+
+//==============================================================================
+
+// The counters of a function are reached through a symbol of its own rather
+// than through the section symbol, so relocations keep working when the code
+// comes from the incremental cache or from another codegen thread.
+BackendErrs_t GetProfileSymbolName(LanguageContext *language_context,
+                                   int32_t          func_pos,
+                                   const char      *suffix,
+                                   char            *name,
+                                   size_t           name_size)
+{
+    CHECK(language_context);
+    CHECK(suffix);
+    CHECK(name);
+
+    int written = snprintf(name, name_size, "%s%s",
+                           GetFunctionName(language_context, func_pos), suffix);
+
+    if (written < 0 || (size_t) written >= name_size)
+    {
+        ColorPrintf(kRed, "%s() function name is too long\n", __func__);
+
+        return kBackendFailedAllocation;
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// .data goes after every other section, so it does not move them
+size_t GetProfileSectionIndex(const BackendContext *backend_context)
+{
+    CHECK(backend_context);
+
+    return backend_context->is_debug_info ? kSectionProfileDebugIndex : kSectionProfileIndex;
+}
+
+//==============================================================================
+
+// Zeroed counters for every profile symbol and every branch site followed
+// by the function names. The symbols were added in declaration order with
+// increasing values, and sorting the symbol table keeps the order of local
+// symbols.
+BackendErrs_t BuildProfileSection(BackendContext *backend_context,
+                                  DebugBuffer    *section)
+{
+    CHECK(backend_context);
+    CHECK(section);
+
+    SymbolTable *symbol_table = backend_context->symbol_table;
+
+    uint64_t function_count = 0;
+
+    for (size_t i = 0; i < symbol_table->sym_count; i++)
+    {
+        if (IsProfileSymbol(backend_context, &symbol_table->sym_array[i]))
+        {
+            function_count++;
+        }
+    }
+
+    BackendErrs_t error = WriteDebugData(section, &function_count, sizeof(function_count));
+
+    const uint8_t zero_entry[kProfileEntrySize] = {};
+
+    for (uint64_t i = 0; i < function_count && error == kBackendSuccess; i++)
+    {
+        error = WriteDebugData(section, zero_entry, sizeof(zero_entry));
+    }
+
+    if (error == kBackendSuccess)
+    {
+        error = WriteBranchEntries(backend_context, section);
+    }
+
+    size_t suffix_length = strlen(kProfileSymbolSuffix);
+
+    for (size_t i = 0; i < symbol_table->sym_count && error == kBackendSuccess; i++)
+    {
+        if (!IsProfileSymbol(backend_context, &symbol_table->sym_array[i]))
+        {
+            continue;
+        }
+
+        const char *name = GetStringByIndex(backend_context->strings, symbol_table->sym_array[i].st_name);
+
+        error = WriteDebugData(section, name, strlen(name) - suffix_length);
+
+        if (error == kBackendSuccess)
+        {
+            error = WriteDebugByte(section, 0);
+        }
+    }
+
+    return error;
+}
+
+//==============================================================================
+
+static BackendErrs_t WriteBranchEntries(const BackendContext *backend_context,
+                                        DebugBuffer          *section)
+{
+    CHECK(backend_context);
+    CHECK(section);
+
+    const BranchSites *branch_sites = backend_context->branch_sites;
+
+    uint64_t branch_count = branch_sites != nullptr ? branch_sites->site_count : 0;
+
+    BackendErrs_t error = WriteDebugData(section, &branch_count, sizeof(branch_count));
+
+    for (uint64_t i = 0; i < branch_count && error == kBackendSuccess; i++)
+    {
+        const BranchSite *site = &branch_sites->sites[i];
+
+        uint64_t counters[2]  = {};
+        uint32_t position[4]  = {site->function_index, site->line, site->ordinal, 0};
+
+        error = WriteDebugData(section, counters, sizeof(counters));
+
+        if (error == kBackendSuccess)
+        {
+            error = WriteDebugData(section, position, sizeof(position));
+        }
+    }
+
+    return error;
+}
+
+//==============================================================================
+
+// the branch counters of a function have a symbol in the section too
+static bool IsProfileSymbol(const BackendContext *backend_context,
+                            const Elf64_Sym      *symbol)
+{
+    if (symbol->st_shndx != GetProfileSectionIndex(backend_context) ||
+        ELF64_ST_TYPE(symbol->st_info) != STT_OBJECT)
+    {
+        return false;
+    }
+
+    const char *name = GetStringByIndex(backend_context->strings, symbol->st_name);
+
+    size_t name_length   = strlen(name);
+    size_t suffix_length = strlen(kProfileSymbolSuffix);
+
+    return name_length >= suffix_length &&
+           strcmp(name + name_length - suffix_length, kProfileSymbolSuffix) == 0;
+}
+
+//==============================================================================
+
+// Sites are numbered in the order the code generator reaches them, and
+// the ordinal keeps sites on one line apart. Lines stay the same when the
+// inliner changes the functions around, so a profile from another build
+// still finds its sites; without --debug-info every line is 0 and the
+// ordinal alone is the key.
+BackendErrs_t CollectBranchSites(BranchSites       *branch_sites,
+                                 LanguageContext   *language_context,
+                                 const ProfileData *profile)
+{
+    CHECK(branch_sites);
+    CHECK(language_context);
+
+    branch_sites->identifier_count = language_context->identifiers.identifier_count;
+    branch_sites->first_sites      = (size_t *) calloc(branch_sites->identifier_count + 1, sizeof(size_t));
+
+    if (branch_sites->first_sites == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kBackendFailedAllocation;
+    }
+
+    uint32_t function_index = 0;
+
+    for (TreeNode *cur_node = language_context->syntax_tree.root; cur_node != nullptr; cur_node = cur_node->right)
+    {
+        TreeNode *decl_node = cur_node->left;
+
+        if (decl_node->type != kFuncDef)
+        {
+            continue;
+        }
+
+        size_t func_pos = decl_node->data.variable_pos;
+
+        if (func_pos < branch_sites->identifier_count)
+        {
+            branch_sites->first_sites[func_pos] = branch_sites->site_count;
+        }
+
+        BackendErrs_t error = CollectStatementSites(branch_sites,
+                                                    decl_node->right->right,
+                                                    function_index++,
+                                                    branch_sites->site_count,
+                                                    GetFunctionName(language_context, (int32_t) func_pos),
+                                                    profile);
+
+        if (error != kBackendSuccess)
+        {
+            return error;
+        }
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t DestroyBranchSites(BranchSites *branch_sites)
+{
+    CHECK(branch_sites);
+
+    free(branch_sites->sites);
+    free(branch_sites->first_sites);
+
+    memset(branch_sites, 0, sizeof(BranchSites));
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+size_t CountBranchSites(const TreeNode *list)
+{
+    size_t site_count = 0;
+
+    for ( ; list != nullptr; list = list->right)
+    {
+        const TreeNode *statement = list->left;
+
+        if (statement != nullptr && statement->type == kOperator &&
+            (statement->data.key_word_code == kIf || statement->data.key_word_code == kWhile))
+        {
+            site_count += 1 + CountBranchSites(statement->right);
+        }
+    }
+
+    return site_count;
+}
+
+//==============================================================================
+
+static BackendErrs_t CollectStatementSites(BranchSites       *branch_sites,
+                                           const TreeNode    *list,
+                                           uint32_t           function_index,
+                                           size_t             first_site,
+                                           const char        *func_name,
+                                           const ProfileData *profile)
+{
+    CHECK(branch_sites);
+
+    for ( ; list != nullptr; list = list->right)
+    {
+        const TreeNode *statement = list->left;
+
+        if (statement == nullptr || statement->type != kOperator ||
+            (statement->data.key_word_code != kIf && statement->data.key_word_code != kWhile))
+        {
+            continue;
+        }
+
+        BranchSite site = {function_index, (uint32_t) statement->line_number, 0, false, 0, 0};
+
+        for (size_t i = first_site; i < branch_sites->site_count; i++)
+        {
+            if (branch_sites->sites[i].line == site.line)
+            {
+                site.ordinal++;
+            }
+        }
+
+        const BranchProfile *branch = FindBranchProfile(profile, func_name, site.line, site.ordinal);
+
+        if (branch != nullptr)
+        {
+            site.is_profiled = true;
+            site.executions  = branch->executions;
+            site.taken       = branch->taken;
+        }
+
+        BackendErrs_t error = AddBranchSite(branch_sites, &site);
+
+        if (error == kBackendSuccess)
+        {
+            error = CollectStatementSites(branch_sites, statement->right, function_index,
+                                          first_site, func_name, profile);
+        }
+
+        if (error != kBackendSuccess)
+        {
+            return error;
+        }
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AddBranchSite(BranchSites      *branch_sites,
+                                   const BranchSite *site)
+{
+    CHECK(branch_sites);
+    CHECK(site);
+
+    if (branch_sites->site_count == branch_sites->capacity)
+    {
+        size_t new_capacity = branch_sites->capacity == 0 ? kBaseBranchSitesCapacity :
+                                                            branch_sites->capacity * 2;
+
+        BranchSite *new_sites = (BranchSite *) realloc(branch_sites->sites, new_capacity * sizeof(BranchSite));
+
+        if (new_sites == nullptr)
+        {
+            ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+            return kBackendFailedAllocation;
+        }
+
+        branch_sites->sites    = new_sites;
+        branch_sites->capacity = new_capacity;
+    }
+
+    branch_sites->sites[branch_sites->site_count++] = *site;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
@@ -0,0 +1,54 @@
+#ifndef PROFILE_HEADER
+#define PROFILE_HEADER
+
+#include "backend.h"
+#include "debug_info.h"
+
+static const char   *kProfileStartFuncName  = "dota_profile_start";
+static const char   *kProfileSymbolSuffix   = ".profile";
+static const char   *kBranchSymbolSuffix    = ".branches";
+static const char   *kSectionProfileName    = ".data";
+
+static const size_t  kMaxProfileSymbolName  = 256;
+
+// Layout of the section, lib/GVN.c reads it at exit:
+//
+//     uint64_t function_count;
+//     struct { uint64_t calls; uint64_t cycles; } entries[function_count];
+//     uint64_t branch_count;
+//     struct { uint64_t executions; uint64_t taken;
+//              uint32_t function_index; uint32_t line;
+//              uint32_t ordinal;        uint32_t reserved; } branches[branch_count];
+//     zero-terminated function names in the order of the entries
+static const size_t  kProfileHeaderSize        = sizeof(uint64_t);
+static const size_t  kProfileEntrySize         = 2 * sizeof(uint64_t);
+static const size_t  kProfileCallsOffset       = 0;
+static const size_t  kProfileCyclesOffset      = sizeof(uint64_t);
+
+static const size_t  kProfileBranchSize        = 4 * sizeof(uint64_t);
+static const size_t  kProfileExecutionsOffset  = 0;
+static const size_t  kProfileTakenOffset       = sizeof(uint64_t);
+
+BackendErrs_t GetProfileSymbolName(LanguageContext *language_context,
+                                   int32_t          func_pos,
+                                   const char      *suffix,
+                                   char            *name,
+                                   size_t           name_size);
+
+//! Lists the ??? and пока of every function and, with a profile, attaches
+//! their recorded counters
+BackendErrs_t CollectBranchSites(BranchSites       *branch_sites,
+                                 LanguageContext   *language_context,
+                                 const ProfileData *profile);
+
+BackendErrs_t DestroyBranchSites(BranchSites *branch_sites);
+
+//! Number of sites in a statement list and the blocks nested in it
+size_t CountBranchSites(const TreeNode *list);
+
+size_t GetProfileSectionIndex(const BackendContext *backend_context);
+
+BackendErrs_t BuildProfileSection(BackendContext *backend_context,
+                                  DebugBuffer    *section);
+
+#endif
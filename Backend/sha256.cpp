@@ -0,0 +1,187 @@
+#include <string.h>
+
+#include "sha256.h"
+#include "../debug/debug.h"
+
+static const uint32_t kSha256InitialState[] =
+{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static const uint32_t kSha256RoundConstants[] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static BackendErrs_t Sha256Transform(Sha256Context *sha_context,
+                                     const uint8_t *block);
+
+//==============================================================================
+
+#define ROTATE_RIGHT(value, shift) (((value) >> (shift)) | ((value) << (32 - (shift))))
+
+BackendErrs_t Sha256Init(Sha256Context *sha_context)
+{
+    CHECK(sha_context);
+
+    memcpy(sha_context->state, kSha256InitialState, sizeof(kSha256InitialState));
+
+    sha_context->block_size = 0;
+    sha_context->total_size = 0;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t Sha256Transform(Sha256Context *sha_context,
+                                     const uint8_t *block)
+{
+    CHECK(sha_context);
+    CHECK(block);
+
+    uint32_t schedule[64] = {};
+
+    for (size_t i = 0; i < 16; i++)
+    {
+        schedule[i] = (uint32_t) block[4 * i]     << 24 |
+                      (uint32_t) block[4 * i + 1] << 16 |
+                      (uint32_t) block[4 * i + 2] <<  8 |
+                      (uint32_t) block[4 * i + 3];
+    }
+
+    for (size_t i = 16; i < 64; i++)
+    {
+        uint32_t sigma0 = ROTATE_RIGHT(schedule[i - 15],  7) ^ ROTATE_RIGHT(schedule[i - 15], 18) ^ (schedule[i - 15] >>  3);
+        uint32_t sigma1 = ROTATE_RIGHT(schedule[i -  2], 17) ^ ROTATE_RIGHT(schedule[i -  2], 19) ^ (schedule[i -  2] >> 10);
+
+        schedule[i] = schedule[i - 16] + sigma0 + schedule[i - 7] + sigma1;
+    }
+
+    uint32_t a = sha_context->state[0];
+    uint32_t b = sha_context->state[1];
+    uint32_t c = sha_context->state[2];
+    uint32_t d = sha_context->state[3];
+    uint32_t e = sha_context->state[4];
+    uint32_t f = sha_context->state[5];
+    uint32_t g = sha_context->state[6];
+    uint32_t h = sha_context->state[7];
+
+    for (size_t i = 0; i < 64; i++)
+    {
+        uint32_t sum1   = ROTATE_RIGHT(e, 6) ^ ROTATE_RIGHT(e, 11) ^ ROTATE_RIGHT(e, 25);
+        uint32_t choose = (e & f) ^ (~e & g);
+        uint32_t temp1  = h + sum1 + choose + kSha256RoundConstants[i] + schedule[i];
+        uint32_t sum0   = ROTATE_RIGHT(a, 2) ^ ROTATE_RIGHT(a, 13) ^ ROTATE_RIGHT(a, 22);
+        uint32_t major  = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t temp2  = sum0 + major;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    sha_context->state[0] += a;
+    sha_context->state[1] += b;
+    sha_context->state[2] += c;
+    sha_context->state[3] += d;
+    sha_context->state[4] += e;
+    sha_context->state[5] += f;
+    sha_context->state[6] += g;
+    sha_context->state[7] += h;
+
+    return kBackendSuccess;
+}
+
+#undef ROTATE_RIGHT
+
+//==============================================================================
+
+BackendErrs_t Sha256Update(Sha256Context *sha_context,
+                                  const void    *data,
+                                  size_t         size)
+{
+    CHECK(sha_context);
+    CHECK(data);
+
+    const uint8_t *bytes = (const uint8_t *) data;
+
+    sha_context->total_size += size;
+
+    while (size > 0)
+    {
+        size_t chunk_size = kSha256BlockSize - sha_context->block_size;
+
+        if (chunk_size > size)
+        {
+            chunk_size = size;
+        }
+
+        memcpy(sha_context->block + sha_context->block_size, bytes, chunk_size);
+
+        sha_context->block_size += chunk_size;
+        bytes                   += chunk_size;
+        size                    -= chunk_size;
+
+        if (sha_context->block_size == kSha256BlockSize)
+        {
+            Sha256Transform(sha_context, sha_context->block);
+
+            sha_context->block_size = 0;
+        }
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t Sha256Final(Sha256Context *sha_context,
+                                 uint8_t       *digest)
+{
+    CHECK(sha_context);
+    CHECK(digest);
+
+    uint64_t bit_size = sha_context->total_size * 8;
+
+    uint8_t padding[kSha256BlockSize * 2] = {0x80};
+
+    size_t padding_size = (sha_context->block_size < kSha256BlockSize - sizeof(bit_size) ? kSha256BlockSize : 2 * kSha256BlockSize) -
+                          sha_context->block_size - sizeof(bit_size);
+
+    Sha256Update(sha_context, padding, padding_size);
+
+    uint8_t size_bytes[sizeof(bit_size)] = {};
+
+    for (size_t i = 0; i < sizeof(bit_size); i++)
+    {
+        size_bytes[i] = (uint8_t) (bit_size >> (56 - 8 * i));
+    }
+
+    Sha256Update(sha_context, size_bytes, sizeof(size_bytes));
+
+    for (size_t i = 0; i < 8; i++)
+    {
+        digest[4 * i]     = (uint8_t) (sha_context->state[i] >> 24);
+        digest[4 * i + 1] = (uint8_t) (sha_context->state[i] >> 16);
+        digest[4 * i + 2] = (uint8_t) (sha_context->state[i] >>  8);
+        digest[4 * i + 3] = (uint8_t)  sha_context->state[i];
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
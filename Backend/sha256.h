@@ -0,0 +1,32 @@
+#ifndef SHA256_HEADER
+#define SHA256_HEADER
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "backend.h"
+
+static const size_t kSha256BlockSize  = 64;
+static const size_t kSha256DigestSize = 32;
+
+struct Sha256Context
+{
+    uint32_t state[8];
+
+    uint8_t  block[kSha256BlockSize];
+
+    size_t   block_size;
+
+    uint64_t total_size;
+};
+
+BackendErrs_t Sha256Init  (Sha256Context *sha_context);
+
+BackendErrs_t Sha256Update(Sha256Context *sha_context,
+                           const void    *data,
+                           size_t         size);
+
+BackendErrs_t Sha256Final (Sha256Context *sha_context,
+                           uint8_t       *digest);
+
+#endif
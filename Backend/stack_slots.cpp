@@ -0,0 +1,650 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "stack_slots.h"
+#include "../debug/debug.h"
+#include "../debug/color_print.h"
+
+static const size_t kNoOccurrence = (size_t) -1;
+
+static const size_t kBaseLoopArrayCapacity = 8;
+
+struct LiveRange
+{
+    size_t first;
+    size_t last;
+};
+
+struct LoopRange
+{
+    size_t begin;
+    size_t end;
+};
+
+struct WeightContext
+{
+    const TableOfNames *cur_table;
+    const StackFrame   *stack_frame;
+
+    const BranchSite   *sites;
+    size_t              site_pos;
+
+    uint64_t           *slot_weights;
+};
+
+struct LivenessContext
+{
+    const TableOfNames *cur_table;
+
+    LiveRange          *ranges;
+
+    LoopRange          *loops;
+    size_t              loops_count;
+    size_t              loops_capacity;
+
+    size_t              statement_counter;
+};
+
+static BackendErrs_t ReallocStackFrame(StackFrame *stack_frame,
+                                       size_t      new_capacity);
+
+static BackendErrs_t MarkStatementList(LivenessContext *liveness_context,
+                                       const TreeNode  *list);
+
+static BackendErrs_t MarkOccurrences(LivenessContext *liveness_context,
+                                     const TreeNode  *node,
+                                     size_t           statement_pos);
+
+static BackendErrs_t AddOccurrence(LiveRange *range,
+                                   size_t     statement_pos);
+
+static BackendErrs_t AddLoop(LivenessContext *liveness_context,
+                             size_t           begin,
+                             size_t           end);
+
+static BackendErrs_t ExtendRangesOverLoops(LivenessContext *liveness_context);
+
+static BackendErrs_t AssignSlots(StackFrame      *stack_frame,
+                                 const LiveRange *ranges,
+                                 size_t           name_count);
+
+static BackendErrs_t WeighStatementList(WeightContext  *weight_context,
+                                        const TreeNode *list,
+                                        uint64_t        weight);
+
+static BackendErrs_t WeighOccurrences(WeightContext  *weight_context,
+                                      const TreeNode *node,
+                                      uint64_t        weight);
+
+//==============================================================================
+
+BackendErrs_t InitStackFrame(StackFrame *stack_frame)
+{
+    CHECK(stack_frame);
+
+    stack_frame->variable_slots = (size_t *)         calloc(kBaseStackFrameCapacity, sizeof(size_t));
+    stack_frame->slot_registers = (RegisterCode_t *) calloc(kBaseStackFrameCapacity, sizeof(RegisterCode_t));
+
+    if (stack_frame->variable_slots == nullptr || stack_frame->slot_registers == nullptr)
+    {
+        return kBackendFailedAllocation;
+    }
+
+    stack_frame->capacity       = kBaseStackFrameCapacity;
+    stack_frame->slot_count     = 0;
+    stack_frame->promoted_count = 0;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+BackendErrs_t DestroyStackFrame(StackFrame *stack_frame)
+{
+    CHECK(stack_frame);
+
+    free(stack_frame->variable_slots);
+    free(stack_frame->slot_registers);
+
+    stack_frame->variable_slots = nullptr;
+    stack_frame->slot_registers = nullptr;
+    stack_frame->capacity       = 0;
+    stack_frame->slot_count     = 0;
+    stack_frame->promoted_count = 0;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t ReallocStackFrame(StackFrame *stack_frame,
+                                       size_t      new_capacity)
+{
+    CHECK(stack_frame);
+
+    size_t *new_slots = (size_t *) realloc(stack_frame->variable_slots, new_capacity * sizeof(size_t));
+
+    if (new_slots == nullptr)
+    {
+        return kBackendFailedAllocation;
+    }
+
+    stack_frame->variable_slots = new_slots;
+
+    RegisterCode_t *new_registers = (RegisterCode_t *) realloc(stack_frame->slot_registers,
+                                                               new_capacity * sizeof(RegisterCode_t));
+
+    if (new_registers == nullptr)
+    {
+        return kBackendFailedAllocation;
+    }
+
+    stack_frame->slot_registers = new_registers;
+    stack_frame->capacity       = new_capacity;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+size_t GetStackFrameSize(const StackFrame *stack_frame)
+{
+    CHECK(stack_frame);
+
+    size_t frame_size = stack_frame->slot_count * kSizeOfArg;
+
+    return (frame_size + kStackAlignSize - 1) / kStackAlignSize * kStackAlignSize;
+}
+
+//==============================================================================
+
+BackendErrs_t AllocateStackSlots(StackFrame         *stack_frame,
+                                 const TreeNode     *params_node,
+                                 const TableOfNames *cur_table)
+{
+    CHECK(stack_frame);
+    CHECK(params_node);
+    CHECK(cur_table);
+
+    if (cur_table->name_count > stack_frame->capacity &&
+        ReallocStackFrame(stack_frame, cur_table->name_count) != kBackendSuccess)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kBackendFailedAllocation;
+    }
+
+    LivenessContext liveness_context = {};
+
+    liveness_context.cur_table = cur_table;
+    liveness_context.ranges    = (LiveRange *) calloc(cur_table->name_count + 1, sizeof(LiveRange));
+
+    if (liveness_context.ranges == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kBackendFailedAllocation;
+    }
+
+    for (size_t i = 0; i < cur_table->name_count; i++)
+    {
+        liveness_context.ranges[i].first = kNoOccurrence;
+        liveness_context.ranges[i].last  = 0;
+    }
+
+    // parameters are stored on entry, so they are all live from the start
+    size_t params_pos = 0;
+
+    for (const TreeNode *cur_param = params_node->left; cur_param != nullptr; cur_param = cur_param->right)
+    {
+        if (cur_param->left != nullptr && params_pos < cur_table->name_count)
+        {
+            AddOccurrence(&liveness_context.ranges[params_pos++], 0);
+        }
+    }
+
+    liveness_context.statement_counter = 1;
+
+    MarkStatementList(&liveness_context, params_node->right);
+
+    ExtendRangesOverLoops(&liveness_context);
+
+    AssignSlots(stack_frame, liveness_context.ranges, cur_table->name_count);
+
+    free(liveness_context.loops);
+    free(liveness_context.ranges);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t MarkStatementList(LivenessContext *liveness_context,
+                                       const TreeNode  *list)
+{
+    CHECK(liveness_context);
+
+    for (const TreeNode *cur_node = list; cur_node != nullptr; cur_node = cur_node->right)
+    {
+        const TreeNode *statement     = cur_node->left;
+        size_t          statement_pos = liveness_context->statement_counter++;
+
+        if (statement == nullptr)
+        {
+            continue;
+        }
+
+        if (statement->type == kOperator &&
+            (statement->data.key_word_code == kIf || statement->data.key_word_code == kWhile))
+        {
+            MarkOccurrences(liveness_context, statement->left, statement_pos);
+
+            MarkStatementList(liveness_context, statement->right);
+
+            if (statement->data.key_word_code == kWhile)
+            {
+                AddLoop(liveness_context, statement_pos, liveness_context->statement_counter - 1);
+            }
+
+            continue;
+        }
+
+        MarkOccurrences(liveness_context, statement, statement_pos);
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t MarkOccurrences(LivenessContext *liveness_context,
+                                     const TreeNode  *node,
+                                     size_t           statement_pos)
+{
+    CHECK(liveness_context);
+
+    if (node == nullptr)
+    {
+        return kBackendSuccess;
+    }
+
+    const TableOfNames *cur_table = liveness_context->cur_table;
+
+    if (node->type == kIdentifier || node->type == kVarDecl)
+    {
+        for (size_t i = 0; i < cur_table->name_count; i++)
+        {
+            if (cur_table->names[i].pos == node->data.variable_pos)
+            {
+                AddOccurrence(&liveness_context->ranges[i], statement_pos);
+
+                break;
+            }
+        }
+    }
+
+    if (node->type == kCall)
+    {
+        return MarkOccurrences(liveness_context, node->left, statement_pos);
+    }
+
+    MarkOccurrences(liveness_context, node->left,  statement_pos);
+    MarkOccurrences(liveness_context, node->right, statement_pos);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AddOccurrence(LiveRange *range,
+                                   size_t     statement_pos)
+{
+    CHECK(range);
+
+    if (range->first == kNoOccurrence || statement_pos < range->first)
+    {
+        range->first = statement_pos;
+    }
+
+    if (statement_pos > range->last)
+    {
+        range->last = statement_pos;
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AddLoop(LivenessContext *liveness_context,
+                             size_t           begin,
+                             size_t           end)
+{
+    CHECK(liveness_context);
+
+    if (liveness_context->loops_count >= liveness_context->loops_capacity)
+    {
+        size_t new_capacity = liveness_context->loops_capacity == 0 ? kBaseLoopArrayCapacity :
+                                                                      liveness_context->loops_capacity * 2;
+
+        LoopRange *new_loops = (LoopRange *) realloc(liveness_context->loops, new_capacity * sizeof(LoopRange));
+
+        if (new_loops == nullptr)
+        {
+            return kBackendFailedAllocation;
+        }
+
+        liveness_context->loops          = new_loops;
+        liveness_context->loops_capacity = new_capacity;
+    }
+
+    liveness_context->loops[liveness_context->loops_count].begin = begin;
+    liveness_context->loops[liveness_context->loops_count].end   = end;
+
+    liveness_context->loops_count++;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// a variable touched anywhere inside a loop may be carried around its back
+// edge, so it has to keep its slot for the whole loop
+static BackendErrs_t ExtendRangesOverLoops(LivenessContext *liveness_context)
+{
+    CHECK(liveness_context);
+
+    bool changed = true;
+
+    while (changed)
+    {
+        changed = false;
+
+        for (size_t i = 0; i < liveness_context->cur_table->name_count; i++)
+        {
+            LiveRange *range = &liveness_context->ranges[i];
+
+            if (range->first == kNoOccurrence)
+            {
+                continue;
+            }
+
+            for (size_t j = 0; j < liveness_context->loops_count; j++)
+            {
+                const LoopRange *loop = &liveness_context->loops[j];
+
+                if (range->last < loop->begin || range->first > loop->end)
+                {
+                    continue;
+                }
+
+                if (loop->begin < range->first)
+                {
+                    range->first = loop->begin;
+                    changed      = true;
+                }
+
+                if (loop->end > range->last)
+                {
+                    range->last = loop->end;
+                    changed     = true;
+                }
+            }
+        }
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AssignSlots(StackFrame      *stack_frame,
+                                 const LiveRange *ranges,
+                                 size_t           name_count)
+{
+    CHECK(stack_frame);
+    CHECK(ranges);
+
+    // slot_ends[k] is the last statement that uses slot k, there are never
+    // more slots than names
+    size_t *slot_ends = (size_t *) calloc(name_count + 1, sizeof(size_t));
+
+    if (slot_ends == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kBackendFailedAllocation;
+    }
+
+    stack_frame->slot_count     = 0;
+    stack_frame->promoted_count = 0;
+
+    for (size_t i = 0; i < name_count; i++)
+    {
+        stack_frame->variable_slots[i] = 0;
+        stack_frame->slot_registers[i] = kNotRegister;
+    }
+
+    // names are visited in order of their first occurrence, ties keep the
+    // table order so that parameter i always gets slot i
+    size_t prev_first = 0;
+    size_t prev_pos   = 0;
+    bool   has_prev   = false;
+
+    for (size_t assigned = 0; assigned < name_count; assigned++)
+    {
+        size_t cur_pos = name_count;
+
+        for (size_t i = 0; i < name_count; i++)
+        {
+            if (ranges[i].first == kNoOccurrence)
+            {
+                continue;
+            }
+
+            if (has_prev && (ranges[i].first < prev_first ||
+                            (ranges[i].first == prev_first && i <= prev_pos)))
+            {
+                continue;
+            }
+
+            if (cur_pos == name_count || ranges[i].first < ranges[cur_pos].first)
+            {
+                cur_pos = i;
+            }
+        }
+
+        if (cur_pos == name_count)
+        {
+            break;
+        }
+
+        size_t slot = 0;
+
+        while (slot < stack_frame->slot_count && slot_ends[slot] >= ranges[cur_pos].first)
+        {
+            slot++;
+        }
+
+        if (slot == stack_frame->slot_count)
+        {
+            stack_frame->slot_count++;
+        }
+
+        slot_ends[slot]                      = ranges[cur_pos].last;
+        stack_frame->variable_slots[cur_pos] = slot;
+
+        prev_first = ranges[cur_pos].first;
+        prev_pos   = cur_pos;
+        has_prev   = true;
+    }
+
+    free(slot_ends);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// A use is weighed by how many times the profiled run executed it: the
+// statements of a function run once per call, a block body as many times
+// as its counter says. Blocks missing from the profile inherit the weight
+// of the statements around them.
+BackendErrs_t PromoteHotSlots(StackFrame         *stack_frame,
+                              const TreeNode     *params_node,
+                              const TableOfNames *cur_table,
+                              const BranchSite   *sites,
+                              uint64_t            calls)
+{
+    CHECK(stack_frame);
+    CHECK(params_node);
+    CHECK(cur_table);
+
+    if (calls == 0 || stack_frame->slot_count == 0)
+    {
+        return kBackendSuccess;
+    }
+
+    WeightContext weight_context = {cur_table, stack_frame, sites, 0, nullptr};
+
+    weight_context.slot_weights = (uint64_t *) calloc(stack_frame->slot_count, sizeof(uint64_t));
+
+    if (weight_context.slot_weights == nullptr)
+    {
+        ColorPrintf(kRed, "%s() failed allocation\n", __func__);
+
+        return kBackendFailedAllocation;
+    }
+
+    // parameters are stored on every call
+    size_t params_pos = 0;
+
+    for (const TreeNode *cur_param = params_node->left; cur_param != nullptr; cur_param = cur_param->right)
+    {
+        if (cur_param->left != nullptr && params_pos < cur_table->name_count)
+        {
+            weight_context.slot_weights[stack_frame->variable_slots[params_pos++]] += calls;
+        }
+    }
+
+    WeighStatementList(&weight_context, params_node->right, calls);
+
+    while (stack_frame->promoted_count < kPromotedVariableRegisterCount)
+    {
+        size_t hottest_slot = stack_frame->slot_count;
+
+        for (size_t i = 0; i < stack_frame->slot_count; i++)
+        {
+            if (stack_frame->slot_registers[i] == kNotRegister &&
+                weight_context.slot_weights[i] > kPromotionCostPerCall * calls &&
+                (hottest_slot == stack_frame->slot_count ||
+                 weight_context.slot_weights[i] > weight_context.slot_weights[hottest_slot]))
+            {
+                hottest_slot = i;
+            }
+        }
+
+        if (hottest_slot == stack_frame->slot_count)
+        {
+            break;
+        }
+
+        stack_frame->slot_registers[hottest_slot] = PromotedVariableRegisters[stack_frame->promoted_count++];
+    }
+
+    free(weight_context.slot_weights);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// Walks the blocks in the order the branch sites were numbered in
+static BackendErrs_t WeighStatementList(WeightContext  *weight_context,
+                                        const TreeNode *list,
+                                        uint64_t        weight)
+{
+    CHECK(weight_context);
+
+    for (const TreeNode *cur_node = list; cur_node != nullptr; cur_node = cur_node->right)
+    {
+        const TreeNode *statement = cur_node->left;
+
+        if (statement == nullptr)
+        {
+            continue;
+        }
+
+        if (statement->type == kOperator &&
+            (statement->data.key_word_code == kIf || statement->data.key_word_code == kWhile))
+        {
+            const BranchSite *site = weight_context->sites != nullptr ?
+                                     &weight_context->sites[weight_context->site_pos++] : nullptr;
+
+            uint64_t test_weight = weight;
+            uint64_t body_weight = weight;
+
+            if (site != nullptr && site->is_profiled)
+            {
+                body_weight = site->taken;
+
+                // a loop test runs once more than the body on every entry
+                if (statement->data.key_word_code == kWhile)
+                {
+                    test_weight = site->executions + site->taken;
+                }
+            }
+
+            WeighOccurrences(weight_context, statement->left, test_weight);
+
+            WeighStatementList(weight_context, statement->right, body_weight);
+
+            continue;
+        }
+
+        WeighOccurrences(weight_context, statement, weight);
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t WeighOccurrences(WeightContext  *weight_context,
+                                      const TreeNode *node,
+                                      uint64_t        weight)
+{
+    CHECK(weight_context);
+
+    if (node == nullptr)
+    {
+        return kBackendSuccess;
+    }
+
+    const TableOfNames *cur_table = weight_context->cur_table;
+
+    if (node->type == kIdentifier || node->type == kVarDecl)
+    {
+        for (size_t i = 0; i < cur_table->name_count; i++)
+        {
+            if (cur_table->names[i].pos == node->data.variable_pos)
+            {
+                weight_context->slot_weights[weight_context->stack_frame->variable_slots[i]] += weight;
+
+                break;
+            }
+        }
+    }
+
+    if (node->type == kCall)
+    {
+        return WeighOccurrences(weight_context, node->left, weight);
+    }
+
+    WeighOccurrences(weight_context, node->left,  weight);
+    WeighOccurrences(weight_context, node->right, weight);
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
@@ -0,0 +1,26 @@
+#ifndef STACK_SLOTS_HEADER
+#define STACK_SLOTS_HEADER
+
+#include "backend.h"
+
+BackendErrs_t InitStackFrame   (StackFrame *stack_frame);
+BackendErrs_t DestroyStackFrame(StackFrame *stack_frame);
+
+BackendErrs_t AllocateStackSlots(StackFrame         *stack_frame,
+                                 const TreeNode     *params_node,
+                                 const TableOfNames *cur_table);
+
+//! Moves the slots used most often per the profile to callee-saved
+//! registers, the freed slots keep the old values of the registers
+//!
+//! @param sites first branch site of the function
+//! @param calls calls of the function in the profiled run
+BackendErrs_t PromoteHotSlots(StackFrame         *stack_frame,
+                              const TreeNode     *params_node,
+                              const TableOfNames *cur_table,
+                              const BranchSite   *sites,
+                              uint64_t            calls);
+
+size_t GetStackFrameSize(const StackFrame *stack_frame);
+
+#endif
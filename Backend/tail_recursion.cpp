@@ -0,0 +1,400 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tree_optimizer.h"
+#include "backend_common.h"
+#include "../debug/debug.h"
+#include "../debug/color_print.h"
+
+static const size_t kMaxAccumulatorNameLen = 256;
+
+static TreeErrs_t IntroduceFuncAccumulator(LanguageContext *language_context,
+                                           TreeNode        *decl_list_node);
+
+static bool CheckAccumulatorReturns(const TreeNode *node,
+                                    size_t          func_pos,
+                                    KeyCode_t      *accumulator_op);
+
+static bool IsSelfCall(const TreeNode *node,
+                       size_t          func_pos);
+
+static TreeErrs_t RewriteAccumulatorReturns(TreeNode  *node,
+                                            size_t     func_pos,
+                                            size_t     acc_func_pos,
+                                            size_t     acc_var_pos,
+                                            KeyCode_t  accumulator_op);
+
+static TreeErrs_t AppendListItem(TreeNode **list,
+                                 TreeNode  *item);
+
+static size_t AddAccumulatorIdentifier(Identifiers *identifiers,
+                                       const char  *func_name,
+                                       const char  *suffix,
+                                       IdType_t     id_type);
+
+static TableOfNames *CreateAccumulatorTable(NameTables   *tables,
+                                            TableOfNames *func_table,
+                                            size_t        acc_func_pos,
+                                            size_t        acc_var_pos,
+                                            size_t        params_count);
+
+//==============================================================================
+
+TreeErrs_t IntroduceAccumulators(LanguageContext *language_context)
+{
+    CHECK(language_context);
+
+    TreeErrs_t status = kTreeNotOptimized;
+
+    for (TreeNode *cur_decl = language_context->syntax_tree.root;
+                   cur_decl != nullptr;
+                   cur_decl = cur_decl->right)
+    {
+        if (cur_decl->left != nullptr && cur_decl->left->type == kFuncDef)
+        {
+            if (IntroduceFuncAccumulator(language_context, cur_decl) == kTreeOptimized)
+            {
+                status = kTreeOptimized;
+
+                cur_decl = cur_decl->right;
+            }
+        }
+    }
+
+    return status;
+}
+
+//==============================================================================
+
+static TreeErrs_t IntroduceFuncAccumulator(LanguageContext *language_context,
+                                           TreeNode        *decl_list_node)
+{
+    CHECK(language_context);
+    CHECK(decl_list_node);
+
+    TreeNode *func_node = decl_list_node->left;
+    size_t    func_pos  = func_node->data.variable_pos;
+
+    if (func_pos == language_context->tables.main_id_pos || func_node->right == nullptr)
+    {
+        return kTreeNotOptimized;
+    }
+
+    KeyCode_t accumulator_op = kNotAnOperation;
+
+    if (!CheckAccumulatorReturns(func_node->right->right, func_pos, &accumulator_op) ||
+        accumulator_op == kNotAnOperation)
+    {
+        return kTreeNotOptimized;
+    }
+
+    size_t params_count = 0;
+
+    for (TreeNode *cur_param = func_node->right->left; cur_param != nullptr; cur_param = cur_param->right)
+    {
+        if (cur_param->left != nullptr)
+        {
+            params_count++;
+        }
+    }
+
+    // the accumulator is one more parameter, and codegen passes parameters
+    // in registers only
+    if (params_count + 1 > kArgPassingRegisterCount)
+    {
+        return kTreeNotOptimized;
+    }
+
+    TableOfNames *func_table = GetFuncNameTable(&language_context->tables, func_pos);
+
+    if (func_table == nullptr)
+    {
+        return kFailedToFind;
+    }
+
+    Identifiers *identifiers = &language_context->identifiers;
+
+    size_t acc_func_pos = AddAccumulatorIdentifier(identifiers, identifiers->identifier_array[func_pos].id,
+                                                   "acc", kFunc);
+    size_t acc_var_pos  = AddAccumulatorIdentifier(identifiers, identifiers->identifier_array[func_pos].id,
+                                                   "accumulator", kVar);
+
+    TreeNode *acc_func_node = CopyNode(func_node);
+
+    acc_func_node->data.variable_pos = acc_func_pos;
+
+    TreeNode *acc_param = NodeCtor(nullptr,
+                                   CopyNode(func_node->left),
+                                   NodeCtor(nullptr, nullptr, nullptr, kIdentifier, (double) acc_var_pos),
+                                   kVarDecl, (double) acc_var_pos);
+
+    AppendListItem(&acc_func_node->right->left, acc_param);
+
+    RewriteAccumulatorReturns(acc_func_node->right->right, func_pos,
+                              acc_func_pos, acc_var_pos, accumulator_op);
+
+    TreeNode *acc_args = nullptr;
+
+    for (TreeNode *cur_param = func_node->right->left; cur_param != nullptr; cur_param = cur_param->right)
+    {
+        if (cur_param->left != nullptr)
+        {
+            AppendListItem(&acc_args, NodeCtor(nullptr, nullptr, nullptr, kIdentifier,
+                                               (double) cur_param->left->data.variable_pos));
+        }
+    }
+
+    AppendListItem(&acc_args, NodeCtor(nullptr, nullptr, nullptr, kConstNumber,
+                                       accumulator_op == kMult ? 1 : 0));
+
+    TreeNode *acc_call = NodeCtor(nullptr, acc_args,
+                                  NodeCtor(nullptr, nullptr, nullptr, kIdentifier, (double) acc_func_pos),
+                                  kCall, 0);
+
+    TreeDtor(func_node->right->right);
+
+    func_node->right->right = NodeCtor(nullptr,
+                                       NodeCtor(nullptr, nullptr, acc_call, kOperator, kReturn),
+                                       nullptr,
+                                       kOperator, kEndOfLine);
+
+    CreateAccumulatorTable(&language_context->tables, func_table,
+                           acc_func_pos, acc_var_pos, params_count);
+
+    func_table->name_count = params_count;
+
+    decl_list_node->right = NodeCtor(nullptr, acc_func_node, decl_list_node->right,
+                                     kOperator, kEndOfLine);
+
+    return kTreeOptimized;
+}
+
+//==============================================================================
+
+static bool IsSelfCall(const TreeNode *node,
+                       size_t          func_pos)
+{
+    return node != nullptr && node->type == kCall &&
+           node->right->data.variable_pos == func_pos &&
+           !ContainsCall(node->left, (int) func_pos);
+}
+
+//==============================================================================
+
+static bool CheckAccumulatorReturns(const TreeNode *node,
+                                    size_t          func_pos,
+                                    KeyCode_t      *accumulator_op)
+{
+    CHECK(accumulator_op);
+
+    if (node == nullptr)
+    {
+        return true;
+    }
+
+    if (node->type == kCall && node->right->data.variable_pos == func_pos)
+    {
+        return false;
+    }
+
+    if (node->type != kOperator || node->data.key_word_code != kReturn)
+    {
+        return CheckAccumulatorReturns(node->left,  func_pos, accumulator_op) &&
+               CheckAccumulatorReturns(node->right, func_pos, accumulator_op);
+    }
+
+    const TreeNode *value = node->right;
+
+    if (!ContainsCall(value, (int) func_pos) || IsSelfCall(value, func_pos))
+    {
+        return true;
+    }
+
+    if (value->type != kOperator ||
+        (value->data.key_word_code != kMult && value->data.key_word_code != kAdd))
+    {
+        return false;
+    }
+
+    const TreeNode *operand = nullptr;
+
+    if (IsSelfCall(value->left, func_pos))
+    {
+        operand = value->right;
+    }
+    else if (IsSelfCall(value->right, func_pos))
+    {
+        operand = value->left;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (!IsPureExpression(operand))
+    {
+        return false;
+    }
+
+    if (*accumulator_op != kNotAnOperation && *accumulator_op != value->data.key_word_code)
+    {
+        return false;
+    }
+
+    *accumulator_op = value->data.key_word_code;
+
+    return true;
+}
+
+//==============================================================================
+
+static TreeErrs_t RewriteAccumulatorReturns(TreeNode  *node,
+                                            size_t     func_pos,
+                                            size_t     acc_func_pos,
+                                            size_t     acc_var_pos,
+                                            KeyCode_t  accumulator_op)
+{
+    if (node == nullptr)
+    {
+        return kTreeSuccess;
+    }
+
+    if (node->type != kOperator || node->data.key_word_code != kReturn)
+    {
+        RewriteAccumulatorReturns(node->left,  func_pos, acc_func_pos, acc_var_pos, accumulator_op);
+        RewriteAccumulatorReturns(node->right, func_pos, acc_func_pos, acc_var_pos, accumulator_op);
+
+        return kTreeSuccess;
+    }
+
+    TreeNode *value    = node->right;
+    TreeNode *acc_node = NodeCtor(nullptr, nullptr, nullptr, kIdentifier, (double) acc_var_pos);
+
+    if (!ContainsCall(value, (int) func_pos))
+    {
+        node->right = NodeCtor(nullptr, acc_node, value, kOperator, accumulator_op);
+
+        return kTreeSuccess;
+    }
+
+    TreeNode *call_node = value;
+
+    if (value->type != kCall)
+    {
+        TreeNode *operand = nullptr;
+
+        if (value->left->type == kCall)
+        {
+            call_node = value->left;
+            operand   = value->right;
+        }
+        else
+        {
+            call_node = value->right;
+            operand   = value->left;
+        }
+
+        value->left  = nullptr;
+        value->right = nullptr;
+
+        TreeDtor(value);
+
+        acc_node = NodeCtor(nullptr, acc_node, operand, kOperator, accumulator_op);
+    }
+
+    call_node->right->data.variable_pos = acc_func_pos;
+
+    AppendListItem(&call_node->left, acc_node);
+
+    node->right = call_node;
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+static TreeErrs_t AppendListItem(TreeNode **list,
+                                 TreeNode  *item)
+{
+    CHECK(list);
+
+    TreeNode **link = list;
+
+    while (*link != nullptr)
+    {
+        if ((*link)->left == nullptr)
+        {
+            (*link)->left = item;
+
+            return kTreeSuccess;
+        }
+
+        link = &(*link)->right;
+    }
+
+    *link = NodeCtor(nullptr, item, nullptr, kOperator, kEnumOp);
+
+    if (*link == nullptr)
+    {
+        return kFailedAllocation;
+    }
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+static size_t AddAccumulatorIdentifier(Identifiers *identifiers,
+                                       const char  *func_name,
+                                       const char  *suffix,
+                                       IdType_t     id_type)
+{
+    CHECK(identifiers);
+    CHECK(func_name);
+    CHECK(suffix);
+
+    char name[kMaxAccumulatorNameLen] = {0};
+
+    snprintf(name, kMaxAccumulatorNameLen, "%s.%s", func_name, suffix);
+
+    size_t pos = AddIdentifier(identifiers, strdup(name));
+
+    identifiers->identifier_array[pos].declaration_state = true;
+    identifiers->identifier_array[pos].id_type           = id_type;
+
+    return pos;
+}
+
+//==============================================================================
+
+static TableOfNames *CreateAccumulatorTable(NameTables   *tables,
+                                            TableOfNames *func_table,
+                                            size_t        acc_func_pos,
+                                            size_t        acc_var_pos,
+                                            size_t        params_count)
+{
+    CHECK(tables);
+    CHECK(func_table);
+
+    TableOfNames *acc_table = AddTableOfNames(tables, (int) acc_func_pos);
+
+    for (size_t i = 0; i < func_table->name_count; i++)
+    {
+        if (i == params_count)
+        {
+            AddName(acc_table, acc_var_pos, kVar);
+        }
+
+        AddName(acc_table, func_table->names[i].pos, func_table->names[i].type);
+    }
+
+    if (params_count == func_table->name_count)
+    {
+        AddName(acc_table, acc_var_pos, kVar);
+    }
+
+    return acc_table;
+}
+
+//==============================================================================
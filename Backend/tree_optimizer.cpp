@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "tree_optimizer.h"
+#include "../debug/debug.h"
+#include "../debug/color_print.h"
+
+static bool EvalConstantOperator(KeyCode_t  key_word_code,
+                                 int64_t    lhs,
+                                 int64_t    rhs,
+                                 int64_t   *value);
+
+//==============================================================================
+
+TreeErrs_t OptimizeSyntaxTree(LanguageContext   *language_context,
+                              const ProfileData *profile)
+{
+    CHECK(language_context);
+
+    if (language_context->syntax_tree.root == nullptr)
+    {
+        return kNullTree;
+    }
+
+    IntroduceAccumulators(language_context);
+
+    InlineFunctions(language_context, profile);
+
+    EliminateDeadCode(language_context);
+
+    HoistLoopInvariants(language_context);
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+TableOfNames *GetFuncNameTable(NameTables *tables,
+                               size_t      func_pos)
+{
+    CHECK(tables);
+
+    for (size_t i = 0; i < tables->tables_count; i++)
+    {
+        if (tables->name_tables[i]->func_code == (int) func_pos)
+        {
+            return tables->name_tables[i];
+        }
+    }
+
+    return nullptr;
+}
+
+//==============================================================================
+
+bool IsTerminatorStatement(const TreeNode *node)
+{
+    if (node == nullptr || node->type != kOperator)
+    {
+        return false;
+    }
+
+    return node->data.key_word_code == kReturn   ||
+           node->data.key_word_code == kBreak    ||
+           node->data.key_word_code == kContinue ||
+           node->data.key_word_code == kAbort;
+}
+
+//==============================================================================
+
+bool ContainsCall(const TreeNode *node,
+                  int             func_pos)
+{
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    if (node->type == kCall &&
+        (func_pos < 0 || node->right->data.variable_pos == (size_t) func_pos))
+    {
+        return true;
+    }
+
+    return ContainsCall(node->left,  func_pos) ||
+           ContainsCall(node->right, func_pos);
+}
+
+//==============================================================================
+
+bool IsPureExpression(const TreeNode *node)
+{
+    if (node == nullptr)
+    {
+        return true;
+    }
+
+    switch (node->type)
+    {
+        case kConstNumber:
+        case kIdentifier:
+        {
+            return true;
+        }
+
+        case kOperator:
+        {
+            switch (node->data.key_word_code)
+            {
+                case kAdd:
+                case kSub:
+                case kMult:
+                case kDiv:
+                case kSqrt:
+                case kSin:
+                case kCos:
+                case kFloor:
+                case kEqual:
+                case kLess:
+                case kMore:
+                case kLessOrEqual:
+                case kMoreOrEqual:
+                case kNotEqual:
+                case kAnd:
+                case kOr:
+                {
+                    return IsPureExpression(node->left) &&
+                           IsPureExpression(node->right);
+                }
+
+                default:
+                {
+                    return false;
+                }
+            }
+        }
+
+        case kCall:
+        case kFuncDef:
+        case kParamsNode:
+        case kVarDecl:
+        default:
+        {
+            return false;
+        }
+    }
+}
+
+//==============================================================================
+
+bool EvalConstantExpression(const TreeNode *node,
+                            int64_t        *value)
+{
+    CHECK(value);
+
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    if (node->type == kConstNumber)
+    {
+        *value = (int64_t) node->data.const_val;
+
+        return !((NumType_t) *value < node->data.const_val || (NumType_t) *value > node->data.const_val);
+    }
+
+    if (node->type != kOperator)
+    {
+        return false;
+    }
+
+    int64_t lhs = 0;
+    int64_t rhs = 0;
+
+    if (!EvalConstantExpression(node->left,  &lhs) ||
+        !EvalConstantExpression(node->right, &rhs))
+    {
+        return false;
+    }
+
+    return EvalConstantOperator(node->data.key_word_code, lhs, rhs, value);
+}
+
+//==============================================================================
+
+static bool EvalConstantOperator(KeyCode_t  key_word_code,
+                                 int64_t    lhs,
+                                 int64_t    rhs,
+                                 int64_t   *value)
+{
+    // overflowing sums and products are left to the runtime: --double mode
+    // does not wrap them, and folding them here would be UB
+    switch (key_word_code)
+    {
+        case kAdd:
+        {
+            return !__builtin_add_overflow(lhs, rhs, value);
+        }
+
+        case kSub:
+        {
+            return !__builtin_sub_overflow(lhs, rhs, value);
+        }
+
+        case kMult:
+        {
+            return !__builtin_mul_overflow(lhs, rhs, value);
+        }
+
+        case kEqual:
+        {
+            *value = (lhs == rhs);
+
+            return true;
+        }
+
+        case kNotEqual:
+        {
+            *value = (lhs != rhs);
+
+            return true;
+        }
+
+        case kLess:
+        {
+            *value = (lhs <  rhs);
+
+            return true;
+        }
+
+        case kMore:
+        {
+            *value = (lhs >  rhs);
+
+            return true;
+        }
+
+        case kLessOrEqual:
+        {
+            *value = (lhs <= rhs);
+
+            return true;
+        }
+
+        case kMoreOrEqual:
+        {
+            *value = (lhs >= rhs);
+
+            return true;
+        }
+
+        case kAnd:
+        {
+            *value = (lhs != 0) && (rhs != 0);
+
+            return true;
+        }
+
+        case kOr:
+        {
+            *value = (lhs != 0) || (rhs != 0);
+
+            return true;
+        }
+
+        case kDiv:
+        {
+            // inexact quotients are not folded, so the result is the same
+            // whether the backend truncates them or keeps them as doubles
+            if (rhs == 0 || (lhs == INT64_MIN && rhs == -1) || lhs % rhs != 0)
+            {
+                return false;
+            }
+
+            *value = lhs / rhs;
+
+            return true;
+        }
+
+        default:
+        {
+            return false;
+        }
+    }
+}
+
+//==============================================================================
+
+TreeErrs_t RemoveStatement(TreeNode **statement_link)
+{
+    CHECK(statement_link);
+
+    TreeNode *statement = *statement_link;
+
+    if (statement == nullptr)
+    {
+        return kNullTree;
+    }
+
+    *statement_link = statement->right;
+
+    statement->right = nullptr;
+
+    TreeDtor(statement);
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
@@ -0,0 +1,40 @@
+#ifndef TREE_OPTIMIZER_HEADER
+#define TREE_OPTIMIZER_HEADER
+
+#include "../Common/trees.h"
+#include "../Common/NameTable.h"
+#include "pgo.h"
+
+// profile may be nullptr
+TreeErrs_t OptimizeSyntaxTree(LanguageContext   *language_context,
+                              const ProfileData *profile);
+
+TreeErrs_t IntroduceAccumulators(LanguageContext *language_context);
+
+TreeErrs_t InlineFunctions(LanguageContext   *language_context,
+                           const ProfileData *profile);
+
+TreeErrs_t EliminateDeadCode(LanguageContext *language_context);
+
+TreeErrs_t HoistLoopInvariants(LanguageContext *language_context);
+
+//==============================================================================
+//                  helpers shared by the tree passes
+//==============================================================================
+
+TableOfNames *GetFuncNameTable(NameTables *tables,
+                               size_t      func_pos);
+
+bool IsTerminatorStatement(const TreeNode *node);
+
+bool IsPureExpression(const TreeNode *node);
+
+bool ContainsCall(const TreeNode *node,
+                  int             func_pos);
+
+bool EvalConstantExpression(const TreeNode *node,
+                            int64_t        *value);
+
+TreeErrs_t RemoveStatement(TreeNode **statement_link);
+
+#endif
@@ -0,0 +1,437 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "unwind_info.h"
+#include "elf_ctor.h"
+#include "../debug/debug.h"
+#include "../debug/color_print.h"
+
+// Where the canonical frame address is: a register plus an offset
+struct CfaState
+{
+    uint8_t reg;
+
+    int64_t offset;
+};
+
+static BackendErrs_t WriteCie(DebugBuffer *eh_frame);
+
+static BackendErrs_t WriteFde(BackendContext *backend_context,
+                              UnwindSection  *section,
+                              size_t          text_symbol,
+                              size_t          begin_address,
+                              size_t          end_address,
+                              size_t         *cur_node_pos);
+
+static BackendErrs_t WriteFunctionCfi(BackendContext *backend_context,
+                                      DebugBuffer    *eh_frame,
+                                      size_t          begin_address,
+                                      size_t          end_address,
+                                      size_t         *cur_node_pos);
+
+static BackendErrs_t AdvanceCfaLocation(DebugBuffer *eh_frame,
+                                        size_t      *cur_location,
+                                        size_t       new_location);
+
+static BackendErrs_t FinishEhFrameRecord(DebugBuffer *eh_frame,
+                                         size_t       record_pos);
+
+static bool IsPushRbp(const Instruction *instruction);
+
+static bool IsMovRspToRbp(const Instruction *instruction);
+
+static bool IsRspDestination(const Instruction *instruction);
+
+static const size_t  kCiePos              = 0;
+static const uint8_t kModRmWithoutSrcMask = 0xC7;
+
+//==============================================================================
+
+// One CIE shared by every function and one FDE per function. Expects the
+// symbol table to be sorted already, the relocations refer to the final
+// symbol indices.
+BackendErrs_t BuildUnwindSection(BackendContext *backend_context,
+                                 UnwindSection  *section)
+{
+    CHECK(backend_context);
+    CHECK(section);
+
+    BackendErrs_t error = WriteCie(&section->eh_frame);
+
+    size_t text_symbol  = FindSectionSymbol(backend_context->symbol_table, kSectionTextIndex);
+    size_t cur_node_pos = backend_context->instruction_list->next[backend_context->instruction_list->head];
+
+    // functions are laid out one after another, so a function ends where
+    // the next one begins
+    LabelTable  *label_table = backend_context->label_table;
+    const Label *func_label  = nullptr;
+
+    for (size_t i = 0; i <= label_table->label_count && error == kBackendSuccess; i++)
+    {
+        const Label *label = i < label_table->label_count ? &label_table->label_array[i] : nullptr;
+
+        if (label != nullptr && label->func_pos == kFuncLabelPosPoison)
+        {
+            continue;
+        }
+
+        if (func_label != nullptr)
+        {
+            error = WriteFde(backend_context,
+                             section,
+                             text_symbol,
+                             func_label->address,
+                             label != nullptr ? label->address : backend_context->cur_address,
+                             &cur_node_pos);
+        }
+
+        func_label = label;
+    }
+
+    return error;
+}
+
+//==============================================================================
+
+BackendErrs_t DestroyUnwindSection(UnwindSection *section)
+{
+    CHECK(section);
+
+    free(section->eh_frame.data);
+    free(section->relocations.relocation_array);
+
+    memset(section, 0, sizeof(UnwindSection));
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t WriteCie(DebugBuffer *eh_frame)
+{
+    CHECK(eh_frame);
+
+    uint32_t length = 0;
+    uint32_t cie_id = 0;
+
+    WriteDebugData  (eh_frame, &length, sizeof(length));
+    WriteDebugData  (eh_frame, &cie_id, sizeof(cie_id));
+    WriteDebugByte  (eh_frame, kEhFrameVersion);
+    WriteDebugString(eh_frame, kEhFrameAugmentation);
+    WriteUleb128    (eh_frame, 1);
+    WriteSleb128    (eh_frame, kCfaDataAlignment);
+    WriteUleb128    (eh_frame, kDwarfRegReturnAddress);
+
+    // augmentation data: FDE addresses are 32-bit and pc-relative
+    WriteUleb128  (eh_frame, 1);
+    WriteDebugByte(eh_frame, kDwEhPePcrel | kDwEhPeSdata4);
+
+    // on entry the return address is on top of the stack
+    WriteDebugByte(eh_frame, kDwCfaDefCfa);
+    WriteUleb128  (eh_frame, kDwarfRegRsp);
+    WriteUleb128  (eh_frame, kSizeOfArg);
+    WriteDebugByte(eh_frame, kDwCfaOffset | kDwarfRegReturnAddress);
+    WriteUleb128  (eh_frame, kSizeOfArg / -kCfaDataAlignment);
+
+    return FinishEhFrameRecord(eh_frame, kCiePos);
+}
+
+//==============================================================================
+
+static BackendErrs_t WriteFde(BackendContext *backend_context,
+                              UnwindSection  *section,
+                              size_t          text_symbol,
+                              size_t          begin_address,
+                              size_t          end_address,
+                              size_t         *cur_node_pos)
+{
+    CHECK(backend_context);
+    CHECK(section);
+    CHECK(cur_node_pos);
+
+    DebugBuffer *eh_frame = &section->eh_frame;
+
+    size_t fde_pos = eh_frame->size;
+
+    uint32_t length       = 0;
+    uint32_t cie_pointer  = (uint32_t) (fde_pos + sizeof(length) - kCiePos);
+    int32_t  null_address = 0;
+    uint32_t func_size    = (uint32_t) (end_address - begin_address);
+
+    WriteDebugData(eh_frame, &length,      sizeof(length));
+    WriteDebugData(eh_frame, &cie_pointer, sizeof(cie_pointer));
+
+    BackendErrs_t error = AddDebugRelocation(&section->relocations,
+                                             eh_frame->size,
+                                             text_symbol,
+                                             R_X86_64_PC32,
+                                             (Elf64_Sxword) begin_address);
+
+    if (error != kBackendSuccess)
+    {
+        return error;
+    }
+
+    WriteDebugData(eh_frame, &null_address, sizeof(null_address));
+    WriteDebugData(eh_frame, &func_size,    sizeof(func_size));
+    WriteUleb128  (eh_frame, 0);
+
+    WriteFunctionCfi(backend_context, eh_frame, begin_address, end_address, cur_node_pos);
+
+    return FinishEhFrameRecord(eh_frame, fde_pos);
+}
+
+//==============================================================================
+
+// Follows rsp through the function's instructions in address order. The
+// code generator keeps the stack depth the same on every path into a
+// label, so the straight-line state is the state of every path. An
+// epilogue (leave; ret or leave; jmp) switches the CFA back to rsp and
+// the state of the body is restored right after it.
+static BackendErrs_t WriteFunctionCfi(BackendContext *backend_context,
+                                      DebugBuffer    *eh_frame,
+                                      size_t          begin_address,
+                                      size_t          end_address,
+                                      size_t         *cur_node_pos)
+{
+    CHECK(backend_context);
+    CHECK(eh_frame);
+    CHECK(cur_node_pos);
+
+    List  *list      = backend_context->instruction_list;
+    size_t list_head = (size_t) list->head;
+
+    CfaState state       = {kDwarfRegRsp, kSizeOfArg};
+    CfaState saved_state = state;
+
+    bool   is_in_epilogue = false;
+    size_t cur_location   = begin_address;
+
+    while (*cur_node_pos != list_head && list->data[*cur_node_pos].begin_address < end_address)
+    {
+        const Instruction *instruction = &list->data[*cur_node_pos];
+
+        *cur_node_pos = list->next[*cur_node_pos];
+
+        size_t next_address = instruction->begin_address + instruction->instruction_size;
+
+        switch (instruction->logical_op_code)
+        {
+            case kLogicPushRegister:
+            case kLogicPushImmediate:
+            {
+                if (state.reg != kDwarfRegRsp)
+                {
+                    break;
+                }
+
+                state.offset += kSizeOfArg;
+
+                AdvanceCfaLocation(eh_frame, &cur_location, next_address);
+
+                WriteDebugByte(eh_frame, kDwCfaDefCfaOffset);
+                WriteUleb128  (eh_frame, (uint64_t) state.offset);
+
+                if (instruction->begin_address == begin_address && IsPushRbp(instruction))
+                {
+                    WriteDebugByte(eh_frame, kDwCfaOffset | kDwarfRegRbp);
+                    WriteUleb128  (eh_frame, (uint64_t) (state.offset / -kCfaDataAlignment));
+                }
+
+                break;
+            }
+
+            case kLogicPopInRegister:
+            {
+                if (state.reg != kDwarfRegRsp)
+                {
+                    break;
+                }
+
+                state.offset -= kSizeOfArg;
+
+                AdvanceCfaLocation(eh_frame, &cur_location, next_address);
+
+                WriteDebugByte(eh_frame, kDwCfaDefCfaOffset);
+                WriteUleb128  (eh_frame, (uint64_t) state.offset);
+
+                break;
+            }
+
+            case kLogicAddImmediateToRegister:
+            case kLogicSubImmediateFromRegister:
+            {
+                if (state.reg != kDwarfRegRsp || !IsRspDestination(instruction))
+                {
+                    break;
+                }
+
+                state.offset += instruction->logical_op_code == kLogicSubImmediateFromRegister ?
+                                instruction->immediate_arg : -instruction->immediate_arg;
+
+                AdvanceCfaLocation(eh_frame, &cur_location, next_address);
+
+                WriteDebugByte(eh_frame, kDwCfaDefCfaOffset);
+                WriteUleb128  (eh_frame, (uint64_t) state.offset);
+
+                break;
+            }
+
+            case kLogicMovRegisterToRegister:
+            {
+                if (state.reg != kDwarfRegRsp || !IsMovRspToRbp(instruction))
+                {
+                    break;
+                }
+
+                state.reg = kDwarfRegRbp;
+
+                AdvanceCfaLocation(eh_frame, &cur_location, next_address);
+
+                WriteDebugByte(eh_frame, kDwCfaDefCfaRegister);
+                WriteUleb128  (eh_frame, kDwarfRegRbp);
+
+                break;
+            }
+
+            case kLogicLeave:
+            {
+                saved_state = state;
+                state       = {kDwarfRegRsp, kSizeOfArg};
+
+                is_in_epilogue = true;
+
+                AdvanceCfaLocation(eh_frame, &cur_location, next_address);
+
+                WriteDebugByte(eh_frame, kDwCfaRememberState);
+                WriteDebugByte(eh_frame, kDwCfaDefCfa);
+                WriteUleb128  (eh_frame, kDwarfRegRsp);
+                WriteUleb128  (eh_frame, kSizeOfArg);
+
+                break;
+            }
+
+            case kLogicRet:
+            case kLogicJmp:
+            {
+                if (!is_in_epilogue || next_address >= end_address)
+                {
+                    break;
+                }
+
+                state = saved_state;
+
+                is_in_epilogue = false;
+
+                AdvanceCfaLocation(eh_frame, &cur_location, next_address);
+
+                WriteDebugByte(eh_frame, kDwCfaRestoreState);
+
+                break;
+            }
+
+            default:
+            {
+                break;
+            }
+        }
+    }
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+static BackendErrs_t AdvanceCfaLocation(DebugBuffer *eh_frame,
+                                        size_t      *cur_location,
+                                        size_t       new_location)
+{
+    CHECK(eh_frame);
+    CHECK(cur_location);
+
+    size_t delta = new_location - *cur_location;
+
+    if (delta == 0)
+    {
+        return kBackendSuccess;
+    }
+
+    if (delta <= kDwCfaMaxShortAdvance)
+    {
+        WriteDebugByte(eh_frame, (uint8_t) (kDwCfaAdvanceLoc | delta));
+    }
+    else if (delta <= UINT8_MAX)
+    {
+        uint8_t short_delta = (uint8_t) delta;
+
+        WriteDebugByte(eh_frame, kDwCfaAdvanceLoc1);
+        WriteDebugData(eh_frame, &short_delta, sizeof(short_delta));
+    }
+    else if (delta <= UINT16_MAX)
+    {
+        uint16_t short_delta = (uint16_t) delta;
+
+        WriteDebugByte(eh_frame, kDwCfaAdvanceLoc2);
+        WriteDebugData(eh_frame, &short_delta, sizeof(short_delta));
+    }
+    else
+    {
+        uint32_t long_delta = (uint32_t) delta;
+
+        WriteDebugByte(eh_frame, kDwCfaAdvanceLoc4);
+        WriteDebugData(eh_frame, &long_delta, sizeof(long_delta));
+    }
+
+    *cur_location = new_location;
+
+    return kBackendSuccess;
+}
+
+//==============================================================================
+
+// Pads the record with nops to the address size and patches its length
+static BackendErrs_t FinishEhFrameRecord(DebugBuffer *eh_frame,
+                                         size_t       record_pos)
+{
+    CHECK(eh_frame);
+
+    while ((eh_frame->size - record_pos) % kEhFrameAlignment != 0)
+    {
+        WriteDebugByte(eh_frame, kDwCfaNop);
+    }
+
+    return PatchDebugWord(eh_frame, record_pos, (uint32_t) (eh_frame->size - record_pos - sizeof(uint32_t)));
+}
+
+//==============================================================================
+
+static bool IsPushRbp(const Instruction *instruction)
+{
+    CHECK(instruction);
+
+    return instruction->logical_op_code == kLogicPushRegister  &&
+           instruction->op_code         == kPushR64 + kRBP      &&
+           (instruction->rex_prefix & kModRmExtension) == 0;
+}
+
+//==============================================================================
+
+static bool IsMovRspToRbp(const Instruction *instruction)
+{
+    CHECK(instruction);
+
+    return instruction->mod_rm == (kRegister | (kRSP << 3) | kRBP) &&
+           (instruction->rex_prefix & (kRegisterExtension | kModRmExtension)) == 0;
+}
+
+//==============================================================================
+
+static bool IsRspDestination(const Instruction *instruction)
+{
+    CHECK(instruction);
+
+    return (instruction->mod_rm & kModRmWithoutSrcMask) == (kRegister | kRSP) &&
+           (instruction->rex_prefix & kModRmExtension) == 0;
+}
+
+//==============================================================================
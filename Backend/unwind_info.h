@@ -0,0 +1,49 @@
+#ifndef UNWIND_INFO_HEADER
+#define UNWIND_INFO_HEADER
+
+#include "backend.h"
+#include "debug_info.h"
+
+static const uint8_t  kEhFrameVersion          = 1;
+static const char    *kEhFrameAugmentation     = "zR";
+
+static const uint8_t  kDwEhPeSdata4            = 0x0b;
+static const uint8_t  kDwEhPePcrel             = 0x10;
+
+static const uint8_t  kDwCfaNop                = 0x00;
+static const uint8_t  kDwCfaAdvanceLoc1        = 0x02;
+static const uint8_t  kDwCfaAdvanceLoc2        = 0x03;
+static const uint8_t  kDwCfaAdvanceLoc4        = 0x04;
+static const uint8_t  kDwCfaRememberState      = 0x0a;
+static const uint8_t  kDwCfaRestoreState       = 0x0b;
+static const uint8_t  kDwCfaDefCfa             = 0x0c;
+static const uint8_t  kDwCfaDefCfaRegister     = 0x0d;
+static const uint8_t  kDwCfaDefCfaOffset       = 0x0e;
+static const uint8_t  kDwCfaAdvanceLoc         = 0x40;
+static const uint8_t  kDwCfaOffset             = 0x80;
+
+static const uint8_t  kDwCfaMaxShortAdvance    = 0x3f;
+
+// DWARF numbers of the registers CFI talks about, they differ from the
+// instruction encoding
+static const uint8_t  kDwarfRegRbp             = 6;
+static const uint8_t  kDwarfRegRsp             = 7;
+static const uint8_t  kDwarfRegReturnAddress   = 16;
+
+static const int64_t  kCfaDataAlignment        = -8;
+static const size_t   kEhFrameAlignment        = 8;
+
+// .eh_frame contents and the relocations of the FDE start addresses
+struct UnwindSection
+{
+    DebugBuffer     eh_frame;
+
+    RelocationTable relocations;
+};
+
+BackendErrs_t BuildUnwindSection(BackendContext *backend_context,
+                                 UnwindSection  *section);
+
+BackendErrs_t DestroyUnwindSection(UnwindSection *section);
+
+#endif
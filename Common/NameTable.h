@@ -82,6 +82,7 @@ static const KeyWord NameTable[]=
 
 static const size_t kPrintPos = 30;
 static const size_t kScanPos  = 31;
+static const size_t kAbortPos = 32;
 static const size_t kCosPos   = 5;
 static const size_t kSinPos   = 4;
 static const size_t kSqrtPos  = 8;
@@ -29,6 +29,14 @@ static TreeErrs_t PrintTree(const TreeNode *root,
                             Identifiers *identifiers,
                             FILE           *output_file);
 
+static TreeErrs_t PrintTreeLines(const TreeNode *root,
+                                 FILE           *output_file);
+
+static size_t GetNodeLine(const TreeNode *node);
+
+static TreeErrs_t ReadTreeLines(TreeNode *root,
+                                FILE     *input_file);
+
 static TreeErrs_t ReallocVarArray(Identifiers *identifiers,
                                   size_t          new_size);
 
@@ -136,7 +144,7 @@ TableOfNames *AddTableOfNames(NameTables *tables,
 {
     if (tables->tables_count >= tables->capacity)
     {
-        ReallocNameTables(tables, tables->capacity * 2);
+        ReallocNameTables(tables, tables->capacity == 0 ? kBaseTablesCount : tables->capacity * 2);
     }
 
     tables->name_tables[tables->tables_count] = (TableOfNames *) calloc(1, sizeof(TableOfNames));
@@ -204,7 +212,7 @@ int AddName(TableOfNames *table,
 {
     if (table->name_count >= table->capacity)
     {
-        ReallocTableOfNames(table, table->capacity * 2);
+        ReallocTableOfNames(table, table->capacity == 0 ? kBaseNamesCount : table->capacity * 2);
     }
 
     table->names[table->name_count].pos  = id;
@@ -254,7 +262,7 @@ int AddIdentifier(Identifiers *identifiers, char *var_name)
 {
     if (identifiers->identifier_count >= identifiers->size)
     {
-        ReallocVarArray(identifiers, identifiers->size * 2);
+        ReallocVarArray(identifiers, identifiers->size == 0 ? kBaseVarCount : identifiers->size * 2);
     }
 
     identifiers->identifier_array[identifiers->identifier_count].id                = var_name;
@@ -571,6 +579,161 @@ TreeErrs_t PrintTreeInFile(LanguageContext *language_context,
 
 //==============================================================================
 
+// The tree file has no place for line numbers, so they go to a separate
+// file: the source file path on the first line, then the line of every
+// node in the same order PrintTree() writes the nodes.
+TreeErrs_t PrintTreeLinesInFile(LanguageContext *language_context,
+                                const char      *source_file_name,
+                                const char      *file_name)
+{
+    CHECK(language_context);
+    CHECK(source_file_name);
+    CHECK(file_name);
+
+    FILE *output_file = fopen(file_name, "wb");
+
+    if (output_file == nullptr)
+    {
+        return kFailedToOpenFile;
+    }
+
+    char *source_path = realpath(source_file_name, nullptr);
+
+    fprintf(output_file, "%s\n", source_path != nullptr ? source_path : source_file_name);
+
+    free(source_path);
+
+    PrintTreeLines(language_context->syntax_tree.root, output_file);
+
+    fprintf(output_file, "\n");
+
+    fclose(output_file);
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+static TreeErrs_t PrintTreeLines(const TreeNode *root,
+                                 FILE           *output_file)
+{
+    CHECK(output_file);
+
+    if (root == nullptr)
+    {
+        return kTreeSuccess;
+    }
+
+    fprintf(output_file, "%lu ", GetNodeLine(root));
+
+    PrintTreeLines(root->left,  output_file);
+    PrintTreeLines(root->right, output_file);
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+// Nodes built by the parser rather than taken from the lexer have no line,
+// they get the line of their first token.
+static size_t GetNodeLine(const TreeNode *node)
+{
+    if (node == nullptr)
+    {
+        return 0;
+    }
+
+    if (node->line_number != 0)
+    {
+        return node->line_number;
+    }
+
+    size_t line_number = GetNodeLine(node->left);
+
+    return line_number != 0 ? line_number : GetNodeLine(node->right);
+}
+
+//==============================================================================
+
+TreeErrs_t ReadTreeLinesOutOfFile(LanguageContext  *language_context,
+                                  const char       *file_name,
+                                  char            **source_file_name)
+{
+    CHECK(language_context);
+    CHECK(file_name);
+    CHECK(source_file_name);
+
+    FILE *input_file = fopen(file_name, "rb");
+
+    if (input_file == nullptr)
+    {
+        return kFailedToOpenFile;
+    }
+
+    char   *source_path      = nullptr;
+    size_t  source_path_size = 0;
+
+    ssize_t source_path_length = getline(&source_path, &source_path_size, input_file);
+
+    if (source_path_length <= 0)
+    {
+        free(source_path);
+
+        fclose(input_file);
+
+        return kFailedToReadText;
+    }
+
+    if (source_path[source_path_length - 1] == '\n')
+    {
+        source_path[source_path_length - 1] = '\0';
+    }
+
+    TreeErrs_t error = ReadTreeLines(language_context->syntax_tree.root, input_file);
+
+    fclose(input_file);
+
+    if (error != kTreeSuccess)
+    {
+        free(source_path);
+
+        return error;
+    }
+
+    *source_file_name = source_path;
+
+    return kTreeSuccess;
+}
+
+//==============================================================================
+
+static TreeErrs_t ReadTreeLines(TreeNode *root,
+                                FILE     *input_file)
+{
+    CHECK(input_file);
+
+    if (root == nullptr)
+    {
+        return kTreeSuccess;
+    }
+
+    if (fscanf(input_file, "%lu", &root->line_number) != 1)
+    {
+        return kFailedToReadText;
+    }
+
+    TreeErrs_t error = ReadTreeLines(root->left, input_file);
+
+    if (error != kTreeSuccess)
+    {
+        return error;
+    }
+
+    return ReadTreeLines(root->right, input_file);
+}
+
+//==============================================================================
+
 TreeErrs_t ReadLanguageContextOutOfFile(LanguageContext *language_context,
                                         const char      *tree_file_name,
                                         const char      *tables_file_name)
@@ -637,8 +800,12 @@ static int ReadNameTablesOutOfFile(LanguageContext *language_context,
 
     language_context->identifiers.identifier_count = atoi(CUR_TOKEN);
 
+    free(language_context->identifiers.identifier_array);
+
     language_context->identifiers.identifier_array = (Identifier *) calloc(language_context->identifiers.identifier_count, sizeof(Identifier));
 
+    language_context->identifiers.size = language_context->identifiers.identifier_count;
+
     GO_TO_NEXT_TOKEN;
 
     for (size_t j = 0; j < language_context->identifiers.identifier_count; j++)
@@ -648,7 +815,10 @@ static int ReadNameTablesOutOfFile(LanguageContext *language_context,
         GO_TO_NEXT_TOKEN;
     }
 
+    free(language_context->tables.name_tables);
+
     language_context->tables.tables_count = atoi(CUR_TOKEN);
+    language_context->tables.capacity     = language_context->tables.tables_count;
     language_context->tables.name_tables  = (TableOfNames **) calloc(language_context->tables.tables_count, sizeof(TableOfNames *));
 
     GO_TO_NEXT_TOKEN;
@@ -186,10 +186,18 @@ TreeErrs_t TreeDtor(TreeNode *root);
 TreeErrs_t PrintTreeInFile(LanguageContext *language_context,
                            const char      *file_name);
 
+TreeErrs_t PrintTreeLinesInFile(LanguageContext *language_context,
+                                const char      *source_file_name,
+                                const char      *file_name);
+
 TreeErrs_t ReadLanguageContextOutOfFile(LanguageContext *language_context,
                                         const char      *tree_file_name,
                                         const char      *tables_file);
 
+TreeErrs_t ReadTreeLinesOutOfFile(LanguageContext  *language_context,
+                                  const char       *file_name,
+                                  char            **source_file_name);
+
 TreeNode *CopyNode(const TreeNode *src_node);
 
 TreeErrs_t SetParents(TreeNode *parent_node);
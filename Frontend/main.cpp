@@ -1,8 +1,13 @@
 #include <stdio.h>
+#include <string.h>
 
 #include "parse.h"
 #include "../Common/trees.h"
 #include "../Common/tree_dump.h"
+#include "../debug/time_passes.h"
+
+static const char *kTimePassesFlag     = "--time-passes";
+static const char *kTimePassesJsonFlag = "--time-passes-json";
 
 int main(int argc, char *argv[])
 {
@@ -18,23 +23,63 @@ int main(int argc, char *argv[])
         return 0;
     }
 
+    PassTimingOptions timing_options = {};
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], kTimePassesFlag) == 0)
+        {
+            timing_options.is_table = true;
+
+            EnablePassTiming();
+        }
+        else if (strcmp(argv[i], kTimePassesJsonFlag) == 0 && i + 1 < argc)
+        {
+            timing_options.json_file_name = argv[++i];
+
+            EnablePassTiming();
+        }
+    }
+
+    BeginPass("front");
+
     language_context.syntax_tree.root = GetSyntaxTree(&language_context.identifiers, argv[1]);
 
+    BeginPass("graph dump");
+
     GRAPH_DUMP_TREE(&language_context.syntax_tree);
 
     EndTreeGraphDump();
 
-    if (PrintTreeInFile(&language_context, "tree_save.txt") != kTreeSuccess || language_context.syntax_tree.root == nullptr)
+    EndPass();
+
+    BeginPass("write tree");
+
+    TreeErrs_t print_error = PrintTreeInFile(&language_context, "tree_save.txt");
+
+    EndPass();
+
+    if (print_error != kTreeSuccess || language_context.syntax_tree.root == nullptr)
     {
         printf(">> Иди нахуй, чел... У нас так не базарят.\n");
 
         LanguageContextDtor(&language_context);
 
+        ReportPassTimes(&timing_options, "front");
+
         return -1;
     }
 
+    BeginPass("write line table");
+
+    PrintTreeLinesInFile(&language_context, argv[1], "tree_lines.txt");
+
+    EndPass();
+
     LanguageContextDtor(&language_context);
 
+    ReportPassTimes(&timing_options, "front");
+
     printf(">> Так уж и быть, скомпилю тебе это дерьмо: \"%s\".\n", argv[1]);
 
     return 0;
@@ -7,6 +7,7 @@
 #include "../Common/trees.h"
 #include "../Stack/stack.h"
 #include "../debug/debug.h"
+#include "../debug/time_passes.h"
 
 static const int kExternalTableCode = -1;
 
@@ -102,14 +103,24 @@ TreeNode *GetSyntaxTree(Identifiers  *identifiers,
 
     Text              program;
 
+    BeginPass("read source");
+
     //error
     ReadTextFromFile(&program, file_name);
 
+    EndPass();
+
     BeginStackDump();
     Stack      lexems;
     StackInit(&lexems);
 
-    if ((SplitOnLexems(&program, &lexems, identifiers) != kLexerSuccess) || lexems.stack_data.size == 0)
+    BeginPass("lexer");
+
+    LexerErrs_t lexer_error = SplitOnLexems(&program, &lexems, identifiers);
+
+    EndPass();
+
+    if (lexer_error != kLexerSuccess || lexems.stack_data.size == 0)
     {
         TextDtor(&program);
         StackDtor(&lexems);
@@ -132,11 +143,21 @@ TreeNode *GetSyntaxTree(Identifiers  *identifiers,
 
     size_t i = 0;
 
+    BeginPass("parser");
+
     TreeNode *node = GetExternalDecl(identifiers, &lexems, &tables, external_table, &i);
 
+    EndPass();
+
     TABLES_DUMP(&tables);
 
-    if (PrintNameTableInFile(identifiers ,&tables) < 0)
+    BeginPass("write name table");
+
+    int name_table_error = PrintNameTableInFile(identifiers ,&tables);
+
+    EndPass();
+
+    if (name_table_error < 0)
     {
         return nullptr;
     }
@@ -0,0 +1,152 @@
+#!/bin/bash
+# Compile-time benchmark: sweeps one generator axis at a time and reports
+# the throughput of every front and back phase.
+#
+# usage: Generator/bench.sh [functions|statements|depth|identifiers|branches ...]
+#
+# Front phases are measured in tokens/s, back phases in tree nodes/s.
+# The last column is the throughput relative to the smallest size of the
+# sweep: it stays near 1.00 for linear phases and falls for quadratic ones.
+#
+# Sizes can be set from the environment: BENCH_<AXIS> overrides the value
+# the other sweeps use for that axis and BENCH_<AXIS>_SWEEP the values it is
+# swept over, e.g. BENCH_FUNCTIONS_SWEEP="16 64 256". Every program is
+# compiled BENCH_RUNS times (3 by default) and the fastest run of each
+# phase is kept, so short phases are not dominated by scheduler noise.
+
+set -u
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+
+# the front lexer is super-linear, so the defaults stop at a few thousand
+# tokens to keep a full run within minutes
+declare -A BASE=([functions]=8 [statements]=16 [depth]=1 [identifiers]=4 [branches]=20)
+
+declare -A SWEEP=([functions]="2 8 32"
+                  [statements]="4 16 64"
+                  [depth]="0 2 4"
+                  [identifiers]="2 8 32 128"
+                  [branches]="0 25 50 75")
+
+for option in "${!BASE[@]}"; do
+    name=BENCH_${option^^}
+
+    BASE[$option]=${!name:-${BASE[$option]}}
+
+    name=${name}_SWEEP
+
+    SWEEP[$option]=${!name:-${SWEEP[$option]}}
+done
+
+RUNS=${BENCH_RUNS:-3}
+
+AXES=("$@")
+
+if [ ${#AXES[@]} -eq 0 ]; then
+    AXES=(functions statements depth identifiers branches)
+fi
+
+for axis in "${AXES[@]}"; do
+    if [ -z "${SWEEP[$axis]+x}" ]; then
+        echo "unknown axis \"$axis\", expected one of: ${!SWEEP[*]}" >&2
+        exit 1
+    fi
+done
+
+(cd "$ROOT" && make -s -f MakeFrontend && make -s -f MakeBackend && make -s -f MakeGenerator) >/dev/null 2>&1 || {
+    echo "build failed, run make front back gen" >&2
+    exit 1
+}
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+# prints "tool phase wall_ms" for every pass of a --time-passes-json report
+read_passes() {
+    sed -n 's/.*"name": "\([^"]*\)", "depth": \([0-9]*\), "wall_ms": \([0-9.]*\).*/\2|\1|\3/p' "$1" |
+    awk -F'|' -v tool="$2" '{ printf "%s|%s%s|%s\n", tool, substr("        ", 1, $1 * 2), $2, $3 }'
+}
+
+for axis in "${AXES[@]}"; do
+    for value in ${SWEEP[$axis]}; do
+        args=()
+
+        for option in functions statements depth identifiers branches; do
+            if [ "$option" = "$axis" ]; then
+                args+=("--$option" "$value")
+            else
+                args+=("--$option" "${BASE[$option]}")
+            fi
+        done
+
+        tokens=$("$ROOT/gen" "${args[@]}" -o program.dota 2>&1 >/dev/null | sed -n 's/^tokens //p')
+
+        : > runs.txt
+
+        for ((run = 0; run < RUNS; run++)); do
+            rm -f tree_save.txt id_table.txt front.json back.json
+
+            "$ROOT/front" program.dota --time-passes-json front.json >/dev/null 2>&1
+            "$ROOT/back" tree_save.txt id_table.txt program.o --time-passes-json back.json >/dev/null 2>&1
+
+            if [ ! -s front.json ] || [ ! -s back.json ]; then
+                echo "$axis=$value: compilation failed, program kept in $WORK" >&2
+                trap - EXIT
+                exit 1
+            fi
+
+            { read_passes front.json front; read_passes back.json back; } >> runs.txt
+        done
+
+        # every node of the saved tree opens with a bracket
+        nodes=$(tr -cd '(' < tree_save.txt | wc -c)
+
+        # keeps the fastest run of every phase, in the order of the first run
+        awk -F'|' '
+            {
+                key = $1 "|" $2
+
+                if (!(key in best)) {
+                    order[count++] = key
+                    best[key] = $3
+                } else if ($3 < best[key]) {
+                    best[key] = $3
+                }
+            }
+            END {
+                for (i = 0; i < count; i++) {
+                    print order[i] "|" best[order[i]]
+                }
+            }' runs.txt |
+        while IFS='|' read -r tool phase wall_ms; do
+            echo "$axis|$value|$tokens|$nodes|$tool|$phase|$wall_ms"
+        done
+    done
+done |
+awk -F'|' '
+    BEGIN {
+        printf "%-12s %6s %8s %8s %-5s %-24s %12s %16s %8s\n",
+               "axis", "value", "tokens", "nodes", "tool", "phase", "wall, ms", "throughput", "scaling"
+    }
+    {
+        size = $5 == "front" ? $3 : $4
+        unit = $5 == "front" ? "tok/s" : "nod/s"
+        key  = $1 "|" $5 "|" $6
+
+        # phases below the timer resolution have no meaningful rate
+        if ($7 <= 0) {
+            printf "%-12s %6s %8s %8s %-5s %-24s %12.3f %16s %8s\n",
+                   $1, $2, $3, $4, $5, $6, $7, "-", "-"
+            next
+        }
+
+        rate = size / ($7 / 1000)
+
+        if (!(key in first_rate)) {
+            first_rate[key] = rate
+        }
+
+        printf "%-12s %6s %8s %8s %-5s %-24s %12.3f %10.0f %s %8.2f\n",
+               $1, $2, $3, $4, $5, $6, $7, rate, unit, rate / first_rate[key]
+    }'
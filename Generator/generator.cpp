@@ -0,0 +1,557 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "generator.h"
+#include "../Common/NameTable.h"
+
+static const char *kFunctionPrefix = "герой";
+static const char *kVariablePrefix = "крип";
+static const char *kCounterPrefix  = "волна";
+
+static const size_t kIndentWidth = 4;
+
+static const size_t kLeafConstantPercent = 30;
+
+static const KeyCode_t kArithmeticOps[] = {kAdd, kSub, kMult, kDiv};
+
+static const KeyCode_t kComparisonOps[] = {kLess, kMore, kEqual, kNotEqual, kLessOrEqual, kMoreOrEqual};
+
+struct Generator
+{
+    const GeneratorOptions *options;
+
+    FILE     *output_file;
+
+    uint64_t  random_state;
+    size_t    token_count;
+
+    size_t    function_index;
+    size_t    counter_count;
+    size_t    nesting;
+
+    bool      is_line_start;
+};
+
+static void GenerateFunction(Generator *generator, size_t function_index);
+
+static void GenerateMainFunction(Generator *generator);
+
+static void GenerateLocals(Generator *generator, size_t first_local);
+
+static void GenerateStatements(Generator *generator, size_t statement_count);
+
+static void GenerateBlock(Generator *generator, size_t statement_count);
+
+static void GenerateAssignment(Generator *generator);
+
+static void GenerateCondition(Generator *generator);
+
+static void GenerateExpression(Generator *generator, size_t depth);
+
+static void GenerateOperand(Generator *generator, size_t depth);
+
+static void GenerateLeaf(Generator *generator);
+
+static void GenerateChainCall(Generator *generator, size_t callee_index);
+
+static void EmitKeyword(Generator *generator, KeyCode_t code);
+
+static void EmitFunctionName(Generator *generator, size_t function_index);
+
+static void EmitVariable(Generator *generator, size_t variable_index);
+
+static void EmitCounter(Generator *generator, size_t counter_index);
+
+static void EmitNumber(Generator *generator, size_t number);
+
+static void EmitToken(Generator *generator, const char *token);
+
+static void EndLine(Generator *generator);
+
+static const char *FindKeyword(KeyCode_t code);
+
+static size_t GetRandom(Generator *generator, size_t bound);
+
+//==============================================================================
+
+GeneratorErrs_t VerifyGeneratorOptions(const GeneratorOptions *options)
+{
+    if (options->identifier_count < kParamsCount)
+    {
+        fprintf(stderr, "%s() need at least %zu identifiers per function\n", __func__, kParamsCount);
+
+        return kGeneratorBadOptions;
+    }
+
+    if (options->branch_percent > 100)
+    {
+        fprintf(stderr, "%s() branch density is a percentage\n", __func__);
+
+        return kGeneratorBadOptions;
+    }
+
+    return kGeneratorSuccess;
+}
+
+//==============================================================================
+
+GeneratorErrs_t GenerateProgram(const GeneratorOptions *options,
+                                FILE                   *output_file,
+                                size_t                 *token_count)
+{
+    GeneratorErrs_t error = VerifyGeneratorOptions(options);
+
+    if (error != kGeneratorSuccess)
+    {
+        return error;
+    }
+
+    // xorshift gets stuck on a zero state
+    Generator generator = {options, output_file, options->seed ^ 0x9e3779b97f4a7c15, 0, 0, 0, 0, true};
+
+    fprintf(output_file, "# %s %zu %s %zu %s %zu %s %zu %s %zu %s %llu\n",
+                         kFunctionsFlag,   options->function_count,
+                         kStatementsFlag,  options->statement_count,
+                         kDepthFlag,       options->expression_depth,
+                         kIdentifiersFlag, options->identifier_count,
+                         kBranchesFlag,    options->branch_percent,
+                         kSeedFlag,        (unsigned long long) options->seed);
+
+    GenerateMainFunction(&generator);
+
+    for (size_t i = 0; i < options->function_count; i++)
+    {
+        GenerateFunction(&generator, i);
+    }
+
+    *token_count = generator.token_count;
+
+    return ferror(output_file) ? kGeneratorFailedToWrite : kGeneratorSuccess;
+}
+
+//==============================================================================
+
+static void GenerateMainFunction(Generator *generator)
+{
+    // the main function gets the index after the last ordinary one
+    generator->function_index = generator->options->function_count;
+    generator->counter_count  = 0;
+
+    EmitKeyword(generator, kDoubleType);
+    EmitToken  (generator, kMainFuncName);
+    EmitKeyword(generator, kLeftBracket);
+    EmitKeyword(generator, kRightBracket);
+    EndLine    (generator);
+
+    EmitKeyword(generator, kLeftZoneBracket);
+    EndLine    (generator);
+
+    generator->nesting++;
+
+    GenerateLocals    (generator, 0);
+    GenerateStatements(generator, generator->options->statement_count);
+
+    EmitKeyword(generator, kPrint);
+    EmitKeyword(generator, kLeftBracket);
+    EmitVariable(generator, 0);
+
+    if (generator->options->function_count > 0)
+    {
+        EmitKeyword(generator, kAdd);
+        GenerateChainCall(generator, 0);
+    }
+
+    EmitKeyword(generator, kRightBracket);
+    EmitKeyword(generator, kEndOfLine);
+    EndLine    (generator);
+
+    EmitKeyword(generator, kReturn);
+    EmitKeyword(generator, kLeftBracket);
+    EmitNumber (generator, 0);
+    EmitKeyword(generator, kRightBracket);
+    EmitKeyword(generator, kEndOfLine);
+    EndLine    (generator);
+
+    generator->nesting--;
+
+    EmitKeyword(generator, kRightZoneBracket);
+    EndLine    (generator);
+}
+
+//==============================================================================
+
+static void GenerateFunction(Generator *generator, size_t function_index)
+{
+    generator->function_index = function_index;
+    generator->counter_count  = 0;
+
+    EmitKeyword     (generator, kDoubleType);
+    EmitFunctionName(generator, function_index);
+    EmitKeyword     (generator, kLeftBracket);
+
+    for (size_t i = 0; i < kParamsCount; i++)
+    {
+        if (i > 0)
+        {
+            EmitKeyword(generator, kEnumOp);
+        }
+
+        EmitKeyword (generator, kDoubleType);
+        EmitVariable(generator, i);
+    }
+
+    EmitKeyword(generator, kRightBracket);
+    EndLine    (generator);
+
+    EmitKeyword(generator, kLeftZoneBracket);
+    EndLine    (generator);
+
+    generator->nesting++;
+
+    GenerateLocals    (generator, kParamsCount);
+    GenerateStatements(generator, generator->options->statement_count);
+
+    // every function calls the next one, so none of them is dead code
+    // and the call graph stays acyclic
+    if (function_index + 1 < generator->options->function_count)
+    {
+        EmitVariable(generator, 0);
+        EmitKeyword (generator, kAssign);
+        EmitVariable(generator, 0);
+        EmitKeyword (generator, kAdd);
+
+        GenerateChainCall(generator, function_index + 1);
+
+        EmitKeyword(generator, kEndOfLine);
+        EndLine    (generator);
+    }
+
+    EmitKeyword (generator, kReturn);
+    EmitKeyword (generator, kLeftBracket);
+    EmitVariable(generator, 0);
+    EmitKeyword (generator, kRightBracket);
+    EmitKeyword (generator, kEndOfLine);
+    EndLine     (generator);
+
+    generator->nesting--;
+
+    EmitKeyword(generator, kRightZoneBracket);
+    EndLine    (generator);
+}
+
+//==============================================================================
+
+static void GenerateLocals(Generator *generator, size_t first_local)
+{
+    for (size_t i = first_local; i < generator->options->identifier_count; i++)
+    {
+        EmitKeyword (generator, kDoubleType);
+        EmitVariable(generator, i);
+        EmitKeyword (generator, kAssign);
+        EmitNumber  (generator, 1 + GetRandom(generator, kMaxConstant - 1));
+        EmitKeyword (generator, kEndOfLine);
+        EndLine     (generator);
+    }
+}
+
+//==============================================================================
+
+static void GenerateStatements(Generator *generator, size_t statement_count)
+{
+    while (statement_count > 0)
+    {
+        statement_count--;
+
+        if (generator->nesting <= kMaxBlockNesting && statement_count > 0 &&
+            GetRandom(generator, 100) < generator->options->branch_percent)
+        {
+            size_t max_body = statement_count < kMaxBlockStatements ? statement_count : kMaxBlockStatements;
+            size_t body     = 1 + GetRandom(generator, max_body);
+
+            statement_count -= body;
+
+            GenerateBlock(generator, body);
+        }
+        else
+        {
+            GenerateAssignment(generator);
+        }
+    }
+}
+
+//==============================================================================
+
+static void GenerateBlock(Generator *generator, size_t statement_count)
+{
+    bool   is_loop = GetRandom(generator, 100) < kLoopPercent;
+    size_t counter = generator->counter_count;
+
+    if (is_loop)
+    {
+        generator->counter_count++;
+
+        EmitKeyword(generator, kDoubleType);
+        EmitCounter(generator, counter);
+        EmitKeyword(generator, kAssign);
+        EmitNumber (generator, 0);
+        EmitKeyword(generator, kEndOfLine);
+        EndLine    (generator);
+
+        EmitKeyword(generator, kWhile);
+        EmitKeyword(generator, kLeftBracket);
+        EmitCounter(generator, counter);
+        EmitKeyword(generator, kLess);
+        EmitNumber (generator, kLoopIterations);
+        EmitKeyword(generator, kRightBracket);
+    }
+    else
+    {
+        EmitKeyword      (generator, kIf);
+        EmitKeyword      (generator, kLeftBracket);
+        GenerateCondition(generator);
+        EmitKeyword      (generator, kRightBracket);
+    }
+
+    EndLine    (generator);
+    EmitKeyword(generator, kLeftZoneBracket);
+    EndLine    (generator);
+
+    generator->nesting++;
+
+    GenerateStatements(generator, statement_count);
+
+    if (is_loop)
+    {
+        EmitCounter(generator, counter);
+        EmitKeyword(generator, kAssign);
+        EmitCounter(generator, counter);
+        EmitKeyword(generator, kAdd);
+        EmitNumber (generator, 1);
+        EmitKeyword(generator, kEndOfLine);
+        EndLine    (generator);
+    }
+
+    generator->nesting--;
+
+    EmitKeyword(generator, kRightZoneBracket);
+    EndLine    (generator);
+}
+
+//==============================================================================
+
+static void GenerateAssignment(Generator *generator)
+{
+    EmitVariable(generator, GetRandom(generator, generator->options->identifier_count));
+    EmitKeyword (generator, kAssign);
+
+    GenerateExpression(generator, generator->options->expression_depth);
+
+    EmitKeyword(generator, kEndOfLine);
+    EndLine    (generator);
+}
+
+//==============================================================================
+
+static void GenerateCondition(Generator *generator)
+{
+    size_t depth = generator->options->expression_depth;
+
+    // comparisons share the priority of + and -, so both sides are bracketed
+    EmitKeyword       (generator, kLeftBracket);
+    GenerateExpression(generator, depth);
+    EmitKeyword       (generator, kRightBracket);
+
+    EmitKeyword(generator, kComparisonOps[GetRandom(generator, sizeof(kComparisonOps) / sizeof(KeyCode_t))]);
+
+    EmitKeyword       (generator, kLeftBracket);
+    GenerateExpression(generator, depth);
+    EmitKeyword       (generator, kRightBracket);
+}
+
+//==============================================================================
+
+static void GenerateExpression(Generator *generator, size_t depth)
+{
+    if (depth == 0)
+    {
+        GenerateLeaf(generator);
+
+        return;
+    }
+
+    KeyCode_t op = kArithmeticOps[GetRandom(generator, sizeof(kArithmeticOps) / sizeof(KeyCode_t))];
+
+    GenerateOperand(generator, depth - 1);
+
+    EmitKeyword(generator, op);
+
+    // a constant divisor keeps generated programs runnable
+    if (op == kDiv)
+    {
+        EmitNumber(generator, 1 + GetRandom(generator, kMaxConstant - 1));
+    }
+    else
+    {
+        GenerateOperand(generator, depth - 1);
+    }
+}
+
+//==============================================================================
+
+static void GenerateOperand(Generator *generator, size_t depth)
+{
+    if (depth == 0)
+    {
+        GenerateLeaf(generator);
+
+        return;
+    }
+
+    EmitKeyword       (generator, kLeftBracket);
+    GenerateExpression(generator, depth);
+    EmitKeyword       (generator, kRightBracket);
+}
+
+//==============================================================================
+
+static void GenerateLeaf(Generator *generator)
+{
+    if (GetRandom(generator, 100) < kLeafConstantPercent)
+    {
+        EmitNumber(generator, GetRandom(generator, kMaxConstant));
+    }
+    else
+    {
+        EmitVariable(generator, GetRandom(generator, generator->options->identifier_count));
+    }
+}
+
+//==============================================================================
+
+static void GenerateChainCall(Generator *generator, size_t callee_index)
+{
+    EmitFunctionName(generator, callee_index);
+    EmitKeyword     (generator, kLeftBracket);
+
+    for (size_t i = 0; i < kParamsCount; i++)
+    {
+        if (i > 0)
+        {
+            EmitKeyword(generator, kEnumOp);
+        }
+
+        EmitVariable(generator, i);
+    }
+
+    EmitKeyword(generator, kRightBracket);
+}
+
+//==============================================================================
+
+static void EmitKeyword(Generator *generator, KeyCode_t code)
+{
+    EmitToken(generator, FindKeyword(code));
+}
+
+//==============================================================================
+
+static void EmitFunctionName(Generator *generator, size_t function_index)
+{
+    char name[64] = {};
+
+    snprintf(name, sizeof(name), "%s_%zu", kFunctionPrefix, function_index);
+
+    EmitToken(generator, name);
+}
+
+//==============================================================================
+
+static void EmitVariable(Generator *generator, size_t variable_index)
+{
+    char name[64] = {};
+
+    snprintf(name, sizeof(name), "%s_%zu_%zu", kVariablePrefix, generator->function_index, variable_index);
+
+    EmitToken(generator, name);
+}
+
+//==============================================================================
+
+static void EmitCounter(Generator *generator, size_t counter_index)
+{
+    char name[64] = {};
+
+    snprintf(name, sizeof(name), "%s_%zu_%zu", kCounterPrefix, generator->function_index, counter_index);
+
+    EmitToken(generator, name);
+}
+
+//==============================================================================
+
+static void EmitNumber(Generator *generator, size_t number)
+{
+    char digits[32] = {};
+
+    snprintf(digits, sizeof(digits), "%zu", number);
+
+    EmitToken(generator, digits);
+}
+
+//==============================================================================
+
+static void EmitToken(Generator *generator, const char *token)
+{
+    if (generator->is_line_start)
+    {
+        fprintf(generator->output_file, "%*s", (int) (generator->nesting * kIndentWidth), "");
+
+        generator->is_line_start = false;
+    }
+    else
+    {
+        fputc(' ', generator->output_file);
+    }
+
+    fputs(token, generator->output_file);
+
+    generator->token_count++;
+}
+
+//==============================================================================
+
+static void EndLine(Generator *generator)
+{
+    fputc('\n', generator->output_file);
+
+    generator->is_line_start = true;
+}
+
+//==============================================================================
+
+static const char *FindKeyword(KeyCode_t code)
+{
+    for (size_t i = 0; i < kKeyWordCount; i++)
+    {
+        if (NameTable[i].key_code == code)
+        {
+            return NameTable[i].key_word;
+        }
+    }
+
+    return nullptr;
+}
+
+//==============================================================================
+
+static size_t GetRandom(Generator *generator, size_t bound)
+{
+    uint64_t state = generator->random_state;
+
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    generator->random_state = state;
+
+    return bound == 0 ? 0 : (size_t) (state % bound);
+}
@@ -0,0 +1,59 @@
+#ifndef GENERATOR_HEADER
+#define GENERATOR_HEADER
+
+#include <stdio.h>
+#include <stdint.h>
+
+static const char   *kFunctionsFlag      = "--functions";
+static const char   *kStatementsFlag     = "--statements";
+static const char   *kDepthFlag          = "--depth";
+static const char   *kIdentifiersFlag    = "--identifiers";
+static const char   *kBranchesFlag       = "--branches";
+static const char   *kSeedFlag           = "--seed";
+
+// every function but the main one takes two parameters
+static const size_t  kParamsCount        = 2;
+
+static const size_t  kMaxBlockNesting    = 3;
+static const size_t  kMaxBlockStatements = 4;
+
+// loops run this many times, so nested ones stay cheap to execute
+static const size_t  kLoopIterations     = 4;
+
+// share of blocks that are loops, the rest are conditions
+static const size_t  kLoopPercent        = 25;
+
+static const size_t  kMaxConstant        = 100;
+
+typedef enum
+{
+    kGeneratorSuccess,
+    kGeneratorBadOptions,
+    kGeneratorFailedToOpenFile,
+    kGeneratorFailedToWrite,
+} GeneratorErrs_t;
+
+// Independent axes of the generated program
+struct GeneratorOptions
+{
+    size_t   function_count;   // besides the main one
+    size_t   statement_count;  // per function, block statements included
+    size_t   expression_depth; // operator levels of every expression
+    size_t   identifier_count; // variables per function, parameters included
+    size_t   branch_percent;   // chance of a statement to open a block
+
+    uint64_t seed;
+};
+
+//! Rejects options no valid program can be generated for, so callers
+//! can check them before creating the output file
+GeneratorErrs_t VerifyGeneratorOptions(const GeneratorOptions *options);
+
+//! Writes a valid DOTA program shaped by the options
+//!
+//! @param token_count number of tokens written, for throughput reports
+GeneratorErrs_t GenerateProgram(const GeneratorOptions *options,
+                                FILE                   *output_file,
+                                size_t                 *token_count);
+
+#endif
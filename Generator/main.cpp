@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "generator.h"
+
+static const char *kOutputFlag = "-o";
+
+int main(int argc, char *argv[])
+{
+    GeneratorOptions options = {};
+
+    options.function_count   = 8;
+    options.statement_count  = 16;
+    options.expression_depth = 2;
+    options.identifier_count = 4;
+    options.branch_percent   = 20;
+    options.seed             = 1;
+
+    const char *output_file_name = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            fprintf(stderr, ">> GENERATOR: flag \"%s\" needs a value\n", argv[i]);
+
+            return -1;
+        }
+
+        if (strcmp(argv[i], kFunctionsFlag) == 0)
+        {
+            options.function_count = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], kStatementsFlag) == 0)
+        {
+            options.statement_count = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], kDepthFlag) == 0)
+        {
+            options.expression_depth = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], kIdentifiersFlag) == 0)
+        {
+            options.identifier_count = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], kBranchesFlag) == 0)
+        {
+            options.branch_percent = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], kSeedFlag) == 0)
+        {
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], kOutputFlag) == 0)
+        {
+            output_file_name = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, ">> GENERATOR: unknown flag \"%s\"\n", argv[i]);
+
+            return -1;
+        }
+    }
+
+    if (VerifyGeneratorOptions(&options) != kGeneratorSuccess)
+    {
+        return -1;
+    }
+
+    FILE *output_file = output_file_name == nullptr ? stdout : fopen(output_file_name, "w");
+
+    if (output_file == nullptr)
+    {
+        fprintf(stderr, ">> GENERATOR: failed to open \"%s\"\n", output_file_name);
+
+        return -1;
+    }
+
+    size_t          token_count = 0;
+    GeneratorErrs_t error       = GenerateProgram(&options, output_file, &token_count);
+
+    if (output_file != stdout)
+    {
+        fclose(output_file);
+    }
+
+    if (error != kGeneratorSuccess)
+    {
+        return -1;
+    }
+
+    // the benchmark harness reads this line to get tokens/s
+    fprintf(stderr, "tokens %zu\n", token_count);
+
+    return 0;
+}
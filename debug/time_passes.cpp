@@ -0,0 +1,365 @@
+#include <malloc.h>
+#include <string.h>
+#include <time.h>
+
+#include "time_passes.h"
+#include "color_print.h"
+
+// The front and back link with -Wl,--wrap for these, so the calls the
+// compiler's own code makes reach the counting wrappers below and the
+// wrappers reach libc through the __real_ names. Nothing else in the
+// process is affected.
+extern "C" void *__real_malloc (size_t size);
+extern "C" void *__real_calloc (size_t count, size_t size);
+extern "C" void *__real_realloc(void *ptr, size_t size);
+extern "C" void  __real_free   (void *ptr);
+
+extern "C" void *__wrap_malloc (size_t size);
+extern "C" void *__wrap_calloc (size_t count, size_t size);
+extern "C" void *__wrap_realloc(void *ptr, size_t size);
+extern "C" void  __wrap_free   (void *ptr);
+extern "C" char *__wrap_strdup (const char *string);
+
+struct OpenPass
+{
+    size_t   index;
+
+    timespec wall_start;
+    timespec cpu_start;
+
+    int64_t  heap_start_bytes;
+    uint64_t allocations_start;
+    int64_t  parent_peak_bytes;
+};
+
+static bool     is_timing_enabled = false;
+
+// written by every thread that allocates, so only through __atomic builtins
+static uint64_t allocation_count  = 0;
+static int64_t  live_bytes        = 0;
+
+// largest live size of the wrapped allocations since the innermost open
+// pass began
+static int64_t  peak_bytes        = 0;
+
+static PassTime passes[kMaxTimedPasses] = {};
+static size_t   pass_count              = 0;
+
+static OpenPass open_passes[kMaxPassDepth] = {};
+static size_t   open_depth                 = 0;
+
+// passes that did not fit, EndPass() still has to match them
+static size_t   dropped_depth              = 0;
+
+static void CountAllocation(void *ptr);
+
+static void CountFree(void *ptr);
+
+static int64_t SampleHeapBytes();
+
+static double GetElapsedMs(const timespec *start, clockid_t clock);
+
+static bool PrintPassTimesJson(FILE *stream, const char *tool_name);
+
+static void PrintPassTimesTable(FILE *stream);
+
+//==============================================================================
+
+extern "C" void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+
+    CountAllocation(ptr);
+
+    return ptr;
+}
+
+//==============================================================================
+
+extern "C" void *__wrap_calloc(size_t count, size_t size)
+{
+    void *ptr = __real_calloc(count, size);
+
+    CountAllocation(ptr);
+
+    return ptr;
+}
+
+//==============================================================================
+
+extern "C" void *__wrap_realloc(void *ptr, size_t size)
+{
+    if (!is_timing_enabled)
+    {
+        return __real_realloc(ptr, size);
+    }
+
+    int64_t old_size = ptr != nullptr ? (int64_t) malloc_usable_size(ptr) : 0;
+
+    void *new_ptr = __real_realloc(ptr, size);
+
+    if (new_ptr != nullptr || size == 0)
+    {
+        __atomic_sub_fetch(&live_bytes, old_size, __ATOMIC_RELAXED);
+    }
+
+    CountAllocation(new_ptr);
+
+    return new_ptr;
+}
+
+//==============================================================================
+
+extern "C" void __wrap_free(void *ptr)
+{
+    CountFree(ptr);
+
+    __real_free(ptr);
+}
+
+//==============================================================================
+
+// libc would allocate the copy behind the wrappers' back and the block
+// would then be freed through them
+extern "C" char *__wrap_strdup(const char *string)
+{
+    size_t size = strlen(string) + 1;
+
+    char *copy = (char *) __wrap_malloc(size);
+
+    if (copy != nullptr)
+    {
+        memcpy(copy, string, size);
+    }
+
+    return copy;
+}
+
+//==============================================================================
+
+// counts only while timing is on, otherwise a wrapper costs one branch
+static void CountAllocation(void *ptr)
+{
+    if (!is_timing_enabled || ptr == nullptr)
+    {
+        return;
+    }
+
+    __atomic_add_fetch(&allocation_count, 1, __ATOMIC_RELAXED);
+
+    int64_t live = __atomic_add_fetch(&live_bytes, (int64_t) malloc_usable_size(ptr), __ATOMIC_RELAXED);
+    int64_t peak = __atomic_load_n(&peak_bytes, __ATOMIC_RELAXED);
+
+    while (live > peak &&
+           !__atomic_compare_exchange_n(&peak_bytes, &peak, live, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+        ;
+    }
+}
+
+//==============================================================================
+
+static void CountFree(void *ptr)
+{
+    if (!is_timing_enabled || ptr == nullptr)
+    {
+        return;
+    }
+
+    __atomic_sub_fetch(&live_bytes, (int64_t) malloc_usable_size(ptr), __ATOMIC_RELAXED);
+}
+
+//==============================================================================
+
+// bytes the allocator has handed out and not got back, mmapped chunks and
+// libc's own blocks included; libcs without mallinfo2() report nothing
+static int64_t SampleHeapBytes()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+
+    return (int64_t) (info.uordblks + info.hblkhd);
+#else
+    return 0;
+#endif
+}
+
+//==============================================================================
+
+void EnablePassTiming()
+{
+    is_timing_enabled = true;
+}
+
+//==============================================================================
+
+void BeginPass(const char *name)
+{
+    if (!is_timing_enabled)
+    {
+        return;
+    }
+
+    if (dropped_depth > 0 || open_depth == kMaxPassDepth || pass_count == kMaxTimedPasses)
+    {
+        dropped_depth++;
+
+        return;
+    }
+
+    OpenPass *open_pass = &open_passes[open_depth];
+
+    passes[pass_count] = {name, open_depth, 0, 0, 0, 0, 0};
+
+    open_pass->index = pass_count++;
+
+    // the peak is tracked per pass and merged back into the parent by EndPass()
+    open_pass->parent_peak_bytes = __atomic_exchange_n(&peak_bytes,
+                                                       __atomic_load_n(&live_bytes, __ATOMIC_RELAXED),
+                                                       __ATOMIC_RELAXED);
+
+    open_pass->heap_start_bytes  = SampleHeapBytes();
+    open_pass->allocations_start = __atomic_load_n(&allocation_count, __ATOMIC_RELAXED);
+
+    open_depth++;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &open_pass->cpu_start);
+    clock_gettime(CLOCK_MONOTONIC,          &open_pass->wall_start);
+}
+
+//==============================================================================
+
+void EndPass()
+{
+    if (!is_timing_enabled)
+    {
+        return;
+    }
+
+    if (dropped_depth > 0)
+    {
+        dropped_depth--;
+
+        return;
+    }
+
+    if (open_depth == 0)
+    {
+        ColorPrintf(kRed, "%s() no pass to end\n", __func__);
+
+        return;
+    }
+
+    OpenPass *open_pass = &open_passes[--open_depth];
+    PassTime *pass      = &passes[open_pass->index];
+
+    pass->wall_ms          = GetElapsedMs(&open_pass->wall_start, CLOCK_MONOTONIC);
+    pass->cpu_ms           = GetElapsedMs(&open_pass->cpu_start,  CLOCK_PROCESS_CPUTIME_ID);
+    pass->heap_delta_bytes = SampleHeapBytes() - open_pass->heap_start_bytes;
+    pass->allocations      = __atomic_load_n(&allocation_count, __ATOMIC_RELAXED) - open_pass->allocations_start;
+    pass->peak_bytes       = __atomic_load_n(&peak_bytes, __ATOMIC_RELAXED);
+
+    int64_t peak = pass->peak_bytes;
+
+    while (open_pass->parent_peak_bytes > peak &&
+           !__atomic_compare_exchange_n(&peak_bytes, &peak, open_pass->parent_peak_bytes, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+        ;
+    }
+}
+
+//==============================================================================
+
+static double GetElapsedMs(const timespec *start, clockid_t clock)
+{
+    timespec now = {};
+
+    clock_gettime(clock, &now);
+
+    return (double) (now.tv_sec  - start->tv_sec)  * 1e3 +
+           (double) (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+//==============================================================================
+
+void ReportPassTimes(const PassTimingOptions *options,
+                     const char              *tool_name)
+{
+    if (!is_timing_enabled)
+    {
+        return;
+    }
+
+    while (open_depth > 0 || dropped_depth > 0)
+    {
+        EndPass();
+    }
+
+    if (options->is_table)
+    {
+        PrintPassTimesTable(stderr);
+    }
+
+    if (options->json_file_name != nullptr)
+    {
+        FILE *json_file = fopen(options->json_file_name, "w");
+
+        if (json_file == nullptr || !PrintPassTimesJson(json_file, tool_name))
+        {
+            ColorPrintf(kRed, "%s() failed to write %s\n", __func__, options->json_file_name);
+        }
+
+        if (json_file != nullptr)
+        {
+            fclose(json_file);
+        }
+    }
+}
+
+//==============================================================================
+
+static void PrintPassTimesTable(FILE *stream)
+{
+    fprintf(stream, "%-32s %12s %12s %12s %12s %12s\n",
+                    "pass", "wall, ms", "cpu, ms", "allocs", "heap +, KiB", "peak, KiB");
+
+    for (size_t i = 0; i < pass_count; i++)
+    {
+        const PassTime *pass = &passes[i];
+
+        int indent = (int) (pass->depth * 2);
+
+        fprintf(stream, "%*s%-*s %12.3f %12.3f %12llu %12.1f %12.1f\n",
+                        indent, "", 32 - indent, pass->name,
+                        pass->wall_ms,
+                        pass->cpu_ms,
+                        (unsigned long long) pass->allocations,
+                        (double) pass->heap_delta_bytes / 1024,
+                        (double) pass->peak_bytes / 1024);
+    }
+}
+
+//==============================================================================
+
+static bool PrintPassTimesJson(FILE *stream, const char *tool_name)
+{
+    fprintf(stream, "{\n  \"tool\": \"%s\",\n  \"passes\": [", tool_name);
+
+    for (size_t i = 0; i < pass_count; i++)
+    {
+        const PassTime *pass = &passes[i];
+
+        fprintf(stream, "%s\n    {\"name\": \"%s\", \"depth\": %zu, \"wall_ms\": %.3f, \"cpu_ms\": %.3f, "
+                        "\"allocations\": %llu, \"heap_delta_bytes\": %lld, \"peak_bytes\": %lld}",
+                        i == 0 ? "" : ",",
+                        pass->name, pass->depth, pass->wall_ms, pass->cpu_ms,
+                        (unsigned long long) pass->allocations,
+                        (long long) pass->heap_delta_bytes,
+                        (long long) pass->peak_bytes);
+    }
+
+    fprintf(stream, "\n  ]\n}\n");
+
+    return ferror(stream) == 0;
+}
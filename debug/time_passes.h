@@ -0,0 +1,50 @@
+#ifndef TIME_PASSES_HEADER
+#define TIME_PASSES_HEADER
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+static const size_t  kMaxTimedPasses     = 64;
+static const size_t  kMaxPassDepth       = 16;
+
+// Inclusive costs of one phase, nested phases are counted in their parent too.
+// The heap delta comes from malloc statistics sampled at the pass boundaries
+// and covers the whole process. Allocations and the peak come from the
+// wrappers the compiler's own malloc calls go through, the peak is the
+// largest live size of those blocks at any moment of the pass.
+struct PassTime
+{
+    const char *name;
+    size_t      depth;
+
+    double      wall_ms;
+    double      cpu_ms;
+
+    uint64_t    allocations;
+
+    int64_t     heap_delta_bytes;
+    int64_t     peak_bytes;
+};
+
+struct PassTimingOptions
+{
+    bool        is_table;
+    const char *json_file_name;
+};
+
+//! Turns the timers and the allocation counting on, before that
+//! BeginPass() and EndPass() do nothing
+void EnablePassTiming();
+
+//! Starts a phase, phases nest like brackets
+void BeginPass(const char *name);
+
+//! Finishes the innermost phase
+void EndPass();
+
+//! Prints the table to stderr and writes the JSON file the options ask for
+void ReportPassTimes(const PassTimingOptions *options,
+                     const char              *tool_name);
+
+#endif
@@ -1,5 +1,10 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
 #include <math.h>
 
 int64_t скажи_мне();
@@ -12,18 +17,247 @@ int64_t это_все_преломления(int64_t value);
 
 int64_t углы_вымеряет(int64_t value);
 
-int64_t скажи_мне()
+double скажи_мне_f64();
+
+int пишу_твоей_матери_f64(double value);
+
+double трент_ультует_f64(double value);
+
+double это_все_преломления_f64(double value);
+
+double углы_вымеряет_f64(double value);
+
+double это_все_преломления_fast(double value);
+
+double углы_вымеряет_fast(double value);
+
+void иди_нахуй();
+
+void dota_profile_start(uint64_t *profile);
+
+// The I/O entry points go through two large buffers drained with plain
+// read()/write() instead of stdio: no per-call locking and no format
+// string parsing. Output is flushed when it fills up, before the program
+// blocks on input, at exit and on abort; on a terminal it is flushed after
+// every value so interactive use looks the same as before.
+
+enum
 {
-    int ret_val = 0;
+    kIOBufferSize     = 1 << 16,
+    kMaxNumberLength  = 64,
+};
+
+struct InputBuffer
+{
+    char   data[kIOBufferSize];
+
+    size_t pos;
+    size_t size;
+
+    int    is_eof;
+};
+
+struct OutputBuffer
+{
+    char   data[kIOBufferSize];
+
+    size_t size;
+
+    int    is_line_buffered;
+};
+
+static struct InputBuffer  input_buffer;
+static struct OutputBuffer output_buffer;
+
+static void FlushOutput()
+{
+    size_t written = 0;
+
+    while (written < output_buffer.size)
+    {
+        ssize_t ret_val = write(STDOUT_FILENO, output_buffer.data + written, output_buffer.size - written);
 
-    scanf("%d", &ret_val);
+        if (ret_val < 0 && errno == EINTR)
+        {
+            continue;
+        }
 
-    return ret_val;
+        if (ret_val <= 0)
+        {
+            break;
+        }
+
+        written += (size_t) ret_val;
+    }
+
+    output_buffer.size = 0;
+}
+
+static void FlushOnAbort(int signal_number)
+{
+    FlushOutput();
+
+    signal(signal_number, SIG_DFL);
+    raise(signal_number);
+}
+
+__attribute__((constructor))
+static void InitRuntimeIO()
+{
+    output_buffer.is_line_buffered = isatty(STDOUT_FILENO);
+
+    atexit(FlushOutput);
+
+    signal(SIGABRT, FlushOnAbort);
+}
+
+static void WriteBytes(const char *bytes, size_t count)
+{
+    if (output_buffer.size + count > kIOBufferSize)
+    {
+        FlushOutput();
+    }
+
+    memcpy(output_buffer.data + output_buffer.size, bytes, count);
+
+    output_buffer.size += count;
+
+    if (output_buffer.is_line_buffered)
+    {
+        FlushOutput();
+    }
+}
+
+static int WriteInt(int64_t value)
+{
+    char  text[kMaxNumberLength] = "";
+    char *end   = text + sizeof(text);
+    char *begin = end;
+
+    *--begin = '\n';
+
+    // negate in unsigned arithmetic so INT64_MIN does not overflow
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+
+    do
+    {
+        *--begin   = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    if (value < 0)
+    {
+        *--begin = '-';
+    }
+
+    WriteBytes(begin, (size_t) (end - begin));
+
+    return (int) (end - begin);
+}
+
+static int PeekChar()
+{
+    if (input_buffer.pos < input_buffer.size)
+    {
+        return (unsigned char) input_buffer.data[input_buffer.pos];
+    }
+
+    if (input_buffer.is_eof)
+    {
+        return EOF;
+    }
+
+    FlushOutput();
+
+    ssize_t ret_val = 0;
+
+    do
+    {
+        ret_val = read(STDIN_FILENO, input_buffer.data, kIOBufferSize);
+    } while (ret_val < 0 && errno == EINTR);
+
+    input_buffer.pos  = 0;
+    input_buffer.size = ret_val > 0 ? (size_t) ret_val : 0;
+
+    if (ret_val <= 0)
+    {
+        input_buffer.is_eof = 1;
+
+        return EOF;
+    }
+
+    return (unsigned char) input_buffer.data[0];
+}
+
+static void SkipSpaces()
+{
+    int symbol = PeekChar();
+
+    while (symbol == ' '  || symbol == '\n' || symbol == '\t' ||
+           symbol == '\r' || symbol == '\v' || symbol == '\f')
+    {
+        input_buffer.pos++;
+
+        symbol = PeekChar();
+    }
+}
+
+// like scanf("%ld") it returns 0 and consumes nothing but spaces when the
+// input does not start with a number
+static int64_t ReadInt()
+{
+    SkipSpaces();
+
+    int is_negative = 0;
+
+    if (PeekChar() == '-' || PeekChar() == '+')
+    {
+        is_negative = PeekChar() == '-';
+
+        input_buffer.pos++;
+    }
+
+    uint64_t magnitude = 0;
+
+    for (int symbol = PeekChar(); symbol >= '0' && symbol <= '9'; symbol = PeekChar())
+    {
+        magnitude = magnitude * 10 + (uint64_t) (symbol - '0');
+
+        input_buffer.pos++;
+    }
+
+    return is_negative ? (int64_t) (0 - magnitude) : (int64_t) magnitude;
+}
+
+static size_t ReadToken(char *token, size_t token_size)
+{
+    SkipSpaces();
+
+    size_t length = 0;
+
+    for (int symbol = PeekChar(); symbol != EOF && symbol > ' '; symbol = PeekChar())
+    {
+        if (length + 1 < token_size)
+        {
+            token[length++] = (char) symbol;
+        }
+
+        input_buffer.pos++;
+    }
+
+    token[length] = '\0';
+
+    return length;
+}
+
+int64_t скажи_мне()
+{
+    return ReadInt();
 }
 
 int пишу_твоей_матери(int64_t value)
 {
-    return printf("%d\n", value);
+    return WriteInt(value);
 }
 
 int64_t трент_ультует(int64_t value)
@@ -40,3 +274,251 @@ int64_t углы_вымеряет(int64_t value)
 {
     return (int64_t) sin((double) value);
 }
+
+double скажи_мне_f64()
+{
+    char token[kMaxNumberLength + 1] = "";
+
+    if (ReadToken(token, sizeof(token)) == 0)
+    {
+        return 0;
+    }
+
+    return strtod(token, NULL);
+}
+
+int пишу_твоей_матери_f64(double value)
+{
+    char text[kMaxNumberLength + 1] = "";
+
+    int length = snprintf(text, sizeof(text), "%.17g\n", value);
+
+    WriteBytes(text, (size_t) length);
+
+    return length;
+}
+
+double трент_ультует_f64(double value)
+{
+    return sqrt(value);
+}
+
+double это_все_преломления_f64(double value)
+{
+    return cos(value);
+}
+
+double углы_вымеряет_f64(double value)
+{
+    return sin(value);
+}
+
+// Fast sin/cos for the backend's --fast-trig mode.
+//
+// The argument is reduced to r in [-pi/4, pi/4] with x = k * pi/2 + r
+// (pi/2 is split in two parts so the reduction stays exact), then sin(r)
+// and cos(r) are evaluated as Taylor polynomials of degree 11 and 12 and
+// the quadrant k picks the result. The absolute error is below 1e-11 for
+// |x| < 1e6; past that the reduction loses bits and results degrade, use
+// the default libm path when that matters. NaN and inf give NaN.
+//
+// The generated code calls these out of line for one value at a time, the
+// gain over libm comes from the cheaper kernel, not from vectorization.
+
+static const double kTwoOverPi = 0.63661977236758134308;
+static const double kPiOver2Hi = 1.57079632673412561417;
+static const double kPiOver2Lo = 6.07710050650619224932e-11;
+
+static inline double SinPolynomial(double r)
+{
+    double r2 = r * r;
+
+    return r + r * r2 * (-1.0 / 6 + r2 * (1.0 / 120 + r2 * (-1.0 / 5040 +
+                         r2 * (1.0 / 362880 + r2 * (-1.0 / 39916800)))));
+}
+
+static inline double CosPolynomial(double r)
+{
+    double r2 = r * r;
+
+    return 1 + r2 * (-1.0 / 2 + r2 * (1.0 / 24 + r2 * (-1.0 / 720 +
+               r2 * (1.0 / 40320 + r2 * (-1.0 / 3628800 + r2 * (1.0 / 479001600))))));
+}
+
+static inline double FastTrigKernel(double value, int64_t quadrant_shift)
+{
+    double  k = nearbyint(value * kTwoOverPi);
+    double  r = (value - k * kPiOver2Hi) - k * kPiOver2Lo;
+
+    int64_t quadrant = ((int64_t) k + quadrant_shift) & 3;
+
+    double  s = SinPolynomial(r);
+    double  c = CosPolynomial(r);
+
+    // quadrant 0: sin, 1: cos, 2: -sin, 3: -cos
+    double  result = (quadrant & 1) ? c : s;
+
+    return (quadrant & 2) ? -result : result;
+}
+
+double углы_вымеряет_fast(double value)
+{
+    return FastTrigKernel(value, 0);
+}
+
+double это_все_преломления_fast(double value)
+{
+    return FastTrigKernel(value, 1);
+}
+
+void иди_нахуй()
+{
+    FlushOutput();
+
+    abort();
+}
+
+// Programs built with --profile pass their .data section here from main:
+// the number of functions, then a call counter and a cycle counter for each
+// of them, the number of branches, then for each ??? and пока the times it
+// was reached and the times its body ran along with the function index, the
+// line and the ordinal of the branch, and at last the function names. The
+// report goes to stderr or to the file named by DOTA_PROFILE: functions
+// sorted by cycles, then branches in the order of the program:
+//
+//     calls cycles cycles_per_call name
+//     branch executions taken line ordinal name
+
+struct ProfileBranch
+{
+    uint64_t executions;
+    uint64_t taken;
+
+    uint32_t function_index;
+    uint32_t line;
+    uint32_t ordinal;
+    uint32_t reserved;
+};
+
+struct ProfileEntry
+{
+    uint64_t    calls;
+    uint64_t    cycles;
+
+    const char *name;
+};
+
+static uint64_t *profile_section;
+
+static int CompareProfileEntries(const void *lhs, const void *rhs)
+{
+    const struct ProfileEntry *lhs_entry = (const struct ProfileEntry *) lhs;
+    const struct ProfileEntry *rhs_entry = (const struct ProfileEntry *) rhs;
+
+    if (lhs_entry->cycles != rhs_entry->cycles)
+    {
+        return lhs_entry->cycles < rhs_entry->cycles ? 1 : -1;
+    }
+
+    return strcmp(lhs_entry->name, rhs_entry->name);
+}
+
+static void WriteProfile()
+{
+    uint64_t function_count = profile_section[0];
+
+    struct ProfileEntry *entries = (struct ProfileEntry *) calloc(function_count + 1, sizeof(struct ProfileEntry));
+
+    if (entries == NULL)
+    {
+        return;
+    }
+
+    const char **names = (const char **) calloc(function_count + 1, sizeof(const char *));
+
+    if (names == NULL)
+    {
+        free(entries);
+
+        return;
+    }
+
+    uint64_t branch_count = profile_section[1 + 2 * function_count];
+
+    const struct ProfileBranch *branches = (const struct ProfileBranch *) (profile_section + 2 + 2 * function_count);
+
+    const char *name = (const char *) (branches + branch_count);
+
+    for (uint64_t i = 0; i < function_count; i++)
+    {
+        entries[i].calls  = profile_section[1 + 2 * i];
+        entries[i].cycles = profile_section[2 + 2 * i];
+        entries[i].name   = name;
+
+        names[i] = name;
+
+        name += strlen(name) + 1;
+    }
+
+    qsort(entries, function_count, sizeof(struct ProfileEntry), CompareProfileEntries);
+
+    const char *file_name = getenv("DOTA_PROFILE");
+
+    FILE *profile_file = file_name != NULL ? fopen(file_name, "w") : stderr;
+
+    if (profile_file == NULL)
+    {
+        profile_file = stderr;
+    }
+
+    fprintf(profile_file, "# calls cycles cycles_per_call function\n");
+
+    for (uint64_t i = 0; i < function_count; i++)
+    {
+        fprintf(profile_file, "%llu %llu %llu %s\n",
+                (unsigned long long) entries[i].calls,
+                (unsigned long long) entries[i].cycles,
+                (unsigned long long) (entries[i].calls != 0 ? entries[i].cycles / entries[i].calls : 0),
+                entries[i].name);
+    }
+
+    if (branch_count > 0)
+    {
+        fprintf(profile_file, "# branch executions taken line ordinal function\n");
+    }
+
+    for (uint64_t i = 0; i < branch_count; i++)
+    {
+        if (branches[i].function_index >= function_count)
+        {
+            continue;
+        }
+
+        fprintf(profile_file, "branch %llu %llu %u %u %s\n",
+                (unsigned long long) branches[i].executions,
+                (unsigned long long) branches[i].taken,
+                branches[i].line,
+                branches[i].ordinal,
+                names[branches[i].function_index]);
+    }
+
+    if (profile_file != stderr)
+    {
+        fclose(profile_file);
+    }
+
+    free(names);
+    free(entries);
+}
+
+void dota_profile_start(uint64_t *profile)
+{
+    if (profile_section != NULL)
+    {
+        return;
+    }
+
+    profile_section = profile;
+
+    atexit(WriteProfile);
+}